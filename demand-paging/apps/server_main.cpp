@@ -1,7 +1,7 @@
 #include "server.h"
 
-void RunServer() {
-  LockingServiceImpl service;
+void RunServer(LockConflictPolicy conflictPolicy) {
+  LockingServiceImpl service(conflictPolicy);
 
   ServerBuilder builder;
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
@@ -14,6 +14,14 @@ void RunServer() {
 
 auto main(int argc, char** argv) -> int {
   spdlog::set_level(spdlog::level::info);
-  RunServer();
+
+  // With --wait-die, older transactions wait for conflicting locks
+  LockConflictPolicy conflictPolicy = NO_WAIT;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--wait-die") {
+      conflictPolicy = WAIT_DIE;
+    }
+  }
+  RunServer(conflictPolicy);
   return 0;
 }
\ No newline at end of file
@@ -6,10 +6,20 @@
  * This struct is used either as a transaction table, where the keys
  * resemble the TXIDs and the value the transaction structs or a lock table,
  * with RIDs as keys and lock structs as values.
+ *
+ * The number of buckets follows the number of entries: when the table is
+ * resized, the entries are moved from old_table into table a few buckets at a
+ * time on each following set and remove, so that no single operation has to
+ * rehash the whole table.
  */
 typedef struct {
   int size;
   struct Entry** table;
+  int min_size;              // the table never shrinks below its initial size
+  int num_entries;           // number of entries in table and old_table
+  int old_size;              // number of buckets of old_table
+  int rehash_index;          // next bucket of old_table to migrate
+  struct Entry** old_table;  // buckets left to migrate while resizing
 } HashTable;
 
 typedef struct Entry Entry;  // Required to use C++ structs as C structs
@@ -19,7 +29,21 @@ struct Entry {
   struct Entry* next;
 };
 
-enum Command { SHARED, EXCLUSIVE, UNLOCK, QUIT, REGISTER };
+enum Command {
+  SHARED,
+  EXCLUSIVE,
+  UNLOCK,
+  QUIT,
+  REGISTER,
+  RELEASE  // drops the lock and requests of an aborted transaction
+};
+
+// How a lock request is handled, that conflicts with the lock of another
+// transaction
+enum LockConflictPolicy {
+  NO_WAIT,  // the request fails and the transaction is aborted
+  WAIT_DIE  // an older transaction waits for the lock, a younger one aborts
+};
 
 struct Job {
   enum Command command;
@@ -35,8 +59,8 @@ typedef struct Job Job;  // Required to use C++ structs as C structs
 
 struct Arg {
   int num_threads;
-  int tx_thread_id;
   int transaction_table_size;
   int lock_table_size;
+  enum LockConflictPolicy conflict_policy;
 };
 typedef struct Arg Arg;  // Required to use C++ structs as C structs
\ No newline at end of file
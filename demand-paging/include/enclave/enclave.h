@@ -7,6 +7,7 @@
 
 #include <cstring>
 #include <queue>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -21,11 +22,36 @@
 #include "sgx_tseal.h"
 #include "transaction.h"
 
-// Holds the transaction objects of the currently active transactions
-HashTable *transactionTable_;
+/**
+ * A part of the transaction table with the mutex, that synchronizes access on
+ * it and on the transactions in it. Every shard starts on its own cache line.
+ */
+struct TransactionTableShard {
+  alignas(64) HashTable *transactions;
+  sgx_thread_mutex_t mutex;
+};
+
+// Holds the transaction objects of the currently active transactions, split by
+// transaction ID into one shard per worker thread, see getTransactionShard().
+// A transaction is shared by all worker threads whose lock tables contain one
+// of its locks, which only read or modify it, i.e. its lock budget, its locks
+// and its phase, while they hold the mutex of its shard.
+TransactionTableShard *transactionTable_;
+
+// Keeps track of a lock object for each row ID. Every worker thread has its own
+// lock table, so that it can resize it without synchronization.
+std::vector<HashTable *> lockTables_;
+
+// For each worker thread, the rows of its lock table released by its current
+// job, whose waiting requests may be granted now
+std::vector<std::vector<unsigned int>> releasedRows_;
 
-// Keeps track of a lock object for each row ID
-HashTable *lockTable_;
+// How a lock request ended, when a worker thread processed it
+enum LockRequestResult {
+  REQUEST_GRANTED,
+  REQUEST_DENIED,  // the transaction was aborted
+  REQUEST_WAITING  // finished later, when the lock is granted
+};
 
 // Public private key pair for signing lock requests
 sgx_ec256_private_t ec256_private_key;
@@ -70,8 +96,8 @@ void enclave_send_job(void *data);
  * from its associated job queue in a loop and executes it, e.g. acquiring a
  * shared lock for a specific row. Each row gets assigned a specific thread
  * evenly, so no synchronization is necessary when accessing the underlying lock
- * table. The transaction table is accessed by only one single thread for all
- * requests to register a transaction.
+ * table. Requests to register a transaction go to the thread owning its shard
+ * of the transaction table.
  */
 void enclave_process_request();
 
@@ -128,6 +154,15 @@ auto verify(const char *message, void *signature, size_t sig_len) -> int;
  */
 auto ecdsa_close() -> int;
 
+/**
+ * Returns the shard of the transaction table, that holds the transaction.
+ *
+ * @param transactionId identifies the transaction
+ * @returns the shard
+ */
+auto get_transaction_shard(unsigned int transactionId)
+    -> TransactionTableShard &;
+
 /**
  * Registers the transaction at the enclave prior to being able to
  * acquire any locks, so that the enclave can now the transaction's lock
@@ -136,44 +171,124 @@ auto ecdsa_close() -> int;
  * @param transactionId identifies the transaction
  * @param lockBudget maximum number of locks the transaction is allowed to
  * acquire
+ * @returns false, when the transaction is already registered
  */
-int register_transaction(unsigned int transactionId, unsigned int lockBudget);
+auto register_transaction(unsigned int transactionId, unsigned int lockBudget)
+    -> bool;
 
 /**
  * Acquires a lock for the specified row and writes the signature into the
- * provided buffer.
+ * provided buffer. A request, that conflicts with the lock of another
+ * transaction or with a request waiting for it, waits under WAIT_DIE, if
+ * mayWait() allows it.
  *
  * @param signature buffer where the enclave will store the signature
- * @param sig_len length of the buffer
- * @param transactionId identifies the transaction making the request
- * @param rowId identifies the row to be locked
- * @param requestedMode either shared for concurrent read access or exclusive
- * for sole write access
+ * @param job the SHARED or EXCLUSIVE job with the transaction ID, the row ID
+ * and the lock budget. If not 0, the lock budget registers the transaction,
+ * when it is not registered yet. Since a failed request aborts the
+ * transaction, it is only kept, if it gets the lock or waits for it.
  * @param threadId the context for signing locks is exclusive for each thread,
  * therefore we need to know the calling thread's ID
- * @returns SGX_ERROR_UNEXPCTED, when transaction did not call
- * RegisterTransaction before or the given lock mode is unknown or when the
- * transaction makes a request for a look, that it already owns, makes a
- * request for a lock while in the shrinking phase, or when the lock budget is
- * exhausted
+ * @returns REQUEST_DENIED, when transaction did not call
+ * RegisterTransaction before or when the transaction makes a request for a
+ * look, that it already owns, makes a request for a lock while in the
+ * shrinking phase, when the lock budget is exhausted or the request conflicts
+ * and does not wait. REQUEST_WAITING, when the job was queued at the lock and
+ * grant_waiters() finishes it later.
+ */
+auto acquire_lock(void *signature, const Job &job, int threadId)
+    -> LockRequestResult;
+
+/**
+ * Signs the lock tuple of a granted lock.
+ *
+ * @param signature buffer where the enclave will store the signature
+ * @param transactionId identifies the transaction, that got the lock
+ * @param rowId identifies the locked row
+ * @param isExclusive if the lock is exclusive or shared
+ * @param threadId the calling thread, whose context is used for signing
+ */
+void sign_lock(void *signature, unsigned int transactionId, unsigned int rowId,
+               bool isExclusive, int threadId);
+
+/**
+ * Writes the base64 encoded signature or the error into the result of a
+ * SHARED or EXCLUSIVE job and marks it finished, if its caller waits for it.
+ *
+ * @param job the job
+ * @param signature the signature of the granted lock or nullptr, if the lock
+ * was not granted
  */
-auto acquire_lock(void *signature, unsigned int transactionId,
-                  unsigned int rowId, bool isExclusive, int threadId) -> bool;
+void finish_lock_job(const Job &job, sgx_ec256_signature_t *signature);
+
+/**
+ * Grants the requests waiting for the rows released by the current job of the
+ * worker thread in their order, as long as they do not conflict, and finishes
+ * their jobs. A request of a transaction, that was aborted meanwhile, fails.
+ *
+ * @param threadId the worker thread, whose lock table holds the rows
+ */
+void grant_waiters(int threadId);
+
+/**
+ * Releases the lock of a row in the lock table of the calling worker thread
+ * for a transaction, that was already removed from the transaction table.
+ * Deletes the lock, if nobody owns or waits for it anymore.
+ *
+ * @param threadId the worker thread, whose lock table holds the row
+ * @param transactionId identifies the transaction
+ * @param rowId identifies the row to be released
+ */
+void release_row(int threadId, unsigned int transactionId, unsigned int rowId);
+
+/**
+ * Fails the requests of an aborted transaction, that wait for the lock of a row
+ * in the lock table of the calling worker thread, and finishes their jobs.
+ *
+ * @param threadId the worker thread, whose lock table holds the row
+ * @param transactionId identifies the aborted transaction
+ * @param rowId identifies the row, whose lock the requests wait for
+ */
+void drop_waiters(int threadId, unsigned int transactionId,
+                  unsigned int rowId);
 
 /**
  * Releases a lock for the specified row.
  *
  * @param transactionId identifies the transaction making the request
  * @param rowId identifies the row to be released
+ * @returns false, when the transaction did not own the lock
  */
-void release_lock(unsigned int transactionId, unsigned int rowId);
+auto release_lock(unsigned int transactionId, unsigned int rowId) -> bool;
 
 /**
- * Releases all locks the given transaction currently has.
+ * Releases all locks the given transaction currently has, drops its waiting
+ * requests and removes it from the transaction table. Needs to hold the mutex
+ * of the transaction's shard.
+ * The locks in the lock tables of other worker threads are released by them,
+ * with RELEASE jobs.
  *
  * @param transaction the transaction to be aborted
+ * @param threadId the calling worker thread
+ */
+void abort_transaction(Transaction *transaction, int threadId);
+
+/**
+ * Determines the worker thread responsible for the given row ID. It only
+ * depends on the initial lock table size, so that a row keeps its worker thread
+ * while the lock tables are resized.
+ *
+ * @param rowId the row ID
+ * @returns the ID of the worker thread
+ */
+auto get_worker_thread(unsigned int rowId) -> int;
+
+/**
+ * Returns the lock table of the worker thread responsible for the row ID.
+ *
+ * @param rowId the row ID
  */
-void abort_transaction(Transaction *transaction);
+auto get_lock_table(unsigned int rowId) -> HashTable *;
 
 /**
  * @returns the block timeout, which resembles a future block number of the
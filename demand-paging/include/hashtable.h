@@ -6,6 +6,18 @@
 #include "lock.h"
 #include "transaction.h"
 
+// The table doubles its number of buckets, when it holds more than this many
+// entries per bucket on average
+const float kHashTableMaxLoadFactor = 2;
+
+// The table halves its number of buckets, when it holds less than this many
+// entries per bucket on average, but never shrinks below its initial size
+const float kHashTableMinLoadFactor = 0.125;
+
+// Number of buckets of the old table, whose entries are migrated per set and
+// remove while the table is being resized
+const int kHashTableRehashStep = 4;
+
 HashTable* newHashTable(int size);
 
 Entry* newEntry(int key, void* value);
@@ -73,4 +85,30 @@ auto contains(HashTable* hashTable, int key) -> bool;
  * operation on
  * @param key TXID or RID
  */
-void remove(HashTable* hashTable, int key);
\ No newline at end of file
+void remove(HashTable* hashTable, int key);
+
+/**
+ * Checks if the entries of the hashtable are currently being migrated into a
+ * resized table.
+ *
+ * @param hashTable either the lock or transaction table
+ */
+auto isRehashing(HashTable* hashTable) -> bool;
+
+/**
+ * Migrates the entries of the next kHashTableRehashStep buckets of the old
+ * table into the current one and frees the old table once all of its buckets
+ * are migrated. Does nothing, when the hashtable is not being resized.
+ *
+ * @param hashTable either the lock or transaction table
+ */
+void rehashStep(HashTable* hashTable);
+
+/**
+ * Starts to grow or shrink the hashtable, when its load factor left the range
+ * between kHashTableMinLoadFactor and kHashTableMaxLoadFactor. Only one resize
+ * can be in progress at a time.
+ *
+ * @param hashTable either the lock or transaction table
+ */
+void resizeIfNeeded(HashTable* hashTable);
\ No newline at end of file
@@ -1,21 +1,34 @@
 #pragma once
 
 #include <cstring>
+#include <list>
 #include <mutex>
 #include <set>
 #include <stdexcept>
 
+#include "common.h"
+
 using std::memcpy;
 
 const int kTransactionBudget = 200;
 
 /**
- * The internal representation of a lock for the lock manager.
+ * A lock request, that waits for the lock to become free.
+ */
+struct LockWaiter {
+  Job job;       // the SHARED or EXCLUSIVE job, finished once it is granted
+  bool upgrade;  // the transaction holds the lock shared and wants it exclusive
+};
+
+/**
+ * The internal representation of a lock for the lock manager. The requests
+ * waiting for the lock are granted in the order they arrived.
  */
 struct Lock {
   bool exclusive;
   int* owners;
   int owners_size;
+  std::list<LockWaiter> waiters;  // allocates nothing, while nobody waits
 };
 typedef struct Lock Lock;
 
@@ -58,4 +71,26 @@ void release(Lock* lock, int transactionId);
  * @throws std::domain_error, if some other transaction currently still has
  * shared access to the lock
  */
-auto upgrade(Lock* lock, int transactionId) -> bool;
\ No newline at end of file
+auto upgrade(Lock* lock, int transactionId) -> bool;
+
+/**
+ * Decides by wait-die, if a transaction may wait for a lock, that it cannot
+ * get right away. A transaction is older than another one, if its ID is
+ * smaller. It may only wait, if it is older than every other owner and every
+ * waiter of the lock, so that no transaction ever waits for an older one and
+ * no deadlock can occur. Otherwise it dies.
+ *
+ * @param lock the lock the operation is executed on
+ * @param transactionId ID of the transaction, that wants to acquire the lock
+ * @returns true, if the transaction may wait
+ */
+auto mayWait(Lock* lock, int transactionId) -> bool;
+
+/**
+ * Checks, if a waiting lock request can be granted now.
+ *
+ * @param lock the lock the operation is executed on
+ * @param waiter the waiting request
+ * @returns true, if the lock is free for the request
+ */
+auto isGrantable(Lock* lock, const LockWaiter& waiter) -> bool;
\ No newline at end of file
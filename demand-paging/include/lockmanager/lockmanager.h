@@ -54,6 +54,69 @@ void print_warn(const char *str);
 void print_debug(const char *str);
 //================================================================
 
+/**
+ * Untrusted memory, into which the enclave writes the result of an
+ * asynchronous job.
+ */
+struct JobResult {
+  volatile bool finished;
+  volatile bool error;
+  volatile char return_value[SIGNATURE_SIZE];
+};
+
+/**
+ * The pending result of a job submitted with LockManager::lockAsync() or
+ * LockManager::unlockAsync(). The enclave writes the result into untrusted
+ * memory owned by the future, once a worker thread finished the job, so a
+ * caller can keep many jobs in flight and collect their results in any order.
+ * A future must not outlive its lock manager.
+ */
+class JobFuture {
+ public:
+  JobFuture(JobFuture &&other) noexcept;
+  auto operator=(JobFuture &&other) noexcept -> JobFuture &;
+  JobFuture(const JobFuture &) = delete;
+  auto operator=(const JobFuture &) -> JobFuture & = delete;
+
+  /**
+   * Waits for the job, unless its result was collected, since the enclave
+   * might still write into its memory.
+   */
+  ~JobFuture();
+
+  /**
+   * Checks without blocking, if the enclave finished the job.
+   *
+   * @returns true, when get() returns without waiting
+   */
+  auto isReady() -> bool;
+
+  /**
+   * Waits until the enclave finished the job and collects its result. Can only
+   * be called once.
+   *
+   * @returns the signature, if it was a lock request, and if the job was
+   * successful, like LockManager::lock() does
+   * @throws std::logic_error, when the result was already collected
+   */
+  auto get() -> std::pair<std::string, bool>;
+
+ private:
+  friend class LockManager;
+
+  JobFuture(Command command);
+
+  /**
+   * Waits for the job and frees the memory of its result.
+   *
+   * @returns the result like get() does
+   */
+  auto collect() -> std::pair<std::string, bool>;
+
+  Command command;
+  JobResult *result;  // nullptr, once the result was collected
+};
+
 /**
  * Process lock and unlock requests from the server. It manages a lock table,
  * where for each row ID it can store the corresponding lock object, which
@@ -71,8 +134,11 @@ class LockManager {
    * Initializes the enclave and seals the public and private key for signing.
    *
    * @param numWorkerThreads the number of threads that work on the lock table
+   * @param conflictPolicy how a lock request is handled, that conflicts with
+   * the lock of another transaction
    */
-  LockManager(int numWorkerThreads = 1);
+  LockManager(int numWorkerThreads = 1,
+              LockConflictPolicy conflictPolicy = NO_WAIT);
 
   /**
    * Destroys the enclave.
@@ -100,14 +166,19 @@ class LockManager {
    * @param isExclusive either shared for concurrent read access or exclusive
    * for sole write access
    * @param waitForResult parameter forwarded to create_job function
+   * @param lockBudget if not 0, the enclave registers the transaction with this
+   * lock budget together with granting the lock, when it is not registered
+   * yet. This saves the synchronous registerTransaction() call.
    * @returns the signature for the acquired lock and true or
    * no signature and false, when transaction was not registered before or when
    * the transaction makes a request for a look that it already owns, makes a
    * request for a lock while in the shrinking phase, or when the lock budget is
-   * exhausted
+   * exhausted. Under WAIT_DIE, a request conflicting with the lock of a
+   * younger transaction does not return, until the lock is granted.
    */
   auto lock(unsigned int transactionId, unsigned int rowId, bool isExclusive,
-            bool waitForResult = true) -> std::pair<std::string, bool>;
+            bool waitForResult = true, unsigned int lockBudget = 0)
+      -> std::pair<std::string, bool>;
 
   /**
    * Releases a lock for the specified row
@@ -120,6 +191,34 @@ class LockManager {
   void unlock(unsigned int transactionId, unsigned int rowId,
               bool waitForResult = false);
 
+  /**
+   * Requests a lock for the specified row without waiting for the result. The
+   * calling thread can submit further requests, while the enclave works on
+   * this one.
+   *
+   * @param transactionId identifies the transaction making the request
+   * @param rowId identifies the row to be locked
+   * @param isExclusive either shared for concurrent read access or exclusive
+   * for sole write access
+   * @param lockBudget registers the transaction, if not 0, see lock()
+   * @returns the future, which delivers the signature and if the lock was
+   * granted, once the enclave finished the request
+   */
+  auto lockAsync(unsigned int transactionId, unsigned int rowId,
+                 bool isExclusive, unsigned int lockBudget = 0) -> JobFuture;
+
+  /**
+   * Releases a lock for the specified row without waiting for the result.
+   * Unlike unlock() without waiting, the returned future reports, if the
+   * transaction owned the lock.
+   *
+   * @param transactionId identifies the transaction making the request
+   * @param rowId identifies the row to be released
+   * @returns the future, which delivers if the lock was released
+   */
+  auto unlockAsync(unsigned int transactionId, unsigned int rowId)
+      -> JobFuture;
+
   /**
    * This function is just for testing, to demonstrate that signatures created
    * on lock requests are valid.
@@ -172,8 +271,10 @@ class LockManager {
    * Initializes the configuration parameters for the enclave
    *
    * @param numWorkerThreads the number of threads that work on the lock table
+   * @param conflictPolicy see LockManager()
    */
-  void configuration_init(int numWorkerThreads);
+  void configuration_init(int numWorkerThreads,
+                          LockConflictPolicy conflictPolicy);
 
   /**
    * Creates a job and sends it to the enclave to get it processed by an enclave
@@ -182,7 +283,7 @@ class LockManager {
    * @param command SHARED, EXCLUSIVE, REGISTER or QUIT
    * @param transaction_id additional argument for SHARED, EXCLUSIVE or REGISTER
    * @param row_id additional argument for SHARED or EXCLUSIVE
-   * @param lock_budget additional argument for REGISTER
+   * @param lock_budget additional argument for REGISTER, SHARED or EXCLUSIVE
    * @param waitForResult if the function should wait for return values to be
    * set or immediately return
    * @returns a pair containing a boolean, that is true when the job was
@@ -194,6 +295,20 @@ class LockManager {
                           bool waitForResult = true)
       -> std::pair<std::string, bool>;
 
+  /**
+   * Sends a job to the enclave with the memory for its result, which is kept
+   * until the returned future collects the result.
+   *
+   * @param command SHARED, EXCLUSIVE or UNLOCK
+   * @param transaction_id identifies the transaction making the request
+   * @param row_id identifies the row
+   * @param lock_budget additional argument for SHARED or EXCLUSIVE
+   * @returns the future of the job
+   */
+  auto create_async_enclave_job(Command command, unsigned int transaction_id,
+                                unsigned int row_id, unsigned int lock_budget)
+      -> JobFuture;
+
   Arg arg;  // configuration parameters for the enclave
   pthread_t
       *threads;  // worker threads that execute requests inside the enclave
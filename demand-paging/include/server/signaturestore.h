@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lockmanager.h"
+
+// Number of lock requests, whose signatures the store keeps at most
+const size_t kSignatureStoreCapacity = 65536;
+
+// How long the store keeps a signature, which was not collected
+const std::chrono::seconds kSignatureTimeout(30);
+
+/**
+ * The result of a lock request, which did not wait for its signature.
+ */
+struct CollectedSignature {
+  uint64_t ticket;  // handed out, when the request was made
+  unsigned int rowId;
+  bool isExclusive;
+  bool ok;                // if the lock was granted
+  std::string signature;  // the signature of the lock, if it was granted
+};
+
+/**
+ * Keeps the lock requests, whose callers did not wait for the signature, until
+ * their transaction collects the results. Every request gets a ticket, which
+ * identifies its result. The store is bounded: results, which were not
+ * collected within the timeout, are dropped, and no request is accepted, while
+ * the store is full.
+ */
+class SignatureStore {
+ public:
+  /**
+   * @param capacity the number of requests the store keeps at most
+   * @param timeout how long a result is kept without being collected
+   */
+  SignatureStore(size_t capacity = kSignatureStoreCapacity,
+                 std::chrono::milliseconds timeout = kSignatureTimeout);
+
+  /**
+   * Keeps the pending result of a lock request.
+   *
+   * @param transactionId the transaction that made the request
+   * @param rowId the row to be locked
+   * @param isExclusive the mode of the requested lock
+   * @param future the pending result
+   * @returns the ticket of the request, or 0, when the store is full and the
+   * future was not taken
+   */
+  auto add(unsigned int transactionId, unsigned int rowId, bool isExclusive,
+           JobFuture &future) -> uint64_t;
+
+  /**
+   * Waits for the pending results of a transaction and removes them from the
+   * store.
+   *
+   * @param transactionId identifies the transaction
+   * @returns the results in the order the requests were made
+   */
+  auto collect(unsigned int transactionId) -> std::vector<CollectedSignature>;
+
+  /**
+   * @returns the number of results the store keeps right now
+   */
+  auto size() -> size_t;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct PendingSignature {
+    unsigned int transactionId;
+    unsigned int rowId;
+    bool isExclusive;
+    Clock::time_point deadline;
+    JobFuture future;
+  };
+
+  /**
+   * Drops the results, whose deadline passed. Needs to hold the mutex.
+   *
+   * @param now the current time
+   */
+  void expire(Clock::time_point now);
+
+  size_t capacity;
+  std::chrono::milliseconds timeout;
+  std::mutex mutex;  // synchronizes access on all members below
+  uint64_t nextTicket = 1;
+
+  // The pending results by their ticket. Since every result is kept equally
+  // long, the one added first is the one to expire first.
+  std::map<uint64_t, PendingSignature> pending;
+
+  // The tickets of the pending results of each transaction in ascending order
+  std::unordered_map<unsigned int, std::deque<uint64_t>> tickets;
+};
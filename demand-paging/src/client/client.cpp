@@ -28,7 +28,8 @@ auto LockingServiceClient::registerTransaction(unsigned int transactionId,
 
 auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
                                              unsigned int rowId,
-                                             bool waitForSignature)
+                                             bool waitForSignature,
+                                             unsigned int lockBudget)
     -> std::string {
   if (transactionId == 0 || rowId == 0) {
     spdlog::error("Cannot acquire lock for TXID 0 or RID 0");
@@ -42,6 +43,7 @@ auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
   request.set_transaction_id(transactionId);
   request.set_row_id(rowId);
   request.set_wait_for_signature(waitForSignature);
+  request.set_lock_budget(lockBudget);
 
   LockResponse response;
   ClientContext context;
@@ -61,7 +63,8 @@ auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
 
 auto LockingServiceClient::requestExclusiveLock(unsigned int transactionId,
                                                 unsigned int rowId,
-                                                bool waitForSignature)
+                                                bool waitForSignature,
+                                                unsigned int lockBudget)
     -> std::string {
   if (transactionId == 0 || rowId == 0) {
     spdlog::error("Cannot acquire lock for TXID 0 or RID 0");
@@ -75,6 +78,7 @@ auto LockingServiceClient::requestExclusiveLock(unsigned int transactionId,
   request.set_transaction_id(transactionId);
   request.set_row_id(rowId);
   request.set_wait_for_signature(waitForSignature);
+  request.set_lock_budget(lockBudget);
 
   LockResponse response;
   ClientContext context;
@@ -114,4 +118,25 @@ auto LockingServiceClient::requestUnlock(unsigned int transactionId,
   Status status = stub_->Unlock(&context, request, &response);
 
   return status.ok();
-}
\ No newline at end of file
+}
+
+auto LockingServiceClient::collectSignatures(unsigned int transactionId)
+    -> std::vector<CollectResponse::Result> {
+  spdlog::info("Collecting the signatures of transaction " +
+               std::to_string(transactionId));
+  CollectRequest request;
+  request.set_transaction_id(transactionId);
+
+  CollectResponse response;
+  ClientContext context;
+
+  Status status = stub_->CollectSignatures(&context, request, &response);
+
+  std::vector<CollectResponse::Result> results;
+  if (!status.ok()) {
+    spdlog::error("Collecting signatures failed");
+    return results;
+  }
+  results.assign(response.results().begin(), response.results().end());
+  return results;
+}
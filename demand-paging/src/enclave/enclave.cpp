@@ -4,7 +4,6 @@ Arg arg_enclave;  // configuration parameters for the enclave
 int num = 0;      // global variable used to give every thread a unique ID
 sgx_thread_mutex_t global_num_mutex;    // synchronizes access to num
 sgx_thread_mutex_t *queue_mutex;        // synchronizes access to the job queue
-sgx_thread_mutex_t *transaction_mutex;  // synchronizes access to transactions
 sgx_thread_cond_t *job_cond;            // wakes up worker threads when a
                                         // new job is available
 std::vector<std::queue<Job>> queue;     // a job queue for each worker thread
@@ -13,8 +12,18 @@ sgx_ecc_state_handle_t *contexts;       // context for signing for each thread
 void enclave_init_values(Arg arg) {
   // Get configuration parameters
   arg_enclave = arg;
-  transactionTable_ = newHashTable(arg.transaction_table_size);
-  lockTable_ = newHashTable(arg.lock_table_size);
+  transactionTable_ = new TransactionTableShard[arg.num_threads];
+  for (int i = 0; i < arg.num_threads; i++) {
+    transactionTable_[i].transactions =
+        newHashTable(arg.transaction_table_size / arg.num_threads + 1);
+    sgx_thread_mutex_init(&transactionTable_[i].mutex, NULL);
+  }
+  // The initial lock table size is split among the worker threads
+  for (int i = 0; i < arg.num_threads - 1; i++) {
+    lockTables_.push_back(
+        newHashTable(arg.lock_table_size / (arg.num_threads - 1) + 1));
+  }
+  releasedRows_.resize(arg.num_threads);
 
   // Initialize mutex variables
   sgx_thread_mutex_init(&global_num_mutex, NULL);
@@ -22,14 +31,6 @@ void enclave_init_values(Arg arg) {
                                              arg_enclave.num_threads);
   job_cond = (sgx_thread_cond_t *)malloc(sizeof(sgx_thread_cond_t) *
                                          arg_enclave.num_threads);
-  transaction_mutex = (sgx_thread_mutex_t *)malloc(sizeof(sgx_thread_mutex_t) *
-                                                   kTransactionBudget);
-
-  for (int i = 0; i < kTransactionBudget; i++) {
-    sgx_thread_mutex_init(&transaction_mutex[i],
-                          NULL);  // assumes the transaction IDs to be in the
-                                  // range 1 - kTransactionBudget
-  }
 
   // Initialize job queues and signing context
   contexts = (sgx_ecc_state_handle_t *)malloc(arg_enclave.num_threads *
@@ -64,6 +65,7 @@ void enclave_send_job(void *data) {
       // Copy job parameters
       new_job.transaction_id = ((Job *)data)->transaction_id;
       new_job.row_id = ((Job *)data)->row_id;
+      new_job.lock_budget = command != UNLOCK ? ((Job *)data)->lock_budget : 0;
       new_job.wait_for_result = ((Job *)data)->wait_for_result;
 
       if (new_job.wait_for_result) {
@@ -72,8 +74,15 @@ void enclave_send_job(void *data) {
         new_job.error = ((Job *)data)->error;
       }
 
-      // If transaction is not registered, abort the request
-      if (get(transactionTable_, new_job.transaction_id) == nullptr) {
+      // If transaction is not registered, abort the request. A lock request
+      // with a lock budget registers the transaction itself.
+      TransactionTableShard &shard =
+          get_transaction_shard(new_job.transaction_id);
+      sgx_thread_mutex_lock(&shard.mutex);
+      bool registered = new_job.lock_budget > 0 ||
+                        contains(shard.transactions, new_job.transaction_id);
+      sgx_thread_mutex_unlock(&shard.mutex);
+      if (!registered) {
         print_error("Need to register transaction before lock requests");
         if (new_job.wait_for_result) {
           *new_job.error = true;
@@ -83,9 +92,7 @@ void enclave_send_job(void *data) {
       }
 
       // Send the requests to specific worker thread
-      int thread_id =
-          (int)((new_job.row_id % lockTable_->size) /
-                ((float)lockTable_->size / (arg_enclave.num_threads - 1)));
+      int thread_id = get_worker_thread(new_job.row_id);
       sgx_thread_mutex_lock(&queue_mutex[thread_id]);
       queue[thread_id].push(new_job);
       sgx_thread_cond_signal(&job_cond[thread_id]);
@@ -99,11 +106,14 @@ void enclave_send_job(void *data) {
       new_job.finished = ((Job *)data)->finished;
       new_job.error = ((Job *)data)->error;
 
-      // Send the requests to thread responsible for registering transactions
-      sgx_thread_mutex_lock(&queue_mutex[arg_enclave.tx_thread_id]);
-      queue[arg_enclave.tx_thread_id].push(new_job);
-      sgx_thread_cond_signal(&job_cond[arg_enclave.tx_thread_id]);
-      sgx_thread_mutex_unlock(&queue_mutex[arg_enclave.tx_thread_id]);
+      // Send the requests to the worker thread owning the shard of the
+      // transaction table the transaction belongs to
+      int thread_id =
+          getTransactionShard(new_job.transaction_id, arg_enclave.num_threads);
+      sgx_thread_mutex_lock(&queue_mutex[thread_id]);
+      queue[thread_id].push(new_job);
+      sgx_thread_cond_signal(&job_cond[thread_id]);
+      sgx_thread_mutex_unlock(&queue_mutex[thread_id]);
       break;
     }
     default:
@@ -164,25 +174,11 @@ void enclave_process_request() {
 
         // Acquire lock and receive signature
         sgx_ec256_signature_t sig;
-        bool ok = acquire_lock((void *)&sig, cur_job.transaction_id,
-                               cur_job.row_id, command == EXCLUSIVE, thread_id);
-        if (cur_job.wait_for_result) {
-          if (!ok) {
-            *cur_job.error = true;
-          } else {
-            // Write base64 encoded signature into the return value of the job
-            // struct
-            std::string encoded_signature =
-                base64_encode((unsigned char *)sig.x, sizeof(sig.x)) + "-" +
-                base64_encode((unsigned char *)sig.y, sizeof(sig.y));
-
-            volatile char *p = cur_job.return_value;
-            size_t signature_size = 89;
-            for (int i = 0; i < signature_size; i++) {
-              *p++ = encoded_signature.c_str()[i];
-            }
-          }
-          *cur_job.finished = true;
+        LockRequestResult result =
+            acquire_lock((void *)&sig, cur_job, thread_id);
+        if (result != REQUEST_WAITING) {
+          finish_lock_job(cur_job,
+                          result == REQUEST_GRANTED ? &sig : nullptr);
         }
         break;
       }
@@ -191,12 +187,19 @@ void enclave_process_request() {
                     ", RID: " + std::to_string(cur_job.row_id))
                        .c_str();
         print_debug(log);
-        release_lock(cur_job.transaction_id, cur_job.row_id);
+        bool released = release_lock(cur_job.transaction_id, cur_job.row_id);
         if (cur_job.wait_for_result) {
+          if (!released) {
+            *cur_job.error = true;
+          }
           *cur_job.finished = true;
         }
         break;
       }
+      case RELEASE:
+        drop_waiters(thread_id, cur_job.transaction_id, cur_job.row_id);
+        release_row(thread_id, cur_job.transaction_id, cur_job.row_id);
+        break;
       case REGISTER: {
         auto transactionId = cur_job.transaction_id;
         auto lockBudget = cur_job.lock_budget;
@@ -205,12 +208,8 @@ void enclave_process_request() {
                        .c_str();
         print_debug(log);
 
-        if (contains(transactionTable_, transactionId)) {
-          print_error("Transaction is already registered");
+        if (!register_transaction(transactionId, lockBudget)) {
           *cur_job.error = true;
-        } else {
-          set(transactionTable_, transactionId,
-              (void *)newTransaction(transactionId, lockBudget));
         }
         *cur_job.finished = true;
         break;
@@ -219,6 +218,9 @@ void enclave_process_request() {
         print_error("Worker received unknown command");
     }
 
+    // The job may have released locks, which others wait for
+    grant_waiters(thread_id);
+
     sgx_thread_mutex_lock(&queue_mutex[thread_id]);
     queue[thread_id].pop();
   }
@@ -314,22 +316,59 @@ auto verify(const char *message, void *signature, size_t sig_len) -> int {
   return res;
 }
 
-auto acquire_lock(void *signature, unsigned int transactionId,
-                  unsigned int rowId, bool isExclusive, int threadId) -> bool {
-  bool ok;
+auto get_transaction_shard(unsigned int transactionId)
+    -> TransactionTableShard & {
+  return transactionTable_[getTransactionShard(transactionId,
+                                               arg_enclave.num_threads)];
+}
+
+auto register_transaction(unsigned int transactionId, unsigned int lockBudget)
+    -> bool {
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  sgx_thread_mutex_lock(&shard.mutex);
+  bool registered = contains(shard.transactions, transactionId);
+  if (!registered) {
+    set(shard.transactions, transactionId,
+        (void *)newTransaction(transactionId, lockBudget));
+  }
+  sgx_thread_mutex_unlock(&shard.mutex);
+
+  if (registered) {
+    print_error("Transaction is already registered");
+  }
+  return !registered;
+}
 
-  // Get the transaction object for the given transaction ID
-  auto transaction = (Transaction *)get(transactionTable_, transactionId);
+auto acquire_lock(void *signature, const Job &job, int threadId)
+    -> LockRequestResult {
+  unsigned int transactionId = job.transaction_id;
+  unsigned int rowId = job.row_id;
+  bool isExclusive = job.command == EXCLUSIVE;
+  bool isUpgrade;
+
+  // Get the transaction object for the given transaction ID and keep its shard
+  // locked, until the transaction is updated or aborted
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  sgx_thread_mutex_lock(&shard.mutex);
+  auto transaction = (Transaction *)get(shard.transactions, transactionId);
+  if (transaction == nullptr && job.lock_budget > 0) {
+    // Register the transaction together with its first lock. Since the mutex
+    // of the shard is held, no other worker thread can register it meanwhile.
+    transaction = newTransaction(transactionId, job.lock_budget);
+    set(shard.transactions, transactionId, (void *)transaction);
+  }
   if (transaction == nullptr) {
+    sgx_thread_mutex_unlock(&shard.mutex);
     print_error("Transaction was not registered");
-    return false;
+    return REQUEST_DENIED;
   }
 
   // Get the lock object for the given row ID
-  auto lock = (Lock *)get(lockTable_, rowId);
+  HashTable *lockTable = get_lock_table(rowId);
+  auto lock = (Lock *)get(lockTable, rowId);
   if (lock == nullptr) {
     lock = newLock();
-    set(lockTable_, rowId, (void *)lock);
+    set(lockTable, rowId, (void *)lock);
   }
 
   // Check if 2PL is violated
@@ -346,78 +385,246 @@ auto acquire_lock(void *signature, unsigned int transactionId,
 
   // Comment out for evaluation ->
   // Check for upgrade request
-  if (hasLock(transaction, rowId) && isExclusive && !lock->exclusive) {
-    if (upgrade(lock, transactionId)) {
-      goto sign;
-    }
+  isUpgrade = hasLock(transaction, rowId) && isExclusive && !lock->exclusive;
+  if (!isUpgrade && hasLock(transaction, rowId)) {
+    print_error("Request for already acquired lock");
     goto abort;
   }
+  // <- Comment out for evaluation
 
-  // Acquire lock in requested mode (shared, exclusive)
-  if (!hasLock(transaction, rowId)) {
-    // <- Comment out for evaluation
-    sgx_thread_mutex_lock(&transaction_mutex[transaction->transaction_id]);
-    ok = addLock(transaction, rowId, isExclusive, lock);
-    sgx_thread_mutex_unlock(&transaction_mutex[transaction->transaction_id]);
-
-    if (ok) {
-      goto sign;
-    }
-    goto abort;
-    // Comment out for evaluation ->
+  // Acquire lock in requested mode (shared, exclusive). A new owner must not
+  // overtake the requests waiting for the lock.
+  if (isUpgrade ? upgrade(lock, transactionId)
+                : lock->waiters.empty() &&
+                      addLock(transaction, rowId, isExclusive, lock)) {
+    goto sign;
   }
-  // <- Comment out for evaluation
 
-  print_error("Request for already acquired lock");
+  if (arg_enclave.conflict_policy == WAIT_DIE &&
+      mayWait(lock, transactionId)) {
+    lock->waiters.push_back({job, isUpgrade});
+    transaction->waiting_rows.insert(rowId);
+    sgx_thread_mutex_unlock(&shard.mutex);
+    return REQUEST_WAITING;
+  }
 
 abort:
-  abort_transaction(transaction);
-  return false;
+  abort_transaction(transaction, threadId);
+  sgx_thread_mutex_unlock(&shard.mutex);
+  return REQUEST_DENIED;
 
 sign:
+  sgx_thread_mutex_unlock(&shard.mutex);
+  sign_lock(signature, transactionId, rowId, lock->exclusive, threadId);
+  return REQUEST_GRANTED;
+}
+
+void sign_lock(void *signature, unsigned int transactionId, unsigned int rowId,
+               bool isExclusive, int threadId) {
   std::string string_to_sign =
-      lock_to_string(transactionId, rowId, lock->exclusive);
+      lock_to_string(transactionId, rowId, isExclusive);
 
   sgx_ecdsa_sign((uint8_t *)string_to_sign.c_str(),
                  strnlen(string_to_sign.c_str(), MAX_SIGNATURE_LENGTH),
                  &ec256_private_key, (sgx_ec256_signature_t *)signature,
                  contexts[threadId]);
-
-  return true;
 }
 
-void release_lock(unsigned int transactionId, unsigned int rowId) {
-  // Get the transaction object
-  auto transaction = (Transaction *)get(transactionTable_, transactionId);
-  if (transaction == nullptr) {
-    print_error("Transaction was not registered");
+void finish_lock_job(const Job &job, sgx_ec256_signature_t *signature) {
+  if (!job.wait_for_result) {
     return;
   }
 
+  if (signature == nullptr) {
+    *job.error = true;
+  } else {
+    // Write base64 encoded signature into the return value of the job struct
+    std::string encoded_signature =
+        base64_encode((unsigned char *)signature->x, sizeof(signature->x)) +
+        "-" +
+        base64_encode((unsigned char *)signature->y, sizeof(signature->y));
+
+    volatile char *p = job.return_value;
+    size_t signature_size = 89;
+    for (int i = 0; i < signature_size; i++) {
+      *p++ = encoded_signature.c_str()[i];
+    }
+  }
+  *job.finished = true;
+}
+
+auto release_lock(unsigned int transactionId, unsigned int rowId) -> bool {
   // Get the lock object
-  auto lock = (Lock *)get(lockTable_, rowId);
+  HashTable *lockTable = get_lock_table(rowId);
+  auto lock = (Lock *)get(lockTable, rowId);
   if (lock == nullptr) {
     print_error("Lock does not exist");
-    return;
+    return false;
   }
 
-  sgx_thread_mutex_lock(&transaction_mutex[transaction->transaction_id]);
-  releaseLock(transaction, rowId, lockTable_);
-  sgx_thread_mutex_unlock(&transaction_mutex[transaction->transaction_id]);
+  // Get the transaction object and keep its shard locked, until the transaction
+  // is updated or deleted
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  sgx_thread_mutex_lock(&shard.mutex);
+  auto transaction = (Transaction *)get(shard.transactions, transactionId);
+  if (transaction == nullptr) {
+    sgx_thread_mutex_unlock(&shard.mutex);
+    print_error("Transaction was not registered");
+    return false;
+  }
+
+  bool released = hasLock(transaction, rowId);
+  bool hasWaiters = !lock->waiters.empty();
+  releaseLock(transaction, rowId, lockTable);
+  if (released && hasWaiters) {
+    releasedRows_[get_worker_thread(rowId)].push_back(rowId);
+  }
 
-  // If the transaction released its last lock, delete it
-  if (transaction->locked_rows_size == 0) {
-    remove(transactionTable_, transactionId);
+  // If the transaction released its last lock and waits for no other one,
+  // delete it
+  if (transaction->locked_rows_size == 0 && transaction->waiting_rows.empty()) {
+    remove(shard.transactions, transactionId);
     delete transaction;
   }
+  sgx_thread_mutex_unlock(&shard.mutex);
+  return released;
+}
+
+void grant_waiters(int threadId) {
+  std::vector<unsigned int> &releasedRows = releasedRows_[threadId];
+  while (!releasedRows.empty()) {
+    unsigned int rowId = releasedRows.back();
+    releasedRows.pop_back();
+    HashTable *lockTable = lockTables_[threadId];
+    auto lock = (Lock *)get(lockTable, rowId);
+    if (lock == nullptr) {
+      continue;  // the row was released twice
+    }
+
+    while (lock != nullptr && !lock->waiters.empty()) {
+      LockWaiter waiter = lock->waiters.front();
+      unsigned int transactionId = waiter.job.transaction_id;
+      bool isExclusive = waiter.job.command == EXCLUSIVE;
+      TransactionTableShard &shard = get_transaction_shard(transactionId);
+      sgx_thread_mutex_lock(&shard.mutex);
+      auto transaction = (Transaction *)get(shard.transactions, transactionId);
+      if (transaction != nullptr && !isGrantable(lock, waiter)) {
+        sgx_thread_mutex_unlock(&shard.mutex);
+        break;
+      }
+
+      // Taken off the lock first, since aborting drops the other waiting
+      // requests of the transaction
+      lock->waiters.pop_front();
+      bool granted = false;
+      if (transaction != nullptr) {
+        transaction->waiting_rows.erase(rowId);
+        if (transaction->growing_phase) {
+          granted = waiter.upgrade
+                        ? upgrade(lock, transactionId)
+                        : addLock(transaction, rowId, isExclusive, lock);
+        }
+        if (!granted) {
+          abort_transaction(transaction, threadId);
+        }
+      }
+      sgx_thread_mutex_unlock(&shard.mutex);
+
+      sgx_ec256_signature_t sig;
+      if (granted) {
+        sign_lock((void *)&sig, transactionId, rowId, isExclusive, threadId);
+      }
+      finish_lock_job(waiter.job, granted ? &sig : nullptr);
+      // Aborting may have released the last owner of the lock and deleted it
+      lock = (Lock *)get(lockTable, rowId);
+    }
+
+    if (lock != nullptr && lock->owners_size == 0 && lock->waiters.empty()) {
+      remove(lockTable, rowId);
+      delete lock;
+    }
+  }
+}
+
+void release_row(int threadId, unsigned int transactionId, unsigned int rowId) {
+  HashTable *lockTable = lockTables_[threadId];
+  auto lock = (Lock *)get(lockTable, rowId);
+  if (lock == nullptr) {
+    return;
+  }
+
+  release(lock, transactionId);
+  if (!lock->waiters.empty()) {
+    releasedRows_[threadId].push_back(rowId);
+  } else if (lock->owners_size == 0) {
+    remove(lockTable, rowId);
+    delete lock;
+  }
 }
 
-void abort_transaction(Transaction *transaction) {
-  remove(transactionTable_, transaction->transaction_id);
-  releaseAllLocks(transaction, lockTable_);
+void drop_waiters(int threadId, unsigned int transactionId,
+                  unsigned int rowId) {
+  auto lock = (Lock *)get(lockTables_[threadId], rowId);
+  if (lock == nullptr) {
+    return;
+  }
+
+  auto waiter = lock->waiters.begin();
+  while (waiter != lock->waiters.end()) {
+    if (waiter->job.transaction_id != transactionId) {
+      waiter++;
+      continue;
+    }
+    finish_lock_job(waiter->job, nullptr);
+    waiter = lock->waiters.erase(waiter);
+  }
+}
+
+void abort_transaction(Transaction *transaction, int threadId) {
+  unsigned int transactionId = transaction->transaction_id;
+  remove(get_transaction_shard(transactionId).transactions, transactionId);
+
+  // Its requests stop waiting as well, so that they do not make younger
+  // transactions die in vain
+  std::set<int> rowIds(
+      transaction->locked_rows,
+      transaction->locked_rows + transaction->locked_rows_size);
+  rowIds.insert(transaction->waiting_rows.begin(),
+                transaction->waiting_rows.end());
+  for (int rowId : rowIds) {
+    int owner = get_worker_thread(rowId);
+    if (owner == threadId) {
+      drop_waiters(threadId, transactionId, rowId);
+      release_row(threadId, transactionId, rowId);
+      continue;
+    }
+
+    // Only the worker thread owning the lock table may change it
+    Job job;
+    job.command = RELEASE;
+    job.transaction_id = transactionId;
+    job.row_id = rowId;
+    job.lock_budget = 0;
+    job.wait_for_result = false;
+    sgx_thread_mutex_lock(&queue_mutex[owner]);
+    queue[owner].push(job);
+    sgx_thread_cond_signal(&job_cond[owner]);
+    sgx_thread_mutex_unlock(&queue_mutex[owner]);
+  }
+  delete[] transaction->locked_rows;
   delete transaction;
 }
 
+auto get_worker_thread(unsigned int rowId) -> int {
+  return (int)((rowId % arg_enclave.lock_table_size) /
+               ((float)arg_enclave.lock_table_size /
+                (arg_enclave.num_threads - 1)));
+}
+
+auto get_lock_table(unsigned int rowId) -> HashTable * {
+  return lockTables_[get_worker_thread(rowId)];
+}
+
 auto verify_signature(char *signature, int transactionId, int rowId,
                       int isExclusive) -> int {
   std::string plain = lock_to_string(transactionId, rowId, isExclusive);
@@ -1,5 +1,7 @@
 #include "hashtable.h"
 
+#include <algorithm>
+
 HashTable* newHashTable(int size) {
   HashTable* hashTable = new HashTable();
   hashTable->size = size;
@@ -7,6 +9,11 @@ HashTable* newHashTable(int size) {
   for (int i = 0; i < size; i++) {
     hashTable->table[i] = nullptr;
   }
+  hashTable->min_size = size;
+  hashTable->num_entries = 0;
+  hashTable->old_size = 0;
+  hashTable->rehash_index = 0;
+  hashTable->old_table = nullptr;
   return hashTable;
 };
 
@@ -21,7 +28,12 @@ int hash(int size, int key) { return key % size; }
 
 auto get(HashTable* hashTable, int key) -> void* {
   Entry* entry = hashTable->table[hash(hashTable->size, key)];
-  return get(entry, key);
+  void* value = get(entry, key);
+  if (value == nullptr && isRehashing(hashTable)) {
+    entry = hashTable->old_table[hash(hashTable->old_size, key)];
+    value = get(entry, key);
+  }
+  return value;
 }
 
 auto get(Entry* entry, int key) -> void* {
@@ -35,7 +47,14 @@ auto get(Entry* entry, int key) -> void* {
 }
 
 void set(HashTable* hashTable, int key, void* value) {
-  Entry* entry = hashTable->table[hash(hashTable->size, key)];
+  rehashStep(hashTable);
+  if (contains(hashTable, key)) {
+    return;  // key already exists
+  }
+
+  // New entries always go into the current table
+  int position = hash(hashTable->size, key);
+  Entry* entry = hashTable->table[position];
 
   Entry* entryToInsert = new Entry();
   entryToInsert->key = key;
@@ -43,19 +62,16 @@ void set(HashTable* hashTable, int key, void* value) {
   entryToInsert->next = nullptr;
 
   if (entry == nullptr) {
-    hashTable->table[hash(hashTable->size, key)] = entryToInsert;
-    return;
-  }
-
-  while (entry->next != nullptr) {
-    if (entry->key == key) {
-      delete entryToInsert;
-      return;  // key already exists
+    hashTable->table[position] = entryToInsert;
+  } else {
+    while (entry->next != nullptr) {
+      entry = entry->next;
     }
-    entry = entry->next;
+    entry->next = entryToInsert;  // Add new entry at the end of the list
   }
+  hashTable->num_entries++;
 
-  entry->next = entryToInsert;  // Add new entry at the end of the list
+  resizeIfNeeded(hashTable);
 }
 
 auto contains(HashTable* hashTable, int key) -> bool {
@@ -68,20 +84,30 @@ auto contains(HashTable* hashTable, int key) -> bool {
     entry = entry->next;
   }
 
+  if (isRehashing(hashTable)) {
+    entry = hashTable->old_table[hash(hashTable->old_size, key)];
+    return get(entry, key) != nullptr;
+  }
+
   return false;
 }
 
-void remove(HashTable* hashTable, int key) {
-  Entry* entry = hashTable->table[hash(hashTable->size, key)];
+/**
+ * Unlinks the entry with the given key from its bucket and deletes it.
+ *
+ * @returns true, when the key was found
+ */
+auto removeFromBucket(Entry** table, int position, int key) -> bool {
+  Entry* entry = table[position];
 
   if (entry == nullptr) {
-    return;
+    return false;
   }
 
   if (entry->key == key) {
-    hashTable->table[hash(hashTable->size, key)] = entry->next;
+    table[position] = entry->next;
     delete entry;
-    return;
+    return true;
   }
 
   Entry* next = entry->next;
@@ -90,9 +116,81 @@ void remove(HashTable* hashTable, int key) {
       // delete it and return
       entry->next = next->next;
       delete next;
-      return;
+      return true;
     }
     entry = next;
     next = entry->next;
   }
-}
\ No newline at end of file
+  return false;
+}
+
+void remove(HashTable* hashTable, int key) {
+  rehashStep(hashTable);
+
+  bool removed =
+      removeFromBucket(hashTable->table, hash(hashTable->size, key), key) ||
+      (isRehashing(hashTable) &&
+       removeFromBucket(hashTable->old_table,
+                        hash(hashTable->old_size, key), key));
+  if (removed) {
+    hashTable->num_entries--;
+  }
+  resizeIfNeeded(hashTable);
+}
+
+auto isRehashing(HashTable* hashTable) -> bool {
+  return hashTable->old_table != nullptr;
+}
+
+void rehashStep(HashTable* hashTable) {
+  for (int step = 0; step < kHashTableRehashStep && isRehashing(hashTable);
+       step++) {
+    // Move the entries of the bucket over one by one without reallocating
+    // them, so that pointers to their values stay valid
+    int oldPosition = hashTable->rehash_index;
+    Entry* entry = hashTable->old_table[oldPosition];
+    while (entry != nullptr) {
+      Entry* next = entry->next;
+      int position = hash(hashTable->size, entry->key);
+      entry->next = hashTable->table[position];
+      hashTable->table[position] = entry;
+      entry = next;
+    }
+    hashTable->old_table[oldPosition] = nullptr;
+
+    hashTable->rehash_index++;
+    if (hashTable->rehash_index == hashTable->old_size) {
+      delete[] hashTable->old_table;
+      hashTable->old_table = nullptr;
+      hashTable->old_size = 0;
+      hashTable->rehash_index = 0;
+    }
+  }
+}
+
+void resizeIfNeeded(HashTable* hashTable) {
+  if (isRehashing(hashTable)) {
+    return;
+  }
+
+  int newSize;
+  if (hashTable->num_entries > hashTable->size * kHashTableMaxLoadFactor) {
+    newSize = hashTable->size * 2;
+  } else if (hashTable->size > hashTable->min_size &&
+             hashTable->num_entries <
+                 hashTable->size * kHashTableMinLoadFactor) {
+    newSize = std::max(hashTable->size / 2, hashTable->min_size);
+  } else {
+    return;
+  }
+
+  hashTable->old_table = hashTable->table;
+  hashTable->old_size = hashTable->size;
+  hashTable->rehash_index = 0;
+
+  hashTable->size = newSize;
+  hashTable->table = new Entry*[newSize];
+  for (int i = 0; i < newSize; i++) {
+    hashTable->table[i] = nullptr;
+  }
+}
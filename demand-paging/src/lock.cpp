@@ -86,4 +86,29 @@ void release(Lock* lock, int transactionId) {
         (int*)realloc(lock->owners, sizeof(int) * (lock->owners_size));
     lock->exclusive = false;
   }
+}
+
+auto mayWait(Lock* lock, int transactionId) -> bool {
+  for (int i = 0; i < lock->owners_size; i++) {
+    if (lock->owners[i] < transactionId) {
+      return false;
+    }
+  }
+  for (const LockWaiter& waiter : lock->waiters) {
+    if ((int)waiter.job.transaction_id < transactionId) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto isGrantable(Lock* lock, const LockWaiter& waiter) -> bool {
+  if (waiter.upgrade) {
+    return lock->owners_size == 1 &&
+           lock->owners[0] == (int)waiter.job.transaction_id;
+  }
+  if (waiter.job.command == EXCLUSIVE) {
+    return lock->owners_size == 0;
+  }
+  return !lock->exclusive;
 }
\ No newline at end of file
@@ -34,16 +34,19 @@ auto LockManager::create_worker_thread(void *tmp) -> void * {
   return 0;
 }
 
-void LockManager::configuration_init(int numWorkerThreads) {
-  arg.num_threads =
-      numWorkerThreads + 1;  // one single thread for transaction table
-  arg.tx_thread_id = arg.num_threads - 1;
+void LockManager::configuration_init(int numWorkerThreads,
+                                     LockConflictPolicy conflictPolicy) {
+  // Every thread registers the transactions of its shard of the transaction
+  // table, the additional one has no lock table
+  arg.num_threads = numWorkerThreads + 1;
   arg.lock_table_size = 10000;
   arg.transaction_table_size = 200;
+  arg.conflict_policy = conflictPolicy;
 }
 
-LockManager::LockManager(int numWorkerThreads) {
-  configuration_init(numWorkerThreads);
+LockManager::LockManager(int numWorkerThreads,
+                         LockConflictPolicy conflictPolicy) {
+  configuration_init(numWorkerThreads, conflictPolicy);
 
   // Load and initialize the signed enclave
   sgx_status_t ret = load_and_initialize_enclave(&global_eid);
@@ -95,13 +98,15 @@ auto LockManager::registerTransaction(unsigned int transactionId,
 };
 
 auto LockManager::lock(unsigned int transactionId, unsigned int rowId,
-                       bool isExclusive, bool waitForResult)
+                       bool isExclusive, bool waitForResult,
+                       unsigned int lockBudget)
     -> std::pair<std::string, bool> {
   if (isExclusive) {
-    return create_enclave_job(EXCLUSIVE, transactionId, rowId, 0,
+    return create_enclave_job(EXCLUSIVE, transactionId, rowId, lockBudget,
                               waitForResult);
   }
-  return create_enclave_job(SHARED, transactionId, rowId, 0, waitForResult);
+  return create_enclave_job(SHARED, transactionId, rowId, lockBudget,
+                            waitForResult);
 };
 
 void LockManager::unlock(unsigned int transactionId, unsigned int rowId,
@@ -109,6 +114,18 @@ void LockManager::unlock(unsigned int transactionId, unsigned int rowId,
   create_enclave_job(UNLOCK, transactionId, rowId, 0, waitForResult);
 };
 
+auto LockManager::lockAsync(unsigned int transactionId, unsigned int rowId,
+                            bool isExclusive, unsigned int lockBudget)
+    -> JobFuture {
+  return create_async_enclave_job(isExclusive ? EXCLUSIVE : SHARED,
+                                  transactionId, rowId, lockBudget);
+}
+
+auto LockManager::unlockAsync(unsigned int transactionId, unsigned int rowId)
+    -> JobFuture {
+  return create_async_enclave_job(UNLOCK, transactionId, rowId, 0);
+}
+
 auto LockManager::seal_and_save_keys() -> bool {
   uint32_t sealed_data_size = 0;
   sgx_status_t ret = get_sealed_data_size(global_eid, &sealed_data_size);
@@ -250,6 +267,26 @@ auto LockManager::create_enclave_job(Command command,
   return std::make_pair(NO_SIGNATURE, true);
 }
 
+auto LockManager::create_async_enclave_job(Command command,
+                                           unsigned int transaction_id,
+                                           unsigned int row_id,
+                                           unsigned int lock_budget)
+    -> JobFuture {
+  // The future owns the memory the enclave writes the result into
+  JobFuture future(command);
+  Job job;
+  job.command = command;
+  job.transaction_id = transaction_id;
+  job.row_id = row_id;
+  job.lock_budget = lock_budget;
+  job.finished = &future.result->finished;
+  job.error = &future.result->error;
+  job.return_value = future.result->return_value;
+  job.wait_for_result = true;
+  enclave_send_job(global_eid, &job);
+  return future;
+}
+
 auto LockManager::verify_signature_string(std::string signature,
                                           int transactionId, int rowId,
                                           int isExclusive) -> bool {
@@ -263,4 +300,62 @@ auto LockManager::verify_signature_string(std::string signature,
     print_debug("Signature successfully verified");
     return true;
   }
-}
\ No newline at end of file
+}
+
+JobFuture::JobFuture(Command command)
+    : command(command), result(new JobResult()) {}
+
+JobFuture::JobFuture(JobFuture &&other) noexcept
+    : command(other.command), result(other.result) {
+  other.result = nullptr;
+}
+
+auto JobFuture::operator=(JobFuture &&other) noexcept -> JobFuture & {
+  if (this != &other) {
+    if (result != nullptr) {
+      collect();
+    }
+    command = other.command;
+    result = other.result;
+    other.result = nullptr;
+  }
+  return *this;
+}
+
+JobFuture::~JobFuture() {
+  if (result != nullptr) {
+    collect();
+  }
+}
+
+auto JobFuture::isReady() -> bool {
+  return result != nullptr &&
+         __atomic_load_n(&result->finished, __ATOMIC_ACQUIRE);
+}
+
+auto JobFuture::get() -> std::pair<std::string, bool> {
+  if (result == nullptr) {
+    throw std::logic_error("The result of the job was already collected");
+  }
+  return collect();
+}
+
+auto JobFuture::collect() -> std::pair<std::string, bool> {
+  while (!__atomic_load_n(&result->finished, __ATOMIC_ACQUIRE)) {
+    continue;
+  }
+
+  std::pair<std::string, bool> ret = std::make_pair(NO_SIGNATURE, true);
+  if (result->error) {
+    ret.second = false;
+  } else if (command == SHARED || command == EXCLUSIVE) {
+    // Get the signature return value
+    ret.first.resize(SIGNATURE_SIZE);
+    for (int i = 0; i < SIGNATURE_SIZE; i++) {
+      ret.first[i] = result->return_value[i];
+    }
+  }
+  delete result;
+  result = nullptr;
+  return ret;
+}
@@ -1,5 +1,8 @@
 #include "server.h"
 
+LockingServiceImpl::LockingServiceImpl(LockConflictPolicy conflictPolicy)
+    : lockManager_(1, conflictPolicy) {}
+
 auto LockingServiceImpl::RegisterTransaction(ServerContext* context,
                                              const RegistrationRequest* request,
                                              RegistrationResponse* response)
@@ -17,31 +20,36 @@ auto LockingServiceImpl::RegisterTransaction(ServerContext* context,
 auto LockingServiceImpl::LockExclusive(ServerContext* context,
                                        const LockRequest* request,
                                        LockResponse* response) -> Status {
-  int transaction_id = request->transaction_id();
-  int row_id = request->row_id();
-  bool wait_for_signature = request->wait_for_signature();
-
-  auto [signature, ok] =
-      lockManager_.lock(transaction_id, row_id, true, wait_for_signature);
-
-  response->set_signature(
-      signature);  // If not ok, signature contains an error message instead
-  if (ok) {
-    return Status::OK;
-  }
-  return Status::CANCELLED;
+  return acquire_lock(request, response, true);
 }
 
 auto LockingServiceImpl::LockShared(ServerContext* context,
                                     const LockRequest* request,
                                     LockResponse* response) -> Status {
-  int transaction_id = request->transaction_id();
-  int row_id = request->row_id();
+  return acquire_lock(request, response, false);
+}
+
+auto LockingServiceImpl::acquire_lock(const LockRequest* request,
+                                      LockResponse* response,
+                                      bool isExclusive) -> Status {
+  unsigned int transaction_id = request->transaction_id();
+  unsigned int row_id = request->row_id();
   bool wait_for_signature = request->wait_for_signature();
+  unsigned int lock_budget = request->lock_budget();
 
-  auto [signature, ok] =
-      lockManager_.lock(transaction_id, row_id, false, wait_for_signature);
+  JobFuture future =
+      lockManager_.lockAsync(transaction_id, row_id, isExclusive, lock_budget);
+  if (!wait_for_signature) {
+    uint64_t ticket =
+        signatures_.add(transaction_id, row_id, isExclusive, future);
+    if (ticket != 0) {
+      response->set_ticket(ticket);
+      return Status::OK;
+    }
+    // The store is full, so the result is returned right away
+  }
 
+  auto [signature, ok] = future.get();
   response->set_signature(
       signature);  // If not ok, signature contains an error message instead
   if (ok) {
@@ -59,4 +67,20 @@ auto LockingServiceImpl::Unlock(ServerContext* context,
 
   lockManager_.unlock(transaction_id, row_id, wait_for_signature);
   return Status::OK;
-}
\ No newline at end of file
+}
+
+auto LockingServiceImpl::CollectSignatures(ServerContext* context,
+                                           const CollectRequest* request,
+                                           CollectResponse* response)
+    -> Status {
+  for (const CollectedSignature& collected :
+       signatures_.collect(request->transaction_id())) {
+    CollectResponse::Result* result = response->add_results();
+    result->set_ticket(collected.ticket);
+    result->set_row_id(collected.rowId);
+    result->set_exclusive(collected.isExclusive);
+    result->set_ok(collected.ok);
+    result->set_signature(collected.signature);
+  }
+  return Status::OK;
+}
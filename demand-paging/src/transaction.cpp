@@ -11,6 +11,10 @@ Transaction* newTransaction(int transactionId, int lockBudget) {
   return transaction;
 }
 
+auto getTransactionShard(unsigned int transactionId, int numShards) -> int {
+  return transactionId % numShards;
+}
+
 auto addLock(Transaction* transaction, int rowId, bool isExclusive, Lock* lock)
     -> bool {
   if (transaction->aborted) {
@@ -66,7 +70,7 @@ void releaseLock(Transaction* transaction, int rowId, HashTable* lockTable) {
   auto lock = (Lock*)get(lockTable, rowId);
   release(lock, transaction->transaction_id);
 
-  if (lock->owners_size == 0) {
+  if (lock->owners_size == 0 && lock->waiters.empty()) {
     remove(lockTable, rowId);
     delete lock;
   }
@@ -86,7 +90,7 @@ void releaseAllLocks(Transaction* transaction, HashTable* lockTable) {
     int locked_row = transaction->locked_rows[i];
     auto lock = (Lock*)get(lockTable, locked_row);
     release(lock, transaction->transaction_id);
-    if (lock->owners_size == 0) {
+    if (lock->owners_size == 0 && lock->waiters.empty()) {
       remove(lockTable, locked_row);
     }
   }
@@ -94,4 +98,4 @@ void releaseAllLocks(Transaction* transaction, HashTable* lockTable) {
   delete[] transaction->locked_rows;
   transaction->locked_rows = nullptr;
   transaction->aborted = true;
-};
\ No newline at end of file
+}
\ No newline at end of file
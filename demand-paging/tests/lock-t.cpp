@@ -92,4 +92,25 @@ TEST(LockTest, releaseUnownedLock) {
   }
 
   EXPECT_TRUE(containsId);
-}
\ No newline at end of file
+}
+
+// Only a transaction older than every owner and waiter may wait for a lock
+TEST(LockTest, waitDie) {
+  Lock* lock = newLock();
+  EXPECT_TRUE(getExclusiveAccess(lock, 5));
+  EXPECT_TRUE(mayWait(lock, 3));
+  EXPECT_FALSE(mayWait(lock, 7));
+
+  Job job;
+  job.command = EXCLUSIVE;
+  job.transaction_id = 3;
+  LockWaiter waiter = {job, false};
+  lock->waiters.push_back(waiter);
+  EXPECT_FALSE(mayWait(lock, 4));
+  EXPECT_TRUE(mayWait(lock, 2));
+
+  // The waiter gets the lock, once it is free
+  EXPECT_FALSE(isGrantable(lock, waiter));
+  release(lock, 5);
+  EXPECT_TRUE(isGrantable(lock, waiter));
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 #include "lock.h"
 #include "lockmanager.h"
 
@@ -20,6 +23,27 @@ TEST_F(LockManagerTest, lockRequestAbortsWhenTransactionNotRegistered) {
   EXPECT_FALSE(lock_manager.lock(kTransactionIdA, kRowId, false).second);
 };
 
+// A lock request with a lock budget registers the transaction itself
+TEST_F(LockManagerTest, lockRequestRegistersTransaction) {
+  LockManager lock_manager = LockManager();
+  EXPECT_TRUE(
+      lock_manager.lock(kTransactionIdA, kRowId, false, true, kLockBudget)
+          .second);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId + 1, true).second);
+  EXPECT_FALSE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+};
+
+// A transaction, whose first lock request fails, does not stay registered
+TEST_F(LockManagerTest, failedLockRequestDoesNotRegister) {
+  LockManager lock_manager = LockManager();
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true).second);
+  EXPECT_FALSE(
+      lock_manager.lock(kTransactionIdA, kRowId, true, true, kLockBudget)
+          .second);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+};
+
 // Registering an already registered transaction
 TEST_F(LockManagerTest, cannotRegisterTwice) {
   LockManager lock_manager = LockManager();
@@ -191,4 +215,75 @@ TEST_F(LockManagerTest, notWaitingForSignature) {
   EXPECT_TRUE(lock_manager.lock(kTransactionIdA, lockBudget, false,
                                 true)
                   .second);  // waitung for signature return value at the end
-}
\ No newline at end of file
+}
+// Many asynchronous lock requests are in flight at once and their futures
+// deliver the signatures, in any order
+TEST_F(LockManagerTest, asyncLockRequests) {
+  LockManager lock_manager = LockManager(2);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  std::vector<JobFuture> futures;
+  for (unsigned int rowId = 1; rowId < kLockBudget; rowId++) {
+    futures.push_back(lock_manager.lockAsync(kTransactionIdA, rowId, true));
+  }
+  for (int i = futures.size() - 1; i >= 0; i--) {
+    auto [signature, ok] = futures[i].get();
+    EXPECT_TRUE(ok);
+    EXPECT_TRUE(lock_manager.verify_signature_string(signature,
+                                                     kTransactionIdA, i + 1,
+                                                     true));
+  }
+  EXPECT_THROW(futures[0].get(), std::logic_error);
+}
+
+// The futures report denied lock requests and unlock requests for locks the
+// transaction does not own
+TEST_F(LockManagerTest, asyncRequestsReportErrors) {
+  LockManager lock_manager = LockManager();
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, true).second);
+
+  JobFuture denied = lock_manager.lockAsync(kTransactionIdB, kRowId, false);
+  JobFuture unowned = lock_manager.unlockAsync(kTransactionIdA, kRowId + 1);
+  JobFuture unregistered =
+      lock_manager.lockAsync(kTransactionIdC, kRowId, true);
+  while (!denied.isReady()) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(denied.get().second);
+  EXPECT_FALSE(unowned.get().second);
+  EXPECT_FALSE(unregistered.get().second);
+  EXPECT_TRUE(lock_manager.unlockAsync(kTransactionIdA, kRowId).get().second);
+}
+
+// Under wait-die, an older transaction waits for the lock of a younger one and
+// gets it together with its signature, once the younger one releases it
+TEST_F(LockManagerTest, olderTransactionWaitsForLock) {
+  LockManager lock_manager = LockManager(1, WAIT_DIE);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true).second);
+  JobFuture waiting = lock_manager.lockAsync(kTransactionIdA, kRowId, true);
+
+  // The single worker thread finished the request before this one
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId + 1, true).second);
+  EXPECT_FALSE(waiting.isReady());
+
+  lock_manager.unlock(kTransactionIdB, kRowId);
+  auto [signature, ok] = waiting.get();
+  EXPECT_TRUE(ok);
+  EXPECT_TRUE(lock_manager.verify_signature_string(signature, kTransactionIdA,
+                                                   kRowId, true));
+}
+
+// Under wait-die, a younger transaction does not wait for the lock of an older
+// one, but is aborted
+TEST_F(LockManagerTest, youngerTransactionDies) {
+  LockManager lock_manager = LockManager(1, WAIT_DIE);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, false).second);
+
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId, true).second);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+}
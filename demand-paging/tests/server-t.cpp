@@ -1,6 +1,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "server.h"
 #include "spdlog/spdlog.h"
 
@@ -90,6 +92,41 @@ TEST_F(ServerTest, lockBudget) {
   EXPECT_FALSE(getSharedLock(server));
 };
 
+// Lock requests, which do not wait for their signatures, get a ticket and the
+// transaction collects their results at once
+TEST_F(ServerTest, collectSignatures) {
+  LockingServiceImpl server;
+  EXPECT_TRUE(registerTransaction(server));
+  request_.set_transaction_id(transactionId_);
+  request_.set_wait_for_signature(false);
+  std::vector<uint64_t> tickets;
+  for (unsigned int rowId = 1; rowId <= 3; rowId++) {
+    request_.set_row_id(rowId);
+    EXPECT_TRUE(server.LockExclusive(&context_, &request_, &response_).ok());
+    EXPECT_NE(response_.ticket(), 0);
+    tickets.push_back(response_.ticket());
+  }
+
+  CollectRequest collect;
+  CollectResponse collected;
+  collect.set_transaction_id(transactionId_);
+  EXPECT_TRUE(server.CollectSignatures(&context_, &collect, &collected).ok());
+  ASSERT_EQ(collected.results_size(), 3);
+  for (int i = 0; i < 3; i++) {
+    const CollectResponse::Result& result = collected.results(i);
+    EXPECT_EQ(result.ticket(), tickets[i]);
+    EXPECT_EQ(result.row_id(), i + 1);
+    EXPECT_TRUE(result.exclusive());
+    EXPECT_TRUE(result.ok());
+    EXPECT_FALSE(result.signature().empty());
+  }
+
+  // Every result is handed out once
+  collected.Clear();
+  EXPECT_TRUE(server.CollectSignatures(&context_, &collect, &collected).ok());
+  EXPECT_EQ(collected.results_size(), 0);
+}
+
 // Simple request for exclusive access
 TEST_F(ServerTest, exclusiveAccess) {
   LockingServiceImpl server;
@@ -3,6 +3,7 @@
 #include <atomic>
 #include <functional>
 #include <thread>
+#include <vector>
 
 #include "hashtable.h"
 #include "lock.h"
@@ -121,4 +122,19 @@ TEST_F(TransactionTest, releasesAllLocks) {
 
   // Assert that the transaction holds no locks
   EXPECT_EQ(transactionA_->locked_rows_size, 0);
-};
\ No newline at end of file
+};
+// Consecutive transaction IDs are spread evenly over the shards
+TEST(TransactionShardTest, spreadsTransactionsOverShards) {
+  const int kShards = 5;
+  std::vector<int> transactions(kShards, 0);
+  for (unsigned int transactionId = 0; transactionId < 100; transactionId++) {
+    int shard = getTransactionShard(transactionId, kShards);
+    ASSERT_GE(shard, 0);
+    ASSERT_LT(shard, kShards);
+    transactions[shard]++;
+  }
+  for (int count : transactions) {
+    EXPECT_EQ(count, 100 / kShards);
+  }
+  EXPECT_EQ(getTransactionShard(4294967295u, kShards), 4294967295u % kShards);
+};
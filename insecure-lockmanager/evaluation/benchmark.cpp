@@ -1,13 +1,12 @@
-#include <fstream>
 #include <functional>
 #include <iostream>
 #include <numeric>
 #include <string>
 #include <vector>
 
+#include "csv.h"
 #include "lockmanager.h"
 
-using std::ofstream;
 using std::reduce;
 using std::string;
 using std::vector;
@@ -34,26 +33,6 @@ void flushCache() {
   }
 }
 
-/**
- * Writes the data all in one into a CSV file
- * @param filename the name of the csv file
- * @param values the outer vector contains the rows and the inner vector
- * resembles a row with its column values
- */
-void writeToCSV(string filename, vector<vector<long>> values) {
-  ofstream file;
-  file.open(filename + ".csv", std::ios_base::app);
-
-  for (const auto& row : values) {
-    for (int i = 0; i < row.size() - 1; i++) {
-      file << row[i] << ",";
-    }
-    file << row[row.size() - 1];
-    file << std::endl;
-  }
-  file.close();
-}
-
 /**
  * Highlevel description of the experiment:
  * A acquires given number of locks in shared mode, then B acquires the same
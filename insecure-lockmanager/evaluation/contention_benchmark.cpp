@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numClientThreads = 8;
+const int numWorkerThreads = 4;
+const int transactionsPerClient = 2000;
+const int locksPerTransaction = 4;
+const int lockTableSize = 10000;
+const vector<int> hotRows = {8, 32, 128, 1024};
+
+/**
+ * Runs the transactions of one client thread. A transaction acquires its
+ * exclusive locks one after the other in random order and releases them. When
+ * a lock request fails, the lock manager aborted the transaction and it starts
+ * over with the same ID, so that it keeps its age under wait-die.
+ *
+ * @param lockManager the lock manager
+ * @param client the index of the client thread
+ * @param numHotRows the number of rows all transactions choose from
+ * @param aborts counts the aborted attempts
+ */
+void runClient(LockManager& lockManager, int client, int numHotRows,
+               std::atomic<long>& aborts) {
+  std::mt19937 random(client);
+  vector<unsigned int> rows;
+  for (int i = 0; i < numHotRows; i++) {
+    // Spread over the lock tables of all worker threads
+    rows.push_back(i * (lockTableSize / numHotRows) + 1);
+  }
+
+  for (int i = 0; i < transactionsPerClient; i++) {
+    // Later transactions are younger
+    unsigned int transactionId = i * numClientThreads + client + 1;
+    bool committed = false;
+    while (!committed) {
+      std::shuffle(rows.begin(), rows.end(), random);
+      committed = true;
+      for (int j = 0; j < locksPerTransaction && committed; j++) {
+        committed = lockManager.lock(transactionId, rows[j], true, true,
+                                     locksPerTransaction);
+      }
+      if (!committed) {
+        aborts++;
+        std::this_thread::yield();
+        continue;
+      }
+      for (int j = 0; j < locksPerTransaction; j++) {
+        lockManager.unlock(transactionId, rows[j], true);
+      }
+    }
+  }
+}
+
+/**
+ * Highlevel description of the experiment:
+ * Client threads run transactions, which lock rows out of a few hot ones
+ * exclusively and release them, and retry them after a failed request until
+ * they commit. Writes the policy (0 NO_WAIT, 1 WAIT_DIE), number of hot rows,
+ * commits, aborts and commits per second into contention.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (int numHotRows : hotRows) {
+    for (LockConflictPolicy policy : {NO_WAIT, WAIT_DIE}) {
+      LockManager lockManager(numWorkerThreads, policy);
+      std::atomic<long> aborts = 0;
+
+      auto begin = high_resolution_clock::now();
+      vector<std::thread> clients;
+      for (int client = 0; client < numClientThreads; client++) {
+        clients.emplace_back(runClient, std::ref(lockManager), client,
+                             numHotRows, std::ref(aborts));
+      }
+      for (auto& client : clients) {
+        client.join();
+      }
+      auto end = high_resolution_clock::now();
+
+      long committed = numClientThreads * transactionsPerClient;
+      contentCSVFile.push_back(
+          {policy, numHotRows, committed, aborts.load(),
+           committed * 1000000000L /
+               duration_cast<nanoseconds>(end - begin).count()});
+    }
+  }
+
+  writeToCSV("contention", contentCSVFile);
+  return 0;
+}
@@ -4,6 +4,8 @@
 
 #include <iostream>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "lockmanager.grpc.pb.h"
 #include "spdlog/spdlog.h"
@@ -44,11 +46,14 @@ class LockingServiceClient {
    * @param rowId identifies the row, the transaction wants to access
    * @param waitForSignature if the request should wait for the signature return
    * value or should immediately return
+   * @param lockBudget if not 0, registers the transaction together with the
+   * lock, so that registerTransaction() can be skipped
    * @returns if the operation was successful
    * @throws std::domain_error, if the lock couldn't get acquired
    */
   auto requestSharedLock(unsigned int transactionId, unsigned int rowId,
-                         bool waitForSignature = true) -> bool;
+                         bool waitForSignature = true,
+                         unsigned int lockBudget = 0) -> bool;
 
   /**
    * Requests an exclusive lock for sole write access to a row.
@@ -57,11 +62,14 @@ class LockingServiceClient {
    * @param rowId identifies the row, the transaction wants to access
    * @param waitForSignature if the request should wait for the signature return
    * value or should immediately return
+   * @param lockBudget if not 0, registers the transaction together with the
+   * lock, so that registerTransaction() can be skipped
    * @returns if the operation was successful
    * @throws std::domain_error, if the lock couldn't get acquired
    */
   auto requestExclusiveLock(unsigned int transactionId, unsigned int rowId,
-                            bool waitForSignature = true) -> bool;
+                            bool waitForSignature = true,
+                            unsigned int lockBudget = 0) -> bool;
 
   /**
    * Requests to release a lock acquired by the transaction.
@@ -75,6 +83,21 @@ class LockingServiceClient {
   auto requestUnlock(unsigned int transactionId, unsigned int rowId,
                      bool waitForSignature = false) -> bool;
 
+  /**
+   * Requests the locks of a transaction's read and write set all at once. The
+   * transaction is not aborted, if they are not granted, so it can try again.
+   *
+   * @param transactionId identifies the transaction that makes the request
+   * @param locks the rows with true for an exclusive lock, false for a shared
+   * lock
+   * @param lockBudget if not 0, registers the transaction together with the
+   * locks, so that registerTransaction() can be skipped
+   * @returns true, if every lock was granted, false, if none was
+   */
+  auto requestLockSet(unsigned int transactionId,
+                      const std::vector<std::pair<unsigned int, bool>> &locks,
+                      unsigned int lockBudget = 0) -> bool;
+
  private:
   std::unique_ptr<LockingService::Stub> stub_;
 };
\ No newline at end of file
@@ -1,18 +1,161 @@
 #pragma once
 
+#include <deque>
 #include <iostream>
+#include <map>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "common.h"
+#include "completion.h"
 #include "hashtable.h"
+#include "jobqueue.h"
 #include "lock.h"
 #include "spdlog/spdlog.h"
 #include "transaction.h"
 
+/**
+ * Memory, into which a worker thread writes the result of a job, when the
+ * caller waits for it.
+ */
+struct JobResult {
+  volatile int finished;  // a JobState, first, see wakeJob()
+  volatile bool error;
+  void (*callback)(void *arg) = nullptr;  // see JobFuture::notifyWhenReady()
+  void *callback_arg = nullptr;
+};
+
+/**
+ * Wakes up the caller of a job, which went to sleep before the job was
+ * finished, or runs the callback registered with JobFuture::notifyWhenReady().
+ *
+ * @param finished the completion word of a JobResult
+ */
+void wakeJob(volatile int *finished);
+
+/**
+ * The pending result of a job submitted with LockManager::lockAsync() or
+ * LockManager::unlockAsync(). The worker thread writes the result into memory
+ * owned by the future, so a caller can keep many jobs in flight and collect
+ * their results in any order. A future must not outlive its lock manager.
+ */
+class JobFuture {
+ public:
+  JobFuture(JobFuture &&other) noexcept;
+  auto operator=(JobFuture &&other) noexcept -> JobFuture &;
+  JobFuture(const JobFuture &) = delete;
+  auto operator=(const JobFuture &) -> JobFuture & = delete;
+
+  /**
+   * Waits for the job, unless its result was collected, since the worker
+   * thread might still write into its memory.
+   */
+  ~JobFuture();
+
+  /**
+   * Checks without blocking, if the worker thread finished the job.
+   *
+   * @returns true, when get() returns without waiting
+   */
+  auto isReady() -> bool;
+
+  /**
+   * Registers a callback, which runs once the worker thread finished the job,
+   * on that thread, or right away, if the job is already finished. It must not
+   * block and can be registered once.
+   *
+   * @param callback the function to run
+   * @param arg the argument passed to the function
+   */
+  void notifyWhenReady(void (*callback)(void *arg), void *arg);
+
+  /**
+   * Waits until the worker thread finished the job and collects its result.
+   * Can only be called once.
+   *
+   * @returns if the job was successful, like LockManager::lock() does
+   * @throws std::logic_error, when the result was already collected
+   */
+  auto get() -> bool;
+
+ private:
+  friend class LockManager;
+
+  JobFuture();
+
+  /**
+   * Waits for the job and frees the memory of its result.
+   *
+   * @returns the result like get() does
+   */
+  auto collect() -> bool;
+
+  JobResult *result;  // nullptr, once the result was collected
+};
+
+// How a LOCK_SET job changed a lock of the set, so that it can be taken back
+enum LockSetChange {
+  LOCK_UNCHANGED,  // the transaction already held the lock in the mode
+  LOCK_GRANTED,
+  LOCK_UPGRADED
+};
+
+/**
+ * The locks of a lock set, that belong to the lock table of one worker thread,
+ * see LockManager::acquireLockSet().
+ */
+struct LockSetGroup {
+  std::vector<std::pair<unsigned int, bool>> locks;  // in ascending row order
+  std::vector<LockSetChange> changes;  // for each lock, once it is granted
+  unsigned int lockBudget;             // registers the transaction, if not 0
+  JobResult result;
+};
+
+/**
+ * The job queue of a worker thread, with the mutex and condition variable the
+ * worker thread blocks on, while the queue is empty. Every worker thread's
+ * queue starts on its own cache line.
+ */
+struct WorkerQueue {
+  JobQueue jobs;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+/**
+ * What a worker thread keeps between its jobs. Only the worker thread itself
+ * accesses it.
+ */
+struct WorkerState {
+  // Rows of its lock table released by the current job, whose waiting requests
+  // may be granted now
+  std::vector<unsigned int> releasedRows;
+  // Jobs for other worker threads, that did not fit into their full queues
+  // yet. The worker thread must not block on a full queue, since the other
+  // worker thread may block on its own.
+  std::deque<std::pair<int, Job>> outbox;
+};
+
+// How a lock request ended, when a worker thread processed it
+enum LockRequestResult {
+  REQUEST_GRANTED,
+  REQUEST_DENIED,  // the transaction was aborted
+  REQUEST_WAITING  // completed later, when the lock is granted
+};
+
+/**
+ * A part of the transaction table with the mutex, that synchronizes access on
+ * it and on the transactions in it. Every shard starts on its own cache line.
+ */
+struct TransactionTableShard {
+  alignas(64) HashTable *transactions;
+  std::mutex mutex;
+};
+
 /**
  * Process lock and unlock requests from the server. It manages a lock table,
  * where for each row ID it can store the corresponding lock object, which
@@ -27,8 +170,11 @@ class LockManager {
    * Initializes the job queue, mutexes and the configuration parameters.
    *
    * @param numWorkerThreads the number of threads that work on the lock table
+   * @param conflictPolicy how a lock request is handled, that conflicts with
+   * the lock of another transaction
    */
-  LockManager(int numWorkerThreads = 1);
+  LockManager(int numWorkerThreads = 1,
+              LockConflictPolicy conflictPolicy = NO_WAIT);
 
   /**
    * Shuts down the worker threads.
@@ -44,6 +190,14 @@ class LockManager {
    */
   auto registerTransaction(unsigned int transactionId) -> bool;
 
+  /**
+   * Changes how lock requests are handled, that conflict with the lock of
+   * another transaction. Only requests made afterwards are affected.
+   *
+   * @param conflictPolicy NO_WAIT or WAIT_DIE
+   */
+  void setConflictPolicy(LockConflictPolicy conflictPolicy);
+
   /**
    * Acquires a lock for the specified row
    *
@@ -52,13 +206,18 @@ class LockManager {
    * @param requestedMode either shared for concurrent read access or exclusive
    * for sole write access
    * @param waitForResult parameter forwarded to create_job function
+   * @param lockBudget if not 0, registers the transaction together with
+   * granting the lock, when it is not registered yet. This saves the
+   * synchronous registerTransaction() call.
    * @returns if successful or not. E.g., when the transaction did not call
    * RegisterTransaction before or the given lock mode is unknown or when the
    * transaction makes a request for a look, that it already owns or makes a
    * request for a lock while in the shrinking phase, the request will fail.
+   * Under WAIT_DIE, a request conflicting with the lock of a younger
+   * transaction does not return, until the lock is granted.
    */
   auto lock(unsigned int transactionId, unsigned int rowId, bool isExclusive,
-            bool waitForResult = true) -> bool;
+            bool waitForResult = true, unsigned int lockBudget = 0) -> bool;
 
   /**
    * Releases a lock for the specified row
@@ -71,6 +230,54 @@ class LockManager {
   void unlock(unsigned int transactionId, unsigned int rowId,
               bool waitForResult = false);
 
+  /**
+   * Requests a lock for the specified row without waiting for the result. The
+   * calling thread can submit further requests, while a worker thread works on
+   * this one.
+   *
+   * @param transactionId identifies the transaction making the request
+   * @param rowId identifies the row to be locked
+   * @param isExclusive either shared for concurrent read access or exclusive
+   * for sole write access
+   * @param lockBudget registers the transaction, if not 0, see lock()
+   * @returns the future, which delivers if the lock was granted, once a worker
+   * thread finished the request
+   */
+  auto lockAsync(unsigned int transactionId, unsigned int rowId,
+                 bool isExclusive, unsigned int lockBudget = 0) -> JobFuture;
+
+  /**
+   * Releases a lock for the specified row without waiting for the result.
+   * Unlike unlock() without waiting, the returned future reports, if the
+   * transaction owned the lock.
+   *
+   * @param transactionId identifies the transaction making the request
+   * @param rowId identifies the row to be released
+   * @returns the future, which delivers if the lock was released
+   */
+  auto unlockAsync(unsigned int transactionId, unsigned int rowId)
+      -> JobFuture;
+
+  /**
+   * Acquires a set of locks for a transaction, which knows its read and write
+   * set up front, all at once or none of them. The rows are sorted into their
+   * global order and grouped by the worker thread owning them, which acquires
+   * its group in a single job. When a lock of the set conflicts, the locks
+   * granted for the set are taken back, but unlike with lock(), the
+   * transaction is not aborted and keeps the locks it acquired before.
+   *
+   * @param transactionId identifies the transaction making the request
+   * @param locks the rows with true for an exclusive lock, false for a shared
+   * lock. A row requested in both modes is locked exclusively.
+   * @param lockBudget if not 0, registers the transaction, when it is not
+   * registered yet, see lock(). It stays registered, if the set is not
+   * granted.
+   * @returns true, if every lock of the set was granted, false, if none was
+   */
+  auto acquireLockSet(unsigned int transactionId,
+                      const std::vector<std::pair<unsigned int, bool>> &locks,
+                      unsigned int lockBudget = 0) -> bool;
+
  private:
   /**
    * Function that each worker thread executes. It calls inside the enclave and
@@ -85,8 +292,10 @@ class LockManager {
    * Initializes configuration parameters.
    *
    * @param numWorkerThreads the number of threads that work on the lock table
+   * @param conflictPolicy see LockManager()
    */
-  void configuration_init(int numWorkerThreads);
+  void configuration_init(int numWorkerThreads,
+                          LockConflictPolicy conflictPolicy);
 
   /**
    * Sends a job to the job queue.
@@ -98,17 +307,33 @@ class LockManager {
    * @param row_id optional parameter for SHARED, EXCLUSIVE or UNLOCK
    * @param waitForResult if the function should wait for return values to be
    * set or immediately return
+   * @param lock_budget optional parameter for SHARED or EXCLUSIVE, see lock()
    */
   auto create_job(Command command, unsigned int transaction_id = 0,
-                  unsigned int row_id = 0, bool waitForResult = true) -> bool;
+                  unsigned int row_id = 0, bool waitForResult = true,
+                  unsigned int lock_budget = 0) -> bool;
+
+  /**
+   * Sends a job to the job queue with the memory for its result, which is kept
+   * until the returned future collects the result.
+   *
+   * @param command SHARED, EXCLUSIVE or UNLOCK
+   * @param transaction_id identifies the transaction making the request
+   * @param row_id identifies the row
+   * @param lock_budget additional argument for SHARED or EXCLUSIVE
+   * @returns the future of the job
+   */
+  auto create_async_job(Command command, unsigned int transaction_id,
+                        unsigned int row_id, unsigned int lock_budget)
+      -> JobFuture;
 
   /**
    * Function that is run by the worker threads inside the enclave. It pulls a
    * job from its associated job queue in a loop and executes it, e.g. acquiring
    * a shared lock for a specific row. Each row gets assigned a specific thread
    * evenly, so no synchronization is necessary when accessing the underlying
-   * lock table. The transaction table is accessed by only one single thread for
-   * all requests to register a transaction.
+   * lock table. Requests to register a transaction go to the thread owning its
+   * shard of the transaction table.
    */
   void process_request();
 
@@ -123,50 +348,187 @@ class LockManager {
   void send_job(void *data);
 
   /**
-   * Acquires a lock for the specified row.
+   * Puts a job into the job queue of a worker thread and signals the worker
+   * thread, if it sleeps.
+   *
+   * @param thread_id the worker thread
+   * @param job the job
+   */
+  void push_job(int thread_id, const Job &job);
+
+  /**
+   * Puts a job into the job queue of a worker thread like push_job(), unless
+   * the queue is full.
+   *
+   * @param thread_id the worker thread
+   * @param job the job
+   * @returns false, when the queue is full
+   */
+  auto try_push_job(int thread_id, const Job &job) -> bool;
+
+  /**
+   * Passes the jobs in the outbox of a worker thread on to the other worker
+   * threads, as long as their queues have room.
+   *
+   * @param thread_id the worker thread, that owns the outbox
+   */
+  void flush_outbox(int thread_id);
+
+  /**
+   * Registers the transaction in its shard of the transaction table.
+   *
+   * @param transactionId identifies the transaction
+   * @returns false, when the transaction is already registered
+   */
+  auto register_transaction(unsigned int transactionId) -> bool;
+
+  /**
+   * Checks, if the transaction is registered, under the mutex of its shard.
+   *
+   * @param transactionId identifies the transaction
+   * @returns true, when the transaction is registered
+   */
+  auto is_registered(unsigned int transactionId) -> bool;
+
+  /**
+   * Acquires a lock for the specified row. A request, that conflicts with the
+   * lock of another transaction or with a request waiting for it, waits under
+   * WAIT_DIE, if mayWait() allows it.
+   *
+   * @param job the SHARED or EXCLUSIVE job with the transaction ID, the row ID
+   * and the lock budget. If not 0, the lock budget registers the transaction,
+   * when it is not registered yet. Since a failed request aborts the
+   * transaction, it is only kept, if it gets the lock or waits for it.
+   * @returns REQUEST_DENIED, when transaction did not call
+   * RegisterTransaction before or when the transaction makes a request for a
+   * look, that it already owns, makes a request for a lock while in the
+   * shrinking phase or the request conflicts and does not wait. Then the job is
+   * finished. REQUEST_WAITING, when the job was queued at the lock and
+   * grant_waiters() finishes it later.
+   */
+  auto acquire_lock(const Job &job) -> LockRequestResult;
+
+  /**
+   * Grants the requests waiting for the rows released by the current job of
+   * the worker thread in their order, as long as they do not conflict, and
+   * finishes their jobs. A request of a transaction, that was aborted
+   * meanwhile, fails.
+   *
+   * @param thread_id the worker thread, whose lock table holds the rows
+   */
+  void grant_waiters(int thread_id);
+
+  /**
+   * Releases the lock of a row in the lock table of the calling worker thread
+   * for a transaction, that was already removed from the transaction table.
+   * Deletes the lock, if nobody owns or waits for it anymore.
+   *
+   * @param thread_id the worker thread, whose lock table holds the row
+   * @param transactionId identifies the transaction
+   * @param rowId identifies the row to be released
+   */
+  void release_row(int thread_id, unsigned int transactionId,
+                   unsigned int rowId);
+
+  /**
+   * Fails the requests of an aborted transaction, that wait for the lock of a
+   * row in the lock table of the calling worker thread, and finishes their
+   * jobs.
+   *
+   * @param thread_id the worker thread, whose lock table holds the row
+   * @param transactionId identifies the aborted transaction
+   * @param rowId identifies the row, whose lock the requests wait for
+   */
+  void drop_waiters(int thread_id, unsigned int transactionId,
+                    unsigned int rowId);
+
+  /**
+   * Acquires the locks of a lock set, that belong to the lock table of the
+   * calling worker thread, in their order. Takes back the ones it granted, if
+   * one of them conflicts.
    *
-   * @param sig_len length of the buffer
    * @param transactionId identifies the transaction making the request
-   * @param rowId identifies the row to be locked
-   * @param isExclusive either shared for concurrent read access or exclusive
-   * for sole write access
-   * @returns false, when transaction did not call
-   * RegisterTransaction before or the given lock mode is unknown or when the
-   * transaction makes a request for a look, that it already owns, makes a
-   * request for a lock while in the shrinking phase, else true
+   * @param group the locks, whose changes are recorded for undo_lock_set
+   * @returns true, if every lock of the group was granted
    */
-  auto acquire_lock(unsigned int transactionId, unsigned int rowId,
-                    bool isExclusive) -> bool;
+  auto acquire_lock_set(unsigned int transactionId, LockSetGroup &group)
+      -> bool;
+
+  /**
+   * Takes back the locks a lock set granted, without the transaction entering
+   * the shrinking phase. Needs to hold the mutex of the transaction's shard.
+   *
+   * @param transaction the transaction, that made the request
+   * @param group the locks and their recorded changes
+   * @param count the number of locks of the group to take back, in reverse
+   * order
+   */
+  void undo_lock_set(Transaction *transaction, LockSetGroup &group,
+                     size_t count);
 
   /**
    * Releases a lock for the specified row.
    *
    * @param transactionId identifies the transaction making the request
    * @param rowId identifies the row to be released
+   * @returns false, when the transaction did not own the lock
    */
-  void release_lock(unsigned int transactionId, unsigned int rowId);
+  auto release_lock(unsigned int transactionId, unsigned int rowId) -> bool;
 
   /**
-   * Releases all locks the given transaction currently has.
+   * Releases all locks the given transaction currently has, drops its waiting
+   * requests and removes it from the transaction table. Needs to hold the mutex
+   * of the transaction's shard. The locks in the lock tables of other worker
+   * threads are released by them, with RELEASE jobs sent through the outbox.
    *
    * @param transaction the transaction to be aborted
+   * @param thread_id the calling worker thread
+   */
+  void abort_transaction(Transaction *transaction, int thread_id);
+
+  /**
+   * Determines the worker thread responsible for the given row ID. It only
+   * depends on the initial lock table size, so that a row keeps its worker
+   * thread while the lock tables are resized.
+   *
+   * @param rowId the row ID
+   * @returns the ID of the worker thread
+   */
+  auto get_worker_thread(unsigned int rowId) -> int;
+
+  /**
+   * Returns the shard of the transaction table, that holds the transaction.
+   *
+   * @param transactionId identifies the transaction
+   */
+  auto get_transaction_shard(unsigned int transactionId)
+      -> TransactionTableShard &;
+
+  /**
+   * Returns the lock table of the worker thread responsible for the row ID.
+   *
+   * @param rowId the row ID
    */
-  void abort_transaction(Transaction *transaction);
+  auto get_lock_table(unsigned int rowId) -> HashTable *;
 
   Arg arg;  // configuration parameters for the enclave
   pthread_t
       *threads;  // worker threads that execute requests inside the enclave
 
   pthread_mutex_t global_num_mutex;  // synchronizes access to num
-  pthread_mutex_t *queue_mutex;      // synchronizes access to the job queue
-  pthread_cond_t
-      *job_cond;  // wakes up worker threads when a new job is available
-  std::vector<std::queue<Job>> queue;  // a job queue for each worker thread
+  std::unique_ptr<WorkerQueue[]>
+      workerQueues;  // a job queue for each worker thread
+  std::unique_ptr<WorkerState[]> workerStates_;  // one for each worker thread
 
-  // Holds the transaction objects of the currently active transactions
-  HashTable *transactionTable_;
+  // Holds the transaction objects of the currently active transactions, split
+  // by transaction ID into one shard per worker thread, see
+  // getTransactionShard(). A transaction is shared by all worker threads whose
+  // lock tables contain one of its locks, which only read or modify it while
+  // they hold the mutex of its shard.
+  std::unique_ptr<TransactionTableShard[]> transactionTable_;
 
-  // Keeps track of a lock object for each row ID
-  HashTable *lockTable_;
+  // Keeps track of a lock object for each row ID. Every worker thread has its
+  // own lock table, so that it can resize it without synchronization.
+  std::vector<HashTable *> lockTables_;
   int num = 0;  // global variable used to give every thread a unique ID
 };
\ No newline at end of file
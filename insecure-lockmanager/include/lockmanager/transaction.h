@@ -31,7 +31,8 @@ struct Transaction {
   bool growing_phase;
   int lock_budget;
   std::set<int> locked_rows;
-  std::mutex mut;  // access on locked_rows and lock_budget
+  std::set<int> waiting_rows;  // rows, whose locks its requests wait for
+  std::mutex mut;              // access on locked_rows and lock_budget
 };
 typedef struct Transaction Transaction;
 
@@ -45,6 +46,17 @@ typedef struct Transaction Transaction;
  */
 Transaction* newTransaction(int transactionId, int lockBudget = 500000);
 
+/**
+ * Returns the shard of the transaction table, that holds the transaction. The
+ * transaction IDs are spread round-robin over the shards, of which every
+ * worker thread has one.
+ *
+ * @param transactionId identifies the transaction
+ * @param numShards number of shards of the transaction table
+ * @returns index of the shard
+ */
+auto getTransactionShard(unsigned int transactionId, int numShards) -> int;
+
 /**
  * When the transaction acquires a new lock, the row ID that lock refers to is
  * added to the set of locked rows and it decrements the lock budget by 1.
@@ -62,7 +74,8 @@ auto addLock(Transaction* transaction, int rowId, bool isExclusive, Lock* lock)
 /**
  * Checks if the transaction currently holds a lock on the given row ID.
  * If so, it enters the shrinking phase and removes the row ID from the set of
- * locked rows. Then it releases the lock.
+ * locked rows. Then it releases the lock and deletes it, unless other
+ * transactions own it or wait for it.
  *
  * @param Transaction transaction to execute the operation on
  * @param rowId row ID of the released lock
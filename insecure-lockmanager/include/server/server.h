@@ -22,8 +22,14 @@ using grpc::Status;
  * manager. It takes requests to acquire and release locks from the client and
  * forwards them to the LockManager class.
  */
-class LockingServiceImpl final : public LockingService::Service {
+class LockingServiceImpl : public LockingService::Service {
  public:
+  /**
+   * @param conflictPolicy how the lock manager handles lock requests, that
+   * conflict with the lock of another transaction
+   */
+  explicit LockingServiceImpl(LockConflictPolicy conflictPolicy = NO_WAIT);
+
   /**
    * Registers the transaction at the lock manager prior to being able to
    * acquire any locks.
@@ -78,6 +84,19 @@ class LockingServiceImpl final : public LockingService::Service {
   auto Unlock(ServerContext* context, const LockRequest* request,
               LockResponse* response) -> Status override;
 
- private:
+  /**
+   * Acquires the read and write set of a transaction all at once or none of
+   * it.
+   *
+   * @param context contains metadata about the request
+   * @param request containing the transaction ID, the rows and lock modes and
+   *                optionally a lock budget to register the transaction with
+   * @param response empty, the status tells if the locks were granted
+   * @return OK, if every lock was granted, else CANCELLED
+   */
+  auto AcquireLockSet(ServerContext* context, const LockSetRequest* request,
+                      LockSetResponse* response) -> Status override;
+
+ protected:
   LockManager lockManager_;
 };
\ No newline at end of file
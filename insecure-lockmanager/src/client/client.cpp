@@ -27,7 +27,8 @@ auto LockingServiceClient::registerTransaction(unsigned int transactionId,
 
 auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
                                              unsigned int rowId,
-                                             bool waitForSignature) -> bool {
+                                             bool waitForSignature,
+                                             unsigned int lockBudget) -> bool {
   spdlog::info(
       "Requesting shared lock (TXID: " + std::to_string(transactionId) +
       ", RID: " + std::to_string(rowId) + ")");
@@ -35,6 +36,7 @@ auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
   request.set_transaction_id(transactionId);
   request.set_row_id(rowId);
   request.set_wait_for_signature(waitForSignature);
+  request.set_lock_budget(lockBudget);
 
   LockResponse response;
   ClientContext context;
@@ -52,7 +54,9 @@ auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
 
 auto LockingServiceClient::requestExclusiveLock(unsigned int transactionId,
                                                 unsigned int rowId,
-                                                bool waitForSignature) -> bool {
+                                                bool waitForSignature,
+                                                unsigned int lockBudget)
+    -> bool {
   spdlog::info(
       "Requesting exclusive lock (TXID: " + std::to_string(transactionId) +
       ", RID: " + std::to_string(rowId) + ")");
@@ -60,6 +64,7 @@ auto LockingServiceClient::requestExclusiveLock(unsigned int transactionId,
   request.set_transaction_id(transactionId);
   request.set_row_id(rowId);
   request.set_wait_for_signature(waitForSignature);
+  request.set_lock_budget(lockBudget);
 
   LockResponse response;
   ClientContext context;
@@ -92,4 +97,31 @@ auto LockingServiceClient::requestUnlock(unsigned int transactionId,
   Status status = stub_->Unlock(&context, request, &response);
 
   return status.ok();
-}
\ No newline at end of file
+}
+
+auto LockingServiceClient::requestLockSet(
+    unsigned int transactionId,
+    const std::vector<std::pair<unsigned int, bool>> &locks,
+    unsigned int lockBudget) -> bool {
+  spdlog::info("Requesting a set of " + std::to_string(locks.size()) +
+               " locks (TXID: " + std::to_string(transactionId) + ")");
+  LockSetRequest request;
+  request.set_transaction_id(transactionId);
+  request.set_lock_budget(lockBudget);
+  for (const auto &[rowId, isExclusive] : locks) {
+    LockSetRequest::Lock *lock = request.add_locks();
+    lock->set_row_id(rowId);
+    lock->set_exclusive(isExclusive);
+  }
+
+  LockSetResponse response;
+  ClientContext context;
+
+  Status status = stub_->AcquireLockSet(&context, request, &response);
+
+  if (!status.ok()) {
+    spdlog::error("Acquiring the lock set failed (TXID: " +
+                  std::to_string(transactionId) + ")");
+  }
+  return status.ok();
+}
@@ -0,0 +1,35 @@
+#include "completion.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+void waitForCompletion(volatile int *state) {
+  for (int i = 0; i < kCompletionSpins; i++) {
+    if (__atomic_load_n(state, __ATOMIC_ACQUIRE) == JOB_FINISHED) {
+      return;
+    }
+    __builtin_ia32_pause();
+  }
+
+  // Announce the sleep, unless the job was finished in the meantime
+  int expected = JOB_PENDING;
+  __atomic_compare_exchange_n(state, &expected, JOB_PENDING_WAITER, false,
+                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+  while (__atomic_load_n(state, __ATOMIC_ACQUIRE) != JOB_FINISHED) {
+    // Only sleeps, while the state still announces the sleep
+    syscall(SYS_futex, state, FUTEX_WAIT_PRIVATE, JOB_PENDING_WAITER, nullptr,
+            nullptr, 0);
+  }
+}
+
+void completeJob(volatile int *state, void (*wake)(volatile int *state)) {
+  if (__atomic_exchange_n(state, JOB_FINISHED, __ATOMIC_RELEASE) ==
+      JOB_PENDING_WAITER) {
+    wake(state);
+  }
+}
+
+void wakeCompletion(volatile int *state) {
+  syscall(SYS_futex, state, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
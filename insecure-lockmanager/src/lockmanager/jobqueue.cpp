@@ -0,0 +1,78 @@
+#include "jobqueue.h"
+
+void initJobQueue(JobQueue* queue) {
+  queue->enqueue_pos = 0;
+  queue->dequeue_pos = 0;
+  queue->sleeping = 0;
+  for (unsigned long i = 0; i < kJobQueueSize; i++) {
+    queue->slots[i].sequence = i;
+  }
+}
+
+auto pushJob(JobQueue* queue, const Job& job) -> bool {
+  unsigned long pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+  JobQueueSlot* slot;
+  while (true) {
+    slot = &queue->slots[pos & (kJobQueueSize - 1)];
+    unsigned long sequence =
+        __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    long difference = (long)(sequence - pos);
+    if (difference < 0) {
+      // The consumer has not emptied the slot of the previous round yet
+      return false;
+    }
+    if (difference == 0 &&
+        __atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1, true,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+    if (difference > 0) {
+      // Another producer claimed the position
+      pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+
+  slot->job = job;
+  // Publish the slot only after it was filled
+  __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+auto popJob(JobQueue* queue, Job* job) -> bool {
+  unsigned long pos = queue->dequeue_pos;
+  JobQueueSlot* slot = &queue->slots[pos & (kJobQueueSize - 1)];
+  if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1) {
+    return false;
+  }
+
+  *job = slot->job;
+  // Free the slot for the next round only after it was read
+  __atomic_store_n(&slot->sequence, pos + kJobQueueSize, __ATOMIC_RELEASE);
+  queue->dequeue_pos = pos + 1;
+  return true;
+}
+
+auto prepareToSleep(JobQueue* queue) -> bool {
+  __atomic_store_n(&queue->sleeping, 1, __ATOMIC_RELAXED);
+  // Pairs with the fence in needsWakeUp(): either the producer sees the mark or
+  // the consumer sees the job
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  JobQueueSlot* slot =
+      &queue->slots[queue->dequeue_pos & (kJobQueueSize - 1)];
+  if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) ==
+      queue->dequeue_pos + 1) {
+    wakeUp(queue);
+    return false;
+  }
+  return true;
+}
+
+void wakeUp(JobQueue* queue) {
+  __atomic_store_n(&queue->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+auto needsWakeUp(JobQueue* queue) -> bool {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return __atomic_load_n(&queue->sleeping, __ATOMIC_RELAXED) != 0 &&
+         __atomic_exchange_n(&queue->sleeping, 0, __ATOMIC_RELAXED) != 0;
+}
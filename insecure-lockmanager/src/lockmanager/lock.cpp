@@ -37,4 +37,29 @@ void release(Lock* lock, int transactionId) {
     lock->owners.erase(transactionId);
     lock->exclusive = false;
   }
+}
+
+auto mayWait(Lock* lock, int transactionId) -> bool {
+  for (int owner : lock->owners) {
+    if (owner < transactionId) {
+      return false;
+    }
+  }
+  for (const LockWaiter& waiter : lock->waiters) {
+    if ((int)waiter.job.transaction_id < transactionId) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto isGrantable(Lock* lock, const LockWaiter& waiter) -> bool {
+  if (waiter.upgrade) {
+    return lock->owners.size() == 1 &&
+           lock->owners.find(waiter.job.transaction_id) != lock->owners.end();
+  }
+  if (waiter.job.command == EXCLUSIVE) {
+    return lock->owners.size() == 0;
+  }
+  return !lock->exclusive;
 }
\ No newline at end of file
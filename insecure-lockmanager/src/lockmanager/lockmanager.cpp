@@ -1,5 +1,9 @@
 #include <lockmanager.h>
 
+// The result of the synchronous job a thread waits for. A thread waits for at
+// most one job at a time, so these never need to be allocated.
+thread_local JobResult callerJobResult;
+
 size_t transactionTableSize_;
 size_t lockTableSize_;
 auto LockManager::create_worker_thread(void *object) -> void * {
@@ -7,43 +11,53 @@ auto LockManager::create_worker_thread(void *object) -> void * {
   return 0;
 }
 
-void LockManager::configuration_init(int numWorkerThreads) {
-  const int numLocktableWorkerThreads = numWorkerThreads;
-  arg.num_threads =
-      numLocktableWorkerThreads + 1;  // + 1 thread for transaction table;
-  arg.tx_thread_id = arg.num_threads - 1;
+void LockManager::configuration_init(int numWorkerThreads,
+                                     LockConflictPolicy conflictPolicy) {
+  // Every thread registers the transactions of its shard of the transaction
+  // table, the additional one has no lock table
+  arg.num_threads = numWorkerThreads + 1;
   arg.transaction_table_size = 200;
   arg.lock_table_size = 10000;
+  arg.conflict_policy = conflictPolicy;
 }
 
-LockManager::LockManager(int numWorkerThreads) {
-  configuration_init(numWorkerThreads);
+LockManager::LockManager(int numWorkerThreads,
+                         LockConflictPolicy conflictPolicy) {
+  configuration_init(numWorkerThreads, conflictPolicy);
 
   // Get configuration parameters
   transactionTableSize_ = arg.transaction_table_size;
   lockTableSize_ = arg.lock_table_size;
 
-  transactionTable_ = newHashTable(transactionTableSize_);
-  lockTable_ = newHashTable(lockTableSize_);
+  transactionTable_ =
+      std::make_unique<TransactionTableShard[]>(arg.num_threads);
+  for (int i = 0; i < arg.num_threads; i++) {
+    transactionTable_[i].transactions =
+        newHashTable(transactionTableSize_ / arg.num_threads + 1);
+  }
+  // The initial lock table size is split among the worker threads
+  for (int i = 0; i < arg.num_threads - 1; i++) {
+    lockTables_.push_back(
+        newHashTable(lockTableSize_ / (arg.num_threads - 1) + 1));
+  }
 
   // Initialize mutex variables
   pthread_mutex_init(&global_num_mutex, NULL);
-  queue_mutex =
-      (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t) * arg.num_threads);
-  job_cond = (pthread_cond_t *)malloc(sizeof(pthread_cond_t) * arg.num_threads);
 
   // Initialize job queues
+  workerQueues = std::make_unique<WorkerQueue[]>(arg.num_threads);
   for (int i = 0; i < arg.num_threads; i++) {
-    queue.push_back(std::queue<Job>());
+    initJobQueue(&workerQueues[i].jobs);
+    pthread_mutex_init(&workerQueues[i].mutex, NULL);
+    pthread_cond_init(&workerQueues[i].cond, NULL);
   }
+  workerStates_ = std::make_unique<WorkerState[]>(arg.num_threads);
 
   // Create worker threads to serve lock requests and registrations of
   // transactions
   threads = (pthread_t *)malloc(sizeof(pthread_t) * (arg.num_threads));
   spdlog::info("Initializing " + std::to_string(arg.num_threads) + " threads");
   for (int i = 0; i < arg.num_threads; i++) {
-    pthread_mutex_init(&queue_mutex[i], NULL);
-    pthread_cond_init(&job_cond[i], NULL);
     pthread_create(&threads[i], NULL, &LockManager::create_worker_thread, this);
   }
 }
@@ -56,8 +70,8 @@ LockManager::~LockManager() {
   spdlog::info("Waiting for thread to stop");
   for (int i = 0; i < arg.num_threads; i++) {
     pthread_join(threads[i], NULL);
-    pthread_mutex_destroy(&queue_mutex[i]);
-    pthread_cond_destroy(&job_cond[i]);
+    pthread_mutex_destroy(&workerQueues[i].mutex);
+    pthread_cond_destroy(&workerQueues[i].cond);
   }
 
   spdlog::info("Freeing threads");
@@ -68,12 +82,19 @@ auto LockManager::registerTransaction(unsigned int transactionId) -> bool {
   return create_job(REGISTER, transactionId);
 };
 
+void LockManager::setConflictPolicy(LockConflictPolicy conflictPolicy) {
+  // The worker threads read the policy concurrently
+  __atomic_store_n(&arg.conflict_policy, conflictPolicy, __ATOMIC_RELAXED);
+}
+
 auto LockManager::lock(unsigned int transactionId, unsigned int rowId,
-                       bool isExclusive, bool waitForResult) -> bool {
+                       bool isExclusive, bool waitForResult,
+                       unsigned int lockBudget) -> bool {
   if (isExclusive) {
-    return create_job(EXCLUSIVE, transactionId, rowId, waitForResult);
+    return create_job(EXCLUSIVE, transactionId, rowId, waitForResult,
+                      lockBudget);
   }
-  return create_job(SHARED, transactionId, rowId, waitForResult);
+  return create_job(SHARED, transactionId, rowId, waitForResult, lockBudget);
 };
 
 void LockManager::unlock(unsigned int transactionId, unsigned int rowId,
@@ -81,47 +102,140 @@ void LockManager::unlock(unsigned int transactionId, unsigned int rowId,
   create_job(UNLOCK, transactionId, rowId, waitForResult);
 };
 
+auto LockManager::lockAsync(unsigned int transactionId, unsigned int rowId,
+                            bool isExclusive, unsigned int lockBudget)
+    -> JobFuture {
+  return create_async_job(isExclusive ? EXCLUSIVE : SHARED, transactionId,
+                          rowId, lockBudget);
+}
+
+auto LockManager::unlockAsync(unsigned int transactionId, unsigned int rowId)
+    -> JobFuture {
+  return create_async_job(UNLOCK, transactionId, rowId, 0);
+}
+
+auto LockManager::acquireLockSet(
+    unsigned int transactionId,
+    const std::vector<std::pair<unsigned int, bool>> &locks,
+    unsigned int lockBudget) -> bool {
+  if (lockBudget == 0 && !is_registered(transactionId)) {
+    spdlog::error("Need to register transaction before lock requests");
+    return false;
+  }
+
+  // Sorting the rows into one global order, a row requested twice is locked in
+  // the stronger mode
+  std::map<unsigned int, bool> rows;
+  for (const auto &[rowId, isExclusive] : locks) {
+    rows[rowId] = rows[rowId] || isExclusive;
+  }
+
+  // Every worker thread acquires its rows in one job
+  std::map<int, LockSetGroup> groups;
+  for (const auto &[rowId, isExclusive] : rows) {
+    LockSetGroup &group = groups[get_worker_thread(rowId)];
+    group.locks.emplace_back(rowId, isExclusive);
+  }
+  auto submit = [&](Command command) {
+    for (auto &[threadId, group] : groups) {
+      group.lockBudget = lockBudget;
+      group.result.finished = JOB_PENDING;
+      group.result.error = false;
+
+      Job job;
+      job.command = command;
+      job.transaction_id = transactionId;
+      job.row_id = 0;
+      job.lock_budget = lockBudget;
+      job.wait_for_result = true;
+      job.lock_set = &group;
+      job.finished = &group.result.finished;
+      job.error = &group.result.error;
+      push_job(threadId, job);
+    }
+  };
+
+  submit(LOCK_SET);
+  bool granted = true;
+  for (auto &[threadId, group] : groups) {
+    waitForCompletion(&group.result.finished);
+    granted = granted && !group.result.error;
+  }
+  if (granted) {
+    return true;
+  }
+
+  // Take back the locks of the groups, that were granted
+  for (auto it = groups.begin(); it != groups.end();) {
+    if (it->second.result.error) {
+      it = groups.erase(it);
+    } else {
+      it++;
+    }
+  }
+  submit(UNDO_LOCK_SET);
+  for (auto &[threadId, group] : groups) {
+    waitForCompletion(&group.result.finished);
+  }
+  return false;
+}
+
 auto LockManager::create_job(Command command, unsigned int transaction_id,
-                             unsigned int row_id, bool waitForResult) -> bool {
+                             unsigned int row_id, bool waitForResult,
+                             unsigned int lock_budget) -> bool {
   // Set job parameters
   Job job;
   job.command = command;
 
   job.transaction_id = transaction_id;
   job.row_id = row_id;
+  job.lock_budget = lock_budget;
 
   // Need to track, when job is finished or error has occurred
-  if (waitForResult && (command == SHARED || command == EXCLUSIVE ||
-                        command == REGISTER || command == UNLOCK)) {
-    // Allocate dynamic memory in the untrusted part of the application, so the
-    // enclave can modify it via its pointer
-    job.finished = new bool;
-    job.error = new bool;
-    *job.finished = false;
-    *job.error = false;
+  bool tracked = waitForResult && (command == SHARED || command == EXCLUSIVE ||
+                                   command == REGISTER || command == UNLOCK);
+  if (tracked) {
+    callerJobResult.finished = JOB_PENDING;
+    callerJobResult.error = false;
+    job.finished = &callerJobResult.finished;
+    job.error = &callerJobResult.error;
   }
 
   job.wait_for_result = waitForResult;
   send_job(&job);
-  if (waitForResult && (command == SHARED || command == EXCLUSIVE ||
-                        command == REGISTER || command == UNLOCK)) {
+  if (tracked) {
     // Need to wait until job is finished because we need to be registered for
     // subsequent requests or because we need to wait for the return value
-    while (!*job.finished) {
-      continue;
-    }
-    delete job.finished;
+    waitForCompletion(&callerJobResult.finished);
 
     // Check if an error occured
-    if (*job.error) {
-      return false;
-    }
-    delete job.error;
+    return !callerJobResult.error;
   }
 
   return true;
 }
 
+auto LockManager::create_async_job(Command command,
+                                   unsigned int transaction_id,
+                                   unsigned int row_id,
+                                   unsigned int lock_budget) -> JobFuture {
+  // Unlike the result of a synchronous job, it is kept beyond this call
+  JobFuture future;
+  future.result->finished = JOB_PENDING;
+  future.result->error = false;
+
+  Job job;
+  job.command = command;
+  job.transaction_id = transaction_id;
+  job.row_id = row_id;
+  job.lock_budget = lock_budget;
+  job.finished = &future.result->finished;
+  job.error = &future.result->error;
+  job.wait_for_result = true;
+  send_job(&job);
+  return future;
+}
+
 void LockManager::send_job(void *data) {
   Command command = ((Job *)data)->command;
   Job new_job;
@@ -132,11 +246,7 @@ void LockManager::send_job(void *data) {
       // Send exit message to all of the worker threads
       for (int i = 0; i < arg.num_threads; i++) {
         spdlog::info("Sending QUIT to all threads");
-
-        pthread_mutex_lock(&queue_mutex[i]);
-        queue[i].push(new_job);
-        pthread_cond_signal(&job_cond[i]);
-        pthread_mutex_unlock(&queue_mutex[i]);
+        push_job(i, new_job);
       }
       return;
 
@@ -147,29 +257,27 @@ void LockManager::send_job(void *data) {
 
       new_job.transaction_id = ((Job *)data)->transaction_id;
       new_job.row_id = ((Job *)data)->row_id;
+      new_job.lock_budget =
+          command != UNLOCK ? ((Job *)data)->lock_budget : 0;
       new_job.wait_for_result = ((Job *)data)->wait_for_result;
 
       if (new_job.wait_for_result) {
         new_job.finished = ((Job *)data)->finished;
         new_job.error = ((Job *)data)->error;
       }
-      // If transaction is not registered, abort the request
-      if (get(transactionTable_, new_job.transaction_id) == nullptr) {
+      // If transaction is not registered, abort the request. A lock request
+      // with a lock budget registers the transaction itself.
+      if (new_job.lock_budget == 0 && !is_registered(new_job.transaction_id)) {
         spdlog::error("Need to register transaction before lock requests");
         if (new_job.wait_for_result) {
           *new_job.error = true;
-          *new_job.finished = true;
+          completeJob(new_job.finished, wakeJob);
         }
         return;
       }
 
       // Send the requests to specific worker thread
-      int thread_id = (int)((new_job.row_id % lockTableSize_) /
-                            ((float)lockTableSize_ / (arg.num_threads - 1)));
-      pthread_mutex_lock(&queue_mutex[thread_id]);
-      queue[thread_id].push(new_job);
-      pthread_cond_signal(&job_cond[thread_id]);
-      pthread_mutex_unlock(&queue_mutex[thread_id]);
+      push_job(get_worker_thread(new_job.row_id), new_job);
       break;
     }
     case REGISTER: {
@@ -178,12 +286,10 @@ void LockManager::send_job(void *data) {
       new_job.finished = ((Job *)data)->finished;
       new_job.error = ((Job *)data)->error;
 
-      // Send the requests to thread responsible for registering
-      // transactions
-      pthread_mutex_lock(&queue_mutex[arg.tx_thread_id]);
-      queue[arg.tx_thread_id].push(new_job);
-      pthread_cond_signal(&job_cond[arg.tx_thread_id]);
-      pthread_mutex_unlock(&queue_mutex[arg.tx_thread_id]);
+      // Send the requests to the worker thread owning the shard of the
+      // transaction table the transaction belongs to
+      push_job(getTransactionShard(new_job.transaction_id, arg.num_threads),
+               new_job);
       break;
     }
     default:
@@ -192,6 +298,36 @@ void LockManager::send_job(void *data) {
   }
 }
 
+void LockManager::push_job(int thread_id, const Job &job) {
+  while (!try_push_job(thread_id, job)) {
+    // The worker thread is busy, as long as its queue is full
+    std::this_thread::yield();
+  }
+}
+
+auto LockManager::try_push_job(int thread_id, const Job &job) -> bool {
+  WorkerQueue &worker = workerQueues[thread_id];
+  if (!pushJob(&worker.jobs, job)) {
+    return false;
+  }
+
+  // Only a worker thread, that went to sleep on its empty queue, is signaled
+  if (needsWakeUp(&worker.jobs)) {
+    pthread_mutex_lock(&worker.mutex);
+    pthread_cond_signal(&worker.cond);
+    pthread_mutex_unlock(&worker.mutex);
+  }
+  return true;
+}
+
+void LockManager::flush_outbox(int thread_id) {
+  auto &outbox = workerStates_[thread_id].outbox;
+  while (!outbox.empty() &&
+         try_push_job(outbox.front().first, outbox.front().second)) {
+    outbox.pop_front();
+  }
+}
+
 void LockManager::process_request() {
   pthread_mutex_lock(&global_num_mutex);
 
@@ -200,25 +336,32 @@ void LockManager::process_request() {
 
   pthread_mutex_unlock(&global_num_mutex);
 
-  pthread_mutex_lock(&queue_mutex[thread_id]);
+  WorkerQueue &worker = workerQueues[thread_id];
+  Job cur_job;
   while (1) {
-    spdlog::info("Worker " + std::to_string(thread_id) + " waiting for jobs");
-    if (queue[thread_id].size() == 0) {
-      pthread_cond_wait(&job_cond[thread_id], &queue_mutex[thread_id]);
+    // Take every job there is, before going to sleep
+    if (!popJob(&worker.jobs, &cur_job)) {
+      // Another worker thread might wait for the jobs in the outbox
+      if (!workerStates_[thread_id].outbox.empty()) {
+        std::this_thread::yield();
+        flush_outbox(thread_id);
+        continue;
+      }
+      spdlog::info("Worker " + std::to_string(thread_id) + " waiting for jobs");
+      pthread_mutex_lock(&worker.mutex);
+      if (prepareToSleep(&worker.jobs)) {
+        pthread_cond_wait(&worker.cond, &worker.mutex);
+      }
+      wakeUp(&worker.jobs);
+      pthread_mutex_unlock(&worker.mutex);
       continue;
     }
 
     spdlog::info("Worker " + std::to_string(thread_id) + " got a job");
-    Job cur_job = queue[thread_id].front();
     Command command = cur_job.command;
 
-    pthread_mutex_unlock(&queue_mutex[thread_id]);
-
     switch (command) {
       case QUIT:
-        pthread_mutex_lock(&queue_mutex[thread_id]);
-        queue[thread_id].pop();
-        pthread_mutex_unlock(&queue_mutex[thread_id]);
         spdlog::info("Enclave worker quitting");
         return;
       case SHARED:
@@ -235,15 +378,17 @@ void LockManager::process_request() {
                   .c_str());
         }
 
-        bool ok = acquire_lock(cur_job.transaction_id, cur_job.row_id,
-                               command == EXCLUSIVE);
+        LockRequestResult result = acquire_lock(cur_job);
 
-        if (cur_job.wait_for_result) {
-          if (!ok) {
+        // The locks of an aborted transaction in other lock tables are queued
+        // for release, before the caller learns about the abort
+        flush_outbox(thread_id);
+        if (result != REQUEST_WAITING && cur_job.wait_for_result) {
+          if (result == REQUEST_DENIED) {
             *cur_job.error = true;
           }
 
-          *cur_job.finished = true;
+          completeJob(cur_job.finished, wakeJob);
         }
         break;
       }
@@ -252,10 +397,44 @@ void LockManager::process_request() {
             ("(UNLOCK) TXID: " + std::to_string(cur_job.transaction_id) +
              ", RID: " + std::to_string(cur_job.row_id))
                 .c_str());
-        release_lock(cur_job.transaction_id, cur_job.row_id);
+        bool released = release_lock(cur_job.transaction_id, cur_job.row_id);
         if (cur_job.wait_for_result) {
-          *cur_job.finished = true;
+          if (!released) {
+            *cur_job.error = true;
+          }
+          completeJob(cur_job.finished, wakeJob);
+        }
+        break;
+      }
+      case RELEASE:
+        drop_waiters(thread_id, cur_job.transaction_id, cur_job.row_id);
+        release_row(thread_id, cur_job.transaction_id, cur_job.row_id);
+        break;
+      case LOCK_SET: {
+        auto &group = *static_cast<LockSetGroup *>(cur_job.lock_set);
+        spdlog::info(("(LOCK_SET) TXID: " +
+                      std::to_string(cur_job.transaction_id) + ", " +
+                      std::to_string(group.locks.size()) + " locks")
+                         .c_str());
+        if (!acquire_lock_set(cur_job.transaction_id, group)) {
+          *cur_job.error = true;
         }
+        completeJob(cur_job.finished, wakeJob);
+        break;
+      }
+      case UNDO_LOCK_SET: {
+        auto &group = *static_cast<LockSetGroup *>(cur_job.lock_set);
+        TransactionTableShard &shard =
+            get_transaction_shard(cur_job.transaction_id);
+        {
+          std::lock_guard<std::mutex> guard(shard.mutex);
+          auto transaction =
+              (Transaction *)get(shard.transactions, cur_job.transaction_id);
+          if (transaction != nullptr) {
+            undo_lock_set(transaction, group, group.changes.size());
+          }
+        }
+        completeJob(cur_job.finished, wakeJob);
         break;
       }
       case REGISTER: {
@@ -265,107 +444,426 @@ void LockManager::process_request() {
             ("Registering transaction " + std::to_string(transactionId))
                 .c_str());
 
-        if (contains(transactionTable_, transactionId)) {
-          spdlog::error("Transaction is already registered");
+        if (!register_transaction(transactionId)) {
           *cur_job.error = true;
-        } else {
-          set(transactionTable_, transactionId, newTransaction(transactionId));
         }
-        *cur_job.finished = true;
+        completeJob(cur_job.finished, wakeJob);
         break;
       }
       default:
         spdlog::error("Worker received unknown command");
     }
 
-    pthread_mutex_lock(&queue_mutex[thread_id]);
-    queue[thread_id].pop();
+    // The job may have released locks, which others wait for
+    grant_waiters(thread_id);
+    flush_outbox(thread_id);
   }
 
   return;
 }
 
-auto LockManager::acquire_lock(unsigned int transactionId, unsigned int rowId,
-                               bool isExclusive) -> bool {
-  int ret;
+auto LockManager::register_transaction(unsigned int transactionId) -> bool {
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  if (contains(shard.transactions, transactionId)) {
+    spdlog::error("Transaction is already registered");
+    return false;
+  }
+  set(shard.transactions, transactionId, newTransaction(transactionId));
+  return true;
+}
+
+auto LockManager::is_registered(unsigned int transactionId) -> bool {
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  return contains(shard.transactions, transactionId);
+}
 
-  // Get the transaction object for the given transaction ID
-  auto transaction = (Transaction *)get(transactionTable_, transactionId);
+auto LockManager::acquire_lock(const Job &job) -> LockRequestResult {
+  unsigned int transactionId = job.transaction_id;
+  unsigned int rowId = job.row_id;
+  bool isExclusive = job.command == EXCLUSIVE;
+  int threadId = get_worker_thread(rowId);
+
+  // Get the transaction object for the given transaction ID and keep its shard
+  // locked, until the transaction is updated
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto transaction = (Transaction *)get(shard.transactions, transactionId);
+  if (transaction == nullptr && job.lock_budget > 0) {
+    // Register the transaction together with its first lock. Since the mutex
+    // of the shard is held, no other worker thread can register it meanwhile.
+    transaction = newTransaction(transactionId, job.lock_budget);
+    set(shard.transactions, transactionId, transaction);
+  }
   if (transaction == nullptr) {
     spdlog::error("Transaction was not registered");
-    return false;
+    return REQUEST_DENIED;
   }
 
   // Get the lock object for the given row ID
-  auto lock = (Lock *)get(lockTable_, rowId);
+  HashTable *lockTable = get_lock_table(rowId);
+  auto lock = (Lock *)get(lockTable, rowId);
   if (lock == nullptr) {
     lock = newLock();
-    set(lockTable_, rowId, (void *)lock);
+    set(lockTable, rowId, (void *)lock);
   }
 
   // Check if 2PL is violated
   if (!transaction->growing_phase) {
     spdlog::error("Cannot acquire more locks according to 2PL");
-    abort_transaction(transaction);
-    return false;
+    abort_transaction(transaction, threadId);
+    return REQUEST_DENIED;
   }
 
   // Comment out for evaluation ->
   // Check for upgrade request
-  if (hasLock(transaction, rowId) && isExclusive && !lock->exclusive) {
-    ret = upgrade(lock, transactionId);
+  bool isUpgrade =
+      hasLock(transaction, rowId) && isExclusive && !lock->exclusive;
+  if (!isUpgrade && hasLock(transaction, rowId)) {
+    spdlog::error("Request for already acquired lock");
+    abort_transaction(transaction, threadId);
+    return REQUEST_DENIED;
+  }
+  // <- Comment out for evaluation
 
-    if (!ret) {
-      abort_transaction(transaction);
-      return false;
-    }
-    return ret;
+  // Acquire lock in requested mode (shared, exclusive). A new owner must not
+  // overtake the requests waiting for the lock.
+  bool ok = isUpgrade ? upgrade(lock, transactionId)
+                      : lock->waiters.empty() &&
+                            addLock(transaction, rowId, isExclusive, lock);
+  if (ok) {
+    return REQUEST_GRANTED;
+  }
+
+  if (__atomic_load_n(&arg.conflict_policy, __ATOMIC_RELAXED) == WAIT_DIE &&
+      mayWait(lock, transactionId)) {
+    lock->waiters.push_back({job, isUpgrade});
+    transaction->waiting_rows.insert(rowId);
+    return REQUEST_WAITING;
+  }
+  abort_transaction(transaction, threadId);
+  return REQUEST_DENIED;
+}
+
+auto LockManager::acquire_lock_set(unsigned int transactionId,
+                                   LockSetGroup &group) -> bool {
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto transaction = (Transaction *)get(shard.transactions, transactionId);
+  if (transaction == nullptr && group.lockBudget > 0) {
+    transaction = newTransaction(transactionId, group.lockBudget);
+    set(shard.transactions, transactionId, transaction);
+  }
+  if (transaction == nullptr) {
+    spdlog::error("Transaction was not registered");
+    return false;
   }
+  if (!transaction->growing_phase || transaction->aborted) {
+    spdlog::error("Cannot acquire more locks according to 2PL");
+    return false;
+  }
+
+  HashTable *lockTable = get_lock_table(group.locks.front().first);
+  group.changes.clear();
+  for (const auto &[rowId, isExclusive] : group.locks) {
+    auto lock = (Lock *)get(lockTable, rowId);
+    if (lock == nullptr) {
+      lock = newLock();
+      set(lockTable, rowId, (void *)lock);
+    }
+
+    bool ok = true;
+    LockSetChange change = LOCK_UNCHANGED;
+    if (!hasLock(transaction, rowId)) {
+      // Like a single lock request, it does not overtake waiting requests
+      ok = lock->waiters.empty() &&
+           addLock(transaction, rowId, isExclusive, lock);
+      change = LOCK_GRANTED;
+    } else if (isExclusive && !lock->exclusive) {
+      ok = upgrade(lock, transactionId);
+      change = LOCK_UPGRADED;
+    }
 
-  // Acquire lock in requested mode (shared, exclusive)
-  if (!hasLock(transaction, rowId)) {
-    // <- Comment out for evaluation
-    ret = addLock(transaction, rowId, isExclusive, lock);
-    if (!ret) {
-      abort_transaction(transaction);
+    if (!ok) {
+      if (lock->owners.size() == 0 && lock->waiters.empty()) {
+        remove(lockTable, rowId);
+        delete lock;
+      }
+      undo_lock_set(transaction, group, group.changes.size());
       return false;
     }
-    return ret;
-    // Comment out for evaluation ->
+    group.changes.push_back(change);
   }
-  // <- Comment out for evaluation
+  return true;
+}
 
-  spdlog::error("Request for already acquired lock");
-  abort_transaction(transaction);
-  return false;
+void LockManager::undo_lock_set(Transaction *transaction, LockSetGroup &group,
+                                size_t count) {
+  for (size_t i = count; i-- > 0;) {
+    unsigned int rowId = group.locks[i].first;
+    HashTable *lockTable = get_lock_table(rowId);
+    auto lock = (Lock *)get(lockTable, rowId);
+    switch (group.changes[i]) {
+      case LOCK_GRANTED:
+        transaction->mut.lock();
+        transaction->locked_rows.erase(rowId);
+        transaction->lock_budget++;
+        transaction->mut.unlock();
+        release_row(get_worker_thread(rowId), transaction->transaction_id,
+                    rowId);
+        break;
+      case LOCK_UPGRADED:
+        lock->exclusive = false;
+        if (!lock->waiters.empty()) {
+          workerStates_[get_worker_thread(rowId)].releasedRows.push_back(
+              rowId);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  group.changes.clear();
 }
 
-void LockManager::release_lock(unsigned int transactionId, unsigned int rowId) {
+auto LockManager::release_lock(unsigned int transactionId, unsigned int rowId)
+    -> bool {
   // Get the transaction object
-  auto transaction = (Transaction *)get(transactionTable_, transactionId);
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto transaction = (Transaction *)get(shard.transactions, transactionId);
   if (transaction == nullptr) {
     spdlog::error("Transaction was not registered");
-    return;
+    return false;
   }
 
   // Get the lock object
-  auto lock = (Lock *)get(lockTable_, rowId);
+  HashTable *lockTable = get_lock_table(rowId);
+  auto lock = (Lock *)get(lockTable, rowId);
   if (lock == nullptr) {
     spdlog::error("Lock does not exist");
-    return;
+    return false;
   }
 
-  releaseLock(transaction, rowId, lockTable_);
+  bool released = hasLock(transaction, rowId);
+  bool hasWaiters = !lock->waiters.empty();
+  releaseLock(transaction, rowId, lockTable);
+  if (released && hasWaiters) {
+    workerStates_[get_worker_thread(rowId)].releasedRows.push_back(rowId);
+  }
 
-  // If the transaction released its last lock, delete it
-  if (transaction->locked_rows.size() == 0) {
-    remove(transactionTable_, transactionId);
+  // If the transaction released its last lock and waits for no other one,
+  // delete it
+  if (transaction->locked_rows.size() == 0 &&
+      transaction->waiting_rows.empty()) {
+    remove(shard.transactions, transactionId);
     delete transaction;
   }
+  return released;
 }
 
-void LockManager::abort_transaction(Transaction *transaction) {
-  remove(transactionTable_, transaction->transaction_id);
-  releaseAllLocks(transaction, lockTable_);
+void LockManager::grant_waiters(int thread_id) {
+  WorkerState &state = workerStates_[thread_id];
+  while (!state.releasedRows.empty()) {
+    unsigned int rowId = state.releasedRows.back();
+    state.releasedRows.pop_back();
+    HashTable *lockTable = lockTables_[thread_id];
+    auto lock = (Lock *)get(lockTable, rowId);
+    if (lock == nullptr) {
+      continue;  // the row was released twice
+    }
+
+    while (lock != nullptr && !lock->waiters.empty()) {
+      LockWaiter waiter = lock->waiters.front();
+      unsigned int transactionId = waiter.job.transaction_id;
+      bool granted = false;
+      {
+        TransactionTableShard &shard = get_transaction_shard(transactionId);
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        auto transaction =
+            (Transaction *)get(shard.transactions, transactionId);
+        if (transaction != nullptr && !isGrantable(lock, waiter)) {
+          break;
+        }
+        // Taken off the lock first, since aborting drops the other waiting
+        // requests of the transaction
+        lock->waiters.pop_front();
+        if (transaction != nullptr) {
+          transaction->waiting_rows.erase(rowId);
+          if (transaction->growing_phase) {
+            granted = waiter.upgrade
+                          ? upgrade(lock, transactionId)
+                          : addLock(transaction, rowId,
+                                    waiter.job.command == EXCLUSIVE, lock);
+          }
+          if (!granted) {
+            abort_transaction(transaction, thread_id);
+          }
+        }
+      }
+
+      if (waiter.job.wait_for_result) {
+        if (!granted) {
+          *waiter.job.error = true;
+        }
+        completeJob(waiter.job.finished, wakeJob);
+      }
+      // Aborting may have released the last owner of the lock and deleted it
+      lock = (Lock *)get(lockTable, rowId);
+    }
+
+    if (lock != nullptr && lock->owners.size() == 0 &&
+        lock->waiters.empty()) {
+      remove(lockTable, rowId);
+      delete lock;
+    }
+  }
+}
+
+void LockManager::release_row(int thread_id, unsigned int transactionId,
+                              unsigned int rowId) {
+  HashTable *lockTable = lockTables_[thread_id];
+  auto lock = (Lock *)get(lockTable, rowId);
+  if (lock == nullptr) {
+    return;
+  }
+
+  release(lock, transactionId);
+  if (!lock->waiters.empty()) {
+    workerStates_[thread_id].releasedRows.push_back(rowId);
+  } else if (lock->owners.size() == 0) {
+    remove(lockTable, rowId);
+    delete lock;
+  }
+}
+
+void LockManager::drop_waiters(int thread_id, unsigned int transactionId,
+                               unsigned int rowId) {
+  auto lock = (Lock *)get(lockTables_[thread_id], rowId);
+  if (lock == nullptr) {
+    return;
+  }
+
+  auto waiter = lock->waiters.begin();
+  while (waiter != lock->waiters.end()) {
+    if (waiter->job.transaction_id != transactionId) {
+      waiter++;
+      continue;
+    }
+    if (waiter->job.wait_for_result) {
+      *waiter->job.error = true;
+      completeJob(waiter->job.finished, wakeJob);
+    }
+    waiter = lock->waiters.erase(waiter);
+  }
+}
+
+void LockManager::abort_transaction(Transaction *transaction, int thread_id) {
+  unsigned int transactionId = transaction->transaction_id;
+  remove(get_transaction_shard(transactionId).transactions, transactionId);
+
+  // Its requests stop waiting as well, so that they do not make younger
+  // transactions die in vain
+  std::set<int> rowIds = transaction->locked_rows;
+  rowIds.insert(transaction->waiting_rows.begin(),
+                transaction->waiting_rows.end());
+  for (int rowId : rowIds) {
+    int owner = get_worker_thread(rowId);
+    if (owner == thread_id) {
+      drop_waiters(thread_id, transactionId, rowId);
+      release_row(thread_id, transactionId, rowId);
+      continue;
+    }
+
+    // Only the worker thread owning the lock table may change it
+    Job job;
+    job.command = RELEASE;
+    job.transaction_id = transactionId;
+    job.row_id = rowId;
+    job.lock_budget = 0;
+    job.wait_for_result = false;
+    workerStates_[thread_id].outbox.emplace_back(owner, job);
+  }
   delete transaction;
-}
\ No newline at end of file
+}
+
+auto LockManager::get_worker_thread(unsigned int rowId) -> int {
+  return (int)((rowId % lockTableSize_) /
+               ((float)lockTableSize_ / (arg.num_threads - 1)));
+}
+
+auto LockManager::get_transaction_shard(unsigned int transactionId)
+    -> TransactionTableShard & {
+  return transactionTable_[getTransactionShard(transactionId, arg.num_threads)];
+}
+
+auto LockManager::get_lock_table(unsigned int rowId) -> HashTable * {
+  return lockTables_[get_worker_thread(rowId)];
+}
+
+void wakeJob(volatile int *finished) {
+  auto result = (JobResult *)finished;  // the completion word comes first
+  if (result->callback != nullptr) {
+    result->callback(result->callback_arg);
+  } else {
+    wakeCompletion(finished);
+  }
+}
+
+JobFuture::JobFuture() : result(new JobResult()) {}
+
+JobFuture::JobFuture(JobFuture &&other) noexcept : result(other.result) {
+  other.result = nullptr;
+}
+
+auto JobFuture::operator=(JobFuture &&other) noexcept -> JobFuture & {
+  if (this != &other) {
+    if (result != nullptr) {
+      collect();
+    }
+    result = other.result;
+    other.result = nullptr;
+  }
+  return *this;
+}
+
+JobFuture::~JobFuture() {
+  if (result != nullptr) {
+    collect();
+  }
+}
+
+auto JobFuture::isReady() -> bool {
+  return result != nullptr &&
+         __atomic_load_n(&result->finished, __ATOMIC_ACQUIRE) == JOB_FINISHED;
+}
+
+void JobFuture::notifyWhenReady(void (*callback)(void *arg), void *arg) {
+  result->callback = callback;
+  result->callback_arg = arg;
+
+  // Announce the callback like a sleeping caller, unless the job was finished
+  // in the meantime
+  int expected = JOB_PENDING;
+  if (!__atomic_compare_exchange_n(&result->finished, &expected,
+                                   JOB_PENDING_WAITER, false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    callback(arg);
+  }
+}
+
+auto JobFuture::get() -> bool {
+  if (result == nullptr) {
+    throw std::logic_error("The result of the job was already collected");
+  }
+  return collect();
+}
+
+auto JobFuture::collect() -> bool {
+  waitForCompletion(&result->finished);
+  bool ok = !result->error;
+  delete result;
+  result = nullptr;
+  return ok;
+}
@@ -9,6 +9,10 @@ Transaction* newTransaction(int transactionId, int lockBudget) {
   return transaction;
 }
 
+auto getTransactionShard(unsigned int transactionId, int numShards) -> int {
+  return transactionId % numShards;
+}
+
 auto addLock(Transaction* transaction, int rowId, bool isExclusive, Lock* lock)
     -> bool {
   if (transaction->aborted) {
@@ -42,7 +46,7 @@ void releaseLock(Transaction* transaction, int rowId, HashTable* lockTable) {
     auto lock = (Lock*)get(lockTable, rowId);
     release(lock, transaction->transaction_id);
 
-    if (lock->owners.size() == 0) {
+    if (lock->owners.size() == 0 && lock->waiters.empty()) {
       remove(lockTable, rowId);
       delete lock;
     }
@@ -57,10 +61,10 @@ void releaseAllLocks(Transaction* transaction, HashTable* lockTable) {
   for (auto locked_row : transaction->locked_rows) {
     auto lock = (Lock*)get(lockTable, locked_row);
     release(lock, transaction->transaction_id);
-    if (lock->owners.size() == 0) {
+    if (lock->owners.size() == 0 && lock->waiters.empty()) {
       remove(lockTable, locked_row);
     }
   }
   transaction->locked_rows.clear();
   transaction->aborted = true;
-};
\ No newline at end of file
+}
\ No newline at end of file
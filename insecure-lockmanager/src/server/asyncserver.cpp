@@ -0,0 +1,144 @@
+#include "asyncserver.h"
+
+AsyncLockingServiceImpl::AsyncLockingServiceImpl(
+    int numCompletionQueueThreads, LockConflictPolicy conflictPolicy) {
+  // The wrapped LockingServiceImpl is default constructed
+  lockManager_.setConflictPolicy(conflictPolicy);
+  for (int i = 0; i < numCompletionQueueThreads; i++) {
+    workers_.push_back(std::make_unique<CompletionQueueWorker>());
+  }
+}
+
+AsyncLockingServiceImpl::~AsyncLockingServiceImpl() { shutdown(); }
+
+auto AsyncLockingServiceImpl::start(ServerBuilder& builder) -> Server* {
+  builder.RegisterService(this);
+  for (auto& worker : workers_) {
+    worker->queue = builder.AddCompletionQueue();
+  }
+  server_ = builder.BuildAndStart();
+  if (server_ == nullptr) {
+    return nullptr;
+  }
+
+  for (auto& worker : workers_) {
+    CompletionQueueWorker& w = *worker;
+    request_call(SHARED, w);
+    request_call(EXCLUSIVE, w);
+    request_call(UNLOCK, w);
+    w.server = std::thread([this, &w]() { serve(w); });
+  }
+  return server_.get();
+}
+
+void AsyncLockingServiceImpl::shutdown() {
+  if (server_ == nullptr) {
+    return;
+  }
+
+  // The calls in flight are still answered, the requested ones are cancelled
+  server_->Shutdown();
+  for (auto& worker : workers_) {
+    worker->queue->Shutdown();
+    worker->server.join();
+  }
+  server_ = nullptr;
+}
+
+void AsyncLockingServiceImpl::request_call(Command command,
+                                           CompletionQueueWorker& worker) {
+  auto* call = new AsyncCall();
+  call->command = command;
+  ServerCompletionQueue* queue = worker.queue.get();
+  switch (command) {
+    case SHARED:
+      RequestLockShared(&call->context, &call->request, &call->responder,
+                        queue, queue, call);
+      break;
+    case EXCLUSIVE:
+      RequestLockExclusive(&call->context, &call->request, &call->responder,
+                           queue, queue, call);
+      break;
+    default:
+      RequestUnlock(&call->context, &call->request, &call->responder, queue,
+                    queue, call);
+      break;
+  }
+}
+
+void AsyncLockingServiceImpl::serve(CompletionQueueWorker& worker) {
+  void* tag;
+  bool ok;
+  while (worker.queue->Next(&tag, &ok)) {
+    auto* call = static_cast<AsyncCall*>(tag);
+    if (call->finished || !ok) {
+      // The response was sent, or the server is shutting down
+      delete call;
+      continue;
+    }
+    if (call->submitted) {
+      // A worker thread finished the job of the call
+      complete_call(call);
+      continue;
+    }
+
+    // Keep a call of the same RPC waiting for the next client
+    request_call(call->command, worker);
+    start_call(call, worker);
+  }
+}
+
+void AsyncLockingServiceImpl::start_call(AsyncCall* call,
+                                         CompletionQueueWorker& worker) {
+  const LockRequest& request = call->request;
+  if (!request.wait_for_signature()) {
+    bool ok = true;
+    if (call->command == UNLOCK) {
+      lockManager_.unlock(request.transaction_id(), request.row_id(), false);
+    } else {
+      ok = lockManager_.lock(request.transaction_id(), request.row_id(),
+                             call->command == EXCLUSIVE, false,
+                             request.lock_budget());
+    }
+    finish_call(call, ok ? Status::OK : Status::CANCELLED);
+    return;
+  }
+
+  if (call->command == UNLOCK) {
+    call->future =
+        lockManager_.unlockAsync(request.transaction_id(), request.row_id());
+  } else {
+    call->future = lockManager_.lockAsync(
+        request.transaction_id(), request.row_id(),
+        call->command == EXCLUSIVE, request.lock_budget());
+  }
+
+  if (call->future->isReady()) {
+    complete_call(call);
+    return;
+  }
+  call->submitted = true;
+  call->queue = worker.queue.get();
+  call->future->notifyWhenReady(post_call, call);
+}
+
+void AsyncLockingServiceImpl::post_call(void* tag) {
+  auto* call = static_cast<AsyncCall*>(tag);
+  // An alarm, that expired already, delivers the call right away
+  call->alarm.Set(call->queue, gpr_now(GPR_CLOCK_MONOTONIC), call);
+}
+
+void AsyncLockingServiceImpl::complete_call(AsyncCall* call) {
+  bool ok = call->future->get();
+  if (call->command == UNLOCK || ok) {
+    finish_call(call, Status::OK);
+  } else {
+    finish_call(call, Status::CANCELLED);
+  }
+}
+
+void AsyncLockingServiceImpl::finish_call(AsyncCall* call,
+                                          const Status& status) {
+  call->finished = true;
+  call->responder.Finish(call->response, status, call);
+}
@@ -1,5 +1,9 @@
 #include "server.h"
 
+LockingServiceImpl::LockingServiceImpl(LockConflictPolicy conflictPolicy) {
+  lockManager_.setConflictPolicy(conflictPolicy);
+}
+
 auto LockingServiceImpl::RegisterTransaction(ServerContext* context,
                                              const RegistrationRequest* request,
                                              RegistrationResponse* response)
@@ -19,8 +23,10 @@ auto LockingServiceImpl::LockExclusive(ServerContext* context,
   unsigned int transaction_id = request->transaction_id();
   unsigned int row_id = request->row_id();
   bool wait_for_signature = request->wait_for_signature();
+  unsigned int lock_budget = request->lock_budget();
 
-  if (lockManager_.lock(transaction_id, row_id, true, wait_for_signature)) {
+  if (lockManager_.lock(transaction_id, row_id, true, wait_for_signature,
+                        lock_budget)) {
     return Status::OK;
   }
   return Status::CANCELLED;
@@ -32,8 +38,10 @@ auto LockingServiceImpl::LockShared(ServerContext* context,
   unsigned int transaction_id = request->transaction_id();
   unsigned int row_id = request->row_id();
   bool wait_for_signature = request->wait_for_signature();
+  unsigned int lock_budget = request->lock_budget();
 
-  if (lockManager_.lock(transaction_id, row_id, false, wait_for_signature)) {
+  if (lockManager_.lock(transaction_id, row_id, false, wait_for_signature,
+                        lock_budget)) {
     return Status::OK;
   }
   return Status::CANCELLED;
@@ -48,4 +56,20 @@ auto LockingServiceImpl::Unlock(ServerContext* context,
 
   lockManager_.unlock(transaction_id, row_id, wait_for_signature);
   return Status::OK;
+}
+
+auto LockingServiceImpl::AcquireLockSet(ServerContext* context,
+                                        const LockSetRequest* request,
+                                        LockSetResponse* response) -> Status {
+  std::vector<std::pair<unsigned int, bool>> locks;
+  locks.reserve(request->locks_size());
+  for (const LockSetRequest::Lock& lock : request->locks()) {
+    locks.emplace_back(lock.row_id(), lock.exclusive());
+  }
+
+  if (lockManager_.acquireLockSet(request->transaction_id(), locks,
+                                  request->lock_budget())) {
+    return Status::OK;
+  }
+  return Status::CANCELLED;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "hashtable.h"
 #include "lock.h"
 
@@ -207,4 +209,71 @@ TEST(HashTableTest, keyBiggerThanSize) {
   EXPECT_TRUE(get(hashTable, 1) != nullptr);
   EXPECT_TRUE(get(hashTable, 2) != nullptr);
   EXPECT_TRUE(get(hashTable, 3) != nullptr);
-}
\ No newline at end of file
+}
+
+/*
+ ********************************
+ * RESIZING
+ ********************************
+ */
+
+TEST(HashTableTest, growsWhenLoadFactorIsExceeded) {
+  HashTable* hashTable = newHashTable(2);
+  int numEntries = 2 * kHashTableMaxLoadFactor + 1;
+  for (int i = 0; i < numEntries; i++) {
+    set(hashTable, i, (void*)newLock());
+  }
+
+  // The new table is allocated, but the entries are still in the old one
+  EXPECT_TRUE(isRehashing(hashTable));
+  EXPECT_EQ(hashTable->size, 4);
+  EXPECT_EQ(hashTable->old_size, 2);
+  for (int i = 0; i < numEntries; i++) {
+    EXPECT_TRUE(contains(hashTable, i));
+  }
+}
+
+TEST(HashTableTest, rehashingMigratesEntriesIncrementally) {
+  HashTable* hashTable = newHashTable(16);
+  int numEntries = 16 * kHashTableMaxLoadFactor + 1;
+  std::vector<Lock*> locks;
+  for (int i = 0; i < numEntries; i++) {
+    locks.push_back(newLock());
+    set(hashTable, i, (void*)locks[i]);
+  }
+  ASSERT_TRUE(isRehashing(hashTable));
+
+  // Each operation migrates kHashTableRehashStep buckets of the old table
+  int operations = 0;
+  while (isRehashing(hashTable)) {
+    EXPECT_EQ(hashTable->rehash_index, operations * kHashTableRehashStep);
+    remove(hashTable, numEntries);  // any operation on the table
+    operations++;
+  }
+  EXPECT_EQ(operations, 16 / kHashTableRehashStep);
+
+  // The values were moved without being copied
+  EXPECT_EQ(hashTable->size, 32);
+  EXPECT_EQ(hashTable->num_entries, numEntries);
+  for (int i = 0; i < numEntries; i++) {
+    EXPECT_EQ(get(hashTable, i), (void*)locks[i]);
+  }
+}
+
+TEST(HashTableTest, shrinksToInitialSize) {
+  HashTable* hashTable = newHashTable(2);
+  for (int i = 0; i < 100; i++) {
+    set(hashTable, i, (void*)newLock());
+  }
+  EXPECT_GT(hashTable->size, 2);
+
+  for (int i = 0; i < 100; i++) {
+    remove(hashTable, i);
+  }
+  while (isRehashing(hashTable)) {
+    remove(hashTable, 100);
+  }
+
+  EXPECT_EQ(hashTable->size, 2);
+  EXPECT_EQ(hashTable->num_entries, 0);
+}
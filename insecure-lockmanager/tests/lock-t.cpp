@@ -68,4 +68,40 @@ TEST(LockTest, releaseUnownedLock) {
   EXPECT_TRUE(lock->exclusive);
   EXPECT_EQ(lock->owners.size(), 1);
   EXPECT_TRUE(lock->owners.find(kTransactionIdA) != lock->owners.end());
-}
\ No newline at end of file
+}
+
+// Only a transaction older than every owner and waiter may wait for a lock
+TEST(LockTest, waitDie) {
+  Lock* lock = newLock();
+  EXPECT_TRUE(getExclusiveAccess(lock, 5));
+  EXPECT_TRUE(mayWait(lock, 3));
+  EXPECT_FALSE(mayWait(lock, 7));
+
+  Job job;
+  job.command = SHARED;
+  job.transaction_id = 3;
+  lock->waiters.push_back({job, false});
+  EXPECT_FALSE(mayWait(lock, 4));
+  EXPECT_TRUE(mayWait(lock, 2));
+}
+
+// A waiting request is granted, once the lock is free for its mode
+TEST(LockTest, grantableWaiters) {
+  Lock* lock = newLock();
+  EXPECT_TRUE(getSharedAccess(lock, kTransactionIdA));
+  EXPECT_TRUE(getSharedAccess(lock, kTransactionIdB));
+
+  Job job;
+  job.command = EXCLUSIVE;
+  job.transaction_id = kTransactionIdA;
+  LockWaiter exclusive = {job, false};
+  LockWaiter upgrading = {job, true};
+  job.command = SHARED;
+  LockWaiter shared = {job, false};
+  EXPECT_TRUE(isGrantable(lock, shared));
+  EXPECT_FALSE(isGrantable(lock, exclusive));
+  EXPECT_FALSE(isGrantable(lock, upgrading));
+
+  release(lock, kTransactionIdB);
+  EXPECT_TRUE(isGrantable(lock, upgrading));
+}
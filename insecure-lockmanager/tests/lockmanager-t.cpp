@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <thread>
+#include <vector>
 
 #include "lock.h"
 #include "lockmanager.h"
@@ -37,6 +39,26 @@ TEST_F(LockManagerTest, acquiringLocks) {
   EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId + 1, true));
 };
 
+// A lock request with a lock budget registers the transaction
+TEST_F(LockManagerTest, lockRequestRegistersTransaction) {
+  LockManager lock_manager(2);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, false, true,
+                                kLockBudget));
+  EXPECT_FALSE(lock_manager.registerTransaction(kTransactionIdA));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId + 5000, true));
+};
+
+// The transaction is only registered, if it gets the lock
+TEST_F(LockManagerTest, failedLockRequestDoesNotRegister) {
+  LockManager lock_manager;
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, true));
+
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId, false, true,
+                                 kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB));
+};
+
 // Cannot get exclusive access when someone already has shared access
 TEST_F(LockManagerTest, wantExclusiveButAlreadyShared) {
   LockManager lock_manager;
@@ -166,4 +188,253 @@ TEST_F(LockManagerTest, notWaitingForSignature) {
   EXPECT_TRUE(lock_manager.lock(
       kTransactionIdA, 10000, false,
       true));  // waitung for signature return value at the end
-}
\ No newline at end of file
+}
+// Transactions registered concurrently on all shards of the transaction table
+// acquire and release locks spread over all worker threads
+TEST_F(LockManagerTest, concurrentTransactionsOnAllShards) {
+  const int kClients = 4;
+  const int kTransactionsPerClient = 50;
+  LockManager lock_manager(4);
+  std::atomic<int> failures = 0;
+
+  std::vector<std::thread> clients;
+  for (int client = 0; client < kClients; client++) {
+    clients.emplace_back([&, client]() {
+      for (int i = 0; i < kTransactionsPerClient; i++) {
+        unsigned int transactionId = client * kTransactionsPerClient + i + 1;
+        if (!lock_manager.registerTransaction(transactionId)) {
+          failures++;
+        }
+        for (unsigned int rowId = transactionId; rowId < 10000;
+             rowId += 2500) {
+          if (!lock_manager.lock(transactionId, rowId, false)) {
+            failures++;
+          }
+        }
+        for (unsigned int rowId = transactionId; rowId < 10000;
+             rowId += 2500) {
+          lock_manager.unlock(transactionId, rowId, true);
+        }
+      }
+    });
+  }
+  for (std::thread &client : clients) {
+    client.join();
+  }
+  EXPECT_EQ(failures, 0);
+
+  // Every transaction was removed after releasing its last lock
+  for (unsigned int transactionId = 1;
+       transactionId <= kClients * kTransactionsPerClient; transactionId++) {
+    EXPECT_TRUE(lock_manager.registerTransaction(transactionId));
+  }
+}
+
+// Many asynchronous lock requests are in flight at once and their futures
+// deliver the results, in any order
+TEST_F(LockManagerTest, asyncLockRequests) {
+  LockManager lock_manager(2);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA));
+  std::vector<JobFuture> futures;
+  for (unsigned int rowId = 1; rowId < 10000; rowId += 100) {
+    futures.push_back(lock_manager.lockAsync(kTransactionIdA, rowId, true));
+  }
+  for (int i = futures.size() - 1; i >= 0; i--) {
+    EXPECT_TRUE(futures[i].get());
+  }
+  EXPECT_THROW(futures[0].get(), std::logic_error);
+
+  futures.clear();
+  for (unsigned int rowId = 1; rowId < 10000; rowId += 100) {
+    futures.push_back(lock_manager.unlockAsync(kTransactionIdA, rowId));
+  }
+  for (JobFuture &future : futures) {
+    EXPECT_TRUE(future.get());
+  }
+}
+
+// The futures report denied lock requests and unlock requests for locks the
+// transaction does not own
+TEST_F(LockManagerTest, asyncRequestsReportErrors) {
+  LockManager lock_manager;
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, true));
+
+  JobFuture denied = lock_manager.lockAsync(kTransactionIdB, kRowId, false);
+  JobFuture unowned = lock_manager.unlockAsync(kTransactionIdA, kRowId + 1);
+  JobFuture unregistered =
+      lock_manager.lockAsync(kTransactionIdC, kRowId, true);
+  while (!denied.isReady()) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(denied.get());
+  EXPECT_FALSE(unowned.get());
+  EXPECT_FALSE(unregistered.get());
+  EXPECT_TRUE(lock_manager.unlockAsync(kTransactionIdA, kRowId).get());
+}
+
+// The callback of a future runs once the worker thread finished the job, or
+// right away, when it is already finished
+TEST_F(LockManagerTest, callbackRunsOnceJobIsFinished) {
+  LockManager lock_manager(1, WAIT_DIE);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true, true,
+                                kLockBudget));
+
+  std::atomic<int> notified(0);
+  auto notify = [](void *arg) { (*(std::atomic<int> *)arg)++; };
+  JobFuture waiting =
+      lock_manager.lockAsync(kTransactionIdA, kRowId, true, kLockBudget);
+  waiting.notifyWhenReady(notify, &notified);
+  EXPECT_EQ(notified, 0);
+  lock_manager.unlock(kTransactionIdB, kRowId, true);
+  while (notified == 0) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(waiting.get());
+
+  JobFuture finished = lock_manager.unlockAsync(kTransactionIdA, kRowId);
+  while (!finished.isReady()) {
+    std::this_thread::yield();
+  }
+  finished.notifyWhenReady(notify, &notified);
+  EXPECT_EQ(notified, 2);
+  EXPECT_TRUE(finished.get());
+}
+
+// A lock set spread over all worker threads is granted as a whole
+TEST_F(LockManagerTest, lockSetIsGrantedAtOnce) {
+  LockManager lock_manager(4);
+  std::vector<std::pair<unsigned int, bool>> locks = {
+      {9000, true}, {1, false}, {6000, false}, {3000, true}, {1, true}};
+  EXPECT_TRUE(lock_manager.acquireLockSet(kTransactionIdA, locks, kLockBudget));
+
+  // Row 1 was requested in both modes, so it is locked exclusively
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, 1, false, true, kLockBudget));
+  lock_manager.unlock(kTransactionIdA, 1, true);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdC, 1, true, true, kLockBudget));
+}
+
+// When a lock of the set conflicts, none is granted, but the transaction keeps
+// the locks it acquired before and can try again
+TEST_F(LockManagerTest, lockSetIsAllOrNothing) {
+  LockManager lock_manager(4);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, 1, false));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, 6000, true));
+
+  std::vector<std::pair<unsigned int, bool>> locks = {
+      {1, true}, {2, true}, {3000, false}, {6000, false}, {9000, true}};
+  EXPECT_FALSE(lock_manager.acquireLockSet(kTransactionIdA, locks));
+
+  // Row 1 is shared again and the other rows are free
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdC, 1, false, true, kLockBudget));
+  lock_manager.unlock(kTransactionIdC, 1, true);
+  for (unsigned int rowId : {2, 3000, 9000}) {
+    unsigned int transactionId = kTransactionIdC + rowId;
+    EXPECT_TRUE(
+        lock_manager.lock(transactionId, rowId, true, true, kLockBudget));
+    lock_manager.unlock(transactionId, rowId, true);
+  }
+
+  lock_manager.unlock(kTransactionIdB, 6000, true);
+  EXPECT_TRUE(lock_manager.acquireLockSet(kTransactionIdA, locks));
+}
+
+// An unregistered transaction without a lock budget gets no lock set
+TEST_F(LockManagerTest, lockSetNeedsRegistration) {
+  LockManager lock_manager(2);
+  EXPECT_FALSE(lock_manager.acquireLockSet(kTransactionIdA, {{kRowId, true}}));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true, true,
+                                kLockBudget));
+}
+
+// Under wait-die, an older transaction waits for the lock of a younger one and
+// gets it, once the younger one releases it
+TEST_F(LockManagerTest, olderTransactionWaitsForLock) {
+  LockManager lock_manager(1, WAIT_DIE);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true, true,
+                                kLockBudget));
+  JobFuture waiting =
+      lock_manager.lockAsync(kTransactionIdA, kRowId, true, kLockBudget);
+
+  // The single worker thread finished the request before this one
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdC, kRowId + 1, true, true,
+                                kLockBudget));
+  EXPECT_FALSE(waiting.isReady());
+
+  lock_manager.unlock(kTransactionIdB, kRowId, true);
+  EXPECT_TRUE(waiting.get());
+}
+
+// Under wait-die, a younger transaction does not wait for the lock of an older
+// one, but is aborted
+TEST_F(LockManagerTest, youngerTransactionDies) {
+  LockManager lock_manager(1, WAIT_DIE);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, false));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId + 1, false));
+
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId, true));
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId + 2, false));
+}
+
+// Waiting requests are granted in the order they arrived and a new request
+// does not overtake them, even if it does not conflict with the owners
+TEST_F(LockManagerTest, waitersAreGrantedInOrder) {
+  LockManager lock_manager(1, WAIT_DIE);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdC, kRowId, false, true,
+                                kLockBudget));
+  JobFuture exclusive =
+      lock_manager.lockAsync(kTransactionIdB, kRowId, true, kLockBudget);
+  JobFuture shared =
+      lock_manager.lockAsync(kTransactionIdA, kRowId, false, kLockBudget);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdC, kRowId + 1, true));
+  EXPECT_FALSE(exclusive.isReady());
+  EXPECT_FALSE(shared.isReady());
+
+  lock_manager.unlock(kTransactionIdC, kRowId, true);
+  EXPECT_TRUE(exclusive.get());
+  EXPECT_FALSE(shared.isReady());
+
+  lock_manager.unlock(kTransactionIdB, kRowId, true);
+  EXPECT_TRUE(shared.get());
+}
+
+// An aborted transaction releases its locks in the lock tables of all worker
+// threads, which grant them to the waiting requests
+TEST_F(LockManagerTest, abortGrantsWaitersOnAllWorkerThreads) {
+  LockManager lock_manager(2, WAIT_DIE);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, 1, true, true, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, 6000, true));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, 2, true, true, kLockBudget));
+  JobFuture waiting = lock_manager.lockAsync(kTransactionIdA, 6000, true);
+
+  // B is younger than A, so it dies instead of waiting for row 2
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, 2, false));
+  EXPECT_TRUE(waiting.get());
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdC, 1, true, true, kLockBudget));
+}
+
+// An aborted transaction stops waiting, so that younger transactions do not die
+// for its requests
+TEST_F(LockManagerTest, abortedTransactionStopsWaiting) {
+  LockManager lock_manager(1, WAIT_DIE);
+  unsigned int youngestId = kTransactionIdC + 1;
+  EXPECT_TRUE(lock_manager.lock(youngestId, kRowId, true, true, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId + 1, true, true,
+                                kLockBudget));
+  JobFuture waiting =
+      lock_manager.lockAsync(kTransactionIdB, kRowId, true, kLockBudget);
+
+  // B is younger than A, so it dies and its waiting request fails
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId + 1, false));
+  EXPECT_FALSE(waiting.get());
+
+  JobFuture next =
+      lock_manager.lockAsync(kTransactionIdC, kRowId, true, kLockBudget);
+  lock_manager.unlock(youngestId, kRowId, true);
+  EXPECT_TRUE(next.get());
+}
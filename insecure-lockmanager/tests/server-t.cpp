@@ -1,6 +1,8 @@
 
 #include <gtest/gtest.h>
 
+#include "asyncserver.h"
+#include "client.h"
 #include "server.h"
 
 class ServerTest : public ::testing::Test {
@@ -137,3 +139,47 @@ TEST_F(ServerTest, noExclusiveWhileShared) {
   transactionId_++;
   EXPECT_FALSE(getExclusiveLock(server));
 };
+
+// A lock set is granted as a whole or not at all
+TEST_F(ServerTest, acquireLockSet) {
+  LockingServiceImpl server;
+  LockSetRequest request;
+  LockSetResponse response;
+  request.set_transaction_id(transactionId_);
+  request.set_lock_budget(10);
+  for (unsigned int rowId : {3, 1, 2}) {
+    LockSetRequest::Lock* lock = request.add_locks();
+    lock->set_row_id(rowId);
+    lock->set_exclusive(true);
+  }
+  EXPECT_TRUE(server.AcquireLockSet(&context_, &request, &response).ok());
+
+  request.set_transaction_id(transactionId_ + 1);
+  EXPECT_FALSE(server.AcquireLockSet(&context_, &request, &response).ok());
+  request.set_transaction_id(transactionId_);
+  EXPECT_TRUE(server.AcquireLockSet(&context_, &request, &response).ok());
+}
+
+// Lock and unlock requests are served by completion queues, while the
+// registration stays synchronous
+TEST_F(ServerTest, asyncServer) {
+  AsyncLockingServiceImpl service(2);
+  ServerBuilder builder;
+  int port = 0;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(),
+                           &port);
+  ASSERT_NE(service.start(builder), nullptr);
+  LockingServiceClient client(grpc::CreateChannel(
+      "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+
+  EXPECT_TRUE(client.registerTransaction(transactionId_, 100));
+  for (unsigned int rowId = 1; rowId <= 50; rowId++) {
+    EXPECT_TRUE(client.requestSharedLock(transactionId_, rowId));
+  }
+  EXPECT_FALSE(client.requestExclusiveLock(transactionId_ + 1, 1, true, 10));
+  for (unsigned int rowId = 1; rowId <= 50; rowId++) {
+    EXPECT_TRUE(client.requestUnlock(transactionId_, rowId, true));
+  }
+  EXPECT_TRUE(client.requestExclusiveLock(transactionId_ + 2, 1, true, 10));
+  service.shutdown();
+}
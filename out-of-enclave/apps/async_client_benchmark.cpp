@@ -0,0 +1,83 @@
+#include <future>
+#include <string>
+#include <vector>
+
+#include "asyncclient.h"
+#include "asyncserver.h"
+#include "client.h"
+#include "csv.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numLocks = 10000;
+const vector<size_t> windows = {1, 4, 16, 64, 256, 1024};
+const string serverAddress = "localhost:50053";
+
+/**
+ * Highlevel description of the experiment:
+ * One thread acquires and releases numLocks shared locks from an asynchronous
+ * server in the same process, with the blocking client or with the async client
+ * and a window of requests in flight. Writes the window (0 blocking), number of
+ * locks and lock and unlock requests per second into async_client.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  AsyncLockingServiceImpl service;
+  ServerBuilder builder;
+  builder.AddListeningPort(serverAddress, grpc::InsecureServerCredentials());
+  if (service.start(builder) == nullptr) {
+    return 1;
+  }
+  std::shared_ptr<Channel> channel =
+      grpc::CreateChannel(serverAddress, grpc::InsecureChannelCredentials());
+
+  auto throughput = [](auto begin, auto end) {
+    return numLocks * 1000000000L /
+           duration_cast<nanoseconds>(end - begin).count();
+  };
+
+  vector<vector<long>> contentCSVFile;
+  unsigned int transactionId = 1;
+  LockingServiceClient client(channel);
+  auto begin = high_resolution_clock::now();
+  for (int rowId = 1; rowId <= numLocks; rowId++) {
+    client.requestSharedLock(transactionId, rowId, true, numLocks);
+  }
+  auto middle = high_resolution_clock::now();
+  for (int rowId = 1; rowId <= numLocks; rowId++) {
+    client.requestUnlock(transactionId, rowId, true);
+  }
+  auto end = high_resolution_clock::now();
+  contentCSVFile.push_back(
+      {0, numLocks, throughput(begin, middle), throughput(middle, end)});
+
+  for (size_t window : windows) {
+    transactionId++;
+    AsyncLockingServiceClient asyncClient(channel, window);
+    vector<std::future<std::pair<string, bool>>> grants;
+    grants.reserve(numLocks);
+
+    begin = high_resolution_clock::now();
+    for (int rowId = 1; rowId <= numLocks; rowId++) {
+      grants.push_back(
+          asyncClient.requestSharedLock(transactionId, rowId, numLocks));
+    }
+    for (auto& grant : grants) {
+      grant.wait();
+    }
+    middle = high_resolution_clock::now();
+    asyncClient.commit(transactionId).wait();
+    end = high_resolution_clock::now();
+    contentCSVFile.push_back({(long)window, numLocks, throughput(begin, middle),
+                              throughput(middle, end)});
+  }
+
+  service.shutdown();
+  writeToCSV("async_client", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include <future>
+#include <vector>
+
+#include "asyncclient.h"
+
+const size_t kWindow = 128;  // number of requests in flight at most
+
+void RunClient() {
+  std::string target_address("0.0.0.0:50051");
+  AsyncLockingServiceClient client(
+      grpc::CreateChannel(target_address, grpc::InsecureChannelCredentials()),
+      kWindow);
+
+  unsigned int transactionA = 1;
+  unsigned int transactionB = 2;
+  unsigned int lockBudget = 10000;
+
+  // Both acquire shared locks on the same rows without waiting in between.
+  // The first lock request of each transaction registers it.
+  std::vector<std::future<std::pair<std::string, bool>>> grants;
+  for (unsigned int rowId = 1; rowId <= lockBudget; rowId++) {
+    grants.push_back(client.requestSharedLock(transactionA, rowId, lockBudget));
+    grants.push_back(client.requestSharedLock(transactionB, rowId, lockBudget));
+  }
+
+  int granted = 0;
+  for (auto& grant : grants) {
+    auto [signature, ok] = grant.get();
+    granted += ok;
+  }
+  spdlog::info(std::to_string(granted) + " of " +
+               std::to_string(grants.size()) + " locks granted");
+
+  // Both release their locks with one RPC each
+  std::future<bool> committedA = client.commit(transactionA);
+  std::future<bool> committedB = client.commit(transactionB);
+  if (!committedA.get() || !committedB.get()) {
+    spdlog::error("Releasing the locks failed");
+  }
+}
+
+auto main() -> int {
+  spdlog::info("Starting asynchronous client");
+  RunClient();
+  return 0;
+}
@@ -1,5 +1,7 @@
 #include "client.h"
 
+const int kBatchSize = 1000;  // number of locks requested with one RPC
+
 void requestLocks(LockingServiceClient& client, unsigned int rowId) {
   client.requestSharedLock(1, rowId);
 }
@@ -14,17 +16,27 @@ void RunClient() {
   int lockBudget = 10000;
   client.registerTransaction(transactionA, lockBudget);
   client.registerTransaction(transactionB, lockBudget);
+
+  // Both acquire shared locks on the same rows, a batch at a time
+  std::vector<std::pair<unsigned int, bool>> locks;
+  std::vector<unsigned int> rowIds;
   for (int rowId = 1; rowId <= lockBudget; rowId++) {
-    client.requestSharedLock(transactionA, rowId, true);
-  }
-  for (int rowId = 1; rowId <= lockBudget; rowId++) {
-    client.requestSharedLock(transactionB, rowId, true);
+    locks.emplace_back(rowId, false);
+    rowIds.push_back(rowId);
+    if (locks.size() == kBatchSize || rowId == lockBudget) {
+      client.lockBatch(transactionA, locks);
+      client.lockBatch(transactionB, locks);
+      locks.clear();
+    }
   }
 
   // Both release the locks again
-  for (int rowId = 1; rowId <= lockBudget; rowId++) {
-    client.requestUnlock(transactionA, rowId, false);
-    client.requestUnlock(transactionB, rowId, false);
+  for (int first = 0; first < rowIds.size(); first += kBatchSize) {
+    std::vector<unsigned int> batch(
+        rowIds.begin() + first,
+        rowIds.begin() + std::min<size_t>(first + kBatchSize, rowIds.size()));
+    client.unlockBatch(transactionA, batch);
+    client.unlockBatch(transactionB, batch);
   }
 }
 
@@ -1,20 +1,98 @@
-#include "server.h"
+#include <cstring>
+#include <string>
 
-void RunServer() {
-  std::string server_address("0.0.0.0:50051");
-  LockingServiceImpl service;
+#include "asyncserver.h"
 
+/**
+ * Options of the server, which can be given on the command line.
+ */
+struct ServerOptions {
+  std::string address = "0.0.0.0:50051";
+  bool async = true;  // serve lock and unlock requests by completion queues
+  int numCompletionQueueThreads = kDefaultCompletionQueueThreads;
+  LockConflictPolicy conflictPolicy = NO_WAIT;
+};
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " [--address=HOST:PORT] [--sync] [--cq-threads=N]"
+            << " [--wait-die]\n"
+            << "  --address     the address to listen on (default "
+            << ServerOptions().address << ")\n"
+            << "  --sync        serve every request on its own gRPC thread\n"
+            << "  --cq-threads  the number of completion queue threads "
+            << "(default " << kDefaultCompletionQueueThreads << ")\n"
+            << "  --wait-die    let older transactions wait for conflicting "
+            << "locks\n";
+}
+
+/**
+ * Parses the command line options.
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @param options receives the options
+ * @returns false, if an option is unknown or invalid
+ */
+auto ParseOptions(int argc, char** argv, ServerOptions& options) -> bool {
+  for (int i = 1; i < argc; i++) {
+    std::string argument(argv[i]);
+    if (argument.rfind("--address=", 0) == 0) {
+      options.address = argument.substr(strlen("--address="));
+    } else if (argument == "--sync") {
+      options.async = false;
+    } else if (argument == "--wait-die") {
+      options.conflictPolicy = WAIT_DIE;
+    } else if (argument.rfind("--cq-threads=", 0) == 0) {
+      try {
+        options.numCompletionQueueThreads =
+            std::stoi(argument.substr(strlen("--cq-threads=")));
+      } catch (const std::exception& e) {
+        return false;
+      }
+      if (options.numCompletionQueueThreads < 1) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RunServer(const ServerOptions& options) {
   ServerBuilder builder;
-  builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
-  builder.RegisterService(&service);
+  builder.AddListeningPort(options.address, grpc::InsecureServerCredentials());
+
+  if (options.async) {
+    AsyncLockingServiceImpl service(options.numCompletionQueueThreads,
+                                    options.conflictPolicy);
+    Server* server = service.start(builder);
+    if (server == nullptr) {
+      spdlog::error("Could not start the server on " + options.address);
+      return;
+    }
+    spdlog::info("Server listening on port: " + options.address + " with " +
+                 std::to_string(options.numCompletionQueueThreads) +
+                 " completion queue threads");
+    server->Wait();
+    return;
+  }
 
+  LockingServiceImpl service(options.conflictPolicy);
+  builder.RegisterService(&service);
   std::unique_ptr<Server> server(builder.BuildAndStart());
-  spdlog::info("Server listening on port: " + server_address);
+  spdlog::info("Server listening on port: " + options.address);
 
   server->Wait();
 }
 
 auto main(int argc, char** argv) -> int {
-  RunServer();
+  ServerOptions options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  RunServer(options);
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,56 @@
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numLocks = 100000;
+const int numWorkerThreads = 4;
+const vector<int> batchSizes = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512};
+
+/**
+ * Highlevel description of the experiment:
+ * A single transaction acquires numLocks shared locks spread over all worker
+ * threads and releases them again, in batches of the given size with one ECALL
+ * each. Writes the number of worker threads, batch size, number of locks and
+ * lock and unlock requests per second into batch.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (int batchSize : batchSizes) {
+    auto lockManager = LockManager(numWorkerThreads);
+    unsigned int transactionId = 1;
+    lockManager.registerTransaction(transactionId, numLocks);
+
+    vector<BatchedJob> batch;
+    auto submit = [&](Command command) {
+      auto begin = high_resolution_clock::now();
+      for (unsigned int rowId = 1; rowId <= numLocks; rowId++) {
+        batch.push_back(BatchedJob{command, transactionId, rowId, 0});
+        if (batch.size() == batchSize || rowId == numLocks) {
+          lockManager.submitBatch(batch);
+          batch.clear();
+        }
+      }
+      auto end = high_resolution_clock::now();
+      return duration_cast<nanoseconds>(end - begin).count();
+    };
+    long lockDuration = submit(SHARED);
+    long unlockDuration = submit(UNLOCK);
+
+    contentCSVFile.push_back({numWorkerThreads, batchSize, numLocks,
+                              numLocks * 1000000000L / lockDuration,
+                              numLocks * 1000000000L / unlockDuration});
+  }
+
+  writeToCSV("batch", contentCSVFile);
+  return 0;
+}
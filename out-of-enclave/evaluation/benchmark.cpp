@@ -1,13 +1,13 @@
-#include <fstream>
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <numeric>
 #include <string>
 #include <vector>
 
+#include "csv.h"
 #include "lockmanager.h"
 
-using std::ofstream;
 using std::reduce;
 using std::string;
 using std::vector;
@@ -34,26 +34,6 @@ void flushCache() {
   }
 }
 
-/**
- * Writes the data all in one into a CSV file
- * @param filename the name of the csv file
- * @param values the outer vector contains the rows and the inner vector
- * resembles a row with its column values
- */
-void writeToCSV(string filename, vector<vector<long>> values) {
-  ofstream file;
-  file.open(filename + ".csv", std::ios_base::app);
-
-  for (const auto& row : values) {
-    for (int i = 0; i < row.size() - 1; i++) {
-      file << row[i] << ",";
-    }
-    file << row[row.size() - 1];
-    file << std::endl;
-  }
-  file.close();
-}
-
 /**
  * Highlevel description of the experiment:
  * A acquires given number of locks in shared mode, then B acquires the same
@@ -63,86 +43,56 @@ void writeToCSV(string filename, vector<vector<long>> values) {
  *
  * With multiple concurrent requests (we achieve this by having the client not
  * wait on the result of its requests), we have to make sure that we do wait on
- * the last request for each thread, e.g. when there are two threads we need to
- * make the last request that each of these threads serves wait for its result,
- * so that we wait on all requests to be finished.
+ * the last request for each partition of the lock table, so that we wait on
+ * all requests to be finished.
  */
 void experiment(LockManager& lockManager, int numLocks, int numThreads) {
-  /** Compute RIDs to wait on depending on number of locks and number of
-   threads. The size of the lock table is 10000. Remember, each RID is assigned
-   to a thread ID via
+  /**
+   * Group the RIDs by the partition of the lock table they belong to. The key
+   * range of the lock table is lockTableSize, which is also its initial size,
+   * and it is split into kPartitionsPerWorker partitions per thread. Remember,
+   * each RID is assigned to a partition via getPartition(), which computes
    *
    * ===========================================================================
-   * int thread_id = (int)((new_job.row_id % lockTableSize_) /
-                            ((float)lockTableSize_ / (arg.num_threads - 1)));
+   * int partition = (row_id % lockTable->key_range) *
+                     lockTable->num_partitions / lockTable->key_range;
    * ===========================================================================
    *
-   * which is explained in more detail below. We want to find the latest request
-   * (i.e. request with the largest RID) for
-   * each thread, which needs to be synchronous, so that each thread completes
-   * all requests before we stop the time measurement.
-   *
-   * As you see from the formula above, a
-   * set of RIDs less than the lockTableSize_ = 10000 doesn't distribute over
-   * all threads. I.e., when the range is only between 1-5000 and we have 4
-   * threads, the fourth thread, who has the range of 7500 - 9999, never
-   * receives a request. This can be a disadvantage when RIDs are skewed.
-   */
-  std::set<int> waitOn;
-
-  // The maximum RID is in any case one of the last requests.
-  waitOn.insert(numLocks);
-
-  /**
-   * As you see in the second line of the formula, the lock table ranging from 0
-   * to 9999 (10000 entries) is divided evenly among the worker threads, which
-   * is the number of threads in the enclave - 1 (which is the single thread
-   * responsible for the transaction table). As for the partitions, e.g. for 4
-   * threads, thread 0 takes RIDs 0 - 2499, thread 1 takes RID 2500 - 4999
-   * a.s.o.
+   * I.e., for 4 threads the 64 partitions take about 156 RIDs each, partition
+   * 0 takes RIDs 0 - 156, partition 1 RIDs 157 - 312 a.s.o. If the RID is
+   * 10000 and bigger, the RID is projected into the range of the lock table
+   * from 0 to 9999 using modulo.
    *
-   * If the RID is 10000 and bigger, the RID is projected into the range of the
-   * lock table from 0 to 9999 using modulo (see line 1 of the formula). When we
-   * want to find the largest ID to wait on, we first compute the "base", which
-   * for numLocks 1 - 60000 would be 50000. That means the largest RID for each
-   * thread will be in the range 50000 - 60000. The RIDs to wait on for 4
-   * threads would be 60000, 54999, a.s.o, compare with the ranges
-   * computed in the above paragraph and it should get clear.
+   * The requests of a partition are served one after the other, even when the
+   * enclave hands the partition over to another thread in between. So when the
+   * last request of every partition waits for its result, all requests are
+   * finished before we stop the time measurement.
    */
-  int base = ((numLocks / lockTableSize) - 1) * lockTableSize;
-  if (numLocks < lockTableSize) {
-    base = 0;
-  }
-
-  /**
-   * E.g. with the lockTableSize being fixed to 10000, a partition (i.e. the
-   * range that is assigned to a thread) is 2500 when we have 4 threads
-   * */
-  int partitionSize = lockTableSize / numThreads;
-
-  for (int i = 1; i < numThreads;
-       i++) {  // Note that when numThreads = 1, only
-               // wait on numLocks (see on previous insert)
-    waitOn.insert(base + partitionSize * i - 1);
+  int numPartitions = numThreads * kPartitionsPerWorker;
+  vector<vector<int>> partitions(numPartitions);
+  size_t longestPartition = 0;
+  for (int rowId = 1; rowId <= numLocks; rowId++) {
+    int partition =
+        (long long)(rowId % lockTableSize) * numPartitions / lockTableSize;
+    partitions[partition].push_back(rowId);
+    longestPartition = std::max(longestPartition, partitions[partition].size());
   }
 
   /**
-   *  Now the experiment starts: Transaction A acquires all locks in its lock
-   * budget.
+   * Now the experiment starts: Transaction A acquires all locks in its lock
+   * budget, then B acquires the same locks as A, so locks that are potentially
+   * paged out, are paged in again. We do this in an attempt to show the paging
+   * overhead in Intel SGX enclaves.
    *
-   * We iterate over the range of locks in a specific way, because as you know
-   * each thread gets assigned one partition of the lock table, one sequential
-   * range of IDs, iterating over the IDs sequentially wouldn't equally
-   * distribute the requests over the threads.
+   * We iterate over the partitions round-robin, because each partition is one
+   * sequential range of IDs, which belongs to a single thread at a time.
+   * Iterating over the IDs sequentially wouldn't equally distribute the
+   * requests over the threads.
    */
-  for (int base = 0; base < numLocks;
-       base +=
-       lockTableSize) {  // iterate over the multiples of the lock table size
-    for (int i = 1; i <= partitionSize; i++) {
-      for (int threadId = 0; threadId < numThreads;
-           threadId++) {  // iterate over the thread partitions
-        int rowId = base + threadId * partitionSize + i;
-        if (rowId > numLocks) continue;
+  for (int transactionId : {transactionA, transactionB}) {
+    for (size_t i = 0; i < longestPartition; i++) {
+      for (const vector<int>& rowIds : partitions) {
+        if (i >= rowIds.size()) continue;
         /**
          * Usually clients waited until their lock request returns the
          * signature, so all requests from a single client would end up being
@@ -153,35 +103,8 @@ void experiment(LockManager& lockManager, int numLocks, int numThreads) {
          * yet and requests have a chance to queue up and being operated on
          * concurrently.
          */
-        if (waitOn.find(rowId) != waitOn.end()) {
-          lockManager.lock(transactionA, rowId, false, true);
-        } else {
-          lockManager.lock(transactionA, rowId, false, true);
-        }
-      }
-    }
-  }
-
-  /**
-   * So does B, as B is last we wait on the specific RIDs computed previously. B
-   * acquires the same locks as A, so locks that are potentially paged out, are
-   * paged in again. We does this in an attempt to show the paging overhead in
-   * Intel SGX enclaves.
-   */
-  for (int base = 0; base < numLocks;
-       base +=
-       lockTableSize) {  // iterate over the multiples of the lock table size
-    for (int i = 1; i <= partitionSize; i++) {
-      for (int threadId = 0; threadId < numThreads;
-           threadId++) {  // iterate over the thread partitions
-        int rowId = base + threadId * partitionSize + i;
-        if (rowId > numLocks) continue;
-
-        if (waitOn.find(rowId) != waitOn.end()) {
-          lockManager.lock(transactionB, rowId, false, true);
-        } else {
-          lockManager.lock(transactionB, rowId, false, true);
-        }
+        bool isLast = i + 1 == rowIds.size();
+        lockManager.lock(transactionId, rowIds[i], false, isLast);
       }
     }
   }
@@ -0,0 +1,70 @@
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numTransactions = 5000;
+const int numWorkerThreads = 4;
+const vector<int> locksPerTransaction = {1, 4, 16, 64};
+
+// How a transaction releases its locks
+enum ReleaseMode { UNLOCK_EACH, UNLOCK_BATCH, COMMIT_ALL };
+
+/**
+ * Highlevel description of the experiment:
+ * Transactions acquire the given number of exclusive locks and release them with
+ * one unlock() per lock (0), one submitBatch() (1) or commit() (2), which is
+ * timed. Writes the number of worker threads, locks per transaction, release
+ * mode, number of transactions and transactions per second into commit.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (int numLocks : locksPerTransaction) {
+    for (ReleaseMode mode : {UNLOCK_EACH, UNLOCK_BATCH, COMMIT_ALL}) {
+      auto lockManager = LockManager(numWorkerThreads);
+      long duration = 0;
+
+      for (unsigned int transactionId = 1; transactionId <= numTransactions;
+           transactionId++) {
+        unsigned int firstRow = (transactionId - 1) * numLocks + 1;
+        for (int i = 0; i < numLocks; i++) {
+          int lockBudget = i == 0 ? numLocks : 0;
+          lockManager.lock(transactionId, firstRow + i, true, true, lockBudget);
+        }
+
+        auto begin = high_resolution_clock::now();
+        if (mode == UNLOCK_EACH) {
+          for (int i = 0; i < numLocks; i++) {
+            lockManager.unlock(transactionId, firstRow + i, true);
+          }
+        } else if (mode == UNLOCK_BATCH) {
+          vector<BatchedJob> jobs;
+          for (int i = 0; i < numLocks; i++) {
+            jobs.push_back(BatchedJob{UNLOCK, transactionId, firstRow + i, 0});
+          }
+          lockManager.submitBatch(jobs);
+        } else {
+          lockManager.commit(transactionId);
+        }
+        auto end = high_resolution_clock::now();
+        duration += duration_cast<nanoseconds>(end - begin).count();
+      }
+
+      contentCSVFile.push_back({numWorkerThreads, numLocks, mode,
+                                numTransactions,
+                                numTransactions * 1000000000L / duration});
+    }
+  }
+
+  writeToCSV("commit", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Writes the data all in one into a CSV file
+ * @param filename the name of the csv file
+ * @param values the outer vector contains the rows and the inner vector
+ * resembles a row with its column values
+ */
+inline void writeToCSV(const std::string& filename,
+                       const std::vector<std::vector<long>>& values) {
+  std::ofstream file;
+  file.open(filename + ".csv", std::ios_base::app);
+
+  for (const auto& row : values) {
+    for (int i = 0; i < row.size() - 1; i++) {
+      file << row[i] << ",";
+    }
+    file << row[row.size() - 1];
+    file << std::endl;
+  }
+  file.close();
+}
@@ -0,0 +1,52 @@
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int iterations = 100000;  // per ECALL, so that its overhead vanishes
+
+// SHA-256 and AES-CMAC over whole buckets, with full and truncated digests,
+// against incremental digests
+const vector<IntegrityOptions> schemes = {
+    {HASH_LIST, 0, 0, FULL_HASH, 0},
+    {HASH_LIST, 0, 0, FULL_HASH, 16},
+    {HASH_LIST, 0, 0, FULL_CMAC, 0},
+    {HASH_LIST, 0, 0, FULL_CMAC, 8},
+    {HASH_LIST, 0, 0, INCREMENTAL_HASH, 0},
+    {HASH_LIST, 0, 0, INCREMENTAL_HASH, 8},
+};
+
+/**
+ * Highlevel description of the experiment:
+ * Verifies buckets with one to all slots in use and updates their digests, like
+ * every lock and unlock request does. Writes the bucket digest, bytes kept per
+ * digest, number of used slots and nanoseconds per verification and update
+ * into digest.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (const IntegrityOptions& integrity : schemes) {
+    auto lockManager = LockManager(1, integrity);
+    for (int occupied = 1; occupied <= kLockTableSlotsPerBucket; occupied++) {
+      auto begin = high_resolution_clock::now();
+      lockManager.digestBuckets(occupied, iterations);
+      auto end = high_resolution_clock::now();
+      long duration = duration_cast<nanoseconds>(end - begin).count();
+
+      contentCSVFile.push_back({integrity.digest, integrity.digest_size,
+                                occupied, duration / iterations});
+    }
+  }
+
+  writeToCSV("digest", contentCSVFile);
+  return 0;
+}
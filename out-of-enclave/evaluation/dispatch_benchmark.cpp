@@ -0,0 +1,157 @@
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "csv.h"
+#include "jobqueue.h"
+
+using std::string;
+using std::thread;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numJobs = 1000000;
+const vector<int> numProducerThreads = {1, 2, 4, 8};
+
+// The job queues the worker threads used before, and the lock-free ones
+enum QueueKind { LOCKED_QUEUE, LOCK_FREE_QUEUE };
+
+/**
+ * A std::queue protected by a mutex, which signals the consumer on every job.
+ */
+struct LockedQueue {
+  std::queue<Job> jobs;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+/**
+ * A lock-free queue, whose consumer blocks on the condition variable once the
+ * queue is empty.
+ */
+struct LockFreeQueue {
+  JobQueue jobs;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+/**
+ * Returns the current time in nanoseconds, which the producers store for every
+ * job they push and the consumer compares against, when it pops the job.
+ */
+auto now() -> long {
+  return duration_cast<nanoseconds>(
+             high_resolution_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * Pushes all jobs from the given number of producer threads into a single queue
+ * and pops them in one consumer thread, like the job dispatch to a worker
+ * thread does.
+ *
+ * @param kind the queue to use
+ * @param producers the number of producer threads
+ * @param latency receives the average nanoseconds from pushing to popping a job
+ * @returns the nanoseconds until the consumer popped all jobs
+ */
+auto dispatch(QueueKind kind, int producers, long& latency) -> long {
+  auto locked = std::make_unique<LockedQueue>();
+  auto lockFree = std::make_unique<LockFreeQueue>();
+  initJobQueue(&lockFree->jobs);
+  int jobsPerProducer = numJobs / producers;
+  int jobs = jobsPerProducer * producers;
+  vector<long> pushed(jobs);
+
+  auto push = [&](Job& job) {
+    pushed[job.row_id] = now();
+    if (kind == LOCKED_QUEUE) {
+      std::lock_guard<std::mutex> lock(locked->mutex);
+      locked->jobs.push(job);
+      locked->cond.notify_one();
+      return;
+    }
+    while (!pushJob(&lockFree->jobs, job)) {
+      std::this_thread::yield();
+    }
+    if (needsWakeUp(&lockFree->jobs)) {
+      std::lock_guard<std::mutex> lock(lockFree->mutex);
+      lockFree->cond.notify_one();
+    }
+  };
+
+  auto pop = [&](Job& job) {
+    if (kind == LOCKED_QUEUE) {
+      std::unique_lock<std::mutex> lock(locked->mutex);
+      locked->cond.wait(lock, [&] { return !locked->jobs.empty(); });
+      job = locked->jobs.front();
+      locked->jobs.pop();
+      return;
+    }
+    while (!popJob(&lockFree->jobs, &job)) {
+      std::unique_lock<std::mutex> lock(lockFree->mutex);
+      if (prepareToSleep(&lockFree->jobs)) {
+        lockFree->cond.wait(lock);
+      }
+      wakeUp(&lockFree->jobs);
+    }
+  };
+
+  long totalLatency = 0;
+  auto begin = high_resolution_clock::now();
+  thread consumer([&] {
+    Job job;
+    for (int i = 0; i < jobs; i++) {
+      pop(job);
+      totalLatency += now() - pushed[job.row_id];
+    }
+  });
+  vector<thread> threads;
+  for (int i = 0; i < producers; i++) {
+    threads.emplace_back([&, i] {
+      Job job = Job();
+      job.command = SHARED;
+      for (int j = 0; j < jobsPerProducer; j++) {
+        job.row_id = i * jobsPerProducer + j;
+        push(job);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  consumer.join();
+  auto end = high_resolution_clock::now();
+
+  latency = totalLatency / jobs;
+  return duration_cast<nanoseconds>(end - begin).count();
+}
+
+/**
+ * Highlevel description of the experiment:
+ * Producer threads push numJobs jobs into the queue of one consumer thread,
+ * without the enclave. Writes the queue (0 mutex, 1 lock-free), number of
+ * producers, number of jobs, jobs per second and average nanoseconds from push
+ * to pop into dispatch.csv.
+ */
+auto main() -> int {
+  vector<vector<long>> contentCSVFile;
+  for (QueueKind kind : {LOCKED_QUEUE, LOCK_FREE_QUEUE}) {
+    for (int producers : numProducerThreads) {
+      long latency;
+      long duration = dispatch(kind, producers, latency);
+      int jobs = numJobs / producers * producers;
+      contentCSVFile.push_back({kind, producers, jobs,
+                                jobs * 1000000000L / duration, latency});
+    }
+  }
+
+  writeToCSV("dispatch", contentCSVFile);
+  return 0;
+}
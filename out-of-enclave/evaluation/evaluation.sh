@@ -1,4 +1,4 @@
-num_threads=(1) # only tested single-threaded
+num_threads=(1 2 4 8)
 num_locks=(10 100 500 1000 2500 5000 10000 20000 50000 100000 150000 200000 300000 500000 700000)
 
 output_file=out.csv
@@ -21,7 +21,7 @@ for thread in ${num_threads[*]}
 do
   # Set number of threads
   sed -i -e "s/numWorkerThreads = [0-9]*/numWorkerThreads = ${thread}/" benchmark.cpp
-  thread_num_config=$(($thread+2)) # two more for transaction table and main thread
+  thread_num_config=$(($thread+3)) # three more for transaction table, main thread and trusted switchless worker
   sed -i -e "s/<TCSNum>[0-9]*/<TCSNum>${thread_num_config}/" ../src/enclave/enclave.config.xml
 
   for locks in ${num_locks[*]}
@@ -51,7 +51,7 @@ done
 # Reset everything to its original values
 sed -i -e "s/numWorkerThreads = [0-9]*/numWorkerThreads = 1/" benchmark.cpp
 sed -i -e "s/lockBudget = [0-9]*/lockBudget = 10/" benchmark.cpp
-sed -i -e "s/<TCSNum>[0-9]*/<TCSNum>3/" ../src/enclave/enclave.config.xml
+sed -i -e "s/<TCSNum>[0-9]*/<TCSNum>7/" ../src/enclave/enclave.config.xml
 sed -i -e "s@// print_info@print_info@" ../src/enclave/enclave.cpp ../src/enclave/lock_signatures.cpp ../src/lockmanager/lockmanager.cpp
 
 rm $sealed_keys_file
@@ -0,0 +1,66 @@
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int transactionId = 1;
+const int numWorkerThreads = 1;
+const vector<int> numLocks = {1000, 10000, 50000, 100000, 200000};
+
+// The flat hash list against Merkle trees of different shapes, each with full
+// and incremental bucket digests
+const vector<IntegrityOptions> schemes = {
+    {HASH_LIST, 0, 0, FULL_HASH},     {HASH_LIST, 0, 0, INCREMENTAL_HASH},
+    {MERKLE_TREE, 2, 64, FULL_HASH},  {MERKLE_TREE, 2, 64, INCREMENTAL_HASH},
+    {MERKLE_TREE, 8, 64, FULL_HASH},  {MERKLE_TREE, 8, 64, INCREMENTAL_HASH},
+    {MERKLE_TREE, 8, 512, FULL_HASH}, {MERKLE_TREE, 16, 1, FULL_HASH}};
+
+/**
+ * Highlevel description of the experiment:
+ * A single transaction acquires the given number of exclusive locks one after
+ * the other and releases them again. Writes the scheme, arity, cache size,
+ * bucket digest, number of locks, nanoseconds per lock and unlock request and
+ * the enclave memory of the integrity data into integrity.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (const IntegrityOptions& integrity : schemes) {
+    for (int locks : numLocks) {
+      auto lockManager = LockManager(numWorkerThreads, integrity);
+      lockManager.registerTransaction(transactionId, locks);
+
+      auto begin = high_resolution_clock::now();
+      for (int rowId = 1; rowId <= locks; rowId++) {
+        lockManager.lock(transactionId, rowId, true);
+      }
+      auto end = high_resolution_clock::now();
+      long lockDuration = duration_cast<nanoseconds>(end - begin).count();
+
+      long bytes = lockManager.getIntegrityMemoryUsage();
+
+      begin = high_resolution_clock::now();
+      for (int rowId = 1; rowId <= locks; rowId++) {
+        lockManager.unlock(transactionId, rowId, true);
+      }
+      end = high_resolution_clock::now();
+      long unlockDuration = duration_cast<nanoseconds>(end - begin).count();
+
+      contentCSVFile.push_back({integrity.scheme, integrity.merkle_arity,
+                                integrity.merkle_cache_size, integrity.digest,
+                                locks, lockDuration / locks,
+                                unlockDuration / locks, bytes});
+    }
+  }
+
+  writeToCSV("integrity", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "hashtable.h"
+#include "lock.h"
+#include "locktable.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const size_t bigger_than_cachesize =
+    20 * 1024 * 1024;  // Checked cache size with command 'lscpu | grep cache'
+long* p = new long[bigger_than_cachesize];
+
+const int numLookups = 1000000;  // lookups per measurement
+const int repetitions = 5;       // repeats the same experiments several times
+const int hashTableSize = 10000;  // number of buckets of the chained table
+const float lockTableLoadFactor = 0.75;  // fraction of used lock table slots
+const vector<int> numLocksSweep = {1000, 10000, 100000, 300000, 700000};
+
+void flushCache() {
+  for (int i = 0; i < bigger_than_cachesize; i++) {
+    p[i] = rand();
+  }
+}
+
+/**
+ * Measures the time it takes to look up the given row IDs.
+ *
+ * @param table either the chained HashTable or the open addressing LockTable
+ * @param rowIds the row IDs to look up in that order
+ * @returns the duration in nanoseconds
+ */
+template <typename Table>
+auto measureLookups(Table* table, vector<int>& rowIds) -> long {
+  long found = 0;
+
+  //=========== TIME MEASUREMENT ================
+  auto begin = high_resolution_clock::now();
+  for (int rowId : rowIds) {
+    Lock* lock = (Lock*)get(table, rowId);
+    found += lock->num_owners;
+  }
+  auto end = high_resolution_clock::now();
+  //=============================================
+
+  if (found != rowIds.size()) {
+    std::cerr << "Lookup returned wrong locks" << std::endl;
+  }
+  return duration_cast<nanoseconds>(end - begin).count();
+}
+
+/**
+ * Highlevel description of the experiment:
+ * The same locks are inserted into the chained HashTable and the open
+ * addressing LockTable, which are then queried for random inserted row IDs.
+ * Writes the table (0 HashTable, 1 LockTable), number of locks and lookups per
+ * second into locktable.csv.
+ */
+auto main() -> int {
+  vector<vector<long>> contentCSVFile;
+  std::mt19937 generator(42);
+
+  for (int numLocks : numLocksSweep) {
+    HashTable* hashTable = newHashTable(hashTableSize);
+    LockTable* lockTable = newLockTable(
+        numLocks / (kLockTableSlotsPerBucket * lockTableLoadFactor) + 1);
+
+    for (int rowId = 1; rowId <= numLocks; rowId++) {
+      Lock* lock = newLock();
+      getSharedAccess(lock, 1);
+      set(hashTable, rowId, (void*)lock);
+      set(lockTable, rowId, lock);
+    }
+
+    std::uniform_int_distribution<int> distribution(1, numLocks);
+    vector<int> rowIds(numLookups);
+    for (int& rowId : rowIds) {
+      rowId = distribution(generator);
+    }
+
+    for (int i = 0; i < repetitions; i++) {  // To make result more stable
+      flushCache();
+      long hashTableDuration = measureLookups(hashTable, rowIds);
+      flushCache();
+      long lockTableDuration = measureLookups(lockTable, rowIds);
+
+      contentCSVFile.push_back(
+          {0, numLocks, (long)numLookups * 1000000000 / hashTableDuration});
+      contentCSVFile.push_back(
+          {1, numLocks, (long)numLookups * 1000000000 / lockTableDuration});
+    }
+
+    std::cout << "Finished " << numLocks << " locks" << std::endl;
+    freeLockTable(lockTable);
+  }
+
+  writeToCSV("locktable", contentCSVFile);
+  return 0;
+}
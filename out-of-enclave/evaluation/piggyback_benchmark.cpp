@@ -0,0 +1,64 @@
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numTransactions = 20000;
+const int numWorkerThreads = 4;
+const vector<int> locksPerTransaction = {1, 2, 4, 8, 16};
+
+/**
+ * Highlevel description of the experiment:
+ * Short transactions acquire shared locks and release them, registering either
+ * with registerTransaction() or along with their first lock request. Writes the
+ * number of worker threads, locks per transaction, piggybacking (0 or 1),
+ * transactions, round trips per transaction and transactions per second into
+ * piggyback.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (int numLocks : locksPerTransaction) {
+    for (bool piggybacked : {false, true}) {
+      auto lockManager = LockManager(numWorkerThreads);
+      long roundTrips = 0;
+
+      auto begin = high_resolution_clock::now();
+      for (int transactionId = 1; transactionId <= numTransactions;
+           transactionId++) {
+        if (!piggybacked) {
+          lockManager.registerTransaction(transactionId, numLocks);
+          roundTrips++;
+        }
+        // Spread the locks of a transaction over the key range
+        for (int i = 0; i < numLocks; i++) {
+          int lockBudget = piggybacked && i == 0 ? numLocks : 0;
+          lockManager.lock(transactionId, transactionId + i * 1000, false, true,
+                           lockBudget);
+          roundTrips++;
+        }
+        for (int i = 0; i < numLocks; i++) {
+          lockManager.unlock(transactionId, transactionId + i * 1000);
+        }
+      }
+      auto end = high_resolution_clock::now();
+      long duration = duration_cast<nanoseconds>(end - begin).count();
+
+      contentCSVFile.push_back({numWorkerThreads, numLocks, piggybacked,
+                                numTransactions,
+                                roundTrips / numTransactions,
+                                numTransactions * 1000000000L / duration});
+    }
+  }
+
+  writeToCSV("piggyback", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numTransactions = 100000;
+const int batchSize = 256;
+const vector<int> numWorkerThreads = {1, 2, 4};  // fit into the TCSNum
+
+/**
+ * Highlevel description of the experiment:
+ * Registers numTransactions transactions in batches, then each locks and
+ * unlocks its own row. Writes the number of worker threads, number of
+ * transactions, registrations per second and transactions per second into
+ * registration.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (int threads : numWorkerThreads) {
+    auto lockManager = LockManager(threads);
+
+    vector<BatchedJob> batch;
+    auto submit = [&](vector<Command> commands) {
+      auto begin = high_resolution_clock::now();
+      for (Command command : commands) {
+        for (unsigned int i = 1; i <= numTransactions; i++) {
+          batch.push_back(BatchedJob{command, i, i, 1});
+          if (batch.size() == batchSize || i == numTransactions) {
+            lockManager.submitBatch(batch);
+            batch.clear();
+          }
+        }
+      }
+      auto end = high_resolution_clock::now();
+      return duration_cast<nanoseconds>(end - begin).count();
+    };
+    long registerDuration = submit({REGISTER});
+    long lockDuration = submit({SHARED, UNLOCK});
+
+    contentCSVFile.push_back(
+        {threads, numTransactions,
+         numTransactions * 1000000000L / registerDuration,
+         numTransactions * 1000000000L / lockDuration});
+  }
+
+  writeToCSV("registration", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::thread;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numLocks = 100000;
+const int numWorkerThreads = 2;
+const vector<int> numClientThreads = {1, 2, 4};
+
+const SwitchlessOptions noSwitchless = {false, 0, 0, 0, 0};
+
+/**
+ * A way to hand the jobs to the enclave
+ */
+struct Configuration {
+  JobSubmission submission;
+  SwitchlessOptions switchless;
+};
+
+// ECALLs with regular enclave transitions and switchless ECALLs against the
+// request rings
+const vector<Configuration> configurations = {
+    {SUBMIT_BY_ECALL, noSwitchless},
+    {SUBMIT_BY_ECALL, kDefaultSwitchlessOptions},
+    {SUBMIT_BY_REQUEST_RING, noSwitchless}};
+
+/**
+ * Highlevel description of the experiment:
+ * Client threads acquire and release their share of numLocks exclusive locks
+ * one after the other, through ECALLs or the request rings. Writes the
+ * submission, switchless enabled, number of client threads, number of locks
+ * and lock and unlock requests per second into requestring.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (const Configuration& configuration : configurations) {
+    for (int clients : numClientThreads) {
+      auto lockManager =
+          LockManager(numWorkerThreads, kDefaultIntegrityOptions,
+                      configuration.switchless, configuration.submission);
+      int locksPerClient = numLocks / clients;
+      for (int transactionId = 1; transactionId <= clients; transactionId++) {
+        lockManager.registerTransaction(transactionId, locksPerClient);
+      }
+
+      auto run = [&](bool acquire) {
+        vector<thread> threads;
+        auto begin = high_resolution_clock::now();
+        for (int transactionId = 1; transactionId <= clients; transactionId++) {
+          threads.emplace_back([&, transactionId] {
+            int firstRow = (transactionId - 1) * locksPerClient;
+            for (int rowId = firstRow; rowId < firstRow + locksPerClient;
+                 rowId++) {
+              if (acquire) {
+                lockManager.lock(transactionId, rowId, true);
+              } else {
+                lockManager.unlock(transactionId, rowId, true);
+              }
+            }
+          });
+        }
+        for (auto& t : threads) {
+          t.join();
+        }
+        auto end = high_resolution_clock::now();
+        return duration_cast<nanoseconds>(end - begin).count();
+      };
+      long lockDuration = run(true);
+      long unlockDuration = run(false);
+
+      long requests = (long)locksPerClient * clients;
+      contentCSVFile.push_back({configuration.submission,
+                                configuration.switchless.enabled, clients,
+                                requests, requests * 1000000000L / lockDuration,
+                                requests * 1000000000L / unlockDuration});
+    }
+  }
+
+  writeToCSV("requestring", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <string>
+#include <vector>
+
+#include "client.h"
+#include "csv.h"
+#include "server.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numLocks = 10000;
+const vector<int> batchSizes = {1, 10, 100, 1000, 10000};
+const string serverAddress = "localhost:50052";
+
+/**
+ * Highlevel description of the experiment:
+ * A client acquires and releases numLocks shared locks from a server in the same
+ * process, with one RPC per row or with batch RPCs. Writes if batches were used
+ * (0 or 1), batch size, number of locks and lock and unlock requests per second
+ * into rpc_batch.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  LockingServiceImpl service;
+  ServerBuilder builder;
+  builder.AddListeningPort(serverAddress, grpc::InsecureServerCredentials());
+  builder.RegisterService(&service);
+  std::unique_ptr<Server> server(builder.BuildAndStart());
+  LockingServiceClient client(
+      grpc::CreateChannel(serverAddress, grpc::InsecureChannelCredentials()));
+
+  auto throughput = [](auto begin, auto end) {
+    return numLocks * 1000000000L /
+           duration_cast<nanoseconds>(end - begin).count();
+  };
+
+  vector<vector<long>> contentCSVFile;
+  unsigned int transactionId = 1;
+  client.registerTransaction(transactionId, numLocks);
+  auto begin = high_resolution_clock::now();
+  for (int rowId = 1; rowId <= numLocks; rowId++) {
+    client.requestSharedLock(transactionId, rowId);
+  }
+  auto middle = high_resolution_clock::now();
+  for (int rowId = 1; rowId <= numLocks; rowId++) {
+    client.requestUnlock(transactionId, rowId, true);
+  }
+  auto end = high_resolution_clock::now();
+  contentCSVFile.push_back({0, 1, numLocks, throughput(begin, middle),
+                            throughput(middle, end)});
+
+  for (int batchSize : batchSizes) {
+    transactionId++;
+    client.registerTransaction(transactionId, numLocks);
+    vector<std::pair<unsigned int, bool>> locks;
+    vector<unsigned int> rowIds;
+
+    begin = high_resolution_clock::now();
+    for (int rowId = 1; rowId <= numLocks; rowId++) {
+      locks.emplace_back(rowId, false);
+      if (locks.size() == batchSize || rowId == numLocks) {
+        client.lockBatch(transactionId, locks);
+        locks.clear();
+      }
+    }
+    middle = high_resolution_clock::now();
+    for (int rowId = 1; rowId <= numLocks; rowId++) {
+      rowIds.push_back(rowId);
+      if (rowIds.size() == batchSize || rowId == numLocks) {
+        client.unlockBatch(transactionId, rowIds);
+        rowIds.clear();
+      }
+    }
+    end = high_resolution_clock::now();
+    contentCSVFile.push_back({1, batchSize, numLocks, throughput(begin, middle),
+                              throughput(middle, end)});
+  }
+
+  server->Shutdown();
+  writeToCSV("rpc_batch", contentCSVFile);
+  return 0;
+}
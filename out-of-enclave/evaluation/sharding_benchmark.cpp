@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numLocks = 100000;
+const int lockTableSize = 10000;  // the key range of the lock table
+const int batchSize = 256;
+const vector<int> numWorkerThreads = {1, 2, 4};  // fit into the TCSNum
+const double zipfianTheta = 0.99;
+
+// How the row IDs are spread over the key range of the lock table
+enum Distribution { UNIFORM, CLUSTERED, ZIPFIAN };
+const vector<Distribution> distributions = {UNIFORM, CLUSTERED, ZIPFIAN};
+
+/**
+ * Generates distinct row IDs, whose positions within the key range follow the
+ * given distribution.
+ *
+ * @param distribution UNIFORM over the whole key range, CLUSTERED in its first
+ * quarter or ZIPFIAN with the most frequent positions at its beginning
+ * @returns numLocks row IDs in the order they are requested
+ */
+auto generateRowIds(Distribution distribution) -> vector<unsigned int> {
+  std::mt19937 random(42);
+  vector<unsigned int> rowIds;
+  if (distribution == ZIPFIAN) {
+    vector<double> cdf(lockTableSize);
+    double sum = 0;
+    for (int i = 0; i < lockTableSize; i++) {
+      sum += 1 / std::pow(i + 1, zipfianTheta);
+      cdf[i] = sum;
+    }
+    std::uniform_real_distribution<double> uniform(0, sum);
+
+    // A position drawn again gets the next row ID mapped onto it
+    vector<int> draws(lockTableSize, 0);
+    for (int i = 0; i < numLocks; i++) {
+      int key = std::lower_bound(cdf.begin(), cdf.end(), uniform(random)) -
+                cdf.begin();
+      rowIds.push_back(key + 1 + lockTableSize * draws[key]++);
+    }
+    return rowIds;
+  }
+
+  int range = distribution == CLUSTERED ? lockTableSize / 4 : lockTableSize;
+  for (int i = 0; rowIds.size() < numLocks; i++) {
+    rowIds.push_back(i / range * lockTableSize + i % range + 1);
+  }
+  std::shuffle(rowIds.begin(), rowIds.end(), random);
+  return rowIds;
+}
+
+/**
+ * Highlevel description of the experiment:
+ * A single transaction acquires and releases numLocks shared locks in batches,
+ * on rows spread uniformly, clustered or Zipfian over the key range. Writes the
+ * number of worker threads, distribution (0 uniform, 1 clustered, 2 Zipfian),
+ * number of locks and lock and unlock requests per second into sharding.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (Distribution distribution : distributions) {
+    vector<unsigned int> rowIds = generateRowIds(distribution);
+    for (int threads : numWorkerThreads) {
+      auto lockManager = LockManager(threads);
+      unsigned int transactionId = 1;
+      lockManager.registerTransaction(transactionId, numLocks);
+
+      vector<BatchedJob> batch;
+      auto submit = [&](Command command) {
+        auto begin = high_resolution_clock::now();
+        for (int i = 0; i < numLocks; i++) {
+          batch.push_back(BatchedJob{command, transactionId, rowIds[i], 0});
+          if (batch.size() == batchSize || i + 1 == numLocks) {
+            lockManager.submitBatch(batch);
+            batch.clear();
+          }
+        }
+        auto end = high_resolution_clock::now();
+        return duration_cast<nanoseconds>(end - begin).count();
+      };
+      long lockDuration = submit(SHARED);
+      long unlockDuration = submit(UNLOCK);
+
+      contentCSVFile.push_back({threads, distribution, numLocks,
+                                numLocks * 1000000000L / lockDuration,
+                                numLocks * 1000000000L / unlockDuration});
+    }
+  }
+
+  writeToCSV("sharding", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "csv.h"
+#include "lockmanager.h"
+
+using std::string;
+using std::thread;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::nanoseconds;
+
+const int numLocks = 100000;
+const int numWorkerThreads = 2;
+const vector<int> numClientThreads = {1, 2, 4};
+
+// Regular enclave transitions against one and two switchless workers per side
+const vector<SwitchlessOptions> configurations = {
+    {false, 0, 0, 0, 0},
+    {true, 1, 1, 20000, 20000},
+    {true, 2, 2, 20000, 20000}};
+
+/**
+ * Highlevel description of the experiment:
+ * Client threads acquire and release their share of numLocks exclusive locks
+ * one after the other, with or without switchless ECALLs. Writes the
+ * configuration, number of client threads, number of locks and lock and unlock
+ * requests per second into switchless.csv.
+ */
+auto main() -> int {
+  spdlog::set_level(spdlog::level::err);
+
+  vector<vector<long>> contentCSVFile;
+  for (const SwitchlessOptions& switchless : configurations) {
+    for (int clients : numClientThreads) {
+      auto lockManager =
+          LockManager(numWorkerThreads, kDefaultIntegrityOptions, switchless);
+      int locksPerClient = numLocks / clients;
+      for (int transactionId = 1; transactionId <= clients; transactionId++) {
+        lockManager.registerTransaction(transactionId, locksPerClient);
+      }
+
+      auto run = [&](bool acquire) {
+        vector<thread> threads;
+        auto begin = high_resolution_clock::now();
+        for (int transactionId = 1; transactionId <= clients; transactionId++) {
+          threads.emplace_back([&, transactionId] {
+            int firstRow = (transactionId - 1) * locksPerClient;
+            for (int rowId = firstRow; rowId < firstRow + locksPerClient;
+                 rowId++) {
+              if (acquire) {
+                lockManager.lock(transactionId, rowId, true);
+              } else {
+                lockManager.unlock(transactionId, rowId, true);
+              }
+            }
+          });
+        }
+        for (auto& t : threads) {
+          t.join();
+        }
+        auto end = high_resolution_clock::now();
+        return duration_cast<nanoseconds>(end - begin).count();
+      };
+      long lockDuration = run(true);
+      long unlockDuration = run(false);
+
+      long requests = (long)locksPerClient * clients;
+      contentCSVFile.push_back(
+          {switchless.enabled, switchless.numUntrustedWorkers,
+           switchless.numTrustedWorkers, clients, requests,
+           requests * 1000000000L / lockDuration,
+           requests * 1000000000L / unlockDuration});
+    }
+  }
+
+  writeToCSV("switchless", contentCSVFile);
+  return 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lockmanager.grpc.pb.h"
+#include "spdlog/spdlog.h"
+
+using grpc::Channel;
+using grpc::ClientAsyncResponseReader;
+using grpc::ClientContext;
+using grpc::CompletionQueue;
+using grpc::Status;
+
+// Number of RPCs a client keeps in flight at most, unless configured otherwise
+const size_t kDefaultInFlightWindow = 64;
+
+/**
+ * A gRPC client for the lock manager, which does not wait for the responses of
+ * its lock and unlock requests. Every request returns a future right away, so
+ * that a single thread can keep many requests in flight and the server's
+ * workers busy. A thread of the client takes the responses from a completion
+ * queue in the order they arrive and fulfills the futures.
+ *
+ * The window bounds the number of RPCs in flight on the channel: a request
+ * blocks, while the window is full. The client remembers the locks granted to
+ * each transaction, so that commit() releases them all with one RPC.
+ */
+class AsyncLockingServiceClient {
+ public:
+  /**
+   * @param channel the abstraction of a connection to the remote server
+   * @param window the number of RPCs in flight at most
+   */
+  AsyncLockingServiceClient(const std::shared_ptr<Channel> &channel,
+                            size_t window = kDefaultInFlightWindow);
+
+  /**
+   * Waits for the responses of all RPCs in flight.
+   */
+  ~AsyncLockingServiceClient();
+
+  /**
+   * Requests a shared lock for read-only access to a row.
+   *
+   * @param transactionId identifies the transaction that makes the request
+   * @param rowId identifies the row, the transaction wants to access
+   * @param lockBudget if not 0, registers the transaction with this lock budget
+   * together with the lock
+   * @returns the future of the signature and if the lock was granted
+   */
+  auto requestSharedLock(unsigned int transactionId, unsigned int rowId,
+                         unsigned int lockBudget = 0)
+      -> std::future<std::pair<std::string, bool>>;
+
+  /**
+   * Requests an exclusive lock for sole write access to a row.
+   *
+   * @param transactionId identifies the transaction that makes the request
+   * @param rowId identifies the row, the transaction wants to access
+   * @param lockBudget if not 0, registers the transaction with this lock budget
+   * together with the lock
+   * @returns the future of the signature and if the lock was granted
+   */
+  auto requestExclusiveLock(unsigned int transactionId, unsigned int rowId,
+                            unsigned int lockBudget = 0)
+      -> std::future<std::pair<std::string, bool>>;
+
+  /**
+   * Requests to release a lock acquired by the transaction before it commits.
+   * Requests for the same row can overtake each other, so the lock request
+   * needs to be answered before.
+   *
+   * @param transactionId identifies the transaction that makes the request
+   * @param rowId identifies the row, the transaction wants to unlock
+   * @returns the future of if the lock was released
+   */
+  auto requestUnlock(unsigned int transactionId, unsigned int rowId)
+      -> std::future<bool>;
+
+  /**
+   * Releases all locks granted to the transaction with a single Commit RPC. It
+   * is sent, once the lock requests of the transaction in flight are answered.
+   * A transaction without locks is not known to the server anymore, so it
+   * commits without an RPC.
+   *
+   * @param transactionId identifies the transaction
+   * @returns the future of if every lock was released
+   */
+  auto commit(unsigned int transactionId) -> std::future<bool>;
+
+  /**
+   * @returns the number of RPCs in flight right now
+   */
+  auto inFlight() -> size_t;
+
+ private:
+  /**
+   * An RPC in flight, which is the tag of its completion queue event.
+   */
+  struct AsyncCall {
+    virtual ~AsyncCall() = default;
+    ClientContext context;
+    Status status;
+  };
+
+  // LockShared or LockExclusive
+  struct LockCall : AsyncCall {
+    unsigned int transactionId;
+    unsigned int rowId;
+    LockResponse response;
+    std::unique_ptr<ClientAsyncResponseReader<LockResponse>> reader;
+    std::promise<std::pair<std::string, bool>> promise;
+  };
+
+  struct UnlockCall : AsyncCall {
+    LockResponse response;
+    std::unique_ptr<ClientAsyncResponseReader<LockResponse>> reader;
+    std::promise<bool> promise;
+  };
+
+  struct CommitCall : AsyncCall {
+    EndTransactionResponse response;
+    std::unique_ptr<ClientAsyncResponseReader<EndTransactionResponse>> reader;
+    std::promise<bool> promise;
+  };
+
+  /**
+   * What the client knows about the locks of a transaction.
+   */
+  struct TransactionLocks {
+    std::vector<unsigned int> rowIds;  // granted and not released
+    int pendingLocks = 0;              // lock requests in flight
+    bool committing = false;           // commit() waits for pendingLocks
+    std::promise<bool> commitPromise;  // while committing
+  };
+
+  /**
+   * Starts a LockShared or LockExclusive RPC.
+   *
+   * @returns the future of its result
+   */
+  auto request_lock(unsigned int transactionId, unsigned int rowId,
+                    bool isExclusive, unsigned int lockBudget)
+      -> std::future<std::pair<std::string, bool>>;
+
+  /**
+   * Waits, while the window is full, and takes a place in it. Needs to hold
+   * the mutex.
+   *
+   * @param lock the lock on the mutex
+   */
+  void enter_window(std::unique_lock<std::mutex> &lock);
+
+  /**
+   * Starts the Commit RPC releasing the locks of a transaction, which
+   * takes a place in the window without waiting for one. Needs to hold the
+   * mutex.
+   *
+   * @param transactionId identifies the transaction
+   * @param promise receives if every lock was released
+   */
+  void send_commit(unsigned int transactionId, std::promise<bool> promise);
+
+  /**
+   * Takes the responses from the completion queue and fulfills the futures of
+   * their requests, until the queue is shut down.
+   */
+  void receive();
+
+  /**
+   * Fulfills the future of a finished LockShared or LockExclusive RPC and
+   * remembers the lock, if it was granted.
+   *
+   * @param call the finished call
+   */
+  void complete_lock(LockCall *call);
+
+  std::unique_ptr<LockingService::Stub> stub_;
+  CompletionQueue queue_;
+  std::thread receiver_;
+  size_t window_;
+
+  std::mutex mutex_;  // synchronizes access on the members below
+  std::condition_variable windowFreed_;
+  size_t inFlight_ = 0;
+  std::unordered_map<unsigned int, TransactionLocks> transactions_;
+};
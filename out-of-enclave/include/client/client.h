@@ -2,16 +2,101 @@
 
 #include <grpcpp/grpcpp.h>
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string_view>
+#include <vector>
 
 #include "lockmanager.grpc.pb.h"
 #include "spdlog/spdlog.h"
 
 using grpc::Channel;
 using grpc::ClientContext;
+using grpc::ClientReaderWriter;
 using grpc::Status;
 
+/**
+ * A transaction session with the lock manager, see the TransactionSession RPC.
+ * The lock and unlock requests are sent without waiting for the responses to
+ * the earlier ones. The responses arrive as soon as the requests are finished,
+ * possibly out of order, and carry the ID the request got. The session ends
+ * with finish(), which releases all locks the transaction still holds.
+ */
+class LockingSession {
+ public:
+  /**
+   * Opens the stream for a transaction.
+   *
+   * @param stub the stub of the client that opens the session
+   * @param transactionId identifies the transaction
+   * @param lockBudget if not 0, registers the transaction with this lock budget
+   * together with its first lock request
+   */
+  LockingSession(LockingService::Stub *stub, unsigned int transactionId,
+                 unsigned int lockBudget);
+
+  LockingSession(const LockingSession &) = delete;
+  auto operator=(const LockingSession &) -> LockingSession & = delete;
+
+  /**
+   * Aborts the transaction, if the session was not finished.
+   */
+  ~LockingSession();
+
+  /**
+   * Requests a lock without waiting for the response.
+   *
+   * @param rowId identifies the row, the transaction wants to access
+   * @param isExclusive true for an exclusive lock, false for a shared lock
+   * @returns the ID of the request, or 0, if the stream is broken
+   */
+  auto requestLock(unsigned int rowId, bool isExclusive) -> uint64_t;
+
+  /**
+   * Requests to release a lock without waiting for the response.
+   *
+   * @param rowId identifies the row, the transaction wants to unlock
+   * @returns the ID of the request, or 0, if the stream is broken
+   */
+  auto requestUnlock(unsigned int rowId) -> uint64_t;
+
+  /**
+   * Waits for the next response.
+   *
+   * @param response receives the ID of the request, if it was successful and
+   * the signature of a granted lock
+   * @returns false, if the stream is broken
+   */
+  auto readResponse(SessionResponse *response) -> bool;
+
+  /**
+   * Commits or aborts the transaction, which releases all its locks, and
+   * closes the session.
+   *
+   * @param commit true to commit, false to abort the transaction
+   * @param unread receives the responses, which were not read yet, if not null
+   * @returns if the session ended without errors
+   */
+  auto finish(bool commit, std::vector<SessionResponse> *unread = nullptr)
+      -> bool;
+
+ private:
+  /**
+   * Sends a request of the session.
+   *
+   * @returns the ID of the request, or 0, if the stream is broken
+   */
+  auto send(SessionRequest::Command command, unsigned int rowId) -> uint64_t;
+
+  ClientContext context_;
+  std::unique_ptr<ClientReaderWriter<SessionRequest, SessionResponse>> stream_;
+  unsigned int transactionId_;
+  unsigned int lockBudget_;  // sent with the first lock request only
+  uint64_t nextRequestId_ = 1;
+  bool finished_ = false;
+};
+
 /**
  * The LockingServiceClient is the gRPC client for the lock manager.
  * It sends request to the gRPC server to acquire and release locks.
@@ -43,11 +128,14 @@ class LockingServiceClient {
    * @param rowId identifies the row, the transaction wants to access
    * @param waitForSignature if the request should wait for the signature return
    * value or should immediately return
+   * @param lockBudget if not 0, registers the transaction with this lock budget
+   * together with the lock, so that registerTransaction() can be skipped
    * @returns the signature of the lock
    * @throws std::domain_error, if the lock couldn't get acquired
    */
   auto requestSharedLock(unsigned int transactionId, unsigned int rowId,
-                         bool waitForSignature = true) -> std::string;
+                         bool waitForSignature = true,
+                         unsigned int lockBudget = 0) -> std::string;
 
   /**
    * Requests an exclusive lock for sole write access to a row.
@@ -56,11 +144,14 @@ class LockingServiceClient {
    * @param rowId identifies the row, the transaction wants to access
    * @param waitForSignature if the request should wait for the signature return
    * value or should immediately return
+   * @param lockBudget if not 0, registers the transaction with this lock budget
+   * together with the lock, so that registerTransaction() can be skipped
    * @returns the signature of the lock
    * @throws std::domain_error, if the lock couldn't get acquired
    */
   auto requestExclusiveLock(unsigned int transactionId, unsigned int rowId,
-                            bool waitForSignature = true) -> std::string;
+                            bool waitForSignature = true,
+                            unsigned int lockBudget = 0) -> std::string;
 
   /**
    * Requests to release a lock acquired by the transaction.
@@ -74,6 +165,89 @@ class LockingServiceClient {
   auto requestUnlock(unsigned int transactionId, unsigned int rowId,
                      bool waitForResult = false) -> bool;
 
+  /**
+   * Submits several requests with a single RPC, which the lock manager passes
+   * on to the enclave all at once.
+   *
+   * @param jobs the requests, which can belong to different transactions
+   * @param waitForSignature if the request should wait for the results of all
+   * jobs or should immediately return
+   * @returns for each job its signature, if it acquired a lock, and if it was
+   * successful, or nothing, if the RPC failed
+   */
+  auto submitBatch(const std::vector<BatchRequest::Job> &jobs,
+                   bool waitForSignature = true)
+      -> std::vector<std::pair<std::string, bool>>;
+
+  /**
+   * Requests several locks of a transaction with a single RPC. The worker
+   * threads owning the rows acquire them in parallel.
+   *
+   * @param transactionId identifies the transaction that makes the request
+   * @param locks the rows with true for an exclusive lock, false for a shared
+   * lock
+   * @param lockBudget if not 0, registers the transaction with this lock budget
+   * together with the locks, so that registerTransaction() can be skipped
+   * @returns for each lock its signature, if it was granted, and if it was
+   * granted, or nothing, if the RPC failed
+   */
+  auto lockBatch(unsigned int transactionId,
+                 const std::vector<std::pair<unsigned int, bool>> &locks,
+                 unsigned int lockBudget = 0)
+      -> std::vector<std::pair<std::string, bool>>;
+
+  /**
+   * Releases several locks of a transaction with a single RPC.
+   *
+   * @param transactionId identifies the transaction that makes the request
+   * @param rowIds the rows to unlock
+   * @returns for each row if its lock was released, or nothing, if the RPC
+   * failed
+   */
+  auto unlockBatch(unsigned int transactionId,
+                   const std::vector<unsigned int> &rowIds)
+      -> std::vector<bool>;
+
+  /**
+   * Releases all locks of a transaction with a single RPC, once it commits.
+   *
+   * @param transactionId identifies the transaction
+   * @returns if the transaction was registered and all its locks got released
+   */
+  auto commit(unsigned int transactionId) -> bool;
+
+  /**
+   * Releases all locks of a transaction with a single RPC, once it aborts.
+   *
+   * @param transactionId identifies the transaction
+   * @returns if the transaction was registered and all its locks got released
+   */
+  auto abort(unsigned int transactionId) -> bool;
+
+  /**
+   * Collects the signatures of the lock requests of a transaction, which did
+   * not wait for them, with a single RPC, e.g. before the transaction commits.
+   *
+   * @param transactionId identifies the transaction
+   * @returns for each lock request its ticket, row ID, lock mode, if it was
+   * granted and its signature, or nothing, if the RPC failed
+   */
+  auto collectSignatures(unsigned int transactionId)
+      -> std::vector<CollectResponse::Result>;
+
+  /**
+   * Opens a session, which streams the lock and unlock requests of a
+   * transaction with a single RPC.
+   *
+   * @param transactionId identifies the transaction
+   * @param lockBudget if not 0, registers the transaction with this lock budget
+   * together with its first lock request, so that registerTransaction() can be
+   * skipped
+   * @returns the session
+   */
+  auto openSession(unsigned int transactionId, unsigned int lockBudget = 0)
+      -> std::unique_ptr<LockingSession>;
+
  private:
   std::unique_ptr<LockingService::Stub> stub_;
 };
\ No newline at end of file
@@ -8,12 +8,22 @@
  * with RIDs as keys and lock structs as values.
  *
  * It implements Chained Hashing, where for each entry in the table a linked
- * list, called bucket, is maintained that can store collisions.
+ * list, called bucket, is maintained that can store collisions. The number of
+ * buckets follows the number of entries: when the table is resized, the
+ * entries are moved from old_table into table a few buckets at a time on each
+ * following set and remove, so that no single operation has to rehash the
+ * whole table.
  */
 typedef struct {
   int size;                   // number of buckets
   struct Entry** table;       // list of linked list of entires, i.e. buckets
   unsigned int* bucketSizes;  // list of number of entries for each bucket
+  int min_size;               // the table never shrinks below its initial size
+  int num_entries;            // number of entries in table and old_table
+  int old_size;               // number of buckets of old_table
+  int rehash_index;           // next bucket of old_table to migrate
+  struct Entry** old_table;   // buckets left to migrate while resizing
+  unsigned int* old_bucket_sizes;
 } HashTable;
 
 typedef struct Entry Entry;  // Required to use C++ structs as C structs
@@ -23,7 +33,66 @@ struct Entry {
   struct Entry* next;
 };
 
-enum Command { SHARED, EXCLUSIVE, UNLOCK, QUIT, REGISTER };
+// Open addressing lock table, see locktable.h
+typedef struct LockTable LockTable;
+typedef struct LockBucket LockBucket;
+
+// Hand-over of unused lock table buckets, see reclamation.h
+typedef struct Reclamation Reclamation;
+
+// Submission of jobs through shared memory, see requestring.h
+typedef struct RequestRings RequestRings;
+
+// A node of the Merkle trees over the lock table buckets, see
+// integrity_verification.h
+struct MerkleNode {
+  unsigned char hash[32];  // SHA-256
+};
+typedef struct MerkleNode MerkleNode;
+
+// How the enclave protects the integrity of the lock table buckets
+enum IntegrityScheme {
+  HASH_LIST,   // one hash per bucket, all of them inside the enclave
+  MERKLE_TREE  // Merkle tree over the buckets, only its top levels inside
+};
+
+// How the enclave computes the digest of a single lock table bucket
+enum BucketDigestScheme {
+  FULL_HASH,         // SHA-256 over the whole bucket
+  INCREMENTAL_HASH,  // XOR of keyed tags over the header and each used slot
+  FULL_CMAC          // AES-CMAC over the whole bucket
+};
+
+struct IntegrityOptions {
+  enum IntegrityScheme scheme;
+  int merkle_arity;       // children per inner node, determines the depth
+  int merkle_cache_size;  // nodes per tree kept in the enclave, at least 1
+  enum BucketDigestScheme digest;
+  int digest_size;  // bytes kept of each bucket digest, 0 keeps all of them
+};
+typedef struct IntegrityOptions IntegrityOptions;
+
+// COMMIT and ABORT release all locks of a transaction, which the enclave splits
+// into a RELEASE job for every worker thread owning one of their rows. RELEASE
+// is only created by the enclave itself.
+enum Command {
+  SHARED,
+  EXCLUSIVE,
+  UNLOCK,
+  QUIT,
+  REGISTER,
+  COMMIT,
+  ABORT,
+  RELEASE
+};
+
+// The completion word of a job, through which its caller learns that the job is
+// finished
+enum JobState {
+  JOB_PENDING,
+  JOB_FINISHED,
+  JOB_PENDING_WAITER  // not finished and the caller sleeps until it is
+};
 
 struct Job {
   enum Command command;
@@ -32,15 +101,24 @@ struct Job {
   unsigned int lock_budget;
   bool wait_for_result;
   volatile char* return_value;
-  volatile bool* finished;
+  volatile int* finished;  // a JobState
   volatile bool* error;
+  void* release_group;  // trusted ReleaseGroup of a RELEASE job
 };
 typedef struct Job Job;  // Required to use C++ structs as C structs
 
+// How a lock request is handled, that conflicts with the lock of another
+// transaction
+enum LockConflictPolicy {
+  NO_WAIT,  // the request fails
+  WAIT_DIE  // an older transaction waits for the lock, a younger one fails
+};
+
 struct Arg {
   int num_threads;
-  int tx_thread_id;
   int transaction_table_size;
   int lock_table_size;
+  IntegrityOptions integrity;
+  enum LockConflictPolicy conflict_policy;
 };
 typedef struct Arg Arg;  // Required to use C++ structs as C structs
\ No newline at end of file
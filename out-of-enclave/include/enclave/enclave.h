@@ -5,32 +5,152 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <cstring>
-#include <queue>
+#include <deque>
+#include <list>
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "common.h"
 #include "enclave_t.h"
 #include "hashtable.h"
 #include "integrity_verification.h"
+#include "jobqueue.h"
 #include "lock.h"
 #include "lock_signatures.h"
+#include "locktable.h"
+#include "partitionmap.h"
+#include "reclamation.h"
+#include "requestring.h"
 #include "sgx_tcrypto.h"
 #include "sgx_tkey_exchange.h"
 #include "sgx_trts.h"
 #include "transaction.h"
 
-// Holds the transaction objects of the currently active transactions
-HashTable *transactionTable_;
+/**
+ * A part of the transaction table with the mutex, that synchronizes access on
+ * it and on the transactions in it. Every shard starts on its own cache line.
+ */
+struct TransactionTableShard {
+  alignas(64) HashTable *transactions;
+  sgx_thread_mutex_t mutex;
+};
+
+// Holds the transaction objects of the currently active transactions, split by
+// transaction ID into one shard per worker thread, see getTransactionShard().
+// Each worker thread registers the transactions of its own shard. A
+// transaction is shared by all worker threads whose partitions contain one of
+// its locks, which only read or modify it, i.e. its lock budget, its locks and
+// its phase, while they hold the mutex of its shard. The lock table partitions
+// are only accessed by their own worker thread and need no synchronization.
+TransactionTableShard *transactionTable_;
+
+// Serializes the dispatching of jobs, which routes them through partitionMap_
+sgx_thread_mutex_t dispatchMutex_;
+
+// Keeps track of a lock object for each row ID. The header and the partitions
+// are trusted copies of the ones passed by the untrusted application, only the
+// buckets reside in untrusted memory.
+LockTable lockTable_;
+
+// Assigns the partitions of the lock table to the worker threads and hands them
+// over between them, when the load is unevenly distributed
+PartitionMap *partitionMap_;
+
+// The partitions of the lock table passed by the untrusted application. The
+// enclave never reads from them, but publishes the layout of its partitions
+// there after they were resized, so that the untrusted application can find
+// the buckets.
+LockTablePartition *untrustedPartitions_;
+
+/* Contains the integrity data over the buckets of the lock table for each
+ * partition, which is used to verify the integrity of the lock table: If the
+ * hash of a bucket is recomputed and has changed, it means the contents of the
+ * bucket changed. Depending on the integrity scheme, the hashes are kept in a
+ * list inside the enclave or in a Merkle tree.*/
+std::vector<LockTableIntegrityHashes> lockTableIntegrityHashes;
+
+/**
+ * A lock request, that waits for the lock of a row to become free. It is
+ * answered like its job, or through the request ring it came from.
+ */
+struct LockWaiter {
+  Job job;            // the SHARED or EXCLUSIVE job, trusted copy
+  RequestRing *ring;  // the ring of the request, or nullptr
+  unsigned long tag;  // identifies the response in the ring
+};
+
+// The lock requests waiting for the rows of each partition of the lock table,
+// by row ID, in the order they arrived. The locks themselves reside in the
+// untrusted buckets, but the waiting requests only live in the enclave. Like
+// the buckets, they are only accessed by the worker thread owning the
+// partition, so they are handed over together with it.
+std::vector<std::unordered_map<int, std::list<LockWaiter>>> lockWaiters_;
+
+// How a lock request ended, when a worker thread processed it
+enum LockRequestResult {
+  REQUEST_GRANTED,
+  REQUEST_DENIED,
+  REQUEST_WAITING  // answered later, when the lock is granted
+};
+
+// Reclamation state passed by the untrusted application, through which the
+// worker threads hand back bucket arrays they no longer use. The rings are
+// checked to be in untrusted memory once at initialization and are nullptr
+// otherwise.
+Reclamation *reclamation_;
+ReclamationRing *reclamationRings_;
+
+// The request rings passed by the untrusted application, one for each worker
+// thread, or nullptr, when the jobs are only submitted by ECALLs
+RequestRing *requestRings_;
+
+// Number of times a worker thread polls its empty request ring, before it
+// blocks until it is woken up
+const int kRequestRingPolls = 4096;
+
+// Maximum number of requests a worker thread takes from its request ring,
+// before it looks at its job queue again
+const int kRequestRingBatchSize = 64;
+
+/**
+ * The job queue of a worker thread, with the mutex and condition variable the
+ * worker thread blocks on, while the queue is empty. Every worker thread's
+ * queue starts on its own cache line.
+ */
+struct WorkerQueue {
+  JobQueue jobs;
+  sgx_thread_mutex_t mutex;
+  sgx_thread_cond_t cond;
+};
 
-// Keeps track of a lock object for each row ID
-HashTable *lockTable_;
+/**
+ * Releasing all locks of a committing or aborting transaction. The transaction
+ * is taken out of the transaction table right away, so that it cannot acquire
+ * further locks. Its locks are released by one RELEASE job for every worker
+ * thread owning one of their partitions. The last of them frees the
+ * transaction and finishes the COMMIT or ABORT job of the caller.
+ */
+struct TransactionRelease {
+  Transaction *transaction;
+  int pending_jobs;  // RELEASE jobs not finished yet
+  bool failed;       // if a lock could not be released
+  Job job;           // the COMMIT or ABORT job
+};
 
-/* Contains a list of hashes over the buckets of the lock table, which is used
- * to verify the integrity of the lock table: If the hash is recomputed and has
- * changed, it means the contents of the bucket changed.*/
-std::vector<sgx_sha256_hash_t *> lockTableIntegrityHashes;
+/**
+ * The locks of a transaction on the partitions of one worker thread, which a
+ * RELEASE job releases at once, and the rows its requests still wait for
+ * there. Only lives in trusted memory.
+ */
+struct ReleaseGroup {
+  TransactionRelease *release;
+  std::map<int, std::vector<int>> row_ids;          // by partition
+  std::map<int, std::vector<int>> waiting_row_ids;  // by partition
+};
 
 // Contains configuration parameters
 extern Arg arg_enclave;
@@ -45,9 +165,22 @@ extern int transactionCount;
  * @param arg configuration parameters
  * @param lock_table pointer to lock table whose memory was allocated in the
  * untrusted part
- * allocated in the untrusted part
+ * @param reclamation pointer to the reclamation rings in the untrusted part,
+ * through which the enclave hands back bucket arrays it no longer uses
+ * @param request_rings pointer to the request rings in the untrusted part, or
+ * nullptr, when all jobs are submitted by ECALLs
+ */
+void enclave_init_values(Arg arg, LockTable *lock_table,
+                         Reclamation *reclamation,
+                         RequestRings *request_rings);
+
+/**
+ * Changes how lock requests are handled, that conflict with the lock of
+ * another transaction. Requests already waiting keep waiting.
+ *
+ * @param policy a LockConflictPolicy
  */
-void enclave_init_values(Arg arg, HashTable *lock_table);
+void enclave_set_conflict_policy(int policy);
 
 /**
  * Function that receives a job from the untrusted application.
@@ -60,16 +193,141 @@ void enclave_init_values(Arg arg, HashTable *lock_table);
  */
 void enclave_send_job(void *data);
 
+/**
+ * Receives a batch of jobs from the untrusted application with a single
+ * ECALL, see dispatch_jobs.
+ *
+ * @param data array of Job structs in untrusted memory
+ * @param count number of jobs in the array
+ */
+void enclave_send_jobs(void *data, int count);
+
+/**
+ * Copies jobs from untrusted memory and puts each of them into the job queue
+ * of the worker thread responsible for it. Lock requests of transactions that
+ * are not registered are rejected right away, unless they carry a lock budget
+ * to register the transaction with. COMMIT and ABORT are split into RELEASE
+ * jobs, see dispatch_release. A worker thread is signaled at most once, no
+ * matter how many jobs it receives, and only if it sleeps. Jobs for the same
+ * worker thread keep their order.
+ *
+ * @param jobs the jobs in untrusted memory
+ * @param count number of jobs
+ */
+void dispatch_jobs(Job *jobs, int count);
+
+/**
+ * Takes a committing or aborting transaction out of the transaction table and
+ * groups the rows it holds locks on by the worker thread owning their
+ * partition. Every group becomes a RELEASE job, which is routed like a lock
+ * request for each of its partitions. Finishes the job right away, when the
+ * transaction is not registered or holds no locks. Needs to hold the dispatch
+ * mutex.
+ *
+ * @param job trusted copy of the COMMIT or ABORT job
+ * @param batches receives the RELEASE jobs for each worker thread
+ */
+void dispatch_release(const Job &job, std::vector<std::vector<Job>> &batches);
+
+/**
+ * Wakes up a worker thread, which blocked after it found its request ring
+ * empty, see requestring.h.
+ *
+ * @param thread_id the worker thread
+ */
+void enclave_wake_worker(int thread_id);
+
+/**
+ * Signals a worker thread, which blocked on its empty job queue and request
+ * ring.
+ *
+ * @param thread_id the worker thread
+ */
+void wake_worker(int thread_id);
+
 /**
  * Function that is run by the worker threads inside the enclave. It pulls a job
  * from its associated job queue in a loop and executes it, e.g. acquiring a
- * shared lock for a specific row. Each row gets assigned a specific thread
- * evenly, so no synchronization is necessary when accessing the underlying lock
- * table. The transaction table is accessed by only one single thread for all
- * requests to register a transaction.
+ * shared lock for a specific row. Each partition of the lock table belongs to a
+ * single thread at a time, so no synchronization is necessary when accessing
+ * the underlying lock table. Lock requests for a partition, that was just
+ * handed over to the thread, are held back until its previous owner is done
+ * with it. Requests to register a transaction go to the thread owning its shard
+ * of the transaction table. With request rings, it also polls its ring, while
+ * its job queue is empty.
  */
 void enclave_process_request();
 
+/**
+ * Checks, if a worker thread needs to hold a job back, because one of its
+ * partitions is not handed over yet or jobs before it were held back.
+ *
+ * @param job the job
+ * @param heldBack the jobs the worker thread holds back
+ * @param threadId the worker thread
+ * @returns true, when the job needs to wait
+ */
+auto must_hold_back(const Job &job, const std::deque<Job> &heldBack,
+                    int threadId) -> bool;
+
+/**
+ * Checks, if a SHARED, EXCLUSIVE, UNLOCK or RELEASE job accesses a partition.
+ *
+ * @param job the job
+ * @param partition index of the partition
+ * @returns false for any other job
+ */
+auto accesses_partition(const Job &job, int partition) -> bool;
+
+/**
+ * Marks a job as finished, after its results were written, and wakes up its
+ * caller, if it sleeps.
+ *
+ * @param finished the completion word of the job in untrusted memory
+ */
+void finish_job(volatile int *finished);
+
+/**
+ * Processes the requests in the request ring of a worker thread and answers
+ * those waiting for a result. Polls the ring for a while, if it is empty.
+ *
+ * @param ring the ring of the worker thread
+ * @param threadId the worker thread
+ * @returns true, when at least one request was processed
+ */
+auto poll_request_ring(RequestRing *ring, int threadId) -> bool;
+
+/**
+ * Validates and executes a request from a request ring, which was already
+ * copied into trusted memory.
+ *
+ * @param request the request
+ * @param threadId the worker thread whose ring the request came from
+ * @param signature receives the base64-encoded signature of a lock request
+ * @returns REQUEST_DENIED, when the request is invalid or failed,
+ * REQUEST_WAITING, when a lock request waits for the lock and is answered by
+ * grant_waiters()
+ */
+auto process_ring_request(const RingRequest &request, int threadId,
+                          char *signature) -> LockRequestResult;
+
+/**
+ * Returns the shard of the transaction table, that holds the transaction.
+ *
+ * @param transactionId identifies the transaction
+ * @returns the shard
+ */
+auto get_transaction_shard(unsigned int transactionId)
+    -> TransactionTableShard &;
+
+/**
+ * Checks, if the transaction is registered, under the mutex of its shard.
+ *
+ * @param transactionId identifies the transaction
+ * @returns true, when the transaction is registered
+ */
+auto is_registered(unsigned int transactionId) -> bool;
+
 /**
  * Registers the transaction at the enclave prior to being able to
  * acquire any locks, so that the enclave can now the transaction's lock
@@ -78,34 +336,221 @@ void enclave_process_request();
  * @param transactionId identifies the transaction
  * @param lockBudget maximum number of locks the transaction is allowed to
  * acquire
+ * @returns false, when the transaction is already registered
+ */
+auto register_transaction(unsigned int transactionId, unsigned int lockBudget)
+    -> bool;
+
+/**
+ * Encodes a signature of a lock in base64, as it is handed to the untrusted
+ * application.
+ *
+ * @param signature the signature
+ * @returns the x and y coordinates in base64, separated by a dash
  */
-int register_transaction(unsigned int transactionId, unsigned int lockBudget);
+auto encode_signature(const sgx_ec256_signature_t &signature) -> std::string;
 
 /**
  * Acquires a lock for the specified row and writes the signature into the
- * provided buffer.
+ * provided buffer. A request, that conflicts with the owners of the lock or
+ * with the requests waiting for it, waits under WAIT_DIE, if mayWait() allows
+ * it and the transaction is older than every waiting request.
  *
  * @param signature buffer where the enclave will store the signature
- * @param sig_len length of the buffer
- * @param transactionId identifies the transaction making the request
- * @param rowId identifies the row to be locked
- * @param requestedMode either shared for concurrent read access or exclusive
- * for sole write access
+ * @param waiter the SHARED or EXCLUSIVE job with the transaction ID, the row
+ * ID and the lock budget, and where to answer it, if it waits. If not 0, the
+ * lock budget registers the transaction together with the lock, when it is
+ * not registered yet.
  * @param threadId the context for signing locks is exclusive for each thread,
  * therefore we need to know the calling thread's ID
- * @returns SGX_ERROR_UNEXPCTED, when transaction did not call
- * RegisterTransaction before or the given lock mode is unknown or when the
- * transaction makes a request for a look, that it already owns, makes a
- * request for a lock while in the shrinking phase, or when the lock budget is
- * exhausted
+ * @returns REQUEST_DENIED, when transaction did not call
+ * RegisterTransaction before or when the transaction makes a request for a
+ * look, that it already owns, makes a request for a lock while in the
+ * shrinking phase, when the lock budget is exhausted or the request conflicts
+ * and does not wait. REQUEST_WAITING, when the request was queued and
+ * grant_waiters() answers it later.
+ */
+auto acquire_lock(void *signature, const LockWaiter &waiter, int threadId)
+    -> LockRequestResult;
+
+/**
+ * Queues a conflicting lock request at the row, if it may wait under
+ * WAIT_DIE. An unknown transaction is registered with the lock budget of the
+ * request, so that it fails, once the transaction ends while it waits. Needs
+ * to hold the mutex of the transaction's shard.
+ *
+ * @param waiter the lock request
+ * @param partition index of the partition of the row
+ * @param lock trusted copy of the lock for the row
+ * @returns false, when the request may not wait
+ */
+auto wait_for_lock(const LockWaiter &waiter, int partition, Lock *lock)
+    -> bool;
+
+/**
+ * Signs the lock tuple of a granted lock.
+ *
+ * @param signature buffer where the enclave will store the signature
+ * @param transactionId identifies the transaction, that got the lock
+ * @param rowId identifies the locked row
+ * @param isExclusive if the lock is exclusive or shared
+ * @param threadId the calling thread, whose context is used for signing
+ */
+void sign_lock(sgx_ec256_signature_t *signature, int transactionId, int rowId,
+               bool isExclusive, int threadId);
+
+/**
+ * Writes the base64 encoded signature or the error into the result of a
+ * SHARED or EXCLUSIVE job and marks it finished, if its caller waits for it.
+ *
+ * @param job the job
+ * @param signature the signature of the granted lock or nullptr, if the lock
+ * was not granted
+ */
+void finish_lock_job(const Job &job, sgx_ec256_signature_t *signature);
+
+/**
+ * Answers a lock request, that waited for the lock, either by finishing its
+ * job or by a response in its request ring.
+ *
+ * @param waiter the request
+ * @param signature the signature of the granted lock or nullptr, if the lock
+ * was not granted
+ */
+void answer_waiter(const LockWaiter &waiter, sgx_ec256_signature_t *signature);
+
+/**
+ * Grants the requests waiting for the rows of a partition in their order, as
+ * long as they do not conflict with the owners of the lock, and answers them.
+ * A request of a transaction, that ended meanwhile or is in its shrinking
+ * phase, fails. Called by the worker thread owning the partition, after it
+ * released locks on the rows.
+ *
+ * @param partition index of the partition
+ * @param rowIds the released rows, which requests wait for
+ * @param threadId the calling thread, whose context is used for signing
+ */
+void grant_waiters(int partition, const std::vector<int> &rowIds,
+                   int threadId);
+
+/**
+ * Looks up the transaction and adds the lock to it, see grant_lock(). An
+ * unknown transaction is registered with the given lock budget, if it gets the
+ * lock. Needs to hold the mutex of the transaction's shard.
+ *
+ * @param transactionId identifies the transaction making the request
+ * @param rowId identifies the row to be locked
+ * @param isExclusive true for exclusive, false for shared access
+ * @param lock trusted copy of the lock for the row
+ * @param lockBudget lock budget to register an unknown transaction with, or 0
+ * @returns false, when the transaction is not registered and has no lock
+ * budget or grant_lock() failed
+ */
+auto add_lock_to_transaction(int transactionId, int rowId, bool isExclusive,
+                             Lock *lock, unsigned int lockBudget) -> bool;
+
+/**
+ * Checks if the transaction may acquire the lock and adds the lock to the
+ * transaction.
+ *
+ * @param transaction the transaction making the request
+ * @param rowId identifies the row to be locked
+ * @param isExclusive true for exclusive, false for shared access
+ * @param lock trusted copy of the lock for the row
+ * @returns false, when the transaction is in its shrinking phase, has
+ * exhausted its lock budget or cannot get the requested access
+ */
+auto grant_lock(Transaction *transaction, int rowId, bool isExclusive,
+                Lock *lock) -> bool;
+
+/**
+ * Sums up the protected memory used for the integrity data of the lock table.
+ * Only meaningful while no requests are processed.
+ *
+ * @returns the number of bytes
+ */
+auto get_integrity_memory_usage() -> size_t;
+
+/**
+ * Microbenchmark for the bucket digests. Repeatedly verifies a lock table
+ * bucket with the given number of used slots and updates its digest after a
+ * lock in it changed, like a lock request does.
+ *
+ * @param numOccupied number of used slots of the bucket
+ * @param iterations how often to verify and update the bucket
+ */
+void digest_locktable_buckets(int numOccupied, int iterations);
+
+/**
+ * Advances the resizing of a lock table partition by migrating the locks of a
+ * few old buckets. It is called before every lock and unlock operation on the
+ * partition, so that the cost of resizing is spread across them.
+ *
+ * @param partition index of the partition
+ * @returns false, when the integrity verification of a bucket failed
+ */
+auto rehash_partition(int partition) -> bool;
+
+/**
+ * Replaces the trusted header of a partition with a modified copy and
+ * publishes it to the untrusted application.
+ *
+ * @param partition index of the partition
+ * @param header the modified copy of the header
+ */
+void store_partition(int partition, LockTablePartition &header);
+
+/**
+ * Completes an operation on a partition: writes the modified buckets back,
+ * stores the modified header and only then hands the bucket arrays released by
+ * the operation back to the untrusted application, when nothing refers to them
+ * anymore.
+ *
+ * @param partition index of the partition
+ * @param header the modified copy of the header
+ * @param access the bucket access of the operation
  */
-auto acquire_lock(void *signature, int transactionId, int rowId,
-                  bool isExclusive, int threadId) -> bool;
+void commit_partition(int partition, LockTablePartition &header,
+                      VerifiedLockBucketAccess &access);
 
 /**
- * Releases a lock for the specified row.
+ * Releases a lock for the specified row. When the lock has no owners left, it
+ * is removed from the lock table. Grants the requests waiting for it
+ * afterwards.
  *
  * @param transactionId identifies the transaction making the request
  * @param rowId identifies the row to be released
+ * @param threadId the calling thread, which signs the granted requests
+ * @returns false, when the transaction did not own the lock or the integrity
+ * verification failed
+ */
+auto release_lock(int transactionId, int rowId, int threadId) -> bool;
+/**
+ * Releases the locks of a transaction on several rows of a partition. The
+ * buckets are verified and their integrity hashes updated only once, no matter
+ * how many of the locks they hold. Locks without owners are removed from the
+ * lock table. Does not modify the transaction. Fails the requests of the
+ * transaction, that still wait for locks of the partition, and grants the
+ * requests waiting for the rows afterwards.
+ *
+ * @param transactionId identifies the transaction
+ * @param partition index of the partition
+ * @param rowIds the rows of the partition to release
+ * @param waitingRowIds the rows of the partition, whose locks requests of the
+ * transaction wait for
+ * @param threadId the calling thread, which signs the granted requests
+ * @returns false, when a lock was missing or the integrity verification failed
+ */
+auto release_locks(int transactionId, int partition,
+                   const std::vector<int> &rowIds,
+                   const std::vector<int> &waitingRowIds, int threadId)
+    -> bool;
+
+/**
+ * Executes a RELEASE job. The last RELEASE job of a transaction frees the
+ * transaction and finishes the job of the caller.
+ *
+ * @param group the locks to release
+ * @param threadId the calling thread
  */
-void release_lock(int transactionId, int rowId);
\ No newline at end of file
+void execute_release(ReleaseGroup *group, int threadId);
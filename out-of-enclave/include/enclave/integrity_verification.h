@@ -1,39 +1,298 @@
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "common.h"
 #include "enclave_t.h"
 #include "lock.h"
+#include "locktable.h"
+#include "reclamation.h"
 #include "sgx_tcrypto.h"
 #include "sgx_trts.h"
 #include "transaction.h"
 
-extern int sizeOfSerializedLockEntry;
+// Number of uint32_t elements a serialized lock takes up
+const int sizeOfSerializedLockEntry =
+    3 +  // lock.key, lock.exclusive, lock.num_owners (compare lock struct)
+    kTransactionBudget;  // owners of the lock can be at most kTransactionBudget
+
+// Number of uint32_t elements a serialized bucket of the lock table takes up.
+// It is small and fixed, so every worker thread serializes into a buffer on its
+// own stack.
+const int sizeOfSerializedLockBucket =
+    2 +  // bucket.occupied, bucket.overflow (compare LockBucket struct)
+    kLockTableSlotsPerBucket * sizeOfSerializedLockEntry;
+
+// Selects the integrity scheme for the bucket arrays of the lock table. Set
+// once by set_integrity_options.
+extern IntegrityOptions integrityOptions;
 
 /**
- * Computes the hash over the given bucket from the lock table and updates the
- * integrity hashes stored inside the enclave.
+ * Sets the integrity scheme and generates the key for keyed bucket digests.
+ * Must be called before any integrity data is created.
  *
- * @param bucket
- * @param key
- * @param numEntries
- * @param lockTableIntegrityHashes
+ * @param options the integrity scheme to use from now on
+ * @returns false, when no key could be generated
  */
-void update_integrity_hash_locktable(
-    uint32_t *bucket, int key, int numEntries,
-    std::vector<sgx_sha256_hash_t *> &lockTableIntegrityHashes);
+auto set_integrity_options(IntegrityOptions options) -> bool;
 
 /**
- * Hashes a bucket of the lock table. The hash is saved by the enclave
- * and can be used to detect if the contents of the bucket was altered, by
- * computing the hash again and comparing it with the saved hash. If they don't
- * match, then something inside the bucket changed.
+ * @returns the number of bytes of a bucket digest that are kept, which is the
+ * digest_size of integrityOptions, but at most the size of the hash or tag the
+ * digest is computed with
+ */
+auto bucket_digest_size() -> int;
+
+/**
+ * Computes the digest of a lock table bucket according to
+ * integrityOptions.digest. The digest of an empty bucket, that was never probed
+ * past, is all zeros.
  *
- * @param bucket the bucket to compute the hash over
- * @returns the hash over the given bucket
+ * With FULL_HASH it is the SHA-256 hash of the serialized bucket and with
+ * FULL_CMAC the AES-CMAC of it, under a key that never leaves the enclave.
+ * With INCREMENTAL_HASH every used slot and the bucket header contribute an
+ * independent AES-CMAC tag under that key, and the digest is the XOR of these
+ * tags. Since a tag covers the position of its slot, no two tags of a bucket
+ * are computed over the same input. Only the first bucket_digest_size() bytes
+ * of the digest are kept, the rest is zero.
+ *
+ * @param bucket trusted copy of the bucket
+ * @param digest receives the digest
  */
-auto hash_transactiontable_bucket(Entry *bucket) -> sgx_sha256_hash_t *;
+void digest_locktable_bucket(LockBucket *bucket, MerkleNode &digest);
+
+/**
+ * Turns the digest of a bucket into the digest of its modified copy. With
+ * INCREMENTAL_HASH only the tags of the slots that changed are replaced, so
+ * the cost of an operation does not depend on how full the bucket is.
+ *
+ * @param digest the digest of original, which receives the digest of modified
+ * @param original the bucket the digest was computed over
+ * @param modified the modified copy of the bucket
+ */
+void update_locktable_bucket_digest(MerkleNode &digest, LockBucket &original,
+                                    LockBucket &modified);
+
+/**
+ * Protects the integrity of one bucket array of the lock table. Since the
+ * buckets reside in untrusted memory, every bucket that is read is checked
+ * against data kept inside the enclave, and every bucket that is written back
+ * updates that data.
+ */
+class LockBucketHashes {
+ public:
+  virtual ~LockBucketHashes() = default;
+
+  /**
+   * @returns the number of buckets of the array
+   */
+  virtual auto size() -> int = 0;
+
+  /**
+   * Copies a bucket from untrusted into protected memory and verifies the copy.
+   * Working on the copy makes sure, that the contents cannot change between
+   * verifying and using them.
+   *
+   * @param buckets the bucket array in untrusted memory
+   * @param index position of the bucket within the array
+   * @param trusted receives the copy of the bucket
+   * @param digest receives the digest of the copy
+   * @returns true, when the copy is unaltered
+   */
+  virtual auto verify(LockBucket *buckets, int index, LockBucket &trusted,
+                      MerkleNode &digest) -> bool = 0;
+
+  /**
+   * Writes a modified trusted copy of a bucket back into untrusted memory and
+   * updates the integrity data.
+   *
+   * @param buckets the bucket array in untrusted memory
+   * @param index position of the bucket within the array
+   * @param original the verified copy the modifications started from
+   * @param digest the digest of original, as computed by verify
+   * @param trusted the modified copy of the bucket
+   * @returns false, when the integrity data could not be updated, in which case
+   * the bucket is not written back
+   */
+  virtual auto update(LockBucket *buckets, int index, LockBucket &original,
+                      MerkleNode &digest, LockBucket &trusted) -> bool = 0;
+
+  /**
+   * @returns the number of bytes of protected memory used for the array
+   */
+  virtual auto trusted_memory() -> size_t = 0;
+};
+
+/**
+ * Keeps the digest of every bucket inside the enclave, so that every bucket can
+ * be verified on its own. Only the bytes of the digests that are kept are
+ * stored, one after the other.
+ */
+class HashListLockBucketHashes : public LockBucketHashes {
+ public:
+  /**
+   * @param size the number of buckets, which are all empty
+   */
+  HashListLockBucketHashes(int size);
+
+  auto size() -> int override;
+  auto verify(LockBucket *buckets, int index, LockBucket &trusted,
+              MerkleNode &digest) -> bool override;
+  auto update(LockBucket *buckets, int index, LockBucket &original,
+              MerkleNode &digest, LockBucket &trusted) -> bool override;
+  auto trusted_memory() -> size_t override;
+
+ private:
+  int digestSize_;
+  std::vector<unsigned char> digests_;
+};
+
+/**
+ * Keeps a Merkle tree over the buckets, whose leaves are the digests of the
+ * buckets and whose inner nodes hash merkle_arity children each. Only the top
+ * levels of the tree, which fit into merkle_cache_size nodes, are kept inside
+ * the enclave, the lower ones reside in untrusted memory next to the buckets.
+ * A bucket is verified by hashing its way up to the first level inside the
+ * enclave, using the siblings on the path from untrusted memory. So the
+ * protected memory stays the same, no matter how many buckets there are.
+ *
+ * Empty buckets that were never probed past, and inner nodes with only such
+ * buckets below them, hash to all zeros. Zeroed memory therefore is a valid
+ * tree over empty buckets.
+ */
+class MerkleLockBucketHashes : public LockBucketHashes {
+ public:
+  /**
+   * @param size the number of buckets, which are all empty
+   * @param arity number of children per inner node
+   * @param cacheSize maximum number of nodes to keep inside the enclave
+   */
+  MerkleLockBucketHashes(int size, int arity, int cacheSize);
+  ~MerkleLockBucketHashes() override;
+
+  /**
+   * @returns false, when the untrusted part of the tree could not be allocated
+   */
+  auto allocated() -> bool;
+
+  auto size() -> int override;
+  auto verify(LockBucket *buckets, int index, LockBucket &trusted,
+              MerkleNode &digest) -> bool override;
+  auto update(LockBucket *buckets, int index, LockBucket &original,
+              MerkleNode &digest, LockBucket &trusted) -> bool override;
+  auto trusted_memory() -> size_t override;
+
+ private:
+  /**
+   * Copies the children of every node on the path from a leaf up to the first
+   * level inside the enclave into protected memory.
+   */
+  void read_path(int index, std::vector<MerkleNode> &path);
+
+  /**
+   * Hashes up the copied path, starting with the given leaf, and stores every
+   * node on the way into the path.
+   *
+   * @returns the node of the first level inside the enclave
+   */
+  auto hash_path(int index, MerkleNode &leaf, std::vector<MerkleNode> &path)
+      -> MerkleNode;
+
+  /**
+   * @returns the node of the first level inside the enclave that is on the path
+   * of the leaf
+   */
+  auto cached_node(int index) -> MerkleNode &;
+
+  int arity_;
+  std::vector<int> levelSizes_;  // number of nodes per level, leaves first
+  int firstCachedLevel_;         // levels from here up are inside the enclave
+  MerkleNode *untrusted_;        // levels below firstCachedLevel_, leaves first
+  std::vector<MerkleNode> cached_;  // levels from firstCachedLevel_ up
+};
+
+/**
+ * Creates the integrity data for a new bucket array according to
+ * integrityOptions.
+ *
+ * @param size the number of buckets, which are all empty
+ * @returns the integrity data or nullptr, when it could not be allocated
+ */
+auto newLockBucketHashes(int size) -> LockBucketHashes *;
+
+/**
+ * The integrity data of one lock table partition. Every bucket array of the
+ * partition, i.e. the current one and the old one while the partition is being
+ * resized, has its own. When locks are migrated into the new array, the
+ * integrity data of the buckets they leave and enter is updated, and the one of
+ * the old array is dropped together with it.
+ */
+typedef std::unordered_map<LockBucket *, std::unique_ptr<LockBucketHashes>>
+    LockTableIntegrityHashes;
+
+/**
+ * Gives the operations on a lock table partition access to verified copies of
+ * its buckets in protected memory. Each bucket is copied and verified once,
+ * when it is loaded for the first time. The operations modify the copies only,
+ * which are written back into untrusted memory by commit(). If an operation
+ * fails, the copies are simply dropped and nothing changes in untrusted memory.
+ */
+class VerifiedLockBucketAccess : public LockBucketAccess {
+ public:
+  /**
+   * @param integrityHashes the integrity hashes of the partition
+   */
+  VerifiedLockBucketAccess(LockTableIntegrityHashes &integrityHashes);
+
+  auto load(LockBucket *buckets, int index) -> LockBucket * override;
+
+  /**
+   * Allocates the bucket array in untrusted memory and registers an empty list
+   * of integrity hashes for it.
+   */
+  auto allocate(int size) -> LockBucket * override;
+
+  /**
+   * Drops the integrity hashes of the bucket array, once the modified buckets
+   * got committed. The array itself is left to the caller, see released().
+   */
+  void release(LockBucket *buckets, int size) override;
+
+  /**
+   * @returns true, when a loaded bucket did not match its integrity hash
+   */
+  auto failed() -> bool;
+
+  /**
+   * Writes all modified buckets back into untrusted memory, updates their
+   * integrity hashes and drops the hashes of the released bucket arrays.
+   */
+  void commit();
+
+  /**
+   * @returns the bucket arrays released by the committed operations, which
+   * the enclave no longer accesses and needs to hand back to the untrusted
+   * application
+   */
+  auto released() -> std::vector<RetiredBuckets> &;
+
+ private:
+  struct LoadedBucket {
+    LockBucket *buckets;  // bucket array in untrusted memory
+    int index;
+    LockBucket original;  // verified copy, to detect modifications
+    MerkleNode digest;    // of the original
+    LockBucket trusted;   // copy the operations work on
+  };
+
+  LockTableIntegrityHashes &integrityHashes_;
+  std::deque<LoadedBucket> loaded_;  // does not move elements on push_back
+  std::vector<RetiredBuckets> released_;
+  bool failed_ = false;
+};
 
 /**
  * Hashes a bucket of the transaction table. The hash is saved by the enclave
@@ -45,8 +304,7 @@ auto hash_transactiontable_bucket(Entry *bucket) -> sgx_sha256_hash_t *;
  * @param bucket the bucket to compute the hash over
  * @returns the hash over the given bucket
  */
-auto hash_locktable_bucket(uint32_t *bucket, int numEntries)
-    -> sgx_sha256_hash_t *;
+auto hash_transactiontable_bucket(Entry *bucket) -> sgx_sha256_hash_t *;
 
 /**
  * Verifies the integrity hashes on a copy of the bucket in protected
@@ -76,51 +334,14 @@ auto integrity_verified_get_transactiontable(
 /**
  * Serializes an entire bucket of the lock table into an uint32_t array that is
  * memory efficient and can be directly passed as a parameter to Intel SGX's
- * hash function for integrity verification.
- *
- * @param bucket a pointer to the first entry of the bucket
- * @param numEntries how many entries are in the given bucket
- * @returns the serialized bucket
- */
-auto locktable_bucket_to_uint32_t(Entry *&bucket, int numEntries) -> uint32_t *;
-
-/**
- * Adds a lock in the serialized bucket
- * @param transaction the (trusted) transaction that wants to acquire the lock
- * @param rowId the rowId of the lock to acquire
- * @param isExclusive if the lock should be exclusive or shared
- * @param serializedLockBucket
- * @returns true if the lock was acquired successfully, or false if the lock
- * couldn't get acquired, e.g. because it is already exclusive or integrity
- * verification failed.
- */
-auto add_lock_trusted(Transaction *transaction, int rowId, bool isExclusive,
-                      uint32_t *serializedLockBucket) -> bool;
-
-/**
- * Removes a lock in the serialized bucket
- * @param transaction the (trusted) transaction that wants to release the lock
- * @param rowId the rowId of the lock to release
- * @param bucket the serialized bucket
- * @param numEntries how many entries the serialized bucket has
- * @returns true if the lock was acquired successfully, or false if the lock
- * couldn't get acquired, e.g. because it is already exclusive or integrity
- * verification failed.
- */
-auto release_lock_trusted(Transaction *transaction, int rowId, uint32_t *bucket,
-                          int numEntries) -> bool;
-
-/**
- * Checks if the stored hash is the same as the hash of the given serialized
- * bucket
+ * hash function for integrity verification. Since buckets have a fixed number
+ * of slots, the serialized bucket always has sizeOfSerializedLockBucket
+ * elements.
  *
- * @param serialized serialized form of the recently fetched lock table bucket
- * @param numEntries how many entries the given lock table bucket contains
- * @param storedHash the previously computed hash over the lock table bucket
- * @returns true if the integrity verification was successful, i.e., the hash
- * computed over the bucket in untrusted memory is the same as the one
- * previously computed and stored inside the enclave, meaning no change was done
- * to the lock table in untrusted memory
+ * @param bucket the bucket to serialize
+ * @param serialized buffer of the calling thread with room for
+ * sizeOfSerializedLockBucket elements
+ * @returns the serialized bucket, i.e. the given buffer
  */
-auto verify_against_stored_hash(uint32_t *serialized, int numEntries,
-                                sgx_sha256_hash_t *stored_hash) -> bool;
\ No newline at end of file
+auto locktable_bucket_to_uint32_t(LockBucket *bucket, uint32_t *serialized)
+    -> uint32_t *;
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "common.h"
+
+/*
+Every worker thread takes its jobs from its own bounded queue, which any number
+of threads fill without taking a lock. Each slot carries a sequence number,
+which tells the producers whether the slot is free in the current round and the
+consumer whether it was filled.
+
+The worker thread empties its queue one job after the other. Only when it finds
+the queue empty, it marks itself as sleeping and blocks. A producer checks the
+mark after it published a job and wakes the worker thread up, so that a busy
+worker thread is never signaled. Blocking and waking up need a mutex and
+condition variable, which are provided by the user of the queue.
+
+The positions written by the producers, the one written by the consumer and the
+sleeping mark are kept on separate cache lines.
+*/
+
+// Number of jobs a queue holds, needs to be a power of two
+const unsigned long kJobQueueSize = 1024;
+
+/**
+ * A slot of a job queue. It is free for position p in round r, when its
+ * sequence number is p, and holds the job for position p, when it is p + 1.
+ */
+struct JobQueueSlot {
+  unsigned long sequence;
+  Job job;
+};
+
+/**
+ * Bounded multi-producer single-consumer queue of jobs.
+ */
+struct JobQueue {
+  alignas(64) unsigned long enqueue_pos;  // next position, by the producers
+  alignas(64) unsigned long dequeue_pos;  // next position, by the consumer
+  alignas(64) int sleeping;  // set by the consumer before it blocks
+  alignas(64) JobQueueSlot slots[kJobQueueSize];
+};
+
+/**
+ * Initializes an empty queue, whose consumer is awake.
+ *
+ * @param queue the queue
+ */
+void initJobQueue(JobQueue* queue);
+
+/**
+ * Adds a job to the end of the queue. May be called by any thread.
+ *
+ * @param queue the queue
+ * @param job the job
+ * @returns false, when the queue is full
+ */
+auto pushJob(JobQueue* queue, const Job& job) -> bool;
+
+/**
+ * Takes the first job out of the queue. Only called by the consumer.
+ *
+ * @param queue the queue
+ * @param job receives the job
+ * @returns false, when the queue is empty
+ */
+auto popJob(JobQueue* queue, Job* job) -> bool;
+
+/**
+ * Marks the consumer as sleeping, unless a job arrived in the meantime. Only
+ * called by the consumer, while it holds the mutex which its wake-up takes as
+ * well.
+ *
+ * @param queue the queue
+ * @returns false, when the consumer must not block, because there is a job
+ */
+auto prepareToSleep(JobQueue* queue) -> bool;
+
+/**
+ * Marks the consumer as awake again.
+ *
+ * @param queue the queue
+ */
+void wakeUp(JobQueue* queue);
+
+/**
+ * Checks after a job was pushed, if the consumer sleeps and needs to be woken
+ * up. Returns true at most once per sleep, so that concurrent producers do not
+ * wake it up twice.
+ *
+ * @param queue the queue
+ * @returns true, when the caller needs to wake up the consumer
+ */
+auto needsWakeUp(JobQueue* queue) -> bool;
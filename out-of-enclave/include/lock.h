@@ -10,19 +10,21 @@ using std::memcpy;
 /**
  * Used to set the size of the owners list of a lock. As of right now, there is
  * no way implemented to dynamically resize untrusted memory from the trusted
- * region. Therefore we allocate as much memory as we could possibly need. So we
- * have to set an upper limit on the number of owners of a lock, i.e. the number
- * of concurrent transactions.
+ * region. Therefore we reserve as much memory as we could possibly need inline
+ * in the lock. So we have to set an upper limit on the number of owners of a
+ * lock, i.e. the number of concurrent transactions.
  */
 const int kTransactionBudget = 2;
 
 /**
- * The internal representation of a lock for the lock manager.
+ * The internal representation of a lock for the lock manager. The owners are
+ * stored inline, so that a lock can be embedded into a bucket of the lock table
+ * without any further indirection.
  */
 struct Lock {
   bool exclusive;
-  int* owners;
   int num_owners;
+  int owners[kTransactionBudget];
 };
 typedef struct Lock Lock;
 
@@ -36,7 +38,8 @@ Lock* newLock();
  *
  * @param lock the lock the operation is executed on
  * @param transactionId ID of the transaction, that wants to acquire the lock
- * @throws std::domain_error, when the lock is exclusive
+ * @returns false, when the lock is exclusive or already has kTransactionBudget
+ * owners
  */
 auto getSharedAccess(Lock* lock, int transactionId) -> bool;
 
@@ -67,6 +70,41 @@ void release(Lock* lock, int transactionId);
  */
 auto upgrade(Lock* lock, int transactionId) -> bool;
 
+/**
+ * Checks, if the transaction is one of the owners of the lock.
+ *
+ * @param lock the lock the operation is executed on
+ * @param transactionId ID of the transaction
+ * @returns true, if the transaction holds the lock
+ */
+auto isOwner(Lock* lock, int transactionId) -> bool;
+
+/**
+ * Checks, if a lock request does not conflict with the other owners of the
+ * lock. A request of an owner only conflicts, when it wants to upgrade the
+ * lock, while others share it.
+ *
+ * @param lock the lock the operation is executed on
+ * @param transactionId ID of the transaction, that wants to acquire the lock
+ * @param isExclusive true for exclusive, false for shared access
+ * @returns true, if the lock is free for the request
+ */
+auto isGrantable(Lock* lock, int transactionId, bool isExclusive) -> bool;
+
+/**
+ * Decides by wait-die, if a transaction may wait for a lock, that it cannot
+ * get right away. A transaction is older than another one, if its ID is
+ * smaller. It may only wait, if it is older than every other owner of the
+ * lock, so that no transaction ever waits for an older one and no deadlock can
+ * occur. The requests already waiting for the lock are not stored in it, so
+ * the caller has to check those as well.
+ *
+ * @param lock the lock the operation is executed on
+ * @param transactionId ID of the transaction, that wants to acquire the lock
+ * @returns true, if the transaction may wait
+ */
+auto mayWait(Lock* lock, int transactionId) -> bool;
+
 /**
  * Creates a new lock that has the same content as the given lock. This
  * is used to move a lock that is allocated in untrusted memory into protected
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common.h"
+
+// Number of times a caller checks a job with the pause instruction in between,
+// before it sleeps until the job is finished. Most lock requests are finished
+// by then, longer ones do not keep the core busy.
+const int kCompletionSpins = 2000;
+
+/**
+ * Waits until the job, whose state the given word holds, is finished. Spins for
+ * a short while and then sleeps on a futex, after it announced that by setting
+ * the state to JOB_PENDING_WAITER.
+ *
+ * @param state the completion word of the job, see JobState
+ */
+void waitForCompletion(volatile int *state);
+
+/**
+ * Wakes up the caller sleeping on the completion word of a job, after the
+ * enclave finished it.
+ *
+ * @param state the completion word of the job
+ */
+void wakeCompletion(volatile int *state);
+
+/**
+ * Marks a job as finished and wakes up its caller, if it sleeps. Every result
+ * of the job needs to be written before.
+ *
+ * @param state the completion word of the job
+ * @param wake how the caller is woken up, when it announced its sleep
+ */
+void completeJob(volatile int *state,
+                 void (*wake)(volatile int *state) = wakeCompletion);
@@ -5,17 +5,26 @@
 #include <mutex>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "base64-encoding.h"
 #include "common.h"
+#include "completion.h"
 #include "enclave_u.h"
 #include "errors.h"
 #include "files.h"
 #include "hashtable.h"
 #include "lock.h"
+#include "locktable.h"
+#include "partitionmap.h"
+#include "reclaimer.h"
+#include "reclamation.h"
+#include "requestring.h"
 #include "sgx_eid.h"
 #include "sgx_tcrypto.h"
 #include "sgx_urts.h"
+#include "sgx_uswitchless.h"
+#include "slab.h"
 #include "spdlog/spdlog.h"
 #include "transaction.h"
 
@@ -25,9 +34,145 @@
 #define NO_SIGNATURE ""    // for jobs that return no signature (QUIT, UNLOCK)
 #define SIGNATURE_SIZE 89  // length of the base64-encoded signature
 
+// Number of job results the lock manager preallocates at a time
+const int kJobResultsPerSlab = 64;
+
+// One hash per bucket inside the enclave. The Merkle tree settings are used,
+// once the scheme is switched to MERKLE_TREE.
+const IntegrityOptions kDefaultIntegrityOptions = {HASH_LIST, 8, 64};
+
+/**
+ * Configures switchless calls, i.e. ECALLs and OCALLs marked with
+ * transition_using_threads in enclave.edl, which are handed over to worker
+ * threads on the other side instead of entering or leaving the enclave. Every
+ * trusted worker takes up one TCS of the enclave.
+ */
+struct SwitchlessOptions {
+  bool enabled;
+  int numUntrustedWorkers;    // threads that execute switchless OCALLs
+  int numTrustedWorkers;      // threads that execute switchless ECALLs
+  int retriesBeforeFallback;  // until a call falls back to a transition
+  int retriesBeforeSleep;     // until an idle worker goes to sleep
+};
+
+// One worker on each side, with the retries of the Intel SGX SDK's defaults
+const SwitchlessOptions kDefaultSwitchlessOptions = {true, 1, 1, 20000, 20000};
+
+// How the lock manager hands jobs to the worker threads of the enclave
+enum JobSubmission {
+  SUBMIT_BY_ECALL,        // an ECALL per job or batch of jobs
+  SUBMIT_BY_REQUEST_RING  // shared memory rings polled by the worker threads
+};
+
 extern sgx_enclave_id_t global_eid;  // identifies the enclave
 extern sgx_launch_token_t token;
 
+// Bucket arrays for resizing the lock table partitions, shared by the OCALLs
+extern LockBucketPool lockBucketPool;
+
+// Recycles the bucket arrays handed back by the enclave into lockBucketPool
+extern LockBucketReclaimer *lockBucketReclaimer;
+
+/**
+ * Untrusted memory, into which the enclave writes the result of a job, when the
+ * caller waits for it.
+ */
+struct JobResult {
+  volatile int finished;  // a JobState, first, see wakeJob()
+  volatile bool error;
+  volatile char return_value[SIGNATURE_SIZE];
+  void (*callback)(void *arg);  // see JobFuture::notifyWhenReady()
+  void *callback_arg;
+};
+
+/**
+ * Wakes up the caller of a job, which went to sleep before the job was
+ * finished, or runs the callback registered with JobFuture::notifyWhenReady().
+ *
+ * @param finished the completion word of a JobResult
+ */
+void wakeJob(volatile int *finished);
+
+/**
+ * A single request of a batch, see LockManager::submitBatch
+ */
+struct BatchedJob {
+  Command command;  // SHARED, EXCLUSIVE, UNLOCK or REGISTER
+  unsigned int transactionId;
+  unsigned int rowId;  // for SHARED, EXCLUSIVE and UNLOCK
+  int lockBudget;      // for REGISTER, SHARED and EXCLUSIVE, see lock()
+};
+
+class LockManager;
+
+/**
+ * The pending result of a job submitted with LockManager::lockAsync() or
+ * LockManager::unlockAsync(). The enclave writes the result into untrusted
+ * memory owned by the future, once a worker thread finished the job, so a
+ * caller can keep many jobs in flight and collect their results in any order.
+ * A future must not outlive its lock manager.
+ */
+class JobFuture {
+ public:
+  JobFuture(JobFuture &&other) noexcept;
+  auto operator=(JobFuture &&other) noexcept -> JobFuture &;
+  JobFuture(const JobFuture &) = delete;
+  auto operator=(const JobFuture &) -> JobFuture & = delete;
+
+  /**
+   * Waits for the job, unless its result was collected, since the enclave
+   * might still write into its memory.
+   */
+  ~JobFuture();
+
+  /**
+   * Checks without blocking, if the enclave finished the job. Hands over the
+   * responses of the request rings, when the lock manager submits through
+   * them.
+   *
+   * @returns true, when get() returns without waiting
+   */
+  auto isReady() -> bool;
+
+  /**
+   * Registers a callback, which runs once the enclave finished the job, on the
+   * thread that finishes it, or right away, if the job is already finished. It
+   * must not block and can be registered once. With request rings, it runs once
+   * a caller hands over the responses, see isReady().
+   *
+   * @param callback the function to run
+   * @param arg the argument passed to the function
+   */
+  void notifyWhenReady(void (*callback)(void *arg), void *arg);
+
+  /**
+   * Waits until the enclave finished the job and collects its result. Can only
+   * be called once.
+   *
+   * @returns the signature, if it was a lock request, and if the job was
+   * successful, like LockManager::lock() does
+   * @throws std::logic_error, when the result was already collected
+   */
+  auto get() -> std::pair<std::string, bool>;
+
+ private:
+  friend class LockManager;
+
+  JobFuture(LockManager *lockManager, Command command, JobResult *result);
+
+  /**
+   * Waits for the job and returns the memory of its result to the lock
+   * manager.
+   *
+   * @returns the result like get() does
+   */
+  auto collect() -> std::pair<std::string, bool>;
+
+  LockManager *lockManager;
+  Command command;
+  JobResult *result;  // nullptr, once the result was collected
+};
+
 //=========================== OCALLS ============================
 /**
  * Logs an info message from inside the enclave to the terminal
@@ -49,6 +194,49 @@ void print_error(const char *str);
  * @param str characters to be printed
  */
 void print_warn(const char *str);
+
+/**
+ * Provides an empty bucket array for resizing a lock table partition. Reuses
+ * the bucket arrays the enclave handed back, whenever possible.
+ *
+ * @param size the number of buckets
+ * @returns the bucket array
+ */
+auto ocall_allocate_lock_buckets(int size) -> LockBucket *;
+
+/**
+ * Takes back a bucket array, that the enclave no longer uses, when its
+ * reclamation ring is full.
+ *
+ * @param buckets the bucket array
+ * @param size the number of buckets of the array
+ */
+void ocall_retire_lock_buckets(LockBucket *buckets, int size);
+
+/**
+ * Wakes up the caller of a job, which went to sleep before the enclave finished
+ * the job, or runs its callback, see wakeJob().
+ *
+ * @param finished the completion word of the job
+ */
+void ocall_wake_job(int *finished);
+
+/**
+ * Provides zeroed untrusted memory for the lower levels of a Merkle tree over a
+ * bucket array, see MerkleLockBucketHashes.
+ *
+ * @param count the number of nodes
+ * @returns the nodes
+ */
+auto ocall_allocate_merkle_nodes(int count) -> MerkleNode *;
+
+/**
+ * Frees the nodes of a Merkle tree, whose bucket array the enclave no longer
+ * uses. Only the enclave reads them, so they can be freed right away.
+ *
+ * @param nodes the nodes allocated with ocall_allocate_merkle_nodes()
+ */
+void ocall_free_merkle_nodes(MerkleNode *nodes);
 //================================================================
 
 /**
@@ -64,14 +252,20 @@ void print_warn(const char *str);
  */
 class LockManager {
  public:
-  HashTable *lockTable;
+  LockTable *lockTable;
 
   /**
    * Initializes the enclave and seals the public and private key for signing.
    *
    * @param numWorkerThreads the number of threads that work on the lock table
+   * @param integrity how the enclave protects the lock table buckets
+   * @param switchless how ECALLs and OCALLs of the hot path are executed
+   * @param submission how jobs are handed to the enclave
    */
-  LockManager(int numWorkerThreads = 1);
+  LockManager(int numWorkerThreads = 1,
+              IntegrityOptions integrity = kDefaultIntegrityOptions,
+              SwitchlessOptions switchless = kDefaultSwitchlessOptions,
+              JobSubmission submission = SUBMIT_BY_ECALL);
 
   /**
    * Destroys the enclave.
@@ -90,6 +284,20 @@ class LockManager {
    */
   auto registerTransaction(int transactionId, int lockBudget) -> bool;
 
+  /**
+   * Sets how the enclave handles lock requests, that conflict with the lock of
+   * another transaction. Under NO_WAIT, which is the default, such a request
+   * fails right away. Under WAIT_DIE, it waits until the lock is granted, if
+   * the transaction is older, i.e. has a smaller ID, than every owner of the
+   * lock and every request waiting for it, and fails otherwise. A failed
+   * request does not abort the transaction, so the caller needs to abort it
+   * under WAIT_DIE, so that the older transactions waiting for its locks get
+   * them.
+   *
+   * @param conflictPolicy the policy for the following lock requests
+   */
+  void setConflictPolicy(LockConflictPolicy conflictPolicy);
+
   /**
    * Acquires a lock for the specified row
    *
@@ -98,7 +306,12 @@ class LockManager {
    * @param requestedMode either shared for concurrent read access or exclusive
    * for sole write access
    * @param waitForResult parameter forwarded to create_job function
-   * @returns the signature for the acquired lock
+   * @param lockBudget if not 0, the enclave registers the transaction with this
+   * lock budget together with granting the lock, when it is not registered
+   * yet. This saves the synchronous registerTransaction() call.
+   * @returns the signature for the acquired lock. When the request waits for
+   * the lock under WAIT_DIE, it returns once the lock is granted, see
+   * setConflictPolicy().
    * @throws std::domain_error, when transaction did not call
    * RegisterTransaction before or the given lock mode is unknown or when the
    * transaction makes a request for a look, that it already owns, makes a
@@ -106,7 +319,8 @@ class LockManager {
    * exhausted
    */
   auto lock(int transactionId, int rowId, bool isExclusive,
-            bool waitForResult = true) -> std::pair<std::string, bool>;
+            bool waitForResult = true, int lockBudget = 0)
+      -> std::pair<std::string, bool>;
 
   /**
    * Releases a lock for the specified row
@@ -118,6 +332,73 @@ class LockManager {
    */
   void unlock(int transactionId, int rowId, bool waitForResult = false);
 
+  /**
+   * Requests a lock for the specified row without waiting for the result. The
+   * calling thread can submit further requests, while the enclave works on
+   * this one.
+   *
+   * @param transactionId identifies the transaction making the request
+   * @param rowId identifies the row to be locked
+   * @param isExclusive either shared for concurrent read access or exclusive
+   * for sole write access
+   * @param lockBudget registers the transaction, if not 0, see lock()
+   * @returns the future, which delivers the signature and if the lock was
+   * granted, once the enclave finished the request
+   */
+  auto lockAsync(int transactionId, int rowId, bool isExclusive,
+                 int lockBudget = 0) -> JobFuture;
+
+  /**
+   * Releases a lock for the specified row without waiting for the result.
+   * Unlike unlock() without waiting, the returned future reports, if the
+   * transaction owned the lock.
+   *
+   * @param transactionId identifies the transaction making the request
+   * @param rowId identifies the row to be released
+   * @returns the future, which delivers if the lock was released
+   */
+  auto unlockAsync(int transactionId, int rowId) -> JobFuture;
+
+  /**
+   * Releases all locks of the transaction and forgets about it. The enclave
+   * releases the locks with one job for every worker thread owning some of
+   * them, which verifies and updates every touched bucket only once. The lock
+   * requests of the transaction need to be finished before.
+   *
+   * @param transactionId identifies the committing transaction
+   * @returns false, if the transaction was not registered or a lock could not
+   * be released
+   */
+  auto commit(int transactionId) -> bool;
+
+  /**
+   * Releases all locks of the transaction like commit() does. The lock manager
+   * keeps no undo information, so both only differ for the caller.
+   *
+   * @param transactionId identifies the aborting transaction
+   * @returns false, if the transaction was not registered or a lock could not
+   * be released
+   */
+  auto abort(int transactionId) -> bool;
+
+  /**
+   * Sends several requests to the enclave with a single ECALL. The enclave
+   * hands each worker thread all of its requests at once. Requests for the same
+   * row are executed in the order of the batch, requests for rows of different
+   * worker threads concurrently. A transaction needs to be registered before
+   * the batch with its lock requests is submitted, unless its lock requests
+   * carry a lock budget.
+   *
+   * @param jobs the requests
+   * @param waitForResult if true, waits for all requests to be finished, else
+   * only for the registrations in the batch
+   * @returns for each request in the same order the signature, if it was a
+   * lock request, and if it was successful, like lock() does
+   */
+  auto submitBatch(const std::vector<BatchedJob> &jobs,
+                   bool waitForResult = true)
+      -> std::vector<std::pair<std::string, bool>>;
+
   /**
    * This function is just for testing, to demonstrate that signatures created
    * on lock requests are valid.
@@ -132,7 +413,26 @@ class LockManager {
   auto verify_signature_string(std::string signature, int transactionId,
                                int rowId, int isExclusive) -> bool;
 
+  /**
+   * Reports how much enclave memory the integrity data of the lock table
+   * takes up. Only meaningful while no requests are in flight.
+   *
+   * @returns the number of bytes
+   */
+  auto getIntegrityMemoryUsage() -> size_t;
+
+  /**
+   * This function is just for benchmarking the bucket digests of the
+   * configured integrity scheme, see digest_locktable_buckets.
+   *
+   * @param numOccupied number of used slots of the bucket
+   * @param iterations how often to verify and update the bucket
+   */
+  void digestBuckets(int numOccupied, int iterations);
+
  private:
+  friend class JobFuture;
+
   /**
    * Initializes the enclave (in DEBUG mode).
    *
@@ -159,9 +459,12 @@ class LockManager {
    * Starts the enclave.
    *
    * @param eid specifying the enclave
+   * @param switchless if and how to serve switchless calls
    * @returns success or failure
    */
-  auto load_and_initialize_enclave(sgx_enclave_id_t *eid) -> sgx_status_t;
+  auto load_and_initialize_enclave(sgx_enclave_id_t *eid,
+                                   const SwitchlessOptions &switchless)
+      -> sgx_status_t;
 
   /**
    * Function that each worker thread executes. It calls inside the enclave and
@@ -175,17 +478,19 @@ class LockManager {
    * Initializes the configuration parameters for the enclave
    *
    * @param numWorkerThreads the number of threads that work on the lock table
+   * @param integrity how the enclave protects the lock table buckets
    */
-  void configuration_init(int numWorkerThreads);
+  void configuration_init(int numWorkerThreads, IntegrityOptions integrity);
 
   /**
    * Creates a job and sends it to the enclave to get it processed by an enclave
    * worker thread.
    *
-   * @param command SHARED, EXCLUSIVE, REGISTER or QUIT
-   * @param transaction_id additional argument for SHARED, EXCLUSIVE or REGISTER
+   * @param command SHARED, EXCLUSIVE, REGISTER, COMMIT, ABORT or QUIT
+   * @param transaction_id additional argument for SHARED, EXCLUSIVE, REGISTER,
+   * COMMIT or ABORT
    * @param row_id additional argument for SHARED or EXCLUSIVE
-   * @param lock_budget additional argument for REGISTER
+   * @param lock_budget additional argument for REGISTER, SHARED or EXCLUSIVE
    * @param waitForResult if the function should wait for return values to be
    * set or immediately return
    * @returns a pair containing a boolean, that is true when the job was
@@ -197,11 +502,97 @@ class LockManager {
                           bool waitForResult = true)
       -> std::pair<std::string, bool>;
 
+  /**
+   * Submits a job with the memory for its result, which is kept until the
+   * returned future collects the result.
+   *
+   * @param command SHARED, EXCLUSIVE or UNLOCK
+   * @param transaction_id identifies the transaction making the request
+   * @param row_id identifies the row
+   * @param lock_budget additional argument for SHARED or EXCLUSIVE
+   * @returns the future of the job
+   */
+  auto create_async_enclave_job(Command command, int transaction_id,
+                                int row_id, int lock_budget) -> JobFuture;
+
+  /**
+   * Hands a job to the enclave, either through the request ring of its worker
+   * thread or by an ECALL, and recycles the bucket arrays the enclave handed
+   * back in the meantime.
+   *
+   * @param job the job filled in by prepare_enclave_job
+   * @param result the memory for its result, or nullptr
+   */
+  void submit_enclave_job(Job &job, JobResult *result);
+
+  /**
+   * Fills in a job for the enclave.
+   *
+   * @param job the job to fill in
+   * @param command SHARED, EXCLUSIVE, REGISTER, UNLOCK or QUIT
+   * @param transaction_id additional argument for SHARED, EXCLUSIVE, UNLOCK or
+   * REGISTER
+   * @param row_id additional argument for SHARED, EXCLUSIVE or UNLOCK
+   * @param lock_budget additional argument for REGISTER, SHARED or EXCLUSIVE
+   * @param result the memory the enclave writes the result into, or nullptr,
+   * when the caller does not wait for the result
+   */
+  void prepare_enclave_job(Job &job, Command command, int transaction_id,
+                           int row_id, int lock_budget, JobResult *result);
+
+  /**
+   * Waits until the enclave finished a job and reads its result. Spins for a
+   * short while and then sleeps, unless it has to empty the request rings.
+   *
+   * @param command the command of the job
+   * @param result as passed to prepare_enclave_job
+   * @returns the result like create_enclave_job does
+   */
+  auto collect_enclave_job(Command command, JobResult *result)
+      -> std::pair<std::string, bool>;
+
+  /**
+   * Submits a job through the request ring of the worker thread responsible
+   * for it. QUIT, COMMIT and ABORT are sent by an ECALL, since they go to
+   * several worker threads. COMMIT and ABORT wait for the requests already in
+   * the rings first, so that they do not overtake requests of the transaction.
+   * Wakes up the worker thread, if it sleeps.
+   *
+   * @param job the job filled in by prepare_enclave_job
+   * @param result the memory for its result, or nullptr
+   */
+  void submit_to_request_ring(const Job &job, JobResult *result);
+
+  /**
+   * Hands the responses of all request rings, which no other thread is
+   * emptying right now, to their waiting callers.
+   */
+  void drain_request_rings();
+
+  /**
+   * Waits, until the worker threads processed every request submitted through
+   * their rings so far. Hands over the responses meanwhile, since a worker
+   * thread may wait for room for them.
+   */
+  void fence_request_rings();
+
+  /**
+   * Hands the responses of a request ring to their waiting callers. Needs to
+   * hold the mutex of the ring.
+   *
+   * @param ring index of the ring
+   */
+  void drain_responses(int ring);
+
   Arg arg;  // configuration parameters for the enclave
   pthread_t
       *threads;  // worker threads that execute requests inside the enclave
-  std::mutex new_lock_mut;  // controls the insertion of new lock objects into
-                            // the lock table
-  std::mutex new_transaction_mut;  // controls the insertion of new transaction
-                                   // objects into the lock table
+  Reclamation *reclamation;  // rings through which the enclave hands back
+                             // bucket arrays
+  std::unique_ptr<LockBucketReclaimer> reclaimer;
+  SlabPool jobResults{sizeof(JobResult), kJobResultsPerSlab};
+  RequestRings *requestRings = nullptr;  // nullptr, when submitting by ECALL
+  std::unique_ptr<std::mutex[]> requestRingMutexes;  // one for each ring,
+                                                     // held while filling it
+                                                     // or emptying responses
 };
\ No newline at end of file
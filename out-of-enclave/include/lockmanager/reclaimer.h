@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "reclamation.h"
+#include "slab.h"
+
+/**
+ * Collects the bucket arrays, that the enclave worker threads hand back through
+ * their reclamation rings, and recycles them into a LockBucketPool once no
+ * worker thread can still be reading them (see reclamation.h).
+ */
+class LockBucketReclaimer {
+ public:
+  /**
+   * @param reclamation the reclamation state shared with the enclave
+   * @param pool receives the bucket arrays that are safe to recycle
+   */
+  LockBucketReclaimer(Reclamation *reclamation, LockBucketPool &pool);
+
+  /**
+   * Retires a bucket array directly, which the enclave could not hand back
+   * through its ring, because the ring was full.
+   *
+   * @param buckets the bucket array
+   * @param size the number of buckets of the array
+   */
+  void retire(LockBucket *buckets, int size);
+
+  /**
+   * Empties the reclamation rings and recycles all retired bucket arrays that
+   * no worker thread can be reading anymore. Returns immediately without
+   * taking a lock, when there is nothing to reclaim or another thread is
+   * already reclaiming, so that it can be called on every request.
+   */
+  void reclaim();
+
+  /**
+   * @returns the number of bucket arrays that are retired, but were not
+   * recycled yet
+   */
+  auto num_retired() -> int;
+
+ private:
+  struct Retired {
+    LockBucket *buckets;
+    int size;
+    unsigned long epoch;  // epoch in which the array was retired
+  };
+
+  /**
+   * @returns true, when a ring holds a bucket array or a retired array waits
+   * for the worker threads to finish their operations
+   */
+  auto has_work() -> bool;
+
+  /**
+   * Advances the epoch, so that worker threads starting an operation from now
+   * on cannot see the bucket arrays retired so far. Needs to hold mut_.
+   */
+  void advance_epoch();
+
+  Reclamation *reclamation_;
+  LockBucketPool &pool_;
+  std::mutex mut_;  // only one thread empties the rings at a time
+  std::vector<Retired> retired_;
+  std::atomic<int> numRetired_{0};  // size of retired_, readable without mut_
+};
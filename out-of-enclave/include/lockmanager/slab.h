@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "locktable.h"
+
+// Number of independent free lists of a slab pool. Threads are spread over
+// them, so that concurrent requests rarely contend for the same one.
+const int kSlabPoolShards = 16;
+
+// Maximum number of unused bucket arrays of the same size that are kept for
+// later resizes, before further ones are freed
+const int kLockBucketPoolMaxFreeArrays = 16;
+
+/**
+ * Slab allocator for objects of a fixed size in untrusted memory. Objects are
+ * carved out of slabs, which are allocated kObjectsPerSlab objects at a time
+ * and only freed together with the pool. Freed objects go into a free list and
+ * are handed out again by the following allocations, so that the memory of the
+ * pool stays flat under a steady workload and no allocation needs to go to the
+ * system allocator once the pool has warmed up.
+ *
+ * The slabs and free lists are split into kSlabPoolShards shards. A thread
+ * always allocates from and frees into the shard it is assigned to, so there is
+ * no lock that all threads have to take.
+ */
+class SlabPool {
+ public:
+  /**
+   * @param objectSize size of one object in bytes
+   * @param objectsPerSlab number of objects to preallocate at a time
+   */
+  SlabPool(size_t objectSize, int objectsPerSlab);
+  ~SlabPool();
+
+  SlabPool(const SlabPool &) = delete;
+  auto operator=(const SlabPool &) -> SlabPool & = delete;
+
+  /**
+   * @returns an unused object, which is not initialized
+   */
+  auto allocate() -> void *;
+
+  /**
+   * Returns an object to the pool, from which it was allocated. The object goes
+   * into the shard of the calling thread.
+   *
+   * @param object the object, which must not be accessed afterwards
+   */
+  void free(void *object);
+
+  /**
+   * @returns the number of objects the pool has preallocated in total
+   */
+  auto capacity() -> int;
+
+ private:
+  struct alignas(64) Shard {
+    std::mutex mut;  // synchronizes access on the slabs and the free list
+    std::vector<char *> slabs;
+    std::vector<void *> freeList;
+  };
+
+  /**
+   * @returns the shard the calling thread is assigned to
+   */
+  auto shard() -> Shard &;
+
+  size_t objectSize_;
+  int objectsPerSlab_;
+  Shard shards_[kSlabPoolShards];
+};
+
+/**
+ * Keeps the bucket arrays of lock table partitions, which are no longer used,
+ * for later resizes. Partitions always grow and shrink by a factor of 2 from
+ * their initial size, so there are only few different array sizes, each of
+ * which gets its own free list.
+ */
+class LockBucketPool {
+ public:
+  LockBucketPool() = default;
+  ~LockBucketPool();
+
+  LockBucketPool(const LockBucketPool &) = delete;
+  auto operator=(const LockBucketPool &) -> LockBucketPool & = delete;
+
+  /**
+   * @param size the number of buckets
+   * @returns a bucket array with all buckets empty
+   */
+  auto allocate(int size) -> LockBucket *;
+
+  /**
+   * Keeps a bucket array for later allocations of the same size. The array may
+   * also have been allocated with new[] outside of the pool.
+   *
+   * @param buckets the bucket array, which must not be accessed afterwards
+   * @param size the number of buckets of the array
+   */
+  void free(LockBucket *buckets, int size);
+
+  /**
+   * Preallocates bucket arrays, so that the next allocations of that size do
+   * not need to go to the system allocator.
+   *
+   * @param size the number of buckets of each array
+   * @param count the number of arrays
+   */
+  void reserve(int size, int count);
+
+  /**
+   * @returns the number of bucket arrays the pool allocated in total
+   */
+  auto num_allocated() -> int;
+
+ private:
+  std::mutex mut_;  // synchronizes access on the free lists
+  std::unordered_map<int, std::vector<LockBucket *>> freeLists_;
+  int numAllocated_ = 0;
+};
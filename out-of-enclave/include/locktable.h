@@ -0,0 +1,320 @@
+#pragma once
+
+#include <stdlib.h>
+
+#include "common.h"
+#include "lock.h"
+
+/*
+The lock table uses open addressing instead of chained hashing: every bucket
+is a fixed-size, cache-line aligned block that stores the row IDs and the lock
+structs inline. A lookup therefore touches one or two cache lines of the
+bucket instead of walking a linked list of separately allocated entries, locks
+and owner arrays. Like the HashTable, it is a C-style struct, so that the
+enclave can operate on it via a pointer into untrusted memory.
+
+The table is split into several partitions per worker thread of the enclave,
+which the enclave hands over between its worker threads, see partitionmap.h.
+Each partition has its own bucket array, which grows and shrinks with the
+number of locks in it. Resizing allocates a new bucket array and then migrates
+the locks of the old one a few buckets at a time on every following operation
+of the partition, so that no operation has to wait for the whole partition to
+be rehashed.
+*/
+
+// Size of one bucket of the lock table in bytes (two 64-byte cache lines)
+const int kLockTableBucketBytes = 128;
+
+// Number of locks that fit into one bucket next to its header
+const int kLockTableSlotsPerBucket =
+    (kLockTableBucketBytes - 2 * sizeof(int)) / (sizeof(int) + sizeof(Lock));
+
+// A partition doubles its number of buckets, when more than this fraction of
+// its slots is in use
+const float kLockTableMaxLoadFactor = 0.75;
+
+// A partition halves its number of buckets, when less than this fraction of its
+// slots is in use, but never shrinks below its initial size
+const float kLockTableMinLoadFactor = 0.125;
+
+// Number of old buckets, whose locks are migrated per operation on a partition
+// that is being resized
+const int kLockTableRehashStep = 2;
+
+/**
+ * A bucket of the lock table. Slot i is in use, when bit i of occupied is set,
+ * in which case keys[i] holds the row ID and locks[i] the corresponding lock.
+ *
+ * The overflow counter keeps track of how many keys that hash to this bucket
+ * or one of its predecessors on the probe sequence were placed behind it,
+ * because the bucket was full at the time of insertion. A lookup can stop at
+ * the first bucket with an overflow count of 0, which keeps misses cheap even
+ * when the table is highly loaded.
+ */
+struct alignas(64) LockBucket {
+  int keys[kLockTableSlotsPerBucket];
+  unsigned int occupied;  // bitmask of the used slots
+  int overflow;           // number of keys that probed past this bucket
+  Lock locks[kLockTableSlotsPerBucket];
+};
+static_assert(sizeof(LockBucket) == kLockTableBucketBytes,
+              "A lock table bucket needs to fit into two cache lines");
+
+/**
+ * The part of the lock table a single worker thread is responsible for. While
+ * the partition is being resized, the locks are spread over two bucket arrays:
+ * new locks are only inserted into buckets, while the locks in old_buckets are
+ * moved over bucket by bucket, starting at rehash_index. Both arrays are
+ * complete open addressing tables on their own, so a lookup checks buckets
+ * first and then old_buckets.
+ */
+struct LockTablePartition {
+  int size;             // number of buckets
+  int min_size;         // the partition never shrinks below this size
+  int num_locks;        // number of locks in buckets and old_buckets
+  LockBucket* buckets;  // probing wraps around at the end of the array
+  int old_size;         // number of old buckets, 0 when not resizing
+  int rehash_index;     // next old bucket to migrate
+  LockBucket* old_buckets;
+};
+
+/**
+ * The lock table, mapping row IDs to locks. A row ID is assigned to a
+ * partition by its position within the key range, which never changes, so
+ * every row stays in the same partition, no matter how the partitions are
+ * resized.
+ */
+struct LockTable {
+  int key_range;       // row IDs are assigned to partitions by key % key_range
+  int num_partitions;  // number of parts the key range is split into
+  LockTablePartition* partitions;
+};
+
+/**
+ * Gives the operations on a partition access to its buckets. The untrusted
+ * application works on the buckets in place, while the enclave hands out
+ * verified copies in protected memory, which it writes back once the operation
+ * is complete.
+ */
+class LockBucketAccess {
+ public:
+  virtual ~LockBucketAccess() = default;
+
+  /**
+   * Provides a bucket for reading and modification.
+   *
+   * @param buckets the bucket array of the partition
+   * @param index position of the bucket within the array
+   * @returns a pointer to the bucket or nullptr, when it cannot be accessed
+   */
+  virtual auto load(LockBucket* buckets, int index) -> LockBucket* = 0;
+
+  /**
+   * Allocates a new bucket array with all buckets empty.
+   *
+   * @param size the number of buckets
+   * @returns the bucket array or nullptr, when the allocation failed
+   */
+  virtual auto allocate(int size) -> LockBucket* = 0;
+
+  /**
+   * Frees a bucket array that no longer contains any locks.
+   *
+   * @param buckets the bucket array
+   * @param size the number of buckets of the array
+   */
+  virtual void release(LockBucket* buckets, int size) = 0;
+};
+
+/**
+ * Creates a new lock table with all buckets empty.
+ *
+ * @param size the initial number of buckets, which also determines the key
+ * range that is split into the partitions
+ * @param numPartitions the number of disjoint parts of the table, which the
+ * worker threads operate on
+ * @returns a pointer to the lock table
+ */
+LockTable* newLockTable(int size, int numPartitions = 1);
+
+/**
+ * Frees the memory of a lock table created with newLockTable()
+ *
+ * @param lockTable the lock table to free
+ */
+void freeLockTable(LockTable* lockTable);
+
+/**
+ * Determines which partition of the key range the given row ID belongs to.
+ * Row IDs are unsigned, so that any of them maps to a valid partition.
+ *
+ * @param lockTable the lock table
+ * @param key the row ID
+ * @returns the partition index in 0..num_partitions-1
+ */
+auto getPartition(LockTable* lockTable, unsigned int key) -> int;
+
+/**
+ * Returns the index of the bucket where the probe sequence for the given key
+ * starts.
+ *
+ * @param size the number of buckets of the array
+ * @param key the row ID
+ */
+auto getHomeBucket(int size, unsigned int key) -> int;
+
+/**
+ * Returns the index of the bucket that follows the given bucket on the probe
+ * sequence. The probe sequence wraps around at the end of the array.
+ *
+ * @param size the number of buckets of the array
+ * @param index index of the current bucket
+ */
+auto getNextBucket(int size, int index) -> int;
+
+/**
+ * Searches a single bucket for the given key.
+ *
+ * @param bucket the bucket to search
+ * @param key the row ID
+ * @returns the slot of the key within the bucket or -1 if it is not there
+ */
+auto findSlot(LockBucket* bucket, int key) -> int;
+
+/**
+ * Searches a single bucket for an unused slot.
+ *
+ * @param bucket the bucket to search
+ * @returns the index of the first free slot or -1, when the bucket is full
+ */
+auto findFreeSlot(LockBucket* bucket) -> int;
+
+/**
+ * Occupies the given slot with the key and the lock.
+ *
+ * @param bucket the bucket containing the slot
+ * @param slot index of a free slot within the bucket
+ * @param key the row ID
+ * @param lock the lock, which is copied into the bucket
+ * @returns a pointer to the lock inside of the bucket
+ */
+auto claimSlot(LockBucket* bucket, int slot, int key, Lock* lock) -> Lock*;
+
+/**
+ * Marks the given slot as unused and clears its contents.
+ *
+ * @param bucket the bucket containing the slot
+ * @param slot index of the slot within the bucket
+ */
+void freeSlot(LockBucket* bucket, int slot);
+
+/**
+ * Checks if the locks of the partition are currently being migrated into a
+ * resized bucket array.
+ *
+ * @param partition the partition
+ */
+auto isRehashing(LockTablePartition* partition) -> bool;
+
+/**
+ * Retrieves the lock for the given row ID from a partition.
+ *
+ * @param partition the partition responsible for the row ID
+ * @param key the row ID
+ * @param access provides the buckets of the partition
+ * @returns a pointer to the lock inside of the bucket provided by access or
+ * nullptr, when there is no lock for that row ID or a bucket could not be
+ * accessed
+ */
+auto get(LockTablePartition* partition, int key, LockBucketAccess& access)
+    -> Lock*;
+
+/**
+ * Sets the lock for the given row ID in a partition. Doesn't do anything when
+ * the key already exists in the partition.
+ *
+ * @param partition the partition responsible for the row ID
+ * @param key the row ID
+ * @param lock the lock, which is copied into the bucket
+ * @param access provides the buckets of the partition
+ * @returns a pointer to the lock for that key inside of the bucket provided by
+ * access or nullptr, when the partition is full or a bucket could not be
+ * accessed
+ */
+auto set(LockTablePartition* partition, int key, Lock* lock,
+         LockBucketAccess& access) -> Lock*;
+
+/**
+ * Deletes the lock for the given row ID from a partition.
+ *
+ * @param partition the partition responsible for the row ID
+ * @param key the row ID
+ * @param access provides the buckets of the partition
+ * @returns true, when the lock was found and deleted
+ */
+auto remove(LockTablePartition* partition, int key, LockBucketAccess& access)
+    -> bool;
+
+/**
+ * Migrates the locks of the next kLockTableRehashStep old buckets into the
+ * current bucket array and frees the old array once it is empty. Does nothing,
+ * when the partition is not being resized.
+ *
+ * @param partition the partition
+ * @param access provides the buckets of the partition
+ * @returns false, when a bucket could not be accessed
+ */
+auto rehashStep(LockTablePartition* partition, LockBucketAccess& access)
+    -> bool;
+
+/**
+ * Starts to grow or shrink the partition, when its load factor left the range
+ * between kLockTableMinLoadFactor and kLockTableMaxLoadFactor. Only one resize
+ * can be in progress at a time.
+ *
+ * @param partition the partition
+ * @param access provides the buckets of the partition
+ * @returns true, when a new bucket array was allocated
+ */
+auto resizeIfNeeded(LockTablePartition* partition, LockBucketAccess& access)
+    -> bool;
+
+/**
+ * Retrieves the lock for the given row ID.
+ *
+ * @param lockTable the lock table to execute the operation on
+ * @param key the row ID
+ * @returns a pointer to the lock inside of the table or nullptr, when there is
+ * no lock for that row ID
+ */
+auto get(LockTable* lockTable, int key) -> Lock*;
+
+/**
+ * Sets the lock for the given row ID. Doesn't do anything when the key already
+ * exists in the table. Advances the resizing of the partition of the row ID.
+ *
+ * @param lockTable the lock table to execute the operation on
+ * @param key the row ID
+ * @param lock the lock, which is copied into the table
+ * @returns a pointer to the lock for that key inside of the table or nullptr,
+ * when the partition of the key is full
+ */
+auto set(LockTable* lockTable, int key, Lock* lock) -> Lock*;
+
+/**
+ * Checks if a lock exists for the given row ID.
+ *
+ * @param lockTable the lock table to execute the operation on
+ * @param key the row ID
+ * @returns true if there is a lock for the row ID in the table
+ */
+auto contains(LockTable* lockTable, int key) -> bool;
+
+/**
+ * Deletes the lock for the given row ID. Advances the resizing of the
+ * partition of the row ID.
+ *
+ * @param lockTable the lock table to execute the operation on
+ * @param key the row ID
+ */
+void remove(LockTable* lockTable, int key);
@@ -0,0 +1,131 @@
+#pragma once
+
+/*
+The lock table is split into many more partitions than there are worker
+threads, kPartitionsPerWorker for each of them. Every partition belongs to
+exactly one worker thread at a time, which is the only one to access its
+buckets, so the worker threads still share nothing of the lock table. The
+partitions start out dealt round-robin, so that row IDs clustered in a part of
+the key range are already spread over all worker threads.
+
+The thread dispatching the jobs counts the lock requests of every partition.
+Every kRebalanceInterval requests it compares the load of the worker threads
+and hands one partition of the busiest worker thread over to the least busy
+one, if that evens out their load. The counts are halved afterwards, so that
+the load of the past fades out.
+
+Jobs dispatched before a handoff may still wait in the queue of the previous
+owner, while the new owner already receives jobs for the partition. The new
+owner therefore holds the jobs of the partition back, until the previous owner
+executed every job dispatched to it before the handoff. It learns about that
+from a counter per partition, which is advanced after every job. Only one
+handoff is in progress at a time, so no two worker threads ever wait for each
+other.
+*/
+
+// Number of partitions of the lock table per worker thread
+const int kPartitionsPerWorker = 16;
+
+// Number of lock requests between two decisions to hand over a partition
+const int kRebalanceInterval = 4096;
+
+// A partition is only handed over, when the load of the busiest and the least
+// busy worker thread differs by more than this fraction of the average load
+const float kRebalanceImbalance = 0.25;
+
+/**
+ * The state of a partition. The counter of executed jobs is written by the
+ * worker threads, so it gets a cache line of its own, apart from the fields
+ * written by the dispatching thread.
+ */
+struct PartitionState {
+  int owner;                 // the worker thread responsible for the partition
+  unsigned long load;        // decayed number of dispatched lock requests
+  unsigned long dispatched;  // number of lock requests dispatched so far
+  unsigned long handoff;     // requests the previous owner executes, before
+                             // the current owner may access the partition
+  alignas(64) unsigned long executed;  // number of lock requests executed
+};
+
+/**
+ * Assignment of the lock table partitions to the worker threads.
+ */
+struct PartitionMap {
+  int num_partitions;
+  int num_workers;
+  bool rebalancing;     // if partitions are handed over at all
+  int requests;         // lock requests since the last rebalancing
+  int pending_handoff;  // the partition handed over last, or -1
+  PartitionState* partitions;
+};
+
+/**
+ * Returns the worker thread a partition is assigned to in the beginning. When
+ * the partitions are not rebalanced, it keeps the partition.
+ *
+ * @param partition index of the partition
+ * @param numWorkers the number of worker threads sharing the lock table
+ * @returns the worker thread
+ */
+auto getHomeWorker(int partition, int numWorkers) -> int;
+
+/**
+ * Creates a map, which assigns every partition to its home worker.
+ *
+ * @param numPartitions the number of partitions of the lock table
+ * @param numWorkers the number of worker threads sharing the lock table
+ * @param rebalancing if partitions are handed over between the worker threads
+ * @returns a pointer to the map
+ */
+auto newPartitionMap(int numPartitions, int numWorkers, bool rebalancing)
+    -> PartitionMap*;
+
+/**
+ * Frees the memory of a map created with newPartitionMap().
+ *
+ * @param map the map to free
+ */
+void freePartitionMap(PartitionMap* map);
+
+/**
+ * Determines the worker thread, which executes a lock request, and counts the
+ * request for the partition. May hand over a partition before. Only called by
+ * one dispatching thread at a time.
+ *
+ * @param map the map
+ * @param partition the partition of the row ID of the request
+ * @returns the worker thread
+ */
+auto routeRequest(PartitionMap* map, int partition) -> int;
+
+/**
+ * Hands over a partition of the busiest worker thread to the least busy one, if
+ * the load is unevenly distributed and no other handoff is in progress. Only
+ * called by one dispatching thread at a time.
+ *
+ * @param map the map
+ * @returns true, when a partition was handed over
+ */
+auto rebalance(PartitionMap* map) -> bool;
+
+/**
+ * Checks, if a worker thread may execute a lock request of a partition. The
+ * owner of the partition may only do so, after the previous owner executed all
+ * lock requests dispatched to it. A worker thread, which handed the partition
+ * over, still executes the lock requests it received before.
+ *
+ * @param map the map
+ * @param partition index of the partition
+ * @param worker the worker thread, which received the lock request
+ * @returns false, when the worker thread needs to hold the request back
+ */
+auto mayExecute(PartitionMap* map, int partition, int worker) -> bool;
+
+/**
+ * Counts a lock request of a partition as executed, after the worker thread
+ * is done with the partition.
+ *
+ * @param map the map
+ * @param partition index of the partition
+ */
+void finishRequest(PartitionMap* map, int partition);
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "locktable.h"
+
+/*
+The bucket arrays of the lock table are allocated in untrusted memory, but only
+the enclave knows when an array is no longer used, i.e. after a resize migrated
+all of its locks. Instead of leaving the enclave for every array it gives up,
+the worker thread owning a partition of the lock table hands them back to the
+untrusted application through the partition's own ring buffer in untrusted
+memory.
+
+The untrusted application recycles those arrays for later resizes, but only once
+no worker thread can still be reading them. For that it uses epoch-based
+reclamation: every worker announces the current epoch when it starts an
+operation on the lock table. An array that was handed back in epoch e is only
+recycled, when every worker is either idle or announced an epoch after e.
+
+The enclave does not trust anything in these structs. The worst the untrusted
+application can do by tampering with them, is to keep its own memory from being
+recycled or to recycle an array too early, which the integrity verification of
+the enclave detects.
+*/
+
+// Number of bucket arrays a worker thread can hand back before the untrusted
+// application collects them
+const int kReclamationRingSize = 64;
+
+// Announced by a worker thread, that is not operating on the lock table
+const unsigned long kIdleEpoch = ~0UL;
+
+/**
+ * A bucket array that is no longer used by the enclave.
+ */
+struct RetiredBuckets {
+  LockBucket* buckets;
+  int size;  // number of buckets
+};
+
+/**
+ * Single-producer single-consumer ring buffer, through which one worker thread
+ * of the enclave hands retired bucket arrays back to the untrusted application.
+ */
+struct ReclamationRing {
+  RetiredBuckets slots[kReclamationRingSize];
+  unsigned int head;           // next slot to fill, written by the enclave
+  unsigned int tail;           // next slot to empty, written by the application
+  unsigned long active_epoch;  // epoch of the worker's current operation
+};
+
+/**
+ * Shared state of the reclamation, which is allocated by the untrusted
+ * application and passed to the enclave once at initialization.
+ */
+struct Reclamation {
+  unsigned long epoch;     // advanced by the untrusted application
+  int num_rings;           // one ring per partition of the lock table
+  ReclamationRing* rings;  // all of them idle and empty in the beginning
+};
+
+/**
+ * Creates the shared reclamation state with all rings empty and all worker
+ * threads idle.
+ *
+ * @param numRings the number of partitions of the lock table
+ * @returns a pointer to the reclamation state
+ */
+auto newReclamation(int numRings) -> Reclamation*;
+
+/**
+ * Frees the memory of a reclamation state created with newReclamation(),
+ * without freeing the bucket arrays that are still in the rings.
+ *
+ * @param reclamation the reclamation state to free
+ */
+void freeReclamation(Reclamation* reclamation);
+
+/**
+ * Hands a bucket array back to the untrusted application. Only called by the
+ * worker thread owning the ring.
+ *
+ * @param ring the ring of the worker thread
+ * @param buckets the bucket array, which must not be accessed afterwards
+ * @param size the number of buckets of the array
+ * @returns false, when the ring is full
+ */
+auto pushRetired(ReclamationRing* ring, LockBucket* buckets, int size) -> bool;
+
+/**
+ * Takes the oldest bucket array out of a ring. Only called by the untrusted
+ * application, while no other thread is emptying the same ring.
+ *
+ * @param ring the ring of a worker thread
+ * @param retired receives the bucket array
+ * @returns false, when the ring is empty
+ */
+auto popRetired(ReclamationRing* ring, RetiredBuckets* retired) -> bool;
+
+/**
+ * Announces the current epoch for the worker thread owning the ring. Must be
+ * called before the worker thread accesses any bucket array.
+ *
+ * @param reclamation the shared reclamation state
+ * @param ring the ring of the worker thread
+ */
+void enterEpoch(Reclamation* reclamation, ReclamationRing* ring);
+
+/**
+ * Announces that the worker thread owning the ring no longer accesses any
+ * bucket array.
+ *
+ * @param ring the ring of the worker thread
+ */
+void exitEpoch(ReclamationRing* ring);
+
+/**
+ * Announces the current epoch for a worker thread during its lifetime, so that
+ * every return path of an operation leaves the epoch again. Does nothing, when
+ * there is no ring.
+ */
+class EpochGuard {
+ public:
+  EpochGuard(Reclamation* reclamation, ReclamationRing* ring);
+  ~EpochGuard();
+
+ private:
+  ReclamationRing* ring_;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "common.h"
+
+/*
+Instead of an ECALL per job or batch of jobs, the untrusted application can
+submit jobs through a ring buffer in untrusted memory per worker thread of the
+enclave. The worker threads poll their ring, copy each request into trusted
+memory before they look at it and answer the requests that wait for a result
+through a second ring going the other way. In the steady state no request
+leaves or enters the enclave.
+
+Only when a worker thread found its ring empty for a while, it marks itself as
+sleeping and blocks on its condition variable. The next request for it then
+needs one ECALL to wake it up again.
+
+The enclave does not trust anything in these structs. Every request is
+validated after it was copied, like a job passed by an ECALL.
+*/
+
+// Number of requests and responses each ring holds
+const int kRequestRingSize = 256;
+
+// Length of the base64-encoded signature in a response
+const int kRingSignatureSize = 89;
+
+/**
+ * A job submitted through a request ring.
+ */
+struct RingRequest {
+  enum Command command;  // SHARED, EXCLUSIVE, UNLOCK or REGISTER
+  unsigned int transaction_id;
+  unsigned int row_id;       // for SHARED, EXCLUSIVE and UNLOCK
+  unsigned int lock_budget;  // for REGISTER, SHARED and EXCLUSIVE
+  int wait_for_result;       // the enclave only answers, if it is not 0
+  unsigned long tag;         // identifies the response, opaque to the enclave
+};
+
+/**
+ * The result of a request, which waited for it.
+ */
+struct RingResponse {
+  unsigned long tag;  // the tag of the request
+  int error;          // not 0, if the job failed
+  char signature[kRingSignatureSize];
+};
+
+/**
+ * Single-producer single-consumer ring buffers of requests for one worker
+ * thread and of its responses. The indices written by the application and by
+ * the enclave are kept on separate cache lines.
+ */
+struct RequestRing {
+  RingRequest requests[kRequestRingSize];
+  RingResponse responses[kRequestRingSize];
+  alignas(64) unsigned int request_head;  // next request, by the application
+  unsigned int response_tail;             // next response, by the application
+  alignas(64) unsigned int request_tail;  // next request, by the enclave
+  unsigned int response_head;             // next response, by the enclave
+  unsigned int request_done;              // requests processed, by the enclave
+  int sleeping;  // set by the worker thread before it blocks
+};
+
+/**
+ * The rings of all worker threads, which are allocated by the untrusted
+ * application and passed to the enclave once at initialization.
+ */
+struct RequestRings {
+  int num_rings;  // one per worker thread, including the one registering
+                  // transactions
+  RequestRing* rings;
+};
+
+/**
+ * Creates empty rings, whose worker threads are all awake.
+ *
+ * @param numRings the number of worker threads
+ * @returns a pointer to the rings
+ */
+auto newRequestRings(int numRings) -> RequestRings*;
+
+/**
+ * Frees the memory of rings created with newRequestRings().
+ *
+ * @param rings the rings to free
+ */
+void freeRequestRings(RequestRings* rings);
+
+/**
+ * Submits a request. Only called by the untrusted application, while no other
+ * thread submits to the same ring.
+ *
+ * @param ring the ring of the worker thread
+ * @param request the request
+ * @returns false, when the ring is full
+ */
+auto pushRequest(RequestRing* ring, const RingRequest& request) -> bool;
+
+/**
+ * Copies the oldest request out of a ring. Only called by the worker thread
+ * owning the ring.
+ *
+ * @param ring the ring of the worker thread
+ * @param request receives the request
+ * @returns false, when the ring is empty or its indices are corrupted
+ */
+auto popRequest(RequestRing* ring, RingRequest* request) -> bool;
+
+/**
+ * Answers a request. Only called by the worker thread owning the ring.
+ *
+ * @param ring the ring of the worker thread
+ * @param response the response
+ * @returns false, when the ring of responses is full
+ */
+auto pushResponse(RequestRing* ring, const RingResponse& response) -> bool;
+
+/**
+ * Copies the oldest response out of a ring. Only called by the untrusted
+ * application, while no other thread empties the same ring.
+ *
+ * @param ring the ring of the worker thread
+ * @param response receives the response
+ * @returns false, when there is no response
+ */
+auto popResponse(RequestRing* ring, RingResponse* response) -> bool;
+
+/**
+ * Counts a request as processed, once the worker thread is done with it. Only
+ * called by the worker thread owning the ring.
+ *
+ * @param ring the ring of the worker thread
+ */
+void markRequestProcessed(RequestRing* ring);
+
+/**
+ * Checks, if the worker thread has processed every request submitted, before
+ * the given number of requests was reached.
+ *
+ * @param ring the ring of the worker thread
+ * @param fence the request_head of the ring, when the caller started waiting
+ * @returns true, when no request before the fence is left
+ */
+auto isProcessedUpTo(RequestRing* ring, unsigned int fence) -> bool;
+
+/**
+ * Marks the worker thread owning the ring as sleeping, unless a request
+ * arrived in the meantime. Only called by that worker thread, while it holds
+ * the mutex which its wake-up takes as well.
+ *
+ * @param ring the ring of the worker thread
+ * @returns false, when the worker thread must not block, because there is a
+ * request
+ */
+auto prepareToSleep(RequestRing* ring) -> bool;
+
+/**
+ * Marks the worker thread owning the ring as awake again.
+ *
+ * @param ring the ring of the worker thread
+ */
+void wakeUp(RequestRing* ring);
+
+/**
+ * Checks after a request was submitted, if the worker thread sleeps and needs
+ * to be woken up. Returns true at most once per sleep, so that concurrent
+ * submitters do not wake it up twice.
+ *
+ * @param ring the ring of the worker thread
+ * @returns true, when the caller needs to wake up the worker thread
+ */
+auto needsWakeUp(RequestRing* ring) -> bool;
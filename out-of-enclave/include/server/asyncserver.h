@@ -0,0 +1,143 @@
+#pragma once
+
+#include <grpcpp/alarm.h>
+
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "server.h"
+
+using grpc::ServerAsyncResponseWriter;
+using grpc::ServerCompletionQueue;
+
+// Number of threads serving the asynchronous RPCs, each with its own completion
+// queue, unless configured otherwise
+const int kDefaultCompletionQueueThreads = 2;
+
+// LockShared, LockExclusive and Unlock are served through completion queues,
+// every other RPC by the synchronous implementation
+using AsyncLockingServiceBase = LockingService::WithAsyncMethod_LockShared<
+    LockingService::WithAsyncMethod_LockExclusive<
+        LockingService::WithAsyncMethod_Unlock<LockingServiceImpl>>>;
+
+/**
+ * The LockingServiceImpl with asynchronous lock and unlock RPCs. Instead of
+ * blocking a gRPC thread per request until the enclave finished it, a few
+ * threads take the requests from completion queues and submit them to the lock
+ * manager. Once the enclave finished the job of a request, it is posted back to
+ * its completion queue and answered from there. So the number of outstanding
+ * lock requests is not bounded by the number of threads.
+ */
+class AsyncLockingServiceImpl final : public AsyncLockingServiceBase {
+ public:
+  /**
+   * @param numCompletionQueueThreads the number of completion queues and
+   * threads serving them
+   * @param conflictPolicy how the lock manager handles lock requests, that
+   * conflict with the lock of another transaction
+   */
+  explicit AsyncLockingServiceImpl(
+      int numCompletionQueueThreads = kDefaultCompletionQueueThreads,
+      LockConflictPolicy conflictPolicy = NO_WAIT);
+
+  /**
+   * Shuts the server down, if it is still running.
+   */
+  ~AsyncLockingServiceImpl() override;
+
+  /**
+   * Registers the service and its completion queues with the builder, starts
+   * the server and the threads serving the completion queues.
+   *
+   * @param builder the builder with the listening ports and other settings
+   * @returns the server, which is owned by the service, or nullptr, if it could
+   * not be started
+   */
+  auto start(ServerBuilder& builder) -> Server*;
+
+  /**
+   * Shuts down the server, answers the requests in flight, shuts down the
+   * completion queues and waits for their threads.
+   */
+  void shutdown();
+
+ private:
+  /**
+   * An asynchronous LockShared, LockExclusive or Unlock RPC from the moment it
+   * is requested from the completion queue until its response was sent.
+   */
+  struct AsyncCall {
+    Command command;  // SHARED, EXCLUSIVE or UNLOCK
+    ServerContext context;
+    LockRequest request;
+    LockResponse response;
+    ServerAsyncResponseWriter<LockResponse> responder{&context};
+    std::optional<JobFuture> future;  // the pending result of the request
+    grpc::Alarm alarm;  // posts the call, once the job of the request finished
+    ServerCompletionQueue* queue = nullptr;  // the queue the alarm posts to
+    bool submitted = false;  // the next event of this call answers it
+    bool finished = false;   // the next event of this call deletes it
+  };
+
+  /**
+   * A completion queue with the thread serving it.
+   */
+  struct CompletionQueueWorker {
+    std::unique_ptr<ServerCompletionQueue> queue;
+    std::thread server;
+  };
+
+  /**
+   * Asks the completion queue for the next call of an RPC.
+   *
+   * @param command the RPC, i.e. SHARED, EXCLUSIVE or UNLOCK
+   * @param worker the completion queue to deliver the call to
+   */
+  void request_call(Command command, CompletionQueueWorker& worker);
+
+  /**
+   * Takes the events of a completion queue, i.e. new calls, finished jobs and
+   * sent responses, until it is shut down.
+   *
+   * @param worker the completion queue
+   */
+  void serve(CompletionQueueWorker& worker);
+
+  /**
+   * Submits the request of a new call to the lock manager. Answers it right
+   * away, if its result is already available, else once the enclave finished
+   * its job and the call was posted back to its completion queue.
+   *
+   * @param call the new call
+   * @param worker the completion queue of the call
+   */
+  void start_call(AsyncCall* call, CompletionQueueWorker& worker);
+
+  /**
+   * Posts a call to its completion queue, after the enclave finished its job.
+   * Runs on the thread that finished the job, see JobFuture::notifyWhenReady().
+   *
+   * @param tag the call
+   */
+  static void post_call(void* tag);
+
+  /**
+   * Sends the response of a call, whose job is finished.
+   *
+   * @param call the call
+   */
+  void complete_call(AsyncCall* call);
+
+  /**
+   * Sends the response of a call.
+   *
+   * @param call the call
+   * @param status the status code of the RPC call
+   */
+  static void finish_call(AsyncCall* call, const Status& status);
+
+  std::vector<std::unique_ptr<CompletionQueueWorker>> workers_;
+  std::unique_ptr<Server> server_;
+};
@@ -7,14 +7,21 @@
 #include <grpcpp/server_context.h>
 #include "spdlog/spdlog.h"
 
+#include <condition_variable>
 #include <iostream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 #include "lockmanager.grpc.pb.h"
 #include "lockmanager.h"
+#include "signaturestore.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
+using grpc::ServerReaderWriter;
 using grpc::Status;
 
 /**
@@ -22,8 +29,14 @@ using grpc::Status;
  * manager. It takes requests to acquire and release locks from the client and
  * forwards them to the LockManager class.
  */
-class LockingServiceImpl final : public LockingService::Service {
+class LockingServiceImpl : public LockingService::Service {
  public:
+  /**
+   * @param conflictPolicy how the lock manager handles lock requests, that
+   * conflict with the lock of another transaction
+   */
+  explicit LockingServiceImpl(LockConflictPolicy conflictPolicy = NO_WAIT);
+
   /**
    * Registers the transaction at the lock manager prior to being able to
    * acquire any locks, so that the lock manager can now the transaction's lock
@@ -43,9 +56,11 @@ class LockingServiceImpl final : public LockingService::Service {
    *
    * @param context contains metadata about the request
    * @param request containing transaction ID and row ID of the client request,
-   *                that identify client and the row it wants a lock on
+   *                that identify client and the row it wants a lock on, and
+   *                optionally a lock budget to register the transaction with
    * @param response contains if the lock was acquired successfully and if it
-   *                 was, a signature of the lock
+   *                 was, a signature of the lock, or the ticket of the
+   *                 request, if it did not wait for the signature
    * @return the status code of the RPC call (OK or a specific error code)
    */
   auto LockExclusive(ServerContext* context, const LockRequest* request,
@@ -57,9 +72,11 @@ class LockingServiceImpl final : public LockingService::Service {
    *
    * @param context contains metadata about the request
    * @param request containing transaction ID and row ID of the client request,
-   *                that identify client and the row it wants a lock on
+   *                that identify client and the row it wants a lock on, and
+   *                optionally a lock budget to register the transaction with
    * @param response contains if the lock was acquired successfully and if it
-   *                 was a signature of the lock
+   *                 was a signature of the lock, or the ticket of the request,
+   *                 if it did not wait for the signature
    * @return the status code of the RPC call (OK or a specific error code)
    */
   auto LockShared(ServerContext* context, const LockRequest* request,
@@ -79,6 +96,167 @@ class LockingServiceImpl final : public LockingService::Service {
   auto Unlock(ServerContext* context, const LockRequest* request,
               LockResponse* response) -> Status override;
 
- private:
+  /**
+   * Forwards a batch of requests to the lock manager, which submits them to the
+   * enclave all at once.
+   *
+   * @param context contains metadata about the request
+   * @param request containing the jobs, e.g. lock requests of several
+   *                transactions
+   * @param response contains for each job if it was successful and the
+   *                 signature, if it acquired a lock
+   * @return the status code of the RPC call (OK or a specific error code)
+   */
+  auto SubmitBatch(ServerContext* context, const BatchRequest* request,
+                   BatchResponse* response) -> Status override;
+
+  /**
+   * Acquires several locks of a transaction. The lock manager submits them to
+   * the enclave all at once, so that the worker threads owning the rows
+   * execute them in parallel.
+   *
+   * @param context contains metadata about the request
+   * @param request containing the transaction ID, the rows and lock modes and
+   *                optionally a lock budget to register the transaction with
+   * @param response contains for each lock if it was granted and its
+   *                 signature
+   * @return the status code of the RPC call (OK or a specific error code)
+   */
+  auto LockBatch(ServerContext* context, const LockBatchRequest* request,
+                 LockBatchResponse* response) -> Status override;
+
+  /**
+   * Releases several locks of a transaction, like LockBatch acquires them.
+   *
+   * @param context contains metadata about the request
+   * @param request containing the transaction ID and the rows
+   * @param response contains for each row if its lock was released
+   * @return the status code of the RPC call (OK or a specific error code)
+   */
+  auto UnlockBatch(ServerContext* context, const UnlockBatchRequest* request,
+                   UnlockBatchResponse* response) -> Status override;
+
+  /**
+   * Releases all locks of a committing transaction with one job for every
+   * worker thread of the enclave, see LockManager::commit.
+   *
+   * @param context contains metadata about the request
+   * @param request containing the transaction ID
+   * @param response empty, the status tells if the locks were released
+   * @return OK, or CANCELLED, if the transaction was not registered or a lock
+   * could not be released
+   */
+  auto Commit(ServerContext* context, const EndTransactionRequest* request,
+              EndTransactionResponse* response) -> Status override;
+
+  /**
+   * Releases all locks of an aborting transaction like Commit does.
+   *
+   * @param context contains metadata about the request
+   * @param request containing the transaction ID
+   * @param response empty, the status tells if the locks were released
+   * @return OK, or CANCELLED, if the transaction was not registered or a lock
+   * could not be released
+   */
+  auto Abort(ServerContext* context, const EndTransactionRequest* request,
+             EndTransactionResponse* response) -> Status override;
+
+  /**
+   * Serves the lock and unlock requests of a transaction over a single stream.
+   * The requests are submitted to the lock manager right away and their
+   * responses are written, as soon as they are finished. When the client
+   * commits, aborts or the stream breaks, all locks the transaction still
+   * holds are released.
+   *
+   * @param context contains metadata about the request
+   * @param stream the requests from and the responses to the client
+   * @return OK, when the session was ended by COMMIT or ABORT, else CANCELLED
+   */
+  auto TransactionSession(
+      ServerContext* context,
+      ServerReaderWriter<SessionResponse, SessionRequest>* stream)
+      -> Status override;
+
+  /**
+   * Hands out the results of the lock requests of a transaction, which did not
+   * wait for their signatures. Waits for the ones the enclave did not finish
+   * yet.
+   *
+   * @param context contains metadata about the request
+   * @param request containing the transaction ID
+   * @param response contains the ticket, row ID, lock mode, success and
+   *                 signature of each lock request
+   * @return the status code of the RPC call (OK or a specific error code)
+   */
+  auto CollectSignatures(ServerContext* context, const CollectRequest* request,
+                         CollectResponse* response) -> Status override;
+
+ protected:
+  /**
+   * Submits a lock request of LockShared or LockExclusive. Without waiting for
+   * the signature, the result is kept in the signature store and the response
+   * contains its ticket.
+   *
+   * @param request the lock request
+   * @param response receives the ticket
+   * @param isExclusive the requested lock mode
+   * @returns the pending result, or nothing, if the signature store took it
+   */
+  auto submit_lock(const LockRequest* request, LockResponse* response,
+                   bool isExclusive) -> std::optional<JobFuture>;
+
+  /**
+   * Fills in the response to a lock request, once its result is available.
+   *
+   * @param result the signature and if the lock was granted
+   * @param response receives the signature, or an error message
+   * @return the status code of the RPC call
+   */
+  static auto finish_lock(const std::pair<std::string, bool>& result,
+                          LockResponse* response) -> Status;
+
   LockManager lockManager_;
+  SignatureStore signatures_;  // of lock requests, that did not wait for them
+
+ private:
+  /**
+   * A request of a transaction session, whose response was not sent yet.
+   */
+  struct PendingSessionRequest {
+    uint64_t requestId;
+    std::optional<JobFuture> future;  // empty, if the request was rejected
+  };
+
+  /**
+   * The requests the reading thread of a session submitted, which the writing
+   * thread has not taken over yet.
+   */
+  struct SessionQueue {
+    std::mutex mutex;
+    std::condition_variable submitted;
+    std::list<PendingSessionRequest> requests;
+    bool closed = false;  // no more requests are submitted
+  };
+
+  /**
+   * Writes the responses of a session, as soon as their requests are finished,
+   * until the queue is closed and every request is answered.
+   *
+   * @param queue the submitted requests
+   * @param stream the responses to the client
+   */
+  void answer_session(
+      SessionQueue& queue,
+      ServerReaderWriter<SessionResponse, SessionRequest>* stream);
+
+  /**
+   * Acquires a lock for LockShared and LockExclusive, see submit_lock.
+   *
+   * @param request the lock request
+   * @param response receives the signature or the ticket
+   * @param isExclusive the requested lock mode
+   * @return the status code of the RPC call
+   */
+  auto acquire_lock(const LockRequest* request, LockResponse* response,
+                    bool isExclusive) -> Status;
 };
\ No newline at end of file
@@ -1,13 +1,14 @@
 #pragma once
 
+#include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <unordered_map>
 
-#include "hashtable.h"
 #include "lock.h"
+#include "locktable.h"
 
 using std::memcpy;
 
@@ -33,6 +34,7 @@ struct Transaction {
   int* locked_rows;
   int locked_rows_size;
   int num_locked;
+  std::set<int> waiting_rows;  // rows, whose locks its requests wait for
 };
 typedef struct Transaction Transaction;
 
@@ -49,6 +51,17 @@ typedef struct Transaction Transaction;
  */
 Transaction* newTransaction(int transactionId, int lockBudget);
 
+/**
+ * Returns the shard of the transaction table, that holds the transaction. The
+ * transaction IDs are spread round-robin over the shards, of which every
+ * worker thread has one.
+ *
+ * @param transactionId identifies the transaction
+ * @param numShards number of shards of the transaction table
+ * @returns index of the shard
+ */
+auto getTransactionShard(unsigned int transactionId, int numShards) -> int;
+
 /**
  * When the transaction acquires a new lock, the row ID that lock refers to is
  * added to the set of locked rows and it decrements the lock budget by 1.
@@ -66,13 +79,15 @@ auto addLock(Transaction* transaction, int rowId, bool isExclusive, Lock* lock)
 /**
  * Checks if the transaction currently holds a lock on the given row ID.
  * If so, it enters the shrinking phase and removes the row ID from the set of
- * locked rows. Then it releases the lock.
+ * locked rows. Then it releases the lock. Removing the lock from the lock
+ * table, once it has no owners left, is up to the caller.
  *
  * @param Transaction transaction to execute the operation on
  * @param rowId row ID of the released lock
  * @param lock the lock to release
+ * @returns true if the transaction held the lock
  */
-void releaseLock(Transaction* transaction, int rowId, HashTable* lockTable);
+auto releaseLock(Transaction* transaction, int rowId, Lock* lock) -> bool;
 
 /**
  * Checks if the transaction has a lock on the specified row.
@@ -90,7 +105,7 @@ auto hasLock(Transaction* transaction, int rowId) -> bool;
  * @param Transaction transaction to execute the operation on
  * @param lockTable containing all the locks indexed by row ID
  */
-void releaseAllLocks(Transaction* transaction, HashTable* lockTable);
+void releaseAllLocks(Transaction* transaction, LockTable* lockTable);
 
 /**
  * Creates a new transaction that has the same content as the given transaction.
@@ -108,3 +123,12 @@ auto copy_transaction(Transaction* transaction) -> void*;
  * @param transaction the transaction created with copy_transaction())
  */
 void free_transaction_copy(Transaction*& transaction);
+
+/**
+ * Frees the transaction together with its locked rows. The locked rows are
+ * grown with realloc(), so they must not be freed in any other way.
+ *
+ * @param transaction the transaction created with newTransaction() or
+ * copy_transaction()
+ */
+void freeTransaction(Transaction* transaction);
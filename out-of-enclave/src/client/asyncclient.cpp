@@ -0,0 +1,190 @@
+#include "asyncclient.h"
+
+#include <algorithm>
+
+AsyncLockingServiceClient::AsyncLockingServiceClient(
+    const std::shared_ptr<Channel> &channel, size_t window)
+    : window_(std::max<size_t>(window, 1)) {
+  stub_ = LockingService::NewStub(channel);
+  receiver_ = std::thread([this]() { receive(); });
+}
+
+AsyncLockingServiceClient::~AsyncLockingServiceClient() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    windowFreed_.wait(lock, [&]() { return inFlight_ == 0; });
+  }
+  queue_.Shutdown();
+  receiver_.join();
+}
+
+auto AsyncLockingServiceClient::requestSharedLock(unsigned int transactionId,
+                                                  unsigned int rowId,
+                                                  unsigned int lockBudget)
+    -> std::future<std::pair<std::string, bool>> {
+  return request_lock(transactionId, rowId, false, lockBudget);
+}
+
+auto AsyncLockingServiceClient::requestExclusiveLock(unsigned int transactionId,
+                                                     unsigned int rowId,
+                                                     unsigned int lockBudget)
+    -> std::future<std::pair<std::string, bool>> {
+  return request_lock(transactionId, rowId, true, lockBudget);
+}
+
+auto AsyncLockingServiceClient::request_lock(unsigned int transactionId,
+                                             unsigned int rowId,
+                                             bool isExclusive,
+                                             unsigned int lockBudget)
+    -> std::future<std::pair<std::string, bool>> {
+  auto *call = new LockCall();
+  call->transactionId = transactionId;
+  call->rowId = rowId;
+  std::future<std::pair<std::string, bool>> future =
+      call->promise.get_future();
+
+  LockRequest request;
+  request.set_transaction_id(transactionId);
+  request.set_row_id(rowId);
+  request.set_wait_for_signature(true);
+  request.set_lock_budget(lockBudget);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    enter_window(lock);
+    transactions_[transactionId].pendingLocks++;
+  }
+
+  if (isExclusive) {
+    call->reader =
+        stub_->PrepareAsyncLockExclusive(&call->context, request, &queue_);
+  } else {
+    call->reader =
+        stub_->PrepareAsyncLockShared(&call->context, request, &queue_);
+  }
+  call->reader->StartCall();
+  call->reader->Finish(&call->response, &call->status, call);
+  return future;
+}
+
+auto AsyncLockingServiceClient::requestUnlock(unsigned int transactionId,
+                                              unsigned int rowId)
+    -> std::future<bool> {
+  auto *call = new UnlockCall();
+  std::future<bool> future = call->promise.get_future();
+
+  LockRequest request;
+  request.set_transaction_id(transactionId);
+  request.set_row_id(rowId);
+  request.set_wait_for_signature(true);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    enter_window(lock);
+    auto transaction = transactions_.find(transactionId);
+    if (transaction != transactions_.end()) {
+      std::vector<unsigned int> &rowIds = transaction->second.rowIds;
+      rowIds.erase(std::remove(rowIds.begin(), rowIds.end(), rowId),
+                   rowIds.end());
+    }
+  }
+
+  call->reader = stub_->PrepareAsyncUnlock(&call->context, request, &queue_);
+  call->reader->StartCall();
+  call->reader->Finish(&call->response, &call->status, call);
+  return future;
+}
+
+auto AsyncLockingServiceClient::commit(unsigned int transactionId)
+    -> std::future<bool> {
+  std::promise<bool> promise;
+  std::future<bool> future = promise.get_future();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto transaction = transactions_.find(transactionId);
+  if (transaction == transactions_.end()) {
+    promise.set_value(true);  // holds no locks
+  } else if (transaction->second.pendingLocks > 0) {
+    // The last answered lock request sends the commit
+    transaction->second.committing = true;
+    transaction->second.commitPromise = std::move(promise);
+  } else {
+    send_commit(transactionId, std::move(promise));
+  }
+  return future;
+}
+
+auto AsyncLockingServiceClient::inFlight() -> size_t {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return inFlight_;
+}
+
+void AsyncLockingServiceClient::enter_window(
+    std::unique_lock<std::mutex> &lock) {
+  windowFreed_.wait(lock, [&]() { return inFlight_ < window_; });
+  inFlight_++;
+}
+
+void AsyncLockingServiceClient::send_commit(unsigned int transactionId,
+                                            std::promise<bool> promise) {
+  auto transaction = transactions_.find(transactionId);
+  std::vector<unsigned int> rowIds = std::move(transaction->second.rowIds);
+  transactions_.erase(transaction);
+  if (rowIds.empty()) {
+    promise.set_value(true);
+    return;
+  }
+
+  auto *call = new CommitCall();
+  call->promise = std::move(promise);
+  EndTransactionRequest request;
+  request.set_transaction_id(transactionId);
+
+  // Called by the receiving thread as well, which must not wait for the window
+  // it frees itself
+  inFlight_++;
+  call->reader = stub_->PrepareAsyncCommit(&call->context, request, &queue_);
+  call->reader->StartCall();
+  call->reader->Finish(&call->response, &call->status, call);
+}
+
+void AsyncLockingServiceClient::receive() {
+  void *tag;
+  bool ok;
+  while (queue_.Next(&tag, &ok)) {
+    auto *call = static_cast<AsyncCall *>(tag);
+    if (auto *lockCall = dynamic_cast<LockCall *>(call)) {
+      complete_lock(lockCall);
+    } else if (auto *unlockCall = dynamic_cast<UnlockCall *>(call)) {
+      unlockCall->promise.set_value(unlockCall->status.ok());
+    } else if (auto *commitCall = dynamic_cast<CommitCall *>(call)) {
+      commitCall->promise.set_value(commitCall->status.ok());
+    }
+    delete call;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inFlight_--;
+    }
+    windowFreed_.notify_all();
+  }
+}
+
+void AsyncLockingServiceClient::complete_lock(LockCall *call) {
+  bool granted = call->status.ok();
+  if (!granted) {
+    spdlog::error("Acquiring lock failed (TXID: " +
+                  std::to_string(call->transactionId) +
+                  ", RID: " + std::to_string(call->rowId) + ")");
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TransactionLocks &transaction = transactions_[call->transactionId];
+    if (granted) {
+      transaction.rowIds.push_back(call->rowId);
+    }
+    transaction.pendingLocks--;
+    if (transaction.committing && transaction.pendingLocks == 0) {
+      send_commit(call->transactionId, std::move(transaction.commitPromise));
+    }
+  }
+  call->promise.set_value({call->response.signature(), granted});
+}
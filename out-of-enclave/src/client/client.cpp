@@ -23,7 +23,8 @@ auto LockingServiceClient::registerTransaction(unsigned int transactionId,
 
 auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
                                              unsigned int rowId,
-                                             bool waitForSignature)
+                                             bool waitForSignature,
+                                             unsigned int lockBudget)
     -> std::string {
   spdlog::info(
       "Requesting shared lock (TXID: " + std::to_string(transactionId) +
@@ -32,6 +33,7 @@ auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
   request.set_transaction_id(transactionId);
   request.set_row_id(rowId);
   request.set_wait_for_signature(waitForSignature);
+  request.set_lock_budget(lockBudget);
 
   LockResponse response;
   ClientContext context;
@@ -51,7 +53,8 @@ auto LockingServiceClient::requestSharedLock(unsigned int transactionId,
 
 auto LockingServiceClient::requestExclusiveLock(unsigned int transactionId,
                                                 unsigned int rowId,
-                                                bool waitForResult)
+                                                bool waitForResult,
+                                                unsigned int lockBudget)
     -> std::string {
   spdlog::info(
       "Requesting exclusive lock (TXID: " + std::to_string(transactionId) +
@@ -60,6 +63,7 @@ auto LockingServiceClient::requestExclusiveLock(unsigned int transactionId,
   request.set_transaction_id(transactionId);
   request.set_row_id(rowId);
   request.set_wait_for_signature(waitForResult);
+  request.set_lock_budget(lockBudget);
 
   LockResponse response;
   ClientContext context;
@@ -94,4 +98,220 @@ auto LockingServiceClient::requestUnlock(unsigned int transactionId,
   Status status = stub_->Unlock(&context, request, &response);
 
   return status.ok();
-}
\ No newline at end of file
+}
+auto LockingServiceClient::submitBatch(
+    const std::vector<BatchRequest::Job> &jobs, bool waitForSignature)
+    -> std::vector<std::pair<std::string, bool>> {
+  spdlog::info("Submitting a batch of " + std::to_string(jobs.size()) +
+               " requests");
+  BatchRequest request;
+  request.mutable_jobs()->Add(jobs.begin(), jobs.end());
+  request.set_wait_for_signature(waitForSignature);
+
+  BatchResponse response;
+  ClientContext context;
+
+  Status status = stub_->SubmitBatch(&context, request, &response);
+
+  std::vector<std::pair<std::string, bool>> results;
+  if (!status.ok()) {
+    spdlog::error("Submitting a batch failed");
+    return results;
+  }
+  for (const BatchResponse::Result &result : response.results()) {
+    results.emplace_back(result.signature(), result.ok());
+  }
+  return results;
+}
+
+auto LockingServiceClient::lockBatch(
+    unsigned int transactionId,
+    const std::vector<std::pair<unsigned int, bool>> &locks,
+    unsigned int lockBudget) -> std::vector<std::pair<std::string, bool>> {
+  spdlog::info("Requesting " + std::to_string(locks.size()) +
+               " locks (TXID: " + std::to_string(transactionId) + ")");
+  LockBatchRequest request;
+  request.set_transaction_id(transactionId);
+  request.set_lock_budget(lockBudget);
+  for (const auto &[rowId, isExclusive] : locks) {
+    LockBatchRequest::Lock *lock = request.add_locks();
+    lock->set_row_id(rowId);
+    lock->set_exclusive(isExclusive);
+  }
+
+  LockBatchResponse response;
+  ClientContext context;
+
+  Status status = stub_->LockBatch(&context, request, &response);
+
+  std::vector<std::pair<std::string, bool>> results;
+  if (!status.ok()) {
+    spdlog::error("Acquiring a batch of locks failed");
+    return results;
+  }
+  for (const LockBatchResponse::Result &result : response.results()) {
+    results.emplace_back(result.signature(), result.ok());
+  }
+  return results;
+}
+
+auto LockingServiceClient::unlockBatch(unsigned int transactionId,
+                                       const std::vector<unsigned int> &rowIds)
+    -> std::vector<bool> {
+  spdlog::info("Releasing " + std::to_string(rowIds.size()) +
+               " locks (TXID: " + std::to_string(transactionId) + ")");
+  UnlockBatchRequest request;
+  request.set_transaction_id(transactionId);
+  request.mutable_row_ids()->Add(rowIds.begin(), rowIds.end());
+
+  UnlockBatchResponse response;
+  ClientContext context;
+
+  Status status = stub_->UnlockBatch(&context, request, &response);
+
+  std::vector<bool> results;
+  if (!status.ok()) {
+    spdlog::error("Releasing a batch of locks failed");
+    return results;
+  }
+  results.assign(response.released().begin(), response.released().end());
+  return results;
+}
+
+auto LockingServiceClient::commit(unsigned int transactionId) -> bool {
+  spdlog::info("Committing transaction " + std::to_string(transactionId));
+  EndTransactionRequest request;
+  request.set_transaction_id(transactionId);
+
+  EndTransactionResponse response;
+  ClientContext context;
+
+  Status status = stub_->Commit(&context, request, &response);
+  if (!status.ok()) {
+    spdlog::error("Committing transaction " + std::to_string(transactionId) +
+                  " failed");
+  }
+  return status.ok();
+}
+
+auto LockingServiceClient::abort(unsigned int transactionId) -> bool {
+  spdlog::info("Aborting transaction " + std::to_string(transactionId));
+  EndTransactionRequest request;
+  request.set_transaction_id(transactionId);
+
+  EndTransactionResponse response;
+  ClientContext context;
+
+  Status status = stub_->Abort(&context, request, &response);
+  if (!status.ok()) {
+    spdlog::error("Aborting transaction " + std::to_string(transactionId) +
+                  " failed");
+  }
+  return status.ok();
+}
+
+auto LockingServiceClient::collectSignatures(unsigned int transactionId)
+    -> std::vector<CollectResponse::Result> {
+  spdlog::info("Collecting the signatures of transaction " +
+               std::to_string(transactionId));
+  CollectRequest request;
+  request.set_transaction_id(transactionId);
+
+  CollectResponse response;
+  ClientContext context;
+
+  Status status = stub_->CollectSignatures(&context, request, &response);
+
+  std::vector<CollectResponse::Result> results;
+  if (!status.ok()) {
+    spdlog::error("Collecting signatures failed");
+    return results;
+  }
+  results.assign(response.results().begin(), response.results().end());
+  return results;
+}
+
+auto LockingServiceClient::openSession(unsigned int transactionId,
+                                       unsigned int lockBudget)
+    -> std::unique_ptr<LockingSession> {
+  spdlog::info("Opening a session for transaction " +
+               std::to_string(transactionId));
+  return std::make_unique<LockingSession>(stub_.get(), transactionId,
+                                          lockBudget);
+}
+
+LockingSession::LockingSession(LockingService::Stub *stub,
+                               unsigned int transactionId,
+                               unsigned int lockBudget)
+    : transactionId_(transactionId), lockBudget_(lockBudget) {
+  stream_ = stub->TransactionSession(&context_);
+}
+
+LockingSession::~LockingSession() {
+  if (!finished_) {
+    finish(false);
+  }
+}
+
+auto LockingSession::requestLock(unsigned int rowId, bool isExclusive)
+    -> uint64_t {
+  return send(isExclusive ? SessionRequest::EXCLUSIVE : SessionRequest::SHARED,
+              rowId);
+}
+
+auto LockingSession::requestUnlock(unsigned int rowId) -> uint64_t {
+  return send(SessionRequest::UNLOCK, rowId);
+}
+
+auto LockingSession::readResponse(SessionResponse *response) -> bool {
+  return stream_->Read(response);
+}
+
+auto LockingSession::finish(bool commit, std::vector<SessionResponse> *unread)
+    -> bool {
+  spdlog::info(std::string(commit ? "Committing" : "Aborting") +
+               " transaction " + std::to_string(transactionId_));
+  finished_ = true;
+  uint64_t requestId =
+      send(commit ? SessionRequest::COMMIT : SessionRequest::ABORT, 0);
+  stream_->WritesDone();
+
+  // The response to the commit or abort is the last one of the session
+  SessionResponse response;
+  bool acknowledged = false;
+  while (stream_->Read(&response)) {
+    if (requestId != 0 && response.request_id() == requestId) {
+      acknowledged = true;
+    } else if (unread != nullptr) {
+      unread->push_back(response);
+    }
+  }
+
+  Status status = stream_->Finish();
+  if (!status.ok()) {
+    spdlog::error("Session of transaction " + std::to_string(transactionId_) +
+                  " failed: " + status.error_message());
+  }
+  return status.ok() && acknowledged;
+}
+
+auto LockingSession::send(SessionRequest::Command command, unsigned int rowId)
+    -> uint64_t {
+  SessionRequest request;
+  request.set_request_id(nextRequestId_);
+  request.set_command(command);
+  request.set_transaction_id(transactionId_);
+  request.set_row_id(rowId);
+  if (command == SessionRequest::SHARED ||
+      command == SessionRequest::EXCLUSIVE) {
+    request.set_lock_budget(lockBudget_);
+    lockBudget_ = 0;
+  }
+
+  if (!stream_->Write(request)) {
+    spdlog::error("Session of transaction " + std::to_string(transactionId_) +
+                  " is broken");
+    return 0;
+  }
+  return nextRequestId_++;
+}
@@ -4,106 +4,312 @@ Arg arg_enclave;  // configuration parameters for the enclave
 int num = 0;      // global variable used to give every thread a unique ID
 int transaction_count = 0;  // counts the number of active transactions
 sgx_thread_mutex_t global_num_mutex;  // synchronizes access to num
-sgx_thread_mutex_t *queue_mutex;      // synchronizes access to the job queue
-sgx_thread_cond_t
-    *job_cond;  // wakes up worker threads when a new job is available
-std::vector<std::queue<Job>> queue;  // a job queue for each worker threads
-sgx_ecc_state_handle_t *contexts;    // context for signing for each thread
+WorkerQueue *worker_queues;           // a job queue for each worker thread
+sgx_ecc_state_handle_t *contexts;     // context for signing for each thread
 
-void enclave_init_values(Arg arg, HashTable *lock_table) {
+void enclave_init_values(Arg arg, LockTable *lock_table,
+                         Reclamation *reclamation,
+                         RequestRings *request_rings) {
   // Get configuration parameters
   arg_enclave = arg;
-  lockTable_ = lock_table;
-  transactionTable_ = newHashTable(arg_enclave.transaction_table_size);
+  if (!set_integrity_options(arg_enclave.integrity)) {
+    print_error("Could not generate the key for bucket digests");
+  }
+  lockTable_.key_range = arg_enclave.lock_table_size;
+  lockTable_.num_partitions =
+      (arg_enclave.num_threads - 1) * kPartitionsPerWorker;
+  lockTable_.partitions = new LockTablePartition[lockTable_.num_partitions];
+
+  // Take over the initial bucket arrays, but nothing else from the untrusted
+  // partitions. Each partition gets the integrity data for its buckets, which
+  // are all empty in the beginning.
+  LockTablePartition *partitions = lock_table->partitions;
+  untrustedPartitions_ =
+      sgx_is_outside_enclave(
+          partitions, sizeof(LockTablePartition) * lockTable_.num_partitions)
+          ? partitions
+          : nullptr;
+  int partitionSize = (lockTable_.key_range + lockTable_.num_partitions - 1) /
+                      lockTable_.num_partitions;
+  lockTableIntegrityHashes.resize(lockTable_.num_partitions);
+  lockWaiters_.resize(lockTable_.num_partitions);
+  for (int i = 0; i < lockTable_.num_partitions; i++) {
+    LockTablePartition &partition = lockTable_.partitions[i];
+    partition = LockTablePartition();
+    partition.size = partitionSize;
+    partition.min_size = partitionSize;
+
+    LockBucket *buckets =
+        untrustedPartitions_ != nullptr ? untrustedPartitions_[i].buckets
+                                        : nullptr;
+    LockBucketHashes *hashes = nullptr;
+    if (buckets != nullptr &&
+        sgx_is_outside_enclave(buckets, sizeof(LockBucket) * partitionSize) &&
+        (hashes = newLockBucketHashes(partitionSize)) != nullptr) {
+      partition.buckets = buckets;
+      lockTableIntegrityHashes[i][buckets].reset(hashes);
+    }
+  }
+
+  // Read the location of the rings only once, so that it cannot change later
+  reclamation_ = nullptr;
+  reclamationRings_ = nullptr;
+  if (sgx_is_outside_enclave(reclamation, sizeof(Reclamation))) {
+    ReclamationRing *rings = reclamation->rings;
+    if (reclamation->num_rings == lockTable_.num_partitions &&
+        sgx_is_outside_enclave(
+            rings, sizeof(ReclamationRing) * lockTable_.num_partitions)) {
+      reclamation_ = reclamation;
+      reclamationRings_ = rings;
+    }
+  }
+
+  // Same for the request rings, which need one ring per worker thread
+  requestRings_ = nullptr;
+  if (request_rings != nullptr &&
+      sgx_is_outside_enclave(request_rings, sizeof(RequestRings))) {
+    RequestRing *rings = request_rings->rings;
+    if (request_rings->num_rings == arg_enclave.num_threads &&
+        sgx_is_outside_enclave(
+            rings, sizeof(RequestRing) * arg_enclave.num_threads)) {
+      requestRings_ = rings;
+    } else {
+      print_error("Received invalid request rings");
+    }
+  }
+
+  // The untrusted application routes the requests in the rings itself, so the
+  // partitions are only handed over, when the enclave dispatches all jobs
+  partitionMap_ =
+      newPartitionMap(lockTable_.num_partitions, arg_enclave.num_threads - 1,
+                      requestRings_ == nullptr);
+
+  transactionTable_ = new TransactionTableShard[arg_enclave.num_threads];
+  for (int i = 0; i < arg_enclave.num_threads; i++) {
+    transactionTable_[i].transactions =
+        newHashTable(arg_enclave.transaction_table_size);
+    sgx_thread_mutex_init(&transactionTable_[i].mutex, NULL);
+  }
 
   // Initialize mutex variables
   sgx_thread_mutex_init(&global_num_mutex, NULL);
-  queue_mutex = (sgx_thread_mutex_t *)malloc(sizeof(sgx_thread_mutex_t) *
-                                             arg_enclave.num_threads);
-  job_cond = (sgx_thread_cond_t *)malloc(sizeof(sgx_thread_cond_t) *
-                                         arg_enclave.num_threads);
+  sgx_thread_mutex_init(&dispatchMutex_, NULL);
 
-  // Initialize job queues
+  // Initialize job queues, before any job can be dispatched to them
+  worker_queues = new WorkerQueue[arg_enclave.num_threads];
   contexts = (sgx_ecc_state_handle_t *)malloc(arg_enclave.num_threads *
                                               sizeof(sgx_ecc_state_handle_t));
   for (int i = 0; i < arg_enclave.num_threads; i++) {
-    queue.push_back(std::queue<Job>());
+    initJobQueue(&worker_queues[i].jobs);
+    sgx_thread_mutex_init(&worker_queues[i].mutex, NULL);
+    sgx_thread_cond_init(&worker_queues[i].cond, NULL);
     sgx_ecc256_open_context(&contexts[i]);
   }
+}
 
-  // Allocate space for one hash per bucket
-  lockTableIntegrityHashes.resize(lockTable_->size);
+void enclave_set_conflict_policy(int policy) {
+  if (policy != NO_WAIT && policy != WAIT_DIE) {
+    print_error("Received unknown conflict policy");
+    return;
+  }
+  // The worker threads read it with every conflicting lock request
+  __atomic_store_n(&arg_enclave.conflict_policy, (LockConflictPolicy)policy,
+                   __ATOMIC_RELAXED);
 }
 
-void enclave_send_job(void *data) {
-  Command command = ((Job *)data)->command;
-  Job new_job;
-  new_job.command = command;
+void enclave_send_job(void *data) { dispatch_jobs((Job *)data, 1); }
 
-  switch (command) {
-    case QUIT:
-      // Send exit message to all of the worker threads
-      for (int i = 0; i < arg_enclave.num_threads; i++) {
+void enclave_send_jobs(void *data, int count) {
+  if (count <= 0 || !sgx_is_outside_enclave(data, sizeof(Job) * count)) {
+    print_error("Received invalid batch of jobs");
+    return;
+  }
+  dispatch_jobs((Job *)data, count);
+}
+
+void enclave_wake_worker(int thread_id) {
+  if (thread_id < 0 || thread_id >= arg_enclave.num_threads) {
+    return;
+  }
+  wake_worker(thread_id);
+}
+
+void wake_worker(int thread_id) {
+  WorkerQueue &worker = worker_queues[thread_id];
+  sgx_thread_mutex_lock(&worker.mutex);
+  sgx_thread_cond_signal(&worker.cond);
+  sgx_thread_mutex_unlock(&worker.mutex);
+}
+
+void dispatch_jobs(Job *jobs, int count) {
+  // Collect the jobs of every worker thread first and only push them, once the
+  // dispatching is unlocked. A full queue makes the pushing thread wait for the
+  // worker thread, which other dispatching threads should not wait for.
+  std::vector<std::vector<Job>> batches(arg_enclave.num_threads);
+
+  sgx_thread_mutex_lock(&dispatchMutex_);
+  for (int i = 0; i < count; i++) {
+    Command command = jobs[i].command;
+    Job new_job;
+    new_job.command = command;
+
+    switch (command) {
+      case QUIT:
+        // Send exit message to all of the worker threads
         print_info("Sending QUIT to all threads");
+        for (int thread_id = 0; thread_id < arg_enclave.num_threads;
+             thread_id++) {
+          batches[thread_id].push_back(new_job);
+        }
+        break;
 
-        sgx_thread_mutex_lock(&queue_mutex[i]);
-        queue[i].push(new_job);
-        sgx_thread_cond_signal(&job_cond[i]);
-        sgx_thread_mutex_unlock(&queue_mutex[i]);
-      }
-      break;
+      case SHARED:
+      case EXCLUSIVE:
+      case UNLOCK: {
+        // Copy job parameters
+        new_job.transaction_id = jobs[i].transaction_id;
+        new_job.row_id = jobs[i].row_id;
+        new_job.lock_budget = command != UNLOCK ? jobs[i].lock_budget : 0;
+        new_job.wait_for_result = jobs[i].wait_for_result;
 
-    case SHARED:
-    case EXCLUSIVE:
-    case UNLOCK: {
-      // Copy job parameters
-      new_job.transaction_id = ((Job *)data)->transaction_id;
-      new_job.row_id = ((Job *)data)->row_id;
-      new_job.wait_for_result = ((Job *)data)->wait_for_result;
-
-      if (new_job.wait_for_result) {
-        new_job.return_value = ((Job *)data)->return_value;
-        new_job.finished = ((Job *)data)->finished;
-        new_job.error = ((Job *)data)->error;
+        if (new_job.wait_for_result) {
+          new_job.return_value = jobs[i].return_value;
+          new_job.finished = jobs[i].finished;
+          new_job.error = jobs[i].error;
+        }
+
+        // If transaction is not registered, abort the request. A lock request
+        // with a lock budget registers the transaction itself.
+        if (new_job.lock_budget == 0 &&
+            !is_registered(new_job.transaction_id)) {
+          print_error("Need to register transaction before lock requests");
+          if (new_job.wait_for_result) {
+            *new_job.error = true;
+            finish_job(new_job.finished);
+          }
+          break;
+        }
+
+        // Send the requests to the worker thread owning the partition of the
+        // lock table the row ID belongs to. The partition of a row ID only
+        // depends on the key range, so resizing a partition does not move rows
+        // to another partition. Only handing over the partition moves them to
+        // another worker.
+        int partition = getPartition(&lockTable_, new_job.row_id);
+        batches[routeRequest(partitionMap_, partition)].push_back(new_job);
+        break;
       }
+      case REGISTER: {
+        // Copy job parameters
+        new_job.transaction_id = jobs[i].transaction_id;
+        new_job.lock_budget = jobs[i].lock_budget;
+        new_job.finished = jobs[i].finished;
+        new_job.error = jobs[i].error;
 
-      // If transaction is not registered, abort the request
-      if (!contains(transactionTable_, new_job.transaction_id)) {
-        print_error("Need to register transaction before lock requests");
+        // Send the requests to the worker thread owning the shard of the
+        // transaction table the transaction belongs to
+        batches[getTransactionShard(new_job.transaction_id,
+                                    arg_enclave.num_threads)]
+            .push_back(new_job);
+        break;
+      }
+      case COMMIT:
+      case ABORT:
+        // Copy job parameters
+        new_job.transaction_id = jobs[i].transaction_id;
+        new_job.wait_for_result = jobs[i].wait_for_result;
         if (new_job.wait_for_result) {
-          *new_job.error = true;
-          *new_job.finished = true;
+          new_job.finished = jobs[i].finished;
+          new_job.error = jobs[i].error;
         }
-        return;
+        dispatch_release(new_job, batches);
+        break;
+      default:
+        print_error("Received unknown command");
+        break;
+    }
+  }
+  sgx_thread_mutex_unlock(&dispatchMutex_);
+
+  for (int i = 0; i < arg_enclave.num_threads; i++) {
+    if (batches[i].empty()) {
+      continue;
+    }
+    JobQueue *queue = &worker_queues[i].jobs;
+    for (Job &job : batches[i]) {
+      while (!pushJob(queue, job)) {
+        // The worker thread is busy, as long as its queue is full
+        __builtin_ia32_pause();
       }
+    }
+    // Only a worker thread, that went to sleep on its empty queue, is signaled
+    if (needsWakeUp(queue)) {
+      wake_worker(i);
+    }
+  }
+}
 
-      // Send the requests to specific worker thread
-      int thread_id =
-          (int)((new_job.row_id % lockTable_->size) /
-                ((float)lockTable_->size / (arg_enclave.num_threads - 1)));
-      sgx_thread_mutex_lock(&queue_mutex[thread_id]);
-      queue[thread_id].push(new_job);
-      sgx_thread_cond_signal(&job_cond[thread_id]);
-      sgx_thread_mutex_unlock(&queue_mutex[thread_id]);
-      break;
+void dispatch_release(const Job &job, std::vector<std::vector<Job>> &batches) {
+  // No lock request can add to the transaction, once it is out of the table
+  TransactionTableShard &shard = get_transaction_shard(job.transaction_id);
+  sgx_thread_mutex_lock(&shard.mutex);
+  auto transaction = (Transaction *)get(shard.transactions, job.transaction_id);
+  if (transaction != nullptr) {
+    remove(shard.transactions, job.transaction_id);
+  }
+  sgx_thread_mutex_unlock(&shard.mutex);
+
+  if (transaction == nullptr ||
+      (transaction->num_locked == 0 && transaction->waiting_rows.empty())) {
+    bool registered = transaction != nullptr;
+    if (registered) {
+      freeTransaction(transaction);
+    } else {
+      print_error("Transaction was not registered");
     }
-    case REGISTER: {
-      // Copy job parameters
-      new_job.transaction_id = ((Job *)data)->transaction_id;
-      new_job.lock_budget = ((Job *)data)->lock_budget;
-      new_job.finished = ((Job *)data)->finished;
-      new_job.error = ((Job *)data)->error;
-
-      // Send the requests to thread responsible for registering transactions
-      sgx_thread_mutex_lock(&queue_mutex[arg_enclave.tx_thread_id]);
-      queue[arg_enclave.tx_thread_id].push(new_job);
-      sgx_thread_cond_signal(&job_cond[arg_enclave.tx_thread_id]);
-      sgx_thread_mutex_unlock(&queue_mutex[arg_enclave.tx_thread_id]);
-      break;
+    if (job.wait_for_result) {
+      *job.error = !registered;
+      finish_job(job.finished);
+    }
+    return;
+  }
+
+  // Every partition is routed once, however many locks it holds. The requests
+  // still waiting are dropped by the worker thread owning their partition, so
+  // that they do not make younger transactions die in vain.
+  std::map<int, std::vector<int>> partitions;
+  for (int i = 0; i < transaction->num_locked; i++) {
+    int rowId = transaction->locked_rows[i];
+    partitions[getPartition(&lockTable_, rowId)].push_back(rowId);
+  }
+  std::map<int, std::vector<int>> waitingPartitions;
+  for (int rowId : transaction->waiting_rows) {
+    int partition = getPartition(&lockTable_, rowId);
+    partitions.try_emplace(partition);
+    waitingPartitions[partition].push_back(rowId);
+  }
+
+  auto release = new TransactionRelease{transaction, 0, false, job};
+  std::vector<ReleaseGroup *> groups(batches.size(), nullptr);
+  for (auto &[partition, rowIds] : partitions) {
+    int worker = routeRequest(partitionMap_, partition);
+    if (groups[worker] == nullptr) {
+      groups[worker] = new ReleaseGroup{release, {}};
+      release->pending_jobs++;
+    }
+    groups[worker]->row_ids[partition] = std::move(rowIds);
+    groups[worker]->waiting_row_ids[partition] =
+        std::move(waitingPartitions[partition]);
+  }
+
+  for (int worker = 0; worker < groups.size(); worker++) {
+    if (groups[worker] != nullptr) {
+      Job releaseJob = Job();
+      releaseJob.command = RELEASE;
+      releaseJob.transaction_id = job.transaction_id;
+      releaseJob.release_group = groups[worker];
+      batches[worker].push_back(releaseJob);
     }
-    default:
-      print_error("Received unknown command");
-      break;
   }
 }
 
@@ -113,34 +319,61 @@ void enclave_process_request() {
   int thread_id = num;
   num += 1;
 
-  sgx_thread_mutex_init(&queue_mutex[thread_id], NULL);
-  sgx_thread_cond_init(&job_cond[thread_id], NULL);
-
   sgx_thread_mutex_unlock(&global_num_mutex);
 
-  sgx_thread_mutex_lock(&queue_mutex[thread_id]);
+  WorkerQueue &worker = worker_queues[thread_id];
+  RequestRing *ring =
+      requestRings_ != nullptr ? &requestRings_[thread_id] : nullptr;
+  std::deque<Job> heldBack;
 
+  Job cur_job;
   while (1) {
-    print_info("Worker waiting for jobs");
-    if (queue[thread_id].size() == 0) {
-      sgx_thread_cond_wait(&job_cond[thread_id], &queue_mutex[thread_id]);
+    // Jobs held back go first, as soon as the previous owner of their partition
+    // is done with it
+    if (!heldBack.empty() && !must_hold_back(heldBack.front(), {}, thread_id)) {
+      cur_job = heldBack.front();
+      heldBack.pop_front();
+    } else if (popJob(&worker.jobs, &cur_job)) {
+      if (must_hold_back(cur_job, heldBack, thread_id)) {
+        heldBack.push_back(cur_job);
+        continue;
+      }
+    } else {
+      if (ring != nullptr && poll_request_ring(ring, thread_id)) {
+        continue;
+      }
+
+      // Do not sleep on held back jobs, the previous owner of their partition
+      // is still executing its last jobs for it
+      if (!heldBack.empty()) {
+        __builtin_ia32_pause();
+        continue;
+      }
+
+      // Only block, when neither the job queue nor the request ring has
+      // anything. Producers wake the worker up under the same mutex.
+      print_info("Worker waiting for jobs");
+      sgx_thread_mutex_lock(&worker.mutex);
+      if (prepareToSleep(&worker.jobs) &&
+          (ring == nullptr || prepareToSleep(ring))) {
+        sgx_thread_cond_wait(&worker.cond, &worker.mutex);
+      }
+      wakeUp(&worker.jobs);
+      if (ring != nullptr) {
+        wakeUp(ring);
+      }
+      sgx_thread_mutex_unlock(&worker.mutex);
       continue;
     }
 
     auto log = ("Worker " + std::to_string(thread_id) + " got a job").c_str();
     print_info(log);
-    Job cur_job = queue[thread_id].front();
     Command command = cur_job.command;
 
-    sgx_thread_mutex_unlock(&queue_mutex[thread_id]);
-
     switch (command) {
       case QUIT:
-        sgx_thread_mutex_lock(&queue_mutex[thread_id]);
-        queue[thread_id].pop();
-        sgx_thread_mutex_unlock(&queue_mutex[thread_id]);
-        sgx_thread_mutex_destroy(&queue_mutex[thread_id]);
-        sgx_thread_cond_destroy(&job_cond[thread_id]);
+        sgx_thread_mutex_destroy(&worker.mutex);
+        sgx_thread_cond_destroy(&worker.cond);
         sgx_ecc256_close_context(contexts[thread_id]);
         print_info("Enclave worker quitting");
         return;
@@ -160,27 +393,15 @@ void enclave_process_request() {
           print_info(log);
         }
 
-        // Acquire lock and receive signature
+        // Acquire lock and receive signature. A waiting job is finished,
+        // once the lock is granted.
         sgx_ec256_signature_t sig;
-        bool ok = acquire_lock((void *)&sig, cur_job.transaction_id,
-                               cur_job.row_id, command == EXCLUSIVE, thread_id);
-        if (cur_job.wait_for_result) {
-          if (!ok) {
-            *cur_job.error = true;
-          } else {
-            // Write base64 encoded signature into the return value of the job
-            // struct
-            std::string encoded_signature =
-                base64_encode((unsigned char *)sig.x, sizeof(sig.x)) + "-" +
-                base64_encode((unsigned char *)sig.y, sizeof(sig.y));
-
-            volatile char *p = cur_job.return_value;
-            size_t signature_size = 89;
-            for (int i = 0; i < signature_size; i++) {
-              *p++ = encoded_signature.c_str()[i];
-            }
-          }
-          *cur_job.finished = true;
+        LockRequestResult result =
+            acquire_lock((void *)&sig, {cur_job, nullptr, 0}, thread_id);
+        finishRequest(partitionMap_,
+                      getPartition(&lockTable_, cur_job.row_id));
+        if (result != REQUEST_WAITING) {
+          finish_lock_job(cur_job, result == REQUEST_GRANTED ? &sig : nullptr);
         }
         break;
       }
@@ -189,12 +410,25 @@ void enclave_process_request() {
                     ", RID: " + std::to_string(cur_job.row_id))
                        .c_str();
         print_info(log);
-        release_lock(cur_job.transaction_id, cur_job.row_id);
+        bool released =
+            release_lock(cur_job.transaction_id, cur_job.row_id, thread_id);
+        finishRequest(partitionMap_,
+                      getPartition(&lockTable_, cur_job.row_id));
         if (cur_job.wait_for_result) {
-          *cur_job.finished = true;
+          if (!released) {
+            *cur_job.error = true;
+          }
+          finish_job(cur_job.finished);
         }
         break;
       }
+      case RELEASE: {
+        auto log = ("(RELEASE) TXID: " + std::to_string(cur_job.transaction_id))
+                       .c_str();
+        print_info(log);
+        execute_release((ReleaseGroup *)cur_job.release_group, thread_id);
+        break;
+      }
       case REGISTER: {
         auto transactionId = cur_job.transaction_id;
         auto lockBudget = cur_job.lock_budget;
@@ -203,132 +437,730 @@ void enclave_process_request() {
                        .c_str();
         // print_debug(log);
 
-        if (contains(transactionTable_, transactionId)) {
-          print_error("Transaction is already registered");
+        if (!register_transaction(transactionId, lockBudget)) {
           *cur_job.error = true;
-        } else {
-          set(transactionTable_, transactionId,
-              (void *)newTransaction(transactionId, lockBudget));
         }
-        *cur_job.finished = true;
+        finish_job(cur_job.finished);
         break;
       }
       default:
         print_error("Worker received unknown command");
     }
-
-    sgx_thread_mutex_lock(&queue_mutex[thread_id]);
-    queue[thread_id].pop();
   }
 
   return;
 }
 
-auto acquire_lock(void *signature, int transactionId, int rowId,
-                  bool isExclusive, int threadId) -> bool {
-  bool ok;
+auto must_hold_back(const Job &job, const std::deque<Job> &heldBack,
+                    int threadId) -> bool {
+  if (job.command == QUIT) {
+    return !heldBack.empty();
+  }
 
-  // Get the transaction for the given transaction ID
-  auto transaction = (Transaction *)get(transactionTable_, transactionId);
+  // Jobs for the same partition keep their order
+  auto mustWait = [&](int partition) {
+    for (const Job &other : heldBack) {
+      if (other.command == QUIT || accesses_partition(other, partition)) {
+        return true;
+      }
+    }
+    return !mayExecute(partitionMap_, partition, threadId);
+  };
 
-  if (transaction == nullptr) {
-    print_error("Transaction was not registered");
+  if (job.command == RELEASE) {
+    for (auto &[partition, rowIds] :
+         ((ReleaseGroup *)job.release_group)->row_ids) {
+      if (mustWait(partition)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  if (job.command != SHARED && job.command != EXCLUSIVE &&
+      job.command != UNLOCK) {
     return false;
   }
+  return mustWait(getPartition(&lockTable_, job.row_id));
+}
 
-  if (transaction->lock_budget < 1) {
-    print_error("Lock budget is exhausted");
+auto accesses_partition(const Job &job, int partition) -> bool {
+  switch (job.command) {
+    case SHARED:
+    case EXCLUSIVE:
+    case UNLOCK:
+      return getPartition(&lockTable_, job.row_id) == partition;
+    case RELEASE:
+      return ((ReleaseGroup *)job.release_group)->row_ids.count(partition) > 0;
+    default:
+      return false;
+  }
+}
+
+void finish_job(volatile int *finished) {
+  // The caller only needs an OCALL to wake it up, if it went to sleep
+  if (__atomic_exchange_n(finished, JOB_FINISHED, __ATOMIC_RELEASE) ==
+      JOB_PENDING_WAITER) {
+    ocall_wake_job((int *)finished);
+  }
+}
+
+auto poll_request_ring(RequestRing *ring, int threadId) -> bool {
+  RingRequest request;
+  int processed = 0;
+  int polls = 0;
+  while (processed < kRequestRingBatchSize) {
+    // Copy the request into trusted memory, before looking at it
+    if (!popRequest(ring, &request)) {
+      if (processed > 0 || ++polls >= kRequestRingPolls) {
+        break;
+      }
+      __builtin_ia32_pause();
+      continue;
+    }
+    processed++;
+
+    // Nothing of the trusted stack may end up in untrusted memory
+    RingResponse response = RingResponse();
+    response.tag = request.tag;
+    LockRequestResult result =
+        process_ring_request(request, threadId, response.signature);
+    markRequestProcessed(ring);
+    if (result == REQUEST_WAITING) {
+      continue;  // answered, once the lock is granted
+    }
+    response.error = result == REQUEST_DENIED;
+    if (request.wait_for_result != 0) {
+      while (!pushResponse(ring, response)) {
+        __builtin_ia32_pause();
+      }
+    }
+  }
+  return processed > 0;
+}
+
+auto process_ring_request(const RingRequest &request, int threadId,
+                          char *signature) -> LockRequestResult {
+  Command command = request.command;
+  switch (command) {
+    case SHARED:
+    case EXCLUSIVE:
+    case UNLOCK: {
+      // The untrusted application could put a request into any ring, but only
+      // the worker owning the partition of the row ID may access it. With
+      // request rings, the partitions are never handed over.
+      if (getHomeWorker(getPartition(&lockTable_, request.row_id),
+                        partitionMap_->num_workers) != threadId) {
+        break;
+      }
+
+      unsigned int lockBudget = command != UNLOCK ? request.lock_budget : 0;
+      if (lockBudget == 0 && !is_registered(request.transaction_id)) {
+        print_error("Need to register transaction before lock requests");
+        return REQUEST_DENIED;
+      }
+
+      if (command == UNLOCK) {
+        return release_lock(request.transaction_id, request.row_id, threadId)
+                   ? REQUEST_GRANTED
+                   : REQUEST_DENIED;
+      }
+
+      // A waiting request is answered through the same ring later
+      LockWaiter waiter = {Job(), &requestRings_[threadId], request.tag};
+      waiter.job.command = command;
+      waiter.job.transaction_id = request.transaction_id;
+      waiter.job.row_id = request.row_id;
+      waiter.job.lock_budget = lockBudget;
+      waiter.job.wait_for_result = request.wait_for_result != 0;
+      sgx_ec256_signature_t sig;
+      LockRequestResult result = acquire_lock((void *)&sig, waiter, threadId);
+      if (result == REQUEST_GRANTED) {
+        std::string encoded_signature = encode_signature(sig);
+        memcpy(signature, encoded_signature.c_str(), kRingSignatureSize);
+      }
+      return result;
+    }
+    case REGISTER:
+      // Same for the shard of the transaction table
+      if (getTransactionShard(request.transaction_id,
+                              arg_enclave.num_threads) != threadId) {
+        break;
+      }
+      return register_transaction(request.transaction_id, request.lock_budget)
+                 ? REQUEST_GRANTED
+                 : REQUEST_DENIED;
+    default:
+      break;
+  }
+  print_error("Received invalid request through the request ring");
+  return REQUEST_DENIED;
+}
+
+auto get_transaction_shard(unsigned int transactionId)
+    -> TransactionTableShard & {
+  return transactionTable_[getTransactionShard(transactionId,
+                                               arg_enclave.num_threads)];
+}
+
+auto is_registered(unsigned int transactionId) -> bool {
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  sgx_thread_mutex_lock(&shard.mutex);
+  bool registered = contains(shard.transactions, transactionId);
+  sgx_thread_mutex_unlock(&shard.mutex);
+  return registered;
+}
+
+auto register_transaction(unsigned int transactionId, unsigned int lockBudget)
+    -> bool {
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  sgx_thread_mutex_lock(&shard.mutex);
+  bool registered = contains(shard.transactions, transactionId);
+  if (!registered) {
+    set(shard.transactions, transactionId,
+        (void *)newTransaction(transactionId, lockBudget));
+  }
+  sgx_thread_mutex_unlock(&shard.mutex);
+
+  if (registered) {
+    print_error("Transaction is already registered");
+  }
+  return !registered;
+}
+
+auto encode_signature(const sgx_ec256_signature_t &signature) -> std::string {
+  return base64_encode((unsigned char *)signature.x, sizeof(signature.x)) +
+         "-" + base64_encode((unsigned char *)signature.y, sizeof(signature.y));
+}
+
+auto get_integrity_memory_usage() -> size_t {
+  size_t bytes = 0;
+  for (LockTableIntegrityHashes &partition : lockTableIntegrityHashes) {
+    for (auto &[buckets, hashes] : partition) {
+      bytes += hashes->trusted_memory();
+    }
+  }
+  return bytes;
+}
+
+void digest_locktable_buckets(int numOccupied, int iterations) {
+  LockBucket bucket = LockBucket();
+  for (int i = 0; i < numOccupied && i < kLockTableSlotsPerBucket; i++) {
+    bucket.occupied |= 1u << i;
+    bucket.keys[i] = i + 1;
+    bucket.locks[i].num_owners = kTransactionBudget;
+    for (int j = 0; j < kTransactionBudget; j++) {
+      bucket.locks[i].owners[j] = j + 1;
+    }
+  }
+
+  MerkleNode digest;
+  LockBucket modified = bucket;
+  for (int i = 0; i < iterations; i++) {
+    digest_locktable_bucket(&bucket, digest);
+    modified.locks[0].owners[0] = i;
+    update_locktable_bucket_digest(digest, bucket, modified);
+  }
+}
+
+auto rehash_partition(int partition) -> bool {
+  LockTablePartition header = lockTable_.partitions[partition];
+  if (!isRehashing(&header)) {
+    return true;
+  }
+
+  VerifiedLockBucketAccess access(lockTableIntegrityHashes[partition]);
+  if (!rehashStep(&header, access)) {
+    print_error("Integrity verification of lock bucket failed during rehash");
     return false;
   }
+  commit_partition(partition, header, access);
+  return true;
+}
+
+void store_partition(int partition, LockTablePartition &header) {
+  LockTablePartition &trusted = lockTable_.partitions[partition];
+  bool layoutChanged = trusted.buckets != header.buckets ||
+                       trusted.old_buckets != header.old_buckets ||
+                       trusted.rehash_index != header.rehash_index;
+  trusted = header;
+  if (layoutChanged && untrustedPartitions_ != nullptr) {
+    untrustedPartitions_[partition] = header;
+  }
+}
+
+void commit_partition(int partition, LockTablePartition &header,
+                      VerifiedLockBucketAccess &access) {
+  access.commit();
+  store_partition(partition, header);
+
+  for (RetiredBuckets &retired : access.released()) {
+    if (reclamationRings_ == nullptr ||
+        !pushRetired(&reclamationRings_[partition], retired.buckets,
+                     retired.size)) {
+      ocall_retire_lock_buckets(retired.buckets, retired.size);
+    }
+  }
+  access.released().clear();
+}
 
-  // Get the lock object for the given row ID
-  auto lockUntrusted = (Lock *)get(lockTable_, rowId);
+auto acquire_lock(void *signature, const LockWaiter &waiter, int threadId)
+    -> LockRequestResult {
+  int transactionId = waiter.job.transaction_id;
+  int rowId = waiter.job.row_id;
+  bool isExclusive = waiter.job.command == EXCLUSIVE;
 
-  auto [bucket, numEntries] = getBucket(lockTable_, rowId);
+  // Announce the epoch, before any bucket array of the partition is read
+  int partition = getPartition(&lockTable_, rowId);
+  EpochGuard epoch(reclamation_, reclamationRings_ != nullptr
+                                     ? &reclamationRings_[partition]
+                                     : nullptr);
+  if (!rehash_partition(partition)) {
+    return REQUEST_DENIED;
+  }
 
-  uint32_t *serialized = locktable_bucket_to_uint32_t(bucket, numEntries);
-  if (numEntries == 1 &&
-      serialized[2] == 0) {  // only one empty lock with no owners
-    // note: untrusted part adds empty lock because we cannot allocate memory in
-    // untrusted part from within the enclave
-    if (lockTableIntegrityHashes[hash(lockTable_->size, rowId)] != nullptr) {
+  // Look up the lock on verified copies of the buckets and insert a new lock,
+  // if there is none for the row ID yet. The copies are only written back, if
+  // the lock can be acquired.
+  LockTablePartition header = lockTable_.partitions[partition];
+  VerifiedLockBucketAccess access(lockTableIntegrityHashes[partition]);
+  Lock *lock = get(&header, rowId, access);
+  if (lock == nullptr && !access.failed()) {
+    Lock emptyLock = Lock();
+    lock = set(&header, rowId, &emptyLock, access);
+  }
+  if (lock == nullptr) {
+    if (access.failed()) {
       print_error(
-          "Integrity verification of lock bucket failed: Bucket should be "
-          "empty");
-      return false;
+          "Integrity verification of lock bucket failed: Hashes are not equal");
+    } else {
+      print_error("Lock table partition is full");
+    }
+    return REQUEST_DENIED;
+  }
+
+  // A new owner must not overtake the requests waiting for the lock, only an
+  // owner upgrading it may
+  bool conflicts = !isGrantable(lock, transactionId, isExclusive) ||
+                   (lockWaiters_[partition].count(rowId) > 0 &&
+                    !isOwner(lock, transactionId));
+
+  // Only hold the mutex of the transaction's shard while the transaction is
+  // checked and updated, the integrity verification and the signing do not
+  // depend on it
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  sgx_thread_mutex_lock(&shard.mutex);
+  LockRequestResult result = REQUEST_DENIED;
+  if (!conflicts) {
+    if (add_lock_to_transaction(transactionId, rowId, isExclusive, lock,
+                                waiter.job.lock_budget)) {
+      result = REQUEST_GRANTED;
     }
+  } else if (wait_for_lock(waiter, partition, lock)) {
+    result = REQUEST_WAITING;
   } else {
-    // skip the uninitialized lock struct at the beginning
-    sgx_sha256_hash_t *stored_hash =
-        lockTableIntegrityHashes[hash(lockTable_->size, rowId)];
+    print_error("Lock could not be acquired");
+  }
+  sgx_thread_mutex_unlock(&shard.mutex);
+  if (result != REQUEST_GRANTED) {
+    return result;
+  }
+
+  // Write the modified buckets back into untrusted memory and update the
+  // stored hashes. If the new lock exceeded the load factor, a bigger bucket
+  // array is allocated, into which the following operations migrate the locks.
+  resizeIfNeeded(&header, access);
+  commit_partition(partition, header, access);
+
+  sign_lock((sgx_ec256_signature_t *)signature, transactionId, rowId,
+            lock->exclusive, threadId);
+  return REQUEST_GRANTED;
+}
 
-    int entriesToHash = numEntries;
-    // Is the last entry an empty lock and should be ignored in the hash?
-    if (serialized[(numEntries - 1) * sizeOfSerializedLockEntry + 2] == 0) {
-      entriesToHash = numEntries - 1;
+auto wait_for_lock(const LockWaiter &waiter, int partition, Lock *lock)
+    -> bool {
+  int transactionId = waiter.job.transaction_id;
+  if (__atomic_load_n(&arg_enclave.conflict_policy, __ATOMIC_RELAXED) !=
+          WAIT_DIE ||
+      !mayWait(lock, transactionId)) {
+    return false;
+  }
+
+  // The transaction also needs to be older than every waiting request
+  auto &waiters = lockWaiters_[partition];
+  auto queue = waiters.find(waiter.job.row_id);
+  if (queue != waiters.end()) {
+    for (const LockWaiter &other : queue->second) {
+      if ((int)other.job.transaction_id <= transactionId) {
+        return false;
+      }
     }
-    if (!verify_against_stored_hash(serialized, entriesToHash, stored_hash)) {
-      print_error(
-          "Integrity verification of lock bucket failed: Hashes are not equal");
+  }
+
+  HashTable *transactions = get_transaction_shard(transactionId).transactions;
+  auto transaction = (Transaction *)get(transactions, transactionId);
+  if (transaction == nullptr) {
+    if (waiter.job.lock_budget == 0) {
+      print_error("Transaction was not registered");
       return false;
     }
+    transaction = newTransaction(transactionId, waiter.job.lock_budget);
+    set(transactions, transactionId, (void *)transaction);
+  }
+  if (!transaction->growing_phase || transaction->lock_budget < 1) {
+    return false;
   }
 
-  // Update stored hash
-  add_lock_trusted(transaction, rowId, isExclusive, serialized);
-  update_integrity_hash_locktable(serialized, hash(lockTable_->size, rowId),
-                                  numEntries, lockTableIntegrityHashes);
-
-  // Repeat operation in untrusted part
-  addLock(transaction, rowId, isExclusive, lockUntrusted);
+  waiters[waiter.job.row_id].push_back(waiter);
+  transaction->waiting_rows.insert(waiter.job.row_id);
+  return true;
+}
 
-  // Sign the lock
+void sign_lock(sgx_ec256_signature_t *signature, int transactionId, int rowId,
+               bool isExclusive, int threadId) {
   std::string string_to_sign =
       lock_to_string(transactionId, rowId, isExclusive);
 
   sgx_ecdsa_sign((uint8_t *)string_to_sign.c_str(),
                  strnlen(string_to_sign.c_str(), MAX_SIGNATURE_LENGTH),
-                 &ec256_private_key, (sgx_ec256_signature_t *)signature,
-                 contexts[threadId]);
-
-  return true;
+                 &ec256_private_key, signature, contexts[threadId]);
 }
 
-void release_lock(int transactionId, int rowId) {
-  auto transaction = (Transaction *)get(transactionTable_, transactionId);
+void finish_lock_job(const Job &job, sgx_ec256_signature_t *signature) {
+  if (!job.wait_for_result) {
+    return;
+  }
 
-  if (transaction == nullptr) {
+  if (signature == nullptr) {
+    *job.error = true;
+  } else {
+    // Write base64 encoded signature into the return value of the job struct
+    std::string encoded_signature = encode_signature(*signature);
+
+    volatile char *p = job.return_value;
+    size_t signature_size = 89;
+    for (int i = 0; i < signature_size; i++) {
+      *p++ = encoded_signature.c_str()[i];
+    }
+  }
+  finish_job(job.finished);
+}
+
+void answer_waiter(const LockWaiter &waiter, sgx_ec256_signature_t *signature) {
+  if (waiter.ring == nullptr) {
+    finish_lock_job(waiter.job, signature);
+    return;
+  }
+  if (!waiter.job.wait_for_result) {
     return;
   }
 
-  // Get the lock object for the given row ID
-  auto lockUntrusted = (Lock *)get(lockTable_, rowId);
+  RingResponse response = RingResponse();
+  response.tag = waiter.tag;
+  response.error = signature == nullptr;
+  if (signature != nullptr) {
+    std::string encoded_signature = encode_signature(*signature);
+    memcpy(response.signature, encoded_signature.c_str(), kRingSignatureSize);
+  }
+  while (!pushResponse(waiter.ring, response)) {
+    __builtin_ia32_pause();
+  }
+}
 
-  auto [bucket, numEntries] = getBucket(lockTable_, rowId);
-  uint32_t *serialized = locktable_bucket_to_uint32_t(bucket, numEntries);
-  sgx_sha256_hash_t *stored_hash =
-      lockTableIntegrityHashes[hash(lockTable_->size, rowId)];
+void grant_waiters(int partition, const std::vector<int> &rowIds,
+                   int threadId) {
+  auto &waiters = lockWaiters_[partition];
+  LockTablePartition header = lockTable_.partitions[partition];
+  VerifiedLockBucketAccess access(lockTableIntegrityHashes[partition]);
 
-  if (!verify_against_stored_hash(serialized, numEntries, stored_hash)) {
-    print_error("Integrity verification of lock bucket failed during UNLOCK");
+  // The requests are only answered, after the buckets were written back
+  std::vector<std::pair<LockWaiter, bool>> answers;
+  for (int rowId : rowIds) {
+    auto queue = waiters.find(rowId);
+    if (queue == waiters.end()) {
+      continue;
+    }
+
+    // The lock was removed, when its last owner released it
+    Lock *lock = get(&header, rowId, access);
+    if (lock == nullptr && !access.failed()) {
+      Lock emptyLock = Lock();
+      lock = set(&header, rowId, &emptyLock, access);
+    }
+    if (lock == nullptr) {
+      if (!access.failed()) {
+        print_error("Lock table partition is full");
+      }
+      break;
+    }
+
+    std::list<LockWaiter> &requests = queue->second;
+    while (!requests.empty()) {
+      const LockWaiter &waiter = requests.front();
+      int transactionId = waiter.job.transaction_id;
+      bool isExclusive = waiter.job.command == EXCLUSIVE;
+
+      // A request of a transaction, that ended meanwhile, fails right away
+      TransactionTableShard &shard = get_transaction_shard(transactionId);
+      sgx_thread_mutex_lock(&shard.mutex);
+      auto transaction = (Transaction *)get(shard.transactions, transactionId);
+      bool blocked = transaction != nullptr &&
+                     !isGrantable(lock, transactionId, isExclusive);
+      bool granted = transaction != nullptr && !blocked &&
+                     grant_lock(transaction, rowId, isExclusive, lock);
+      if (transaction != nullptr && !blocked) {
+        transaction->waiting_rows.erase(rowId);
+      }
+      sgx_thread_mutex_unlock(&shard.mutex);
+      if (blocked) {
+        break;
+      }
+      answers.emplace_back(waiter, granted);
+      requests.pop_front();
+    }
+
+    if (requests.empty()) {
+      waiters.erase(queue);
+    }
+    if (lock->num_owners == 0) {
+      remove(&header, rowId, access);
+    }
+  }
+
+  if (access.failed()) {
+    print_error("Integrity verification of lock bucket failed while granting");
+    for (auto &[waiter, granted] : answers) {
+      answer_waiter(waiter, nullptr);
+    }
     return;
   }
+  if (!answers.empty()) {
+    resizeIfNeeded(&header, access);
+    commit_partition(partition, header, access);
+  }
+
+  for (auto &[waiter, granted] : answers) {
+    if (!granted) {
+      answer_waiter(waiter, nullptr);
+      continue;
+    }
+    sgx_ec256_signature_t sig;
+    sign_lock(&sig, waiter.job.transaction_id, waiter.job.row_id,
+              waiter.job.command == EXCLUSIVE, threadId);
+    answer_waiter(waiter, &sig);
+  }
+}
+
+auto add_lock_to_transaction(int transactionId, int rowId, bool isExclusive,
+                             Lock *lock, unsigned int lockBudget) -> bool {
+  // Get the transaction for the given transaction ID
+  HashTable *transactions = get_transaction_shard(transactionId).transactions;
+  auto transaction = (Transaction *)get(transactions, transactionId);
+  if (transaction != nullptr) {
+    return grant_lock(transaction, rowId, isExclusive, lock);
+  }
+  if (lockBudget == 0) {
+    print_error("Transaction was not registered");
+    return false;
+  }
+
+  // Register the transaction together with its first lock. Since the mutex of
+  // the shard is held, no other worker thread can register it meanwhile. It is
+  // only kept, if it gets the lock.
+  transaction = newTransaction(transactionId, lockBudget);
+  if (!grant_lock(transaction, rowId, isExclusive, lock)) {
+    freeTransaction(transaction);
+    return false;
+  }
+  set(transactions, transactionId, (void *)transaction);
+  return true;
+}
+
+auto grant_lock(Transaction *transaction, int rowId, bool isExclusive,
+                Lock *lock) -> bool {
+  bool ok;
+
+  // Check if 2PL is violated
+  if (!transaction->growing_phase) {
+    print_error("Cannot acquire more locks according to 2PL");
+    return false;
+  }
 
-  // Update stored hash
-  bool entryWasDeleted =
-      release_lock_trusted(transaction, rowId, serialized, numEntries);
-  if (entryWasDeleted) {
-    numEntries--;
+  if (transaction->lock_budget < 1) {
+    print_error("Lock budget is exhausted");
+    return false;
   }
-  update_integrity_hash_locktable(serialized, hash(lockTable_->size, rowId),
-                                  numEntries, lockTableIntegrityHashes);
 
-  // Repeat operation in untrusted memory
-  releaseLock(transaction, rowId, lockTable_);
+  // Check for upgrade request
+  if (hasLock(transaction, rowId)) {
+    ok = isExclusive && !lock->exclusive &&
+         upgrade(lock, transaction->transaction_id);
+  } else {
+    ok = addLock(transaction, rowId, isExclusive, lock);
+  }
+  if (!ok) {
+    print_error("Lock could not be acquired");
+  }
+  return ok;
+}
 
-  // If the transaction released its last lock,
+auto release_lock(int transactionId, int rowId, int threadId) -> bool {
+  int partition = getPartition(&lockTable_, rowId);
+  EpochGuard epoch(reclamation_, reclamationRings_ != nullptr
+                                     ? &reclamationRings_[partition]
+                                     : nullptr);
+  if (!rehash_partition(partition)) {
+    return false;
+  }
+
+  // Find the lock on verified copies of the buckets
+  LockTablePartition header = lockTable_.partitions[partition];
+  VerifiedLockBucketAccess access(lockTableIntegrityHashes[partition]);
+  Lock *lock = get(&header, rowId, access);
+  if (access.failed()) {
+    print_error("Integrity verification of lock bucket failed during UNLOCK");
+    return false;
+  }
+
+  TransactionTableShard &shard = get_transaction_shard(transactionId);
+  sgx_thread_mutex_lock(&shard.mutex);
+  auto transaction = (Transaction *)get(shard.transactions, transactionId);
+  bool released =
+      transaction != nullptr && releaseLock(transaction, rowId, lock);
+
+  // If the transaction released its last lock and waits for no other one,
   // delete it
-  if (transaction->num_locked == 0) {
-    remove(transactionTable_, transactionId);
+  if (transaction != nullptr && transaction->num_locked == 0 &&
+      transaction->waiting_rows.empty()) {
+    remove(shard.transactions, transactionId);
+    freeTransaction(transaction);
   }
-}
\ No newline at end of file
+  sgx_thread_mutex_unlock(&shard.mutex);
+
+  if (released && lock != nullptr) {
+    if (lock->num_owners == 0) {
+      // Remove the unowned lock, which also resets the overflow counters of
+      // the buckets in front of it
+      remove(&header, rowId, access);
+    }
+
+    // Write the modified buckets back into untrusted memory and update the
+    // stored hashes. Shrinks the partition, if only few locks are left.
+    resizeIfNeeded(&header, access);
+    commit_partition(partition, header, access);
+
+    if (lockWaiters_[partition].count(rowId) > 0) {
+      grant_waiters(partition, {rowId}, threadId);
+    }
+  }
+  return released;
+}
+
+auto release_locks(int transactionId, int partition,
+                   const std::vector<int> &rowIds,
+                   const std::vector<int> &waitingRowIds, int threadId)
+    -> bool {
+  EpochGuard epoch(reclamation_, reclamationRings_ != nullptr
+                                     ? &reclamationRings_[partition]
+                                     : nullptr);
+  if (!rehash_partition(partition)) {
+    return false;
+  }
+
+  // All locks are released on the same verified copies of the buckets, so a
+  // bucket holding several of them is verified and hashed only once
+  LockTablePartition header = lockTable_.partitions[partition];
+  VerifiedLockBucketAccess access(lockTableIntegrityHashes[partition]);
+  bool released = true;
+  std::vector<int> waitedFor;  // rows with waiting requests
+
+  // The requests of the transaction stop waiting, which may let the ones
+  // behind them go ahead
+  auto &waiters = lockWaiters_[partition];
+  for (int rowId : waitingRowIds) {
+    auto queue = waiters.find(rowId);
+    if (queue == waiters.end()) {
+      continue;
+    }
+    std::list<LockWaiter> &requests = queue->second;
+    auto waiter = requests.begin();
+    while (waiter != requests.end()) {
+      if ((int)waiter->job.transaction_id != transactionId) {
+        waiter++;
+        continue;
+      }
+      answer_waiter(*waiter, nullptr);
+      waiter = requests.erase(waiter);
+    }
+    if (requests.empty()) {
+      waiters.erase(queue);
+    } else {
+      waitedFor.push_back(rowId);
+    }
+  }
+
+  for (int rowId : rowIds) {
+    if (lockWaiters_[partition].count(rowId) > 0) {
+      waitedFor.push_back(rowId);
+    }
+    Lock *lock = get(&header, rowId, access);
+    if (lock == nullptr) {
+      released = false;
+      if (access.failed()) {
+        break;
+      }
+      continue;
+    }
+    release(lock, transactionId);
+    if (lock->num_owners == 0) {
+      remove(&header, rowId, access);
+    }
+  }
+  if (access.failed()) {
+    print_error("Integrity verification of lock bucket failed during RELEASE");
+    return false;
+  }
+
+  resizeIfNeeded(&header, access);
+  commit_partition(partition, header, access);
+
+  if (!waitedFor.empty()) {
+    // A row, whose lock the transaction waits to upgrade, may be listed twice
+    std::sort(waitedFor.begin(), waitedFor.end());
+    waitedFor.erase(std::unique(waitedFor.begin(), waitedFor.end()),
+                    waitedFor.end());
+    grant_waiters(partition, waitedFor, threadId);
+  }
+  return released;
+}
+
+void execute_release(ReleaseGroup *group, int threadId) {
+  TransactionRelease *release = group->release;
+  int transactionId = release->transaction->transaction_id;
+  bool released = true;
+  for (auto &[partition, rowIds] : group->row_ids) {
+    if (!release_locks(transactionId, partition, rowIds,
+                       group->waiting_row_ids[partition], threadId)) {
+      released = false;
+    }
+    finishRequest(partitionMap_, partition);
+  }
+  delete group;
+
+  if (!released) {
+    __atomic_store_n(&release->failed, true, __ATOMIC_RELAXED);
+  }
+  // The last RELEASE job of the transaction sees the results of the others
+  if (__atomic_sub_fetch(&release->pending_jobs, 1, __ATOMIC_ACQ_REL) > 0) {
+    return;
+  }
+
+  Transaction *transaction = release->transaction;
+  freeTransaction(transaction);
+  if (release->job.wait_for_result) {
+    if (release->failed) {
+      *release->job.error = true;
+    }
+    finish_job(release->job.finished);
+  }
+  delete release;
+}
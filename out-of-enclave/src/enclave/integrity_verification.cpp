@@ -1,32 +1,140 @@
 #include "integrity_verification.h"
 
-const int maxEntriesPerLocktableBucket = 70;
-int sizeOfSerializedLockEntry =
-    3 +  // lock.key, lock.exclusive, lock.num_owners (compare lock struct)
-    kTransactionBudget;  // owners of the lock can be at most kTransactionBudget
-const int serializedLockBucketSize = 70 * sizeOfSerializedLockEntry;
-uint32_t *serializedLockBucket = new uint32_t[serializedLockBucketSize];
-
-auto hash_locktable_bucket(uint32_t *bucket, int numEntries)
-    -> sgx_sha256_hash_t * {
-  if (numEntries == 0) {
-    return nullptr;
+#include <algorithm>
+
+IntegrityOptions integrityOptions = {HASH_LIST, 0, 0, FULL_HASH, 0};
+
+// Key of the AES-CMAC bucket digests
+sgx_cmac_128bit_key_t bucketDigestKey;
+
+auto set_integrity_options(IntegrityOptions options) -> bool {
+  integrityOptions = options;
+  return sgx_read_rand((unsigned char *)bucketDigestKey,
+                       sizeof(bucketDigestKey)) == SGX_SUCCESS;
+}
+
+auto bucket_digest_size() -> int {
+  int size = integrityOptions.digest == FULL_HASH
+                 ? sizeof(sgx_sha256_hash_t)
+                 : sizeof(sgx_cmac_128bit_tag_t);
+  if (integrityOptions.digest_size > 0 && integrityOptions.digest_size < size) {
+    size = integrityOptions.digest_size;
+  }
+  return size;
+}
+
+/**
+ * Zeroes the bytes of the digest that are not kept. Truncating XORed tags gives
+ * the XOR of the truncated tags, so incremental updates keep working on
+ * truncated digests.
+ */
+void truncate_bucket_digest(MerkleNode &digest) {
+  int size = bucket_digest_size();
+  memset(digest.hash + size, 0, sizeof(digest.hash) - size);
+}
+
+/**
+ * XORs the tag over the given data into the digest.
+ */
+void xor_bucket_digest_tag(MerkleNode &digest, uint32_t *data, int count) {
+  sgx_cmac_128bit_tag_t tag;
+  sgx_rijndael128_cmac_msg(&bucketDigestKey, (uint8_t *)data,
+                           count * sizeof(uint32_t), &tag);
+  for (int i = 0; i < sizeof(tag); i++) {
+    digest.hash[i] ^= tag[i];
+  }
+}
+
+/**
+ * XORs the tag of the bucket header into the digest, unless the header is the
+ * one of an empty bucket that was never probed past. The header takes the
+ * position after the last slot, so its tag never covers the same input as the
+ * tag of a slot.
+ */
+void xor_bucket_header_tag(MerkleNode &digest, LockBucket *bucket) {
+  if (bucket->occupied == 0 && bucket->overflow == 0) {
+    return;
   }
-  sgx_sha256_hash_t *p_hash =
-      (sgx_sha256_hash_t *)malloc(sizeof(sgx_sha256_hash_t));
-  // because the bucket contains "numEntries" entries of size
-  // "sizeOfSerializedLockEntry", but is of type uint32_t, which is 4x the size
-  // of uint8_t
-  uint32_t src_len = numEntries * sizeOfSerializedLockEntry * 4;
-  sgx_status_t ret = sgx_sha256_msg((uint8_t *)bucket, src_len, p_hash);
-  return p_hash;
+  uint32_t header[] = {(uint32_t)kLockTableSlotsPerBucket, bucket->occupied,
+                       (uint32_t)bucket->overflow};
+  xor_bucket_digest_tag(digest, header, 3);
 }
 
-void update_integrity_hash_locktable(
-    uint32_t *bucket, int key, int numEntries,
-    std::vector<sgx_sha256_hash_t *> &lockTableIntegrityHashes) {
-  free(lockTableIntegrityHashes[key]);
-  lockTableIntegrityHashes[key] = hash_locktable_bucket(bucket, numEntries);
+/**
+ * XORs the tag of the given slot of a serialized bucket into the digest. The
+ * position of the slot precedes the serialized lock as part of the tag.
+ */
+void xor_bucket_slot_tag(MerkleNode &digest, uint32_t *serialized, int slot) {
+  uint32_t entry[1 + sizeOfSerializedLockEntry];
+  entry[0] = slot;
+  memcpy(entry + 1, serialized + 2 + slot * sizeOfSerializedLockEntry,
+         sizeof(uint32_t) * sizeOfSerializedLockEntry);
+  xor_bucket_digest_tag(digest, entry, 1 + sizeOfSerializedLockEntry);
+}
+
+void digest_locktable_bucket(LockBucket *bucket, MerkleNode &digest) {
+  digest = MerkleNode();
+  if (bucket->occupied == 0 && bucket->overflow == 0) {
+    return;  // empty bucket that has never been probed past
+  }
+
+  uint32_t serialized[sizeOfSerializedLockBucket];
+  locktable_bucket_to_uint32_t(bucket, serialized);
+  switch (integrityOptions.digest) {
+    case FULL_HASH:
+      sgx_sha256_msg((uint8_t *)serialized, sizeof(serialized),
+                     (sgx_sha256_hash_t *)digest.hash);
+      break;
+    case FULL_CMAC:
+      sgx_rijndael128_cmac_msg(&bucketDigestKey, (uint8_t *)serialized,
+                               sizeof(serialized),
+                               (sgx_cmac_128bit_tag_t *)digest.hash);
+      break;
+    case INCREMENTAL_HASH:
+      xor_bucket_header_tag(digest, bucket);
+      for (int i = 0; i < kLockTableSlotsPerBucket; i++) {
+        if (bucket->occupied & (1u << i)) {
+          xor_bucket_slot_tag(digest, serialized, i);
+        }
+      }
+      break;
+  }
+
+  truncate_bucket_digest(digest);
+}
+
+void update_locktable_bucket_digest(MerkleNode &digest, LockBucket &original,
+                                    LockBucket &modified) {
+  if (integrityOptions.digest != INCREMENTAL_HASH) {
+    digest_locktable_bucket(&modified, digest);
+    return;
+  }
+
+  if (original.occupied != modified.occupied ||
+      original.overflow != modified.overflow) {
+    xor_bucket_header_tag(digest, &original);
+    xor_bucket_header_tag(digest, &modified);
+  }
+
+  // Serialized slots are equal, when the locks in them are
+  uint32_t serializedOriginal[sizeOfSerializedLockBucket];
+  uint32_t serializedModified[sizeOfSerializedLockBucket];
+  locktable_bucket_to_uint32_t(&original, serializedOriginal);
+  locktable_bucket_to_uint32_t(&modified, serializedModified);
+  for (int i = 0; i < kLockTableSlotsPerBucket; i++) {
+    int offset = 2 + i * sizeOfSerializedLockEntry;
+    if (memcmp(serializedOriginal + offset, serializedModified + offset,
+               sizeof(uint32_t) * sizeOfSerializedLockEntry) == 0) {
+      continue;
+    }
+    if (original.occupied & (1u << i)) {
+      xor_bucket_slot_tag(digest, serializedOriginal, i);
+    }
+    if (modified.occupied & (1u << i)) {
+      xor_bucket_slot_tag(digest, serializedModified, i);
+    }
+  }
+  truncate_bucket_digest(digest);
 }
 
 void transactiontable_entry_to_uint8_t(Entry *&entry, uint8_t *&result) {
@@ -62,142 +170,330 @@ void transactiontable_entry_to_uint8_t(Entry *&entry, uint8_t *&result) {
   }
 }
 
-auto locktable_bucket_to_uint32_t(Entry *&bucket, int numEntries)
+auto locktable_bucket_to_uint32_t(LockBucket *bucket, uint32_t *serialized)
     -> uint32_t * {
-  Entry *entry = bucket;
-  Lock *lock;
-  int num_owners;
-
-  for (int i = 0; i < numEntries; i++) {
-    lock = (Lock *)(entry->value);
-    num_owners = lock->num_owners;
-    serializedLockBucket[i * sizeOfSerializedLockEntry] = entry->key;
-    serializedLockBucket[i * sizeOfSerializedLockEntry + 1] = lock->exclusive;
-    serializedLockBucket[i * sizeOfSerializedLockEntry + 2] = num_owners;
+  serialized[0] = bucket->occupied;
+  serialized[1] = bucket->overflow;
+
+  for (int i = 0; i < kLockTableSlotsPerBucket; i++) {
+    uint32_t *entry = serialized + 2 + i * sizeOfSerializedLockEntry;
+    if (!(bucket->occupied & (1u << i))) {
+      for (int j = 0; j < sizeOfSerializedLockEntry; j++) {
+        entry[j] = 0;
+      }
+      continue;
+    }
+
+    Lock *lock = &bucket->locks[i];
+    int num_owners = lock->num_owners;
+    entry[0] = bucket->keys[i];
+    entry[1] = lock->exclusive;
+    entry[2] = num_owners;
     for (int j = 0; j < kTransactionBudget; j++) {
       if (j < num_owners)
-        serializedLockBucket[i * sizeOfSerializedLockEntry + 3 + j] =
-            lock->owners[j];
+        entry[3 + j] = lock->owners[j];
       else
-        serializedLockBucket[i * sizeOfSerializedLockEntry + 3 + j] = 0;
+        entry[3 + j] = 0;
+    }
+  }
+
+  return serialized;
+}
+
+HashListLockBucketHashes::HashListLockBucketHashes(int size)
+    : digestSize_(bucket_digest_size()), digests_(size * digestSize_, 0) {}
+
+auto HashListLockBucketHashes::size() -> int {
+  return digests_.size() / digestSize_;
+}
+
+auto HashListLockBucketHashes::verify(LockBucket *buckets, int index,
+                                      LockBucket &trusted, MerkleNode &digest)
+    -> bool {
+  trusted = buckets[index];
+  digest_locktable_bucket(&trusted, digest);
+  return std::memcmp(digest.hash, &digests_[index * digestSize_],
+                     digestSize_) == 0;
+}
+
+auto HashListLockBucketHashes::update(LockBucket *buckets, int index,
+                                      LockBucket &original, MerkleNode &digest,
+                                      LockBucket &trusted) -> bool {
+  MerkleNode updated = digest;
+  update_locktable_bucket_digest(updated, original, trusted);
+  std::memcpy(&digests_[index * digestSize_], updated.hash, digestSize_);
+
+  buckets[index] = trusted;
+  return true;
+}
+
+auto HashListLockBucketHashes::trusted_memory() -> size_t {
+  return sizeof(HashListLockBucketHashes) + digests_.capacity();
+}
+
+/**
+ * Computes an inner node of a Merkle tree from its children, which is all zeros
+ * when all of its children are.
+ */
+void hash_merkle_children(MerkleNode *children, int count, MerkleNode &node) {
+  bool empty = true;
+  for (int i = 0; i < count && empty; i++) {
+    for (unsigned char byte : children[i].hash) {
+      empty = empty && byte == 0;
     }
+  }
+  if (empty) {
+    node = MerkleNode();
+    return;
+  }
+  sgx_sha256_msg((uint8_t *)children, sizeof(MerkleNode) * count,
+                 (sgx_sha256_hash_t *)node.hash);
+}
 
-    entry = entry->next;
+MerkleLockBucketHashes::MerkleLockBucketHashes(int size, int arity,
+                                               int cacheSize)
+    : arity_(std::max(arity, 2)), untrusted_(nullptr) {
+  levelSizes_.push_back(size);
+  while (levelSizes_.back() > 1) {
+    levelSizes_.push_back((levelSizes_.back() + arity_ - 1) / arity_);
   }
 
-  return serializedLockBucket;
+  // Keep as many levels inside the enclave as fit into the cache, starting
+  // with the root, which is always kept
+  int numCached = 0;
+  firstCachedLevel_ = levelSizes_.size();
+  while (firstCachedLevel_ > 0 &&
+         (firstCachedLevel_ == levelSizes_.size() ||
+          numCached + levelSizes_[firstCachedLevel_ - 1] <= cacheSize)) {
+    firstCachedLevel_--;
+    numCached += levelSizes_[firstCachedLevel_];
+  }
+  cached_.resize(numCached);
+
+  int numUntrusted = 0;
+  for (int level = 0; level < firstCachedLevel_; level++) {
+    numUntrusted += levelSizes_[level];
+  }
+  if (numUntrusted > 0) {
+    MerkleNode *nodes = nullptr;
+    sgx_status_t ret = ocall_allocate_merkle_nodes(&nodes, numUntrusted);
+    if (ret == SGX_SUCCESS && nodes != nullptr &&
+        sgx_is_outside_enclave(nodes, sizeof(MerkleNode) * numUntrusted)) {
+      untrusted_ = nodes;
+    }
+  }
+}
+
+MerkleLockBucketHashes::~MerkleLockBucketHashes() {
+  if (untrusted_ != nullptr) {
+    ocall_free_merkle_nodes(untrusted_);
+  }
+}
+
+auto MerkleLockBucketHashes::allocated() -> bool {
+  return firstCachedLevel_ == 0 || untrusted_ != nullptr;
+}
+
+auto MerkleLockBucketHashes::size() -> int { return levelSizes_[0]; }
+
+void MerkleLockBucketHashes::read_path(int index,
+                                       std::vector<MerkleNode> &path) {
+  path.clear();
+  MerkleNode *level = untrusted_;
+  for (int l = 0; l < firstCachedLevel_; l++) {
+    int first = index / arity_ * arity_;
+    int count = std::min(arity_, levelSizes_[l] - first);
+    path.insert(path.end(), level + first, level + first + count);
+    level += levelSizes_[l];
+    index /= arity_;
+  }
+}
+
+auto MerkleLockBucketHashes::hash_path(int index, MerkleNode &leaf,
+                                       std::vector<MerkleNode> &path)
+    -> MerkleNode {
+  MerkleNode node = leaf;
+  MerkleNode *children = path.data();
+  for (int l = 0; l < firstCachedLevel_; l++) {
+    int first = index / arity_ * arity_;
+    int count = std::min(arity_, levelSizes_[l] - first);
+    children[index - first] = node;
+    hash_merkle_children(children, count, node);
+    children += count;
+    index /= arity_;
+  }
+  return node;
+}
+
+auto MerkleLockBucketHashes::cached_node(int index) -> MerkleNode & {
+  for (int l = 0; l < firstCachedLevel_; l++) {
+    index /= arity_;
+  }
+  return cached_[index];
+}
+
+auto MerkleLockBucketHashes::verify(LockBucket *buckets, int index,
+                                    LockBucket &trusted, MerkleNode &digest)
+    -> bool {
+  trusted = buckets[index];
+
+  digest_locktable_bucket(&trusted, digest);
+  std::vector<MerkleNode> path;
+  read_path(index, path);
+  MerkleNode node = hash_path(index, digest, path);
+  return std::memcmp(&node, &cached_node(index), sizeof(MerkleNode)) == 0;
 }
 
-auto add_lock_trusted(Transaction *transaction, int rowId, bool isExclusive,
-                      uint32_t *bucket) -> bool {
-  if (transaction->aborted) {
+auto MerkleLockBucketHashes::update(LockBucket *buckets, int index,
+                                    LockBucket &original, MerkleNode &digest,
+                                    LockBucket &trusted) -> bool {
+  // The siblings on the path might have been altered since the bucket was
+  // loaded, so they are verified again together with the original bucket
+  // before the new nodes are computed from them
+  MerkleNode leaf = digest;
+  std::vector<MerkleNode> path;
+  read_path(index, path);
+  MerkleNode node = hash_path(index, leaf, path);
+  if (std::memcmp(&node, &cached_node(index), sizeof(MerkleNode)) != 0) {
     return false;
   }
 
-  bool ret;
+  update_locktable_bucket_digest(leaf, original, trusted);
+  cached_node(index) = hash_path(index, leaf, path);
 
-  // Find the lock inside the serialized bucket
-  int i = 0;  // start index of the serialized lock entry
-  while (bucket[i] != rowId &&
-         i < serializedLockBucketSize - sizeOfSerializedLockEntry) {
-    // RID of the lock is at the beginning of each serialized lock entry
-    i += sizeOfSerializedLockEntry;
+  // Write the nodes on the path back into the untrusted levels
+  MerkleNode *level = untrusted_;
+  MerkleNode *children = path.data();
+  int position = index;
+  for (int l = 0; l < firstCachedLevel_; l++) {
+    int first = position / arity_ * arity_;
+    int count = std::min(arity_, levelSizes_[l] - first);
+    level[position] = children[position - first];
+    children += count;
+    level += levelSizes_[l];
+    position /= arity_;
   }
 
-  //  Get exclusive access on the lock
-  if (isExclusive) {
-    int numOwners = bucket[i + 2];
-    if (numOwners == 0) {
-      bucket[i + 1] = true;                         // set lock exclusive
-      bucket[i + 2] = 1;                            // set num_owners
-      bucket[i + 3] = transaction->transaction_id;  // set owner
-      ret = true;
-    } else {
-      ret = false;
-    }
-    //  Get shared access on the lock
-  } else {
-    bool lockExclusive = bucket[i + 1];
-    if (!lockExclusive) {
-      bucket[i + 2]++;  // increment num_owners
-      int numOwners = bucket[i + 2];
-      bucket[i + 2 + numOwners] = transaction->transaction_id;  // set new owner
-      ret = true;
-    } else {
-      ret = false;
-    }
+  // Recompute the cached levels above the first one
+  MerkleNode *cachedLevel = cached_.data();
+  for (int l = firstCachedLevel_; l + 1 < levelSizes_.size(); l++) {
+    int first = position / arity_ * arity_;
+    int count = std::min(arity_, levelSizes_[l] - first);
+    MerkleNode *parentLevel = cachedLevel + levelSizes_[l];
+    hash_merkle_children(cachedLevel + first, count,
+                         parentLevel[position / arity_]);
+    cachedLevel = parentLevel;
+    position /= arity_;
   }
 
-  return ret;
+  buckets[index] = trusted;
+  return true;
 }
 
-auto release_lock_trusted(Transaction *transaction, int rowId, uint32_t *bucket,
-                          int numEntries) -> bool {
-  bool wasOwner = false;
-  for (int i = 0; i < transaction->num_locked; i++) {
-    if (transaction->locked_rows[i] == rowId) {
-      wasOwner = true;
-      break;
-    }
+auto MerkleLockBucketHashes::trusted_memory() -> size_t {
+  return sizeof(MerkleLockBucketHashes) +
+         levelSizes_.capacity() * sizeof(int) +
+         cached_.capacity() * sizeof(MerkleNode);
+}
+
+auto newLockBucketHashes(int size) -> LockBucketHashes * {
+  if (integrityOptions.scheme != MERKLE_TREE) {
+    return new HashListLockBucketHashes(size);
   }
 
-  if (wasOwner) {
-    int transactionId = transaction->transaction_id;
-    // Find the lock inside the serialized bucket
-    int i = 0;  // start index of the serialized lock entry
-    while (bucket[i] != rowId &&
-           i < serializedLockBucketSize - sizeOfSerializedLockEntry) {
-      // RID of the lock is at the beginning of each serialized lock entry
-      i += sizeOfSerializedLockEntry;
-    }
+  auto hashes = new MerkleLockBucketHashes(
+      size, integrityOptions.merkle_arity, integrityOptions.merkle_cache_size);
+  if (!hashes->allocated()) {
+    print_error("Could not allocate Merkle tree");
+    delete hashes;
+    return nullptr;
+  }
+  return hashes;
+}
 
-    int numOwners = bucket[i + 2];
-    for (int j = 0; j < numOwners; j++) {
-      if (bucket[i + 3 + j] == transactionId) {
-        // Lock is owned by the given transaction
-        for (int k = j; k < numOwners - 1; k++) {
-          bucket[i + 3 + k] = bucket[i + 3 + k + 1];
-        }
-        bucket[i + 3 + numOwners - 1] = 0;
-        bucket[i + 1] = false;  // not exclusive anymore
-        bucket[i + 2]--;        // decrement num_owners
-        break;
-      }
-    }
+VerifiedLockBucketAccess::VerifiedLockBucketAccess(
+    LockTableIntegrityHashes &integrityHashes)
+    : integrityHashes_(integrityHashes) {}
 
-    if (bucket[i + 2] == 0) {  // unowned lock
-      // Remove the lock
-      for (int j = i; j < sizeOfSerializedLockEntry * (numEntries - 1); j++) {
-        bucket[i + j] = bucket[i + j + sizeOfSerializedLockEntry];
-      }
-      for (int j = 0; j < sizeOfSerializedLockEntry; j++) {
-        bucket[sizeOfSerializedLockEntry * (numEntries - 1) + j] = 0;
-      }
-      return true;
+auto VerifiedLockBucketAccess::load(LockBucket *buckets, int index)
+    -> LockBucket * {
+  for (LoadedBucket &bucket : loaded_) {
+    if (bucket.buckets == buckets && bucket.index == index) {
+      return &bucket.trusted;
     }
   }
-  return false;
+
+  // Only bucket arrays the enclave allocated itself have integrity hashes
+  auto hashes = integrityHashes_.find(buckets);
+  if (hashes == integrityHashes_.end() || index < 0 ||
+      index >= hashes->second->size()) {
+    failed_ = true;
+    return nullptr;
+  }
+
+  loaded_.push_back(
+      LoadedBucket{buckets, index, LockBucket(), MerkleNode(), LockBucket()});
+  LoadedBucket &bucket = loaded_.back();
+  if (!hashes->second->verify(buckets, index, bucket.original,
+                              bucket.digest)) {
+    loaded_.pop_back();
+    failed_ = true;
+    return nullptr;
+  }
+  bucket.trusted = bucket.original;
+  return &bucket.trusted;
+}
+
+auto VerifiedLockBucketAccess::allocate(int size) -> LockBucket * {
+  LockBucket *buckets = nullptr;
+  sgx_status_t ret = ocall_allocate_lock_buckets(&buckets, size);
+  if (ret != SGX_SUCCESS || buckets == nullptr ||
+      !sgx_is_outside_enclave(buckets, sizeof(LockBucket) * size)) {
+    print_error("Could not allocate lock table buckets");
+    return nullptr;
+  }
+
+  // A new array consists of empty buckets only
+  LockBucketHashes *hashes = newLockBucketHashes(size);
+  if (hashes == nullptr) {
+    ocall_retire_lock_buckets(buckets, size);
+    return nullptr;
+  }
+  integrityHashes_[buckets].reset(hashes);
+  return buckets;
 }
 
-auto verify_against_stored_hash(uint32_t *serialized, int numEntries,
-                                sgx_sha256_hash_t *stored_hash) -> bool {
-  sgx_sha256_hash_t *p_hash = hash_locktable_bucket(serialized, numEntries);
+void VerifiedLockBucketAccess::release(LockBucket *buckets, int size) {
+  released_.push_back(RetiredBuckets{buckets, size});
+}
 
-  bool equal = true;
-  // If both are nullptr, they are equal
-  if (!(p_hash == nullptr && stored_hash == nullptr)) {
-    if (p_hash == nullptr || stored_hash == nullptr) {
-      equal = false;  // if only one is nullptr they are unequal
-    } else {          // none is nullptr: compare values
-      for (int i = 0; i < SGX_SHA256_HASH_SIZE; i++) {
-        auto a = (*p_hash)[i];
-        auto b = (*stored_hash)[i];
-        if (a != b) {
-          equal = false;
-        }
-      }
+auto VerifiedLockBucketAccess::failed() -> bool { return failed_; }
+
+void VerifiedLockBucketAccess::commit() {
+  for (LoadedBucket &bucket : loaded_) {
+    bool released =
+        std::find_if(released_.begin(), released_.end(),
+                     [&bucket](RetiredBuckets &retired) {
+                       return retired.buckets == bucket.buckets;
+                     }) != released_.end();
+    if (released || std::memcmp(&bucket.original, &bucket.trusted,
+                                sizeof(LockBucket)) == 0) {
+      continue;  // nothing to write back
+    }
+    if (!integrityHashes_[bucket.buckets]->update(bucket.buckets, bucket.index,
+                                                  bucket.original,
+                                                  bucket.digest,
+                                                  bucket.trusted)) {
+      print_error("Integrity verification of lock bucket failed on write back");
     }
   }
-  free(p_hash);
-  return equal;
-}
\ No newline at end of file
+  loaded_.clear();
+
+  for (RetiredBuckets &retired : released_) {
+    integrityHashes_.erase(retired.buckets);
+  }
+}
+
+auto VerifiedLockBucketAccess::released() -> std::vector<RetiredBuckets> & {
+  return released_;
+}
@@ -1,5 +1,7 @@
 #include "hashtable.h"
 
+#include <algorithm>
+
 HashTable* newHashTable(int size) {
   HashTable* hashTable = new HashTable();
   hashTable->size = size;
@@ -11,6 +13,12 @@ HashTable* newHashTable(int size) {
   for (int i = 0; i < size; i++) {
     hashTable->bucketSizes[i] = 0;
   }
+  hashTable->min_size = size;
+  hashTable->num_entries = 0;
+  hashTable->old_size = 0;
+  hashTable->rehash_index = 0;
+  hashTable->old_table = nullptr;
+  hashTable->old_bucket_sizes = nullptr;
   return hashTable;
 };
 
@@ -22,6 +30,14 @@ Entry* newEntry(int key, void* value) {
 }
 
 std::pair<Entry*, int> getBucket(HashTable* table, int key) {
+  // Buckets of the old table that were not migrated yet still hold the key
+  if (isRehashing(table)) {
+    int oldPosition = hash(table->old_size, key);
+    if (oldPosition >= table->rehash_index) {
+      return std::make_pair(table->old_table[oldPosition],
+                            table->old_bucket_sizes[oldPosition]);
+    }
+  }
   int position = hash(table->size, key);
   return std::make_pair(table->table[position], table->bucketSizes[position]);
 }
@@ -30,7 +46,12 @@ int hash(int size, int key) { return key % size; }
 
 auto get(HashTable* hashTable, int key) -> void* {
   Entry* entry = hashTable->table[hash(hashTable->size, key)];
-  return get(entry, key);
+  void* value = get(entry, key);
+  if (value == nullptr && isRehashing(hashTable)) {
+    entry = hashTable->old_table[hash(hashTable->old_size, key)];
+    value = get(entry, key);
+  }
+  return value;
 }
 
 auto get(Entry* entry, int key) -> void* {
@@ -44,6 +65,12 @@ auto get(Entry* entry, int key) -> void* {
 }
 
 void set(HashTable* hashTable, int key, void* value) {
+  rehashStep(hashTable);
+  if (contains(hashTable, key)) {
+    return;  // key already exists
+  }
+
+  // New entries always go into the current table
   int position = hash(hashTable->size, key);
   Entry* entry = hashTable->table[position];
 
@@ -54,20 +81,16 @@ void set(HashTable* hashTable, int key, void* value) {
 
   if (entry == nullptr) {
     hashTable->table[position] = entryToInsert;
-    hashTable->bucketSizes[position]++;
-    return;
-  }
-
-  while (entry->next != nullptr) {
-    if (entry->key == key) {
-      delete entryToInsert;
-      return;  // key already exists
+  } else {
+    while (entry->next != nullptr) {
+      entry = entry->next;
     }
-    entry = entry->next;
+    entry->next = entryToInsert;  // Add new entry at the end of the list
   }
-
-  entry->next = entryToInsert;  // Add new entry at the end of the list
   hashTable->bucketSizes[position]++;
+  hashTable->num_entries++;
+
+  resizeIfNeeded(hashTable);
 }
 
 auto contains(HashTable* hashTable, int key) -> bool {
@@ -80,23 +103,34 @@ auto contains(HashTable* hashTable, int key) -> bool {
     entry = entry->next;
   }
 
+  if (isRehashing(hashTable)) {
+    entry = hashTable->old_table[hash(hashTable->old_size, key)];
+    return get(entry, key) != nullptr;
+  }
+
   return false;
 }
 
-void remove(HashTable* hashTable, int key) {
-  int position = hash(hashTable->size, key);
-  Entry* entry = hashTable->table[position];
+/**
+ * Unlinks the entry with the given key from its bucket and deletes it. The
+ * hashtable only serves as the transaction table of the enclave by now, so its
+ * entries are allocated in protected memory and can be freed right away.
+ *
+ * @returns true, when the key was found
+ */
+auto removeFromBucket(Entry** table, unsigned int* bucketSizes, int position,
+                      int key) -> bool {
+  Entry* entry = table[position];
 
   if (entry == nullptr) {
-    return;
+    return false;
   }
 
   if (entry->key == key) {
-    hashTable->table[position] = entry->next;
-    hashTable->bucketSizes[position]--;
-    // delete entry; We don't want to free the memory here, as deleting
-    // untrusted memory from within the enclave causes an error
-    return;
+    table[position] = entry->next;
+    bucketSizes[position]--;
+    delete entry;
+    return true;
   }
 
   Entry* next = entry->next;
@@ -104,12 +138,91 @@ void remove(HashTable* hashTable, int key) {
     if (next->key == key) {
       // delete it and return
       entry->next = next->next;
-      hashTable->bucketSizes[position]--;
-      // delete next; We don't want to free the memory here, as deleting
-      // untrusted memory from within the enclave causes causes an error
-      return;
+      bucketSizes[position]--;
+      delete next;
+      return true;
     }
     entry = next;
     next = entry->next;
   }
-}
\ No newline at end of file
+  return false;
+}
+
+void remove(HashTable* hashTable, int key) {
+  rehashStep(hashTable);
+
+  bool removed =
+      removeFromBucket(hashTable->table, hashTable->bucketSizes,
+                       hash(hashTable->size, key), key) ||
+      (isRehashing(hashTable) &&
+       removeFromBucket(hashTable->old_table, hashTable->old_bucket_sizes,
+                        hash(hashTable->old_size, key), key));
+  if (removed) {
+    hashTable->num_entries--;
+  }
+  resizeIfNeeded(hashTable);
+}
+
+auto isRehashing(HashTable* hashTable) -> bool {
+  return hashTable->old_table != nullptr;
+}
+
+void rehashStep(HashTable* hashTable) {
+  for (int step = 0; step < kHashTableRehashStep && isRehashing(hashTable);
+       step++) {
+    // Move the entries of the bucket over one by one without reallocating
+    // them, so that pointers to their values stay valid
+    int oldPosition = hashTable->rehash_index;
+    Entry* entry = hashTable->old_table[oldPosition];
+    while (entry != nullptr) {
+      Entry* next = entry->next;
+      int position = hash(hashTable->size, entry->key);
+      entry->next = hashTable->table[position];
+      hashTable->table[position] = entry;
+      hashTable->bucketSizes[position]++;
+      entry = next;
+    }
+    hashTable->old_table[oldPosition] = nullptr;
+    hashTable->old_bucket_sizes[oldPosition] = 0;
+
+    hashTable->rehash_index++;
+    if (hashTable->rehash_index == hashTable->old_size) {
+      delete[] hashTable->old_table;
+      delete[] hashTable->old_bucket_sizes;
+      hashTable->old_table = nullptr;
+      hashTable->old_bucket_sizes = nullptr;
+      hashTable->old_size = 0;
+      hashTable->rehash_index = 0;
+    }
+  }
+}
+
+void resizeIfNeeded(HashTable* hashTable) {
+  if (isRehashing(hashTable)) {
+    return;
+  }
+
+  int newSize;
+  if (hashTable->num_entries > hashTable->size * kHashTableMaxLoadFactor) {
+    newSize = hashTable->size * 2;
+  } else if (hashTable->size > hashTable->min_size &&
+             hashTable->num_entries <
+                 hashTable->size * kHashTableMinLoadFactor) {
+    newSize = std::max(hashTable->size / 2, hashTable->min_size);
+  } else {
+    return;
+  }
+
+  hashTable->old_table = hashTable->table;
+  hashTable->old_bucket_sizes = hashTable->bucketSizes;
+  hashTable->old_size = hashTable->size;
+  hashTable->rehash_index = 0;
+
+  hashTable->size = newSize;
+  hashTable->table = new Entry*[newSize];
+  hashTable->bucketSizes = new unsigned int[newSize];
+  for (int i = 0; i < newSize; i++) {
+    hashTable->table[i] = nullptr;
+    hashTable->bucketSizes[i] = 0;
+  }
+}
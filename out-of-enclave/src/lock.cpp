@@ -3,13 +3,12 @@
 Lock* newLock() {
   Lock* lock = new Lock();
   lock->exclusive = false;
-  lock->owners = new int[kTransactionBudget];
   lock->num_owners = 0;
   return lock;
 }
 
 auto getSharedAccess(Lock* lock, int transactionId) -> bool {
-  if (!lock->exclusive) {
+  if (!lock->exclusive && lock->num_owners < kTransactionBudget) {
     lock->owners[lock->num_owners++] = transactionId;
     return true;
   }
@@ -48,13 +47,40 @@ void release(Lock* lock, int transactionId) {
   }
 }
 
+auto isOwner(Lock* lock, int transactionId) -> bool {
+  for (int i = 0; i < lock->num_owners; i++) {
+    if (lock->owners[i] == transactionId) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto isGrantable(Lock* lock, int transactionId, bool isExclusive) -> bool {
+  if (isOwner(lock, transactionId)) {
+    return !isExclusive || lock->exclusive || lock->num_owners == 1;
+  }
+  if (isExclusive) {
+    return lock->num_owners == 0;
+  }
+  return !lock->exclusive && lock->num_owners < kTransactionBudget;
+}
+
+auto mayWait(Lock* lock, int transactionId) -> bool {
+  for (int i = 0; i < lock->num_owners; i++) {
+    if (lock->owners[i] < transactionId) {
+      return false;
+    }
+  }
+  return true;
+}
+
 auto copy_lock(Lock* lock) -> void* {
   Lock* copy = new Lock();
   copy->exclusive = lock->exclusive;
   int num_owners = lock->num_owners;
   copy->num_owners = num_owners;
 
-  copy->owners = new int[kTransactionBudget];
   for (int i = 0; i < num_owners; i++) {
     copy->owners[i] = lock->owners[i];
   }
@@ -62,7 +88,4 @@ auto copy_lock(Lock* lock) -> void* {
   return (void*)copy;
 }
 
-void free_lock_copy(Lock*& lock) {
-  delete[] lock->owners;
-  delete lock;
-}
\ No newline at end of file
+void free_lock_copy(Lock*& lock) { delete lock; }
\ No newline at end of file
@@ -1,9 +1,16 @@
 #include <lockmanager.h>
 
+// The result of the synchronous job a thread waits for. A thread waits for at
+// most one job at a time, so these never need to be allocated.
+thread_local JobResult callerJobResult;
+
 sgx_enclave_id_t global_eid = 0;
 sgx_launch_token_t token = {0};
+LockBucketPool lockBucketPool;
+LockBucketReclaimer *lockBucketReclaimer = nullptr;
 
-auto LockManager::load_and_initialize_enclave(sgx_enclave_id_t *eid)
+auto LockManager::load_and_initialize_enclave(
+    sgx_enclave_id_t *eid, const SwitchlessOptions &switchless)
     -> sgx_status_t {
   sgx_status_t ret = SGX_SUCCESS;
   int retval = 0;
@@ -13,8 +20,22 @@ auto LockManager::load_and_initialize_enclave(sgx_enclave_id_t *eid)
   if (*eid != 0) sgx_destroy_enclave(*eid);
 
   // Load the enclave
-  ret = sgx_create_enclave(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, &token, &updated,
-                           eid, NULL);
+  if (switchless.enabled) {
+    sgx_uswitchless_config_t config = SGX_USWITCHLESS_CONFIG_INITIALIZER;
+    config.num_uworkers = switchless.numUntrustedWorkers;
+    config.num_tworkers = switchless.numTrustedWorkers;
+    config.retries_before_fallback = switchless.retriesBeforeFallback;
+    config.retries_before_sleep = switchless.retriesBeforeSleep;
+
+    const void *features[32] = {0};
+    features[SGX_CREATE_ENCLAVE_EX_SWITCHLESS_BIT_IDX] = &config;
+    ret = sgx_create_enclave_ex(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, &token,
+                                &updated, eid, NULL,
+                                SGX_CREATE_ENCLAVE_EX_SWITCHLESS, features);
+  } else {
+    ret = sgx_create_enclave(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, &token,
+                             &updated, eid, NULL);
+  }
   if (ret != SGX_SUCCESS) return ret;
 
   // Save the launch token if updated
@@ -34,26 +55,46 @@ auto LockManager::create_worker_thread(void *tmp) -> void * {
   return 0;
 }
 
-void LockManager::configuration_init(int numWorkerThreads) {
-  arg.num_threads =
-      numWorkerThreads + 1;  // one single thread for transaction table
-  arg.tx_thread_id = arg.num_threads - 1;
-  arg.lock_table_size = 10000;
+void LockManager::configuration_init(int numWorkerThreads,
+                                     IntegrityOptions integrity) {
+  // Every thread registers the transactions of its shard of the transaction
+  // table, the additional one owns no lock table partition
+  arg.num_threads = numWorkerThreads + 1;
+  arg.lock_table_size = 10000;  // initial number of buckets, which also is the
+                                // key range split among the worker threads.
+                                // The partitions grow with the locks in them.
   arg.transaction_table_size = 2;
+  arg.integrity = integrity;
+  arg.conflict_policy = NO_WAIT;
 }
 
-LockManager::LockManager(int numWorkerThreads) {
-  configuration_init(numWorkerThreads);
+LockManager::LockManager(int numWorkerThreads, IntegrityOptions integrity,
+                         SwitchlessOptions switchless,
+                         JobSubmission submission) {
+  configuration_init(numWorkerThreads, integrity);
 
   // Load and initialize the signed enclave
-  sgx_status_t ret = load_and_initialize_enclave(&global_eid);
+  sgx_status_t ret = load_and_initialize_enclave(&global_eid, switchless);
   if (ret != SGX_SUCCESS) {
     ret_error_support(ret);
     // TODO: implement error handling
   }
 
-  lockTable = newHashTable(arg.lock_table_size);
-  enclave_init_values(global_eid, arg, lockTable);
+  lockTable = newLockTable(arg.lock_table_size,
+                           (arg.num_threads - 1) * kPartitionsPerWorker);
+  reclamation = newReclamation(lockTable->num_partitions);
+  reclaimer =
+      std::make_unique<LockBucketReclaimer>(reclamation, lockBucketPool);
+  lockBucketReclaimer = reclaimer.get();
+
+  // Preallocate the buckets for the first time every partition grows
+  lockBucketPool.reserve(2 * lockTable->partitions[0].size,
+                         lockTable->num_partitions);
+  if (submission == SUBMIT_BY_REQUEST_RING) {
+    requestRings = newRequestRings(arg.num_threads);
+    requestRingMutexes = std::make_unique<std::mutex[]>(arg.num_threads);
+  }
+  enclave_init_values(global_eid, arg, lockTable, reclamation, requestRings);
 
   // Create worker threads inside the enclave to serve lock requests and
   // registrations of transactions
@@ -90,8 +131,14 @@ LockManager::~LockManager() {
   spdlog::info("Destroying enclave");
   sgx_destroy_enclave(global_eid);
 
-  delete[] lockTable->table;
-  delete lockTable;
+  // All worker threads are gone, so every retired bucket array can be recycled
+  reclaimer->reclaim();
+  lockBucketReclaimer = nullptr;
+  freeReclamation(reclamation);
+  freeLockTable(lockTable);
+  if (requestRings != nullptr) {
+    freeRequestRings(requestRings);
+  }
 }
 
 auto LockManager::registerTransaction(int transactionId, int lockBudget)
@@ -99,25 +146,53 @@ auto LockManager::registerTransaction(int transactionId, int lockBudget)
   return create_enclave_job(REGISTER, transactionId, 0, lockBudget).second;
 };
 
-auto LockManager::lock(int transactionId, int rowId, bool isExclusive,
-                       bool waitForResult) -> std::pair<std::string, bool> {
-  new_lock_mut.lock();
-  if (!contains(lockTable, rowId)) {
-    set(lockTable, rowId, (void *)newLock());
-  }
-  new_lock_mut.unlock();
+void LockManager::setConflictPolicy(LockConflictPolicy conflictPolicy) {
+  enclave_set_conflict_policy(global_eid, conflictPolicy);
+}
 
+auto LockManager::lock(int transactionId, int rowId, bool isExclusive,
+                       bool waitForResult, int lockBudget)
+    -> std::pair<std::string, bool> {
   if (isExclusive) {
-    return create_enclave_job(EXCLUSIVE, transactionId, rowId, 0,
+    return create_enclave_job(EXCLUSIVE, transactionId, rowId, lockBudget,
                               waitForResult);
   }
-  return create_enclave_job(SHARED, transactionId, rowId, 0, waitForResult);
+  return create_enclave_job(SHARED, transactionId, rowId, lockBudget,
+                            waitForResult);
 };
 
 void LockManager::unlock(int transactionId, int rowId, bool waitForResult) {
   create_enclave_job(UNLOCK, transactionId, rowId, 0, waitForResult);
 };
 
+auto LockManager::commit(int transactionId) -> bool {
+  return create_enclave_job(COMMIT, transactionId).second;
+}
+
+auto LockManager::abort(int transactionId) -> bool {
+  return create_enclave_job(ABORT, transactionId).second;
+}
+
+auto LockManager::lockAsync(int transactionId, int rowId, bool isExclusive,
+                            int lockBudget) -> JobFuture {
+  return create_async_enclave_job(isExclusive ? EXCLUSIVE : SHARED,
+                                  transactionId, rowId, lockBudget);
+}
+
+auto LockManager::unlockAsync(int transactionId, int rowId) -> JobFuture {
+  return create_async_enclave_job(UNLOCK, transactionId, rowId, 0);
+}
+
+auto LockManager::getIntegrityMemoryUsage() -> size_t {
+  size_t bytes = 0;
+  get_integrity_memory_usage(global_eid, &bytes);
+  return bytes;
+}
+
+void LockManager::digestBuckets(int numOccupied, int iterations) {
+  digest_locktable_buckets(global_eid, numOccupied, iterations);
+}
+
 auto LockManager::initialize_enclave() -> bool {
   sgx_status_t ret = SGX_ERROR_UNEXPECTED;
   ret = sgx_create_enclave(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, NULL, NULL,
@@ -214,59 +289,196 @@ auto LockManager::create_enclave_job(Command command, int transaction_id,
                                      int row_id, int lock_budget,
                                      bool waitForResult)
     -> std::pair<std::string, bool> {
-  // Set job parameters
   Job job;
+  JobResult *result = waitForResult ? &callerJobResult : nullptr;
+  prepare_enclave_job(job, command, transaction_id, row_id, lock_budget,
+                      result);
+  submit_enclave_job(job, result);
+
+  if (!waitForResult) {
+    return std::make_pair(NO_SIGNATURE, true);
+  }
+
+  // Need to wait until job is finished because we need to be registered for
+  // subsequent requests or because we need to wait for the return value
+  return collect_enclave_job(command, result);
+}
+
+auto LockManager::create_async_enclave_job(Command command, int transaction_id,
+                                           int row_id, int lock_budget)
+    -> JobFuture {
+  // Unlike the result of a synchronous job, it is kept beyond this call
+  auto result = (JobResult *)jobResults.allocate();
+  Job job;
+  prepare_enclave_job(job, command, transaction_id, row_id, lock_budget,
+                      result);
+  submit_enclave_job(job, result);
+  return JobFuture(this, command, result);
+}
+
+void LockManager::submit_enclave_job(Job &job, JobResult *result) {
+  if (requestRings != nullptr) {
+    submit_to_request_ring(job, result);
+  } else {
+    enclave_send_job(global_eid, &job);
+  }
+
+  // Recycle the bucket arrays the enclave handed back in the meantime
+  reclaimer->reclaim();
+}
+
+auto LockManager::submitBatch(const std::vector<BatchedJob> &jobs,
+                              bool waitForResult)
+    -> std::vector<std::pair<std::string, bool>> {
+  std::vector<Job> batch(jobs.size());
+  std::vector<JobResult *> results(jobs.size());
+  for (int i = 0; i < jobs.size(); i++) {
+    // The enclave always reports back on registrations. The results of a batch
+    // come from the pool, since there is more than one per caller.
+    results[i] = waitForResult || jobs[i].command == REGISTER
+                     ? (JobResult *)jobResults.allocate()
+                     : nullptr;
+    prepare_enclave_job(batch[i], jobs[i].command, jobs[i].transactionId,
+                        jobs[i].rowId, jobs[i].lockBudget, results[i]);
+  }
+  if (requestRings != nullptr) {
+    for (int i = 0; i < batch.size(); i++) {
+      submit_to_request_ring(batch[i], results[i]);
+    }
+  } else if (!batch.empty()) {
+    enclave_send_jobs(global_eid, batch.data(), batch.size());
+  }
+
+  // Recycle the bucket arrays the enclave handed back in the meantime
+  reclaimer->reclaim();
+
+  std::vector<std::pair<std::string, bool>> ret;
+  ret.reserve(jobs.size());
+  for (int i = 0; i < jobs.size(); i++) {
+    if (results[i] == nullptr) {
+      ret.emplace_back(NO_SIGNATURE, true);
+    } else {
+      ret.push_back(collect_enclave_job(jobs[i].command, results[i]));
+      jobResults.free(results[i]);
+    }
+  }
+  return ret;
+}
+
+void LockManager::prepare_enclave_job(Job &job, Command command,
+                                      int transaction_id, int row_id,
+                                      int lock_budget, JobResult *result) {
+  // Set job parameters
   job.command = command;
 
   job.transaction_id = transaction_id;
   job.row_id = row_id;
   job.lock_budget = lock_budget;
 
-  // Need to track, when job is finished or error has occurred
-  if (waitForResult) {
-    // Allocate dynamic memory in the untrusted part of the application, so the
-    // enclave can modify it via its pointer
-    job.finished = new bool;
-    job.error = new bool;
-    *job.finished = false;
-    *job.error = false;
+  // Need to track, when job is finished or error has occurred. The enclave
+  // only writes the result, when the caller waits for it. The memory is in the
+  // untrusted part of the application, so the enclave can modify it via its
+  // pointer.
+  if (result != nullptr) {
+    result->finished = JOB_PENDING;
+    result->error = false;
+    result->callback = nullptr;
+    job.finished = &result->finished;
+    job.error = &result->error;
+    job.return_value = result->return_value;
   }
 
-  if (command == SHARED || command == EXCLUSIVE) {
-    // These requests return a signature
-    job.return_value = new char[SIGNATURE_SIZE];
+  job.wait_for_result = result != nullptr;
+}
+
+auto LockManager::collect_enclave_job(Command command, JobResult *result)
+    -> std::pair<std::string, bool> {
+  if (requestRings == nullptr) {
+    waitForCompletion(&result->finished);
+  } else {
+    // Someone needs to hand over the responses, so the callers cannot sleep
+    while (result->finished != JOB_FINISHED) {
+      drain_request_rings();
+      __builtin_ia32_pause();
+    }
   }
 
-  job.wait_for_result = waitForResult;
-  enclave_send_job(global_eid, &job);
+  std::pair<std::string, bool> ret = std::make_pair(NO_SIGNATURE, true);
+  if (result->error) {
+    // Check if an error occured
+    ret.second = false;
+  } else if (command == SHARED || command == EXCLUSIVE) {
+    // Get the signature return value
+    ret.first.resize(SIGNATURE_SIZE);
+    for (int i = 0; i < SIGNATURE_SIZE; i++) {
+      ret.first[i] = result->return_value[i];
+    }
+  }
+  return ret;
+}
 
-  if (waitForResult) {
-    // Need to wait until job is finished because we need to be registered for
-    // subsequent requests or because we need to wait for the return value
-    while (!*job.finished) {
-      continue;
+void LockManager::submit_to_request_ring(const Job &job, JobResult *result) {
+  if (job.command == QUIT || job.command == COMMIT || job.command == ABORT) {
+    if (job.command != QUIT) {
+      fence_request_rings();
     }
-    delete job.finished;
+    Job copy = job;
+    enclave_send_job(global_eid, &copy);
+    return;
+  }
 
-    // Check if an error occured
-    if (*job.error) {
-      return std::make_pair(NO_SIGNATURE, false);
+  // With request rings, the enclave never hands the partitions over
+  int ring = job.command == REGISTER
+                 ? getTransactionShard(job.transaction_id, arg.num_threads)
+                 : getHomeWorker(getPartition(lockTable, job.row_id),
+                                 arg.num_threads - 1);
+  RingRequest request = {job.command,     job.transaction_id, job.row_id,
+                         job.lock_budget, result != nullptr,
+                         (unsigned long)result};
+  RequestRing *target = &requestRings->rings[ring];
+  {
+    std::lock_guard<std::mutex> lock(requestRingMutexes[ring]);
+    while (!pushRequest(target, request)) {
+      // The worker thread might wait for room for its responses
+      drain_responses(ring);
     }
-    delete job.error;
+  }
+  if (needsWakeUp(target)) {
+    enclave_wake_worker(global_eid, ring);
+  }
+}
 
-    // Get the signature return value
-    if (command == SHARED || command == EXCLUSIVE) {
-      std::string signature;
-      for (int i = 0; i < SIGNATURE_SIZE; i++) {
-        signature += job.return_value[i];
-      }
-      delete[] job.return_value;
-
-      return std::make_pair(signature, true);
+void LockManager::drain_request_rings() {
+  for (int i = 0; i < arg.num_threads; i++) {
+    std::unique_lock<std::mutex> lock(requestRingMutexes[i], std::try_to_lock);
+    if (lock.owns_lock()) {
+      drain_responses(i);
     }
   }
+}
+
+void LockManager::fence_request_rings() {
+  for (int i = 0; i < arg.num_threads; i++) {
+    RequestRing *ring = &requestRings->rings[i];
+    unsigned int fence =
+        __atomic_load_n(&ring->request_head, __ATOMIC_ACQUIRE);
+    while (!isProcessedUpTo(ring, fence)) {
+      drain_request_rings();
+      __builtin_ia32_pause();
+    }
+  }
+}
 
-  return std::make_pair(NO_SIGNATURE, true);
+void LockManager::drain_responses(int ring) {
+  RingResponse response;
+  while (popResponse(&requestRings->rings[ring], &response)) {
+    auto result = (JobResult *)response.tag;
+    result->error = response.error != 0;
+    for (int i = 0; i < SIGNATURE_SIZE; i++) {
+      result->return_value[i] = response.signature[i];
+    }
+    completeJob(&result->finished, wakeJob);
+  }
 }
 
 auto LockManager::verify_signature_string(std::string signature,
@@ -282,4 +494,81 @@ auto LockManager::verify_signature_string(std::string signature,
     print_info("Signature successfully verified");
     return true;
   }
-}
\ No newline at end of file
+}
+
+void wakeJob(volatile int *finished) {
+  auto result = (JobResult *)finished;  // the completion word comes first
+  if (result->callback != nullptr) {
+    result->callback(result->callback_arg);
+  } else {
+    wakeCompletion(finished);
+  }
+}
+
+JobFuture::JobFuture(LockManager *lockManager, Command command,
+                     JobResult *result)
+    : lockManager(lockManager), command(command), result(result) {}
+
+JobFuture::JobFuture(JobFuture &&other) noexcept
+    : lockManager(other.lockManager),
+      command(other.command),
+      result(other.result) {
+  other.result = nullptr;
+}
+
+auto JobFuture::operator=(JobFuture &&other) noexcept -> JobFuture & {
+  if (this != &other) {
+    if (result != nullptr) {
+      collect();
+    }
+    lockManager = other.lockManager;
+    command = other.command;
+    result = other.result;
+    other.result = nullptr;
+  }
+  return *this;
+}
+
+JobFuture::~JobFuture() {
+  if (result != nullptr) {
+    collect();
+  }
+}
+
+auto JobFuture::isReady() -> bool {
+  if (result == nullptr) {
+    return false;
+  }
+  if (lockManager->requestRings != nullptr) {
+    lockManager->drain_request_rings();
+  }
+  return __atomic_load_n(&result->finished, __ATOMIC_ACQUIRE) == JOB_FINISHED;
+}
+
+void JobFuture::notifyWhenReady(void (*callback)(void *arg), void *arg) {
+  result->callback = callback;
+  result->callback_arg = arg;
+
+  // Announce the callback like a sleeping caller, unless the job was finished
+  // in the meantime
+  int expected = JOB_PENDING;
+  if (!__atomic_compare_exchange_n(&result->finished, &expected,
+                                   JOB_PENDING_WAITER, false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    callback(arg);
+  }
+}
+
+auto JobFuture::get() -> std::pair<std::string, bool> {
+  if (result == nullptr) {
+    throw std::logic_error("The result of the job was already collected");
+  }
+  return collect();
+}
+
+auto JobFuture::collect() -> std::pair<std::string, bool> {
+  auto ret = lockManager->collect_enclave_job(command, result);
+  lockManager->jobResults.free(result);
+  result = nullptr;
+  return ret;
+}
@@ -10,4 +10,27 @@ void print_error(const char *str) {
 
 void print_warn(const char *str) {
   spdlog::warn("Enclave: " + std::string{str});
-}
\ No newline at end of file
+}
+
+auto ocall_allocate_lock_buckets(int size) -> LockBucket * {
+  if (lockBucketReclaimer != nullptr) {
+    lockBucketReclaimer->reclaim();
+  }
+  return lockBucketPool.allocate(size);
+}
+
+void ocall_retire_lock_buckets(LockBucket *buckets, int size) {
+  if (lockBucketReclaimer != nullptr) {
+    lockBucketReclaimer->retire(buckets, size);
+  } else {
+    lockBucketPool.free(buckets, size);
+  }
+}
+
+void ocall_wake_job(int *finished) { wakeJob(finished); }
+
+auto ocall_allocate_merkle_nodes(int count) -> MerkleNode * {
+  return new MerkleNode[count]();
+}
+
+void ocall_free_merkle_nodes(MerkleNode *nodes) { delete[] nodes; }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "reclaimer.h"
+
+#include <algorithm>
+
+LockBucketReclaimer::LockBucketReclaimer(Reclamation *reclamation,
+                                         LockBucketPool &pool)
+    : reclamation_(reclamation), pool_(pool) {}
+
+void LockBucketReclaimer::retire(LockBucket *buckets, int size) {
+  std::lock_guard<std::mutex> lock(mut_);
+  unsigned long epoch = __atomic_load_n(&reclamation_->epoch, __ATOMIC_RELAXED);
+  retired_.push_back(Retired{buckets, size, epoch});
+  numRetired_ = retired_.size();
+  advance_epoch();
+}
+
+void LockBucketReclaimer::reclaim() {
+  if (!has_work()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mut_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return;
+  }
+
+  // The workers handed the arrays back after their last access, so only
+  // operations that started in the current epoch or before can still read them
+  unsigned long epoch = __atomic_load_n(&reclamation_->epoch, __ATOMIC_RELAXED);
+  bool retiredAny = false;
+  RetiredBuckets retired;
+  for (int i = 0; i < reclamation_->num_rings; i++) {
+    while (popRetired(&reclamation_->rings[i], &retired)) {
+      retired_.push_back(Retired{retired.buckets, retired.size, epoch});
+      retiredAny = true;
+    }
+  }
+  if (retiredAny) {
+    advance_epoch();
+  }
+  if (retired_.empty()) {
+    return;
+  }
+
+  // Recycle all arrays that were retired before the oldest running operation
+  unsigned long oldestEpoch = kIdleEpoch;
+  for (int i = 0; i < reclamation_->num_rings; i++) {
+    oldestEpoch = std::min(
+        oldestEpoch, __atomic_load_n(&reclamation_->rings[i].active_epoch,
+                                     __ATOMIC_ACQUIRE));
+  }
+  auto safe = std::partition(
+      retired_.begin(), retired_.end(),
+      [oldestEpoch](Retired &retired) { return retired.epoch >= oldestEpoch; });
+  for (auto it = safe; it != retired_.end(); it++) {
+    pool_.free(it->buckets, it->size);
+  }
+  retired_.erase(safe, retired_.end());
+  numRetired_ = retired_.size();
+}
+
+auto LockBucketReclaimer::num_retired() -> int { return numRetired_; }
+
+auto LockBucketReclaimer::has_work() -> bool {
+  if (numRetired_ > 0) {
+    return true;
+  }
+  // Only reads the rings, so that the callers do not write to shared cache
+  // lines while there is nothing to do
+  for (int i = 0; i < reclamation_->num_rings; i++) {
+    ReclamationRing *ring = &reclamation_->rings[i];
+    if (__atomic_load_n(&ring->head, __ATOMIC_RELAXED) !=
+        __atomic_load_n(&ring->tail, __ATOMIC_RELAXED)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LockBucketReclaimer::advance_epoch() {
+  __atomic_fetch_add(&reclamation_->epoch, 1, __ATOMIC_RELEASE);
+  // Pairs with the fence of enterEpoch(): either this thread sees the epoch a
+  // worker announced, or the worker sees all bucket arrays retired so far as
+  // no longer in use.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
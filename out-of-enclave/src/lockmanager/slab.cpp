@@ -0,0 +1,108 @@
+#include "slab.h"
+
+#include <atomic>
+#include <cstring>
+
+SlabPool::SlabPool(size_t objectSize, int objectsPerSlab)
+    : objectsPerSlab_(objectsPerSlab) {
+  // Keep every object of a slab suitably aligned for any type
+  size_t alignment = alignof(std::max_align_t);
+  objectSize_ = (objectSize + alignment - 1) / alignment * alignment;
+}
+
+SlabPool::~SlabPool() {
+  for (Shard &shard : shards_) {
+    for (char *slab : shard.slabs) {
+      delete[] slab;
+    }
+  }
+}
+
+auto SlabPool::shard() -> Shard & {
+  static std::atomic<unsigned int> numThreads{0};
+  // Threads are assigned to the shards round robin on their first use of any
+  // pool, so that up to kSlabPoolShards threads never share a shard
+  thread_local unsigned int index = numThreads++ % kSlabPoolShards;
+  return shards_[index];
+}
+
+auto SlabPool::allocate() -> void * {
+  Shard &shard = this->shard();
+  std::lock_guard<std::mutex> lock(shard.mut);
+  if (shard.freeList.empty()) {
+    char *slab = new char[objectSize_ * objectsPerSlab_];
+    shard.slabs.push_back(slab);
+    for (int i = objectsPerSlab_ - 1; i >= 0; i--) {
+      shard.freeList.push_back(slab + i * objectSize_);
+    }
+  }
+
+  void *object = shard.freeList.back();
+  shard.freeList.pop_back();
+  return object;
+}
+
+void SlabPool::free(void *object) {
+  Shard &shard = this->shard();
+  std::lock_guard<std::mutex> lock(shard.mut);
+  shard.freeList.push_back(object);
+}
+
+auto SlabPool::capacity() -> int {
+  int capacity = 0;
+  for (Shard &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mut);
+    capacity += shard.slabs.size() * objectsPerSlab_;
+  }
+  return capacity;
+}
+
+LockBucketPool::~LockBucketPool() {
+  for (auto &[size, freeList] : freeLists_) {
+    for (LockBucket *buckets : freeList) {
+      delete[] buckets;
+    }
+  }
+}
+
+auto LockBucketPool::allocate(int size) -> LockBucket * {
+  {
+    std::lock_guard<std::mutex> lock(mut_);
+    std::vector<LockBucket *> &freeList = freeLists_[size];
+    if (!freeList.empty()) {
+      LockBucket *buckets = freeList.back();
+      freeList.pop_back();
+      std::memset((void *)buckets, 0, sizeof(LockBucket) * size);
+      return buckets;
+    }
+    numAllocated_++;
+  }
+  return new LockBucket[size]();
+}
+
+void LockBucketPool::free(LockBucket *buckets, int size) {
+  {
+    std::lock_guard<std::mutex> lock(mut_);
+    std::vector<LockBucket *> &freeList = freeLists_[size];
+    if (freeList.size() < kLockBucketPoolMaxFreeArrays) {
+      freeList.push_back(buckets);
+      return;
+    }
+  }
+  delete[] buckets;
+}
+
+void LockBucketPool::reserve(int size, int count) {
+  std::lock_guard<std::mutex> lock(mut_);
+  std::vector<LockBucket *> &freeList = freeLists_[size];
+  while (freeList.size() < count &&
+         freeList.size() < kLockBucketPoolMaxFreeArrays) {
+    freeList.push_back(new LockBucket[size]());
+    numAllocated_++;
+  }
+}
+
+auto LockBucketPool::num_allocated() -> int {
+  std::lock_guard<std::mutex> lock(mut_);
+  return numAllocated_;
+}
@@ -0,0 +1,313 @@
+#include "locktable.h"
+
+#include <algorithm>
+
+#include "hashtable.h"
+
+/**
+ * Accesses the buckets in place. Used by the untrusted application, which has
+ * no need to protect the buckets against modifications.
+ */
+class DirectLockBucketAccess : public LockBucketAccess {
+ public:
+  auto load(LockBucket* buckets, int index) -> LockBucket* override {
+    return &buckets[index];
+  }
+
+  auto allocate(int size) -> LockBucket* override {
+    return new LockBucket[size]();
+  }
+
+  void release(LockBucket* buckets, int size) override { delete[] buckets; }
+};
+
+LockTable* newLockTable(int size, int numPartitions) {
+  LockTable* lockTable = new LockTable();
+  lockTable->key_range = size;
+  lockTable->num_partitions = numPartitions;
+  lockTable->partitions = new LockTablePartition[numPartitions]();
+
+  // Every partition starts with an equal share of the buckets
+  int partitionSize = (size + numPartitions - 1) / numPartitions;
+  for (int i = 0; i < numPartitions; i++) {
+    LockTablePartition* partition = &lockTable->partitions[i];
+    partition->size = partitionSize;
+    partition->min_size = partitionSize;
+    partition->buckets = new LockBucket[partitionSize]();
+  }
+  return lockTable;
+}
+
+void freeLockTable(LockTable* lockTable) {
+  for (int i = 0; i < lockTable->num_partitions; i++) {
+    delete[] lockTable->partitions[i].buckets;
+    delete[] lockTable->partitions[i].old_buckets;
+  }
+  delete[] lockTable->partitions;
+  delete lockTable;
+}
+
+auto getPartition(LockTable* lockTable, unsigned int key) -> int {
+  // Same as (key % key_range) / (key_range / num_partitions), but without
+  // floating point rounding issues
+  return (int)((long long)(key % (unsigned int)lockTable->key_range) *
+               lockTable->num_partitions / lockTable->key_range);
+}
+
+auto getHomeBucket(int size, unsigned int key) -> int {
+  return (int)(key % (unsigned int)size);
+}
+
+auto getNextBucket(int size, int index) -> int {
+  return index + 1 == size ? 0 : index + 1;
+}
+
+auto findSlot(LockBucket* bucket, int key) -> int {
+  // Compare all keys of the bucket without branching, so that the compiler can
+  // vectorize the loop, and only consider matches in used slots
+  unsigned int matches = 0;
+  for (int i = 0; i < kLockTableSlotsPerBucket; i++) {
+    matches |= (unsigned int)(bucket->keys[i] == key) << i;
+  }
+  matches &= bucket->occupied;
+  return matches != 0 ? __builtin_ctz(matches) : -1;
+}
+
+auto findFreeSlot(LockBucket* bucket) -> int {
+  for (int i = 0; i < kLockTableSlotsPerBucket; i++) {
+    if (!(bucket->occupied & (1u << i))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+auto claimSlot(LockBucket* bucket, int slot, int key, Lock* lock) -> Lock* {
+  bucket->keys[slot] = key;
+  bucket->locks[slot] = *lock;
+  bucket->occupied |= (1u << slot);
+  return &bucket->locks[slot];
+}
+
+void freeSlot(LockBucket* bucket, int slot) {
+  bucket->occupied &= ~(1u << slot);
+  bucket->keys[slot] = 0;
+  bucket->locks[slot] = Lock();
+}
+
+/**
+ * Searches a single bucket array for the given key.
+ */
+auto findInArray(LockBucket* buckets, int size, int key,
+                 LockBucketAccess& access) -> Lock* {
+  int home = getHomeBucket(size, key);
+  int index = home;
+  do {
+    LockBucket* bucket = access.load(buckets, index);
+    if (bucket == nullptr) {
+      return nullptr;
+    }
+    int slot = findSlot(bucket, key);
+    if (slot != -1) {
+      return &bucket->locks[slot];
+    }
+    if (bucket->overflow == 0) {
+      return nullptr;  // no key probed past this bucket
+    }
+    index = getNextBucket(size, index);
+  } while (index != home);
+  return nullptr;
+}
+
+/**
+ * Inserts a key, which is not in the bucket array yet, into the first bucket on
+ * its probe sequence that has a free slot.
+ */
+auto insertIntoArray(LockBucket* buckets, int size, int key, Lock* lock,
+                     LockBucketAccess& access) -> Lock* {
+  int home = getHomeBucket(size, key);
+  int index = home;
+  do {
+    LockBucket* bucket = access.load(buckets, index);
+    if (bucket == nullptr) {
+      return nullptr;
+    }
+    int slot = findFreeSlot(bucket);
+    if (slot != -1) {
+      // Every full bucket that was skipped gets its overflow incremented, so
+      // that lookups know they have to continue probing past it. Those
+      // buckets were loaded just before, so loading them again cannot fail.
+      for (int i = home; i != index; i = getNextBucket(size, i)) {
+        access.load(buckets, i)->overflow++;
+      }
+      return claimSlot(bucket, slot, key, lock);
+    }
+    index = getNextBucket(size, index);
+  } while (index != home);
+
+  return nullptr;  // bucket array is full
+}
+
+/**
+ * Removes a key from a bucket array.
+ */
+auto eraseFromArray(LockBucket* buckets, int size, int key,
+                    LockBucketAccess& access) -> bool {
+  int home = getHomeBucket(size, key);
+  int index = home;
+  do {
+    LockBucket* bucket = access.load(buckets, index);
+    if (bucket == nullptr) {
+      return false;
+    }
+    int slot = findSlot(bucket, key);
+    if (slot != -1) {
+      freeSlot(bucket, slot);
+      for (int i = home; i != index; i = getNextBucket(size, i)) {
+        access.load(buckets, i)->overflow--;
+      }
+      return true;
+    }
+    if (bucket->overflow == 0) {
+      return false;
+    }
+    index = getNextBucket(size, index);
+  } while (index != home);
+  return false;
+}
+
+auto isRehashing(LockTablePartition* partition) -> bool {
+  return partition->old_buckets != nullptr;
+}
+
+auto get(LockTablePartition* partition, int key, LockBucketAccess& access)
+    -> Lock* {
+  Lock* lock = findInArray(partition->buckets, partition->size, key, access);
+  if (lock == nullptr && isRehashing(partition)) {
+    lock = findInArray(partition->old_buckets, partition->old_size, key,
+                       access);
+  }
+  return lock;
+}
+
+auto set(LockTablePartition* partition, int key, Lock* lock,
+         LockBucketAccess& access) -> Lock* {
+  Lock* existing = get(partition, key, access);
+  if (existing != nullptr) {
+    return existing;  // key already exists
+  }
+
+  // New locks always go into the current bucket array
+  Lock* inserted =
+      insertIntoArray(partition->buckets, partition->size, key, lock, access);
+  if (inserted != nullptr) {
+    partition->num_locks++;
+  }
+  return inserted;
+}
+
+auto remove(LockTablePartition* partition, int key, LockBucketAccess& access)
+    -> bool {
+  bool removed =
+      eraseFromArray(partition->buckets, partition->size, key, access) ||
+      (isRehashing(partition) && eraseFromArray(partition->old_buckets,
+                                                partition->old_size, key,
+                                                access));
+  if (removed) {
+    partition->num_locks--;
+  }
+  return removed;
+}
+
+auto rehashStep(LockTablePartition* partition, LockBucketAccess& access)
+    -> bool {
+  for (int step = 0; step < kLockTableRehashStep && isRehashing(partition);
+       step++) {
+    LockBucket* bucket =
+        access.load(partition->old_buckets, partition->rehash_index);
+    if (bucket == nullptr) {
+      return false;
+    }
+
+    // Move every lock of the bucket into the current array. Removing it from
+    // the old array also resets the overflow counters of the buckets in front
+    // of it, so that the old array stays a valid table until it is empty.
+    while (bucket->occupied != 0) {
+      int slot = __builtin_ctz(bucket->occupied);
+      int key = bucket->keys[slot];
+      Lock lock = bucket->locks[slot];
+      if (insertIntoArray(partition->buckets, partition->size, key, &lock,
+                          access) == nullptr ||
+          !eraseFromArray(partition->old_buckets, partition->old_size, key,
+                          access)) {
+        return false;
+      }
+    }
+
+    partition->rehash_index++;
+    if (partition->rehash_index == partition->old_size) {
+      access.release(partition->old_buckets, partition->old_size);
+      partition->old_buckets = nullptr;
+      partition->old_size = 0;
+      partition->rehash_index = 0;
+    }
+  }
+  return true;
+}
+
+auto resizeIfNeeded(LockTablePartition* partition, LockBucketAccess& access)
+    -> bool {
+  if (isRehashing(partition)) {
+    return false;
+  }
+
+  int numSlots = partition->size * kLockTableSlotsPerBucket;
+  int newSize;
+  if (partition->num_locks > numSlots * kLockTableMaxLoadFactor) {
+    newSize = partition->size * 2;
+  } else if (partition->size > partition->min_size &&
+             partition->num_locks < numSlots * kLockTableMinLoadFactor) {
+    newSize = std::max(partition->size / 2, partition->min_size);
+  } else {
+    return false;
+  }
+
+  LockBucket* buckets = access.allocate(newSize);
+  if (buckets == nullptr) {
+    return false;  // keep on using the current buckets
+  }
+  partition->old_buckets = partition->buckets;
+  partition->old_size = partition->size;
+  partition->rehash_index = 0;
+  partition->buckets = buckets;
+  partition->size = newSize;
+  return true;
+}
+
+auto get(LockTable* lockTable, int key) -> Lock* {
+  DirectLockBucketAccess access;
+  return get(&lockTable->partitions[getPartition(lockTable, key)], key, access);
+}
+
+auto set(LockTable* lockTable, int key, Lock* lock) -> Lock* {
+  DirectLockBucketAccess access;
+  LockTablePartition* partition =
+      &lockTable->partitions[getPartition(lockTable, key)];
+  rehashStep(partition, access);
+  Lock* result = set(partition, key, lock, access);
+  resizeIfNeeded(partition, access);
+  return result;
+}
+
+auto contains(LockTable* lockTable, int key) -> bool {
+  return get(lockTable, key) != nullptr;
+}
+
+void remove(LockTable* lockTable, int key) {
+  DirectLockBucketAccess access;
+  LockTablePartition* partition =
+      &lockTable->partitions[getPartition(lockTable, key)];
+  rehashStep(partition, access);
+  remove(partition, key, access);
+  resizeIfNeeded(partition, access);
+}
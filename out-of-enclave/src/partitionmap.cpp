@@ -0,0 +1,121 @@
+#include "partitionmap.h"
+
+#include <vector>
+
+/**
+ * Checks, if the previous owner of a partition executed all lock requests
+ * dispatched to it before the partition was handed over.
+ *
+ * @param state the state of the partition
+ */
+static auto isHandedOver(PartitionState& state) -> bool {
+  // Pairs with the release in finishRequest(), so that everything the previous
+  // owner wrote to the partition is visible afterwards
+  return __atomic_load_n(&state.executed, __ATOMIC_ACQUIRE) >=
+         __atomic_load_n(&state.handoff, __ATOMIC_RELAXED);
+}
+
+auto getHomeWorker(int partition, int numWorkers) -> int {
+  return partition % numWorkers;
+}
+
+auto newPartitionMap(int numPartitions, int numWorkers, bool rebalancing)
+    -> PartitionMap* {
+  PartitionMap* map = new PartitionMap();
+  map->num_partitions = numPartitions;
+  map->num_workers = numWorkers;
+  map->rebalancing = rebalancing;
+  map->pending_handoff = -1;
+  map->partitions = new PartitionState[numPartitions]();
+  for (int i = 0; i < numPartitions; i++) {
+    map->partitions[i].owner = getHomeWorker(i, numWorkers);
+  }
+  return map;
+}
+
+void freePartitionMap(PartitionMap* map) {
+  delete[] map->partitions;
+  delete map;
+}
+
+auto routeRequest(PartitionMap* map, int partition) -> int {
+  if (map->rebalancing && ++map->requests >= kRebalanceInterval) {
+    map->requests = 0;
+    rebalance(map);
+  }
+
+  PartitionState& state = map->partitions[partition];
+  state.load++;
+  state.dispatched++;
+  return state.owner;
+}
+
+auto rebalance(PartitionMap* map) -> bool {
+  // Wait for the last handoff to complete, so that the new owner of a partition
+  // never waits for a worker thread that itself waits for a partition
+  if (map->pending_handoff >= 0 &&
+      !isHandedOver(map->partitions[map->pending_handoff])) {
+    return false;
+  }
+  map->pending_handoff = -1;
+
+  std::vector<unsigned long> loads(map->num_workers, 0);
+  unsigned long total = 0;
+  for (int i = 0; i < map->num_partitions; i++) {
+    loads[map->partitions[i].owner] += map->partitions[i].load;
+    total += map->partitions[i].load;
+  }
+  int busiest = 0;
+  int idlest = 0;
+  for (int i = 1; i < map->num_workers; i++) {
+    busiest = loads[i] > loads[busiest] ? i : busiest;
+    idlest = loads[i] < loads[idlest] ? i : idlest;
+  }
+
+  // Moving a partition with less load than the difference lowers the maximum.
+  // The best one is closest to half of it, which evens out both worker threads.
+  unsigned long difference = loads[busiest] - loads[idlest];
+  int candidate = -1;
+  unsigned long best = 0;
+  if (difference > kRebalanceImbalance * total / map->num_workers) {
+    for (int i = 0; i < map->num_partitions; i++) {
+      unsigned long load = map->partitions[i].load;
+      if (map->partitions[i].owner != busiest || load == 0 ||
+          load >= difference) {
+        continue;
+      }
+      unsigned long gain = load < difference - load ? load : difference - load;
+      if (gain > best) {
+        best = gain;
+        candidate = i;
+      }
+    }
+  }
+
+  for (int i = 0; i < map->num_partitions; i++) {
+    map->partitions[i].load /= 2;
+  }
+  if (candidate < 0) {
+    return false;
+  }
+
+  // The new owner waits for every request dispatched to the partition so far
+  PartitionState& state = map->partitions[candidate];
+  __atomic_store_n(&state.handoff, state.dispatched, __ATOMIC_RELAXED);
+  __atomic_store_n(&state.owner, idlest, __ATOMIC_RELAXED);
+  map->pending_handoff = candidate;
+  return true;
+}
+
+auto mayExecute(PartitionMap* map, int partition, int worker) -> bool {
+  PartitionState& state = map->partitions[partition];
+  // Only one handoff is in progress at a time, so a worker thread, which is not
+  // the owner, got the request before it handed the partition over
+  return __atomic_load_n(&state.owner, __ATOMIC_RELAXED) != worker ||
+         isHandedOver(state);
+}
+
+void finishRequest(PartitionMap* map, int partition) {
+  PartitionState& state = map->partitions[partition];
+  __atomic_store_n(&state.executed, state.executed + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,71 @@
+#include "reclamation.h"
+
+auto newReclamation(int numRings) -> Reclamation* {
+  Reclamation* reclamation = new Reclamation();
+  reclamation->epoch = 0;
+  reclamation->num_rings = numRings;
+  reclamation->rings = new ReclamationRing[numRings]();
+  for (int i = 0; i < numRings; i++) {
+    reclamation->rings[i].active_epoch = kIdleEpoch;
+  }
+  return reclamation;
+}
+
+void freeReclamation(Reclamation* reclamation) {
+  delete[] reclamation->rings;
+  delete reclamation;
+}
+
+auto pushRetired(ReclamationRing* ring, LockBucket* buckets, int size)
+    -> bool {
+  unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  if (head - tail >= kReclamationRingSize) {
+    return false;
+  }
+
+  ring->slots[head % kReclamationRingSize] = RetiredBuckets{buckets, size};
+  // Publish the slot only after it was filled
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+auto popRetired(ReclamationRing* ring, RetiredBuckets* retired) -> bool {
+  unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+  unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  if (head == tail) {
+    return false;
+  }
+
+  *retired = ring->slots[tail % kReclamationRingSize];
+  // Give the slot back only after it was read
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void enterEpoch(Reclamation* reclamation, ReclamationRing* ring) {
+  __atomic_store_n(&ring->active_epoch,
+                   __atomic_load_n(&reclamation->epoch, __ATOMIC_ACQUIRE),
+                   __ATOMIC_RELAXED);
+  // The announcement needs to be visible, before any bucket array is read.
+  // Otherwise the untrusted application could miss it and recycle an array
+  // that is about to be read.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void exitEpoch(ReclamationRing* ring) {
+  __atomic_store_n(&ring->active_epoch, kIdleEpoch, __ATOMIC_RELEASE);
+}
+
+EpochGuard::EpochGuard(Reclamation* reclamation, ReclamationRing* ring)
+    : ring_(ring) {
+  if (ring_ != nullptr) {
+    enterEpoch(reclamation, ring_);
+  }
+}
+
+EpochGuard::~EpochGuard() {
+  if (ring_ != nullptr) {
+    exitEpoch(ring_);
+  }
+}
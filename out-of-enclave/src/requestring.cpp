@@ -0,0 +1,100 @@
+#include "requestring.h"
+
+auto newRequestRings(int numRings) -> RequestRings* {
+  RequestRings* rings = new RequestRings();
+  rings->num_rings = numRings;
+  rings->rings = new RequestRing[numRings]();
+  return rings;
+}
+
+void freeRequestRings(RequestRings* rings) {
+  delete[] rings->rings;
+  delete rings;
+}
+
+auto pushRequest(RequestRing* ring, const RingRequest& request) -> bool {
+  unsigned int head = __atomic_load_n(&ring->request_head, __ATOMIC_RELAXED);
+  unsigned int tail = __atomic_load_n(&ring->request_tail, __ATOMIC_ACQUIRE);
+  if (head - tail >= kRequestRingSize) {
+    return false;
+  }
+
+  ring->requests[head % kRequestRingSize] = request;
+  // Publish the slot only after it was filled
+  __atomic_store_n(&ring->request_head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+auto popRequest(RequestRing* ring, RingRequest* request) -> bool {
+  unsigned int tail = __atomic_load_n(&ring->request_tail, __ATOMIC_RELAXED);
+  unsigned int head = __atomic_load_n(&ring->request_head, __ATOMIC_ACQUIRE);
+  // The untrusted application may have moved the head anywhere, but the slot
+  // is always inside the ring
+  if (head == tail || head - tail > kRequestRingSize) {
+    return false;
+  }
+
+  *request = ring->requests[tail % kRequestRingSize];
+  // Give the slot back only after it was copied
+  __atomic_store_n(&ring->request_tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+auto pushResponse(RequestRing* ring, const RingResponse& response) -> bool {
+  unsigned int head = __atomic_load_n(&ring->response_head, __ATOMIC_RELAXED);
+  unsigned int tail = __atomic_load_n(&ring->response_tail, __ATOMIC_ACQUIRE);
+  if (head - tail >= kRequestRingSize) {
+    return false;
+  }
+
+  ring->responses[head % kRequestRingSize] = response;
+  __atomic_store_n(&ring->response_head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+auto popResponse(RequestRing* ring, RingResponse* response) -> bool {
+  unsigned int tail = __atomic_load_n(&ring->response_tail, __ATOMIC_RELAXED);
+  unsigned int head = __atomic_load_n(&ring->response_head, __ATOMIC_ACQUIRE);
+  if (head == tail) {
+    return false;
+  }
+
+  *response = ring->responses[tail % kRequestRingSize];
+  __atomic_store_n(&ring->response_tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void markRequestProcessed(RequestRing* ring) {
+  unsigned int done = __atomic_load_n(&ring->request_done, __ATOMIC_RELAXED);
+  // Publish the effects of the request together with the count
+  __atomic_store_n(&ring->request_done, done + 1, __ATOMIC_RELEASE);
+}
+
+auto isProcessedUpTo(RequestRing* ring, unsigned int fence) -> bool {
+  unsigned int done = __atomic_load_n(&ring->request_done, __ATOMIC_ACQUIRE);
+  // The counters wrap around, so only their distance is meaningful
+  return (int)(done - fence) >= 0;
+}
+
+auto prepareToSleep(RequestRing* ring) -> bool {
+  __atomic_store_n(&ring->sleeping, 1, __ATOMIC_RELAXED);
+  // Pairs with the fence in needsWakeUp(): either the submitter sees the flag
+  // or the worker thread sees the request
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  unsigned int tail = __atomic_load_n(&ring->request_tail, __ATOMIC_RELAXED);
+  if (__atomic_load_n(&ring->request_head, __ATOMIC_RELAXED) != tail) {
+    wakeUp(ring);
+    return false;
+  }
+  return true;
+}
+
+void wakeUp(RequestRing* ring) {
+  __atomic_store_n(&ring->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+auto needsWakeUp(RequestRing* ring) -> bool {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return __atomic_load_n(&ring->sleeping, __ATOMIC_RELAXED) != 0 &&
+         __atomic_exchange_n(&ring->sleeping, 0, __ATOMIC_RELAXED) != 0;
+}
@@ -1,5 +1,9 @@
 #include "server.h"
 
+LockingServiceImpl::LockingServiceImpl(LockConflictPolicy conflictPolicy) {
+  lockManager_.setConflictPolicy(conflictPolicy);
+}
+
 auto LockingServiceImpl::RegisterTransaction(ServerContext* context,
                                              const RegistrationRequest* request,
                                              RegistrationResponse* response)
@@ -17,34 +21,54 @@ auto LockingServiceImpl::RegisterTransaction(ServerContext* context,
 auto LockingServiceImpl::LockExclusive(ServerContext* context,
                                        const LockRequest* request,
                                        LockResponse* response) -> Status {
-  unsigned int transaction_id = request->transaction_id();
-  unsigned int row_id = request->row_id();
-  bool wait_for_signature = request->wait_for_signature();
+  return acquire_lock(request, response, true);
+}
 
-  auto [signature, ok] =
-      lockManager_.lock(transaction_id, row_id, true, wait_for_signature);
+auto LockingServiceImpl::LockShared(ServerContext* context,
+                                    const LockRequest* request,
+                                    LockResponse* response) -> Status {
+  return acquire_lock(request, response, false);
+}
 
-  response->set_signature(
-      signature);  // If not ok, signature contains an error message instead
-  if (ok) {
+auto LockingServiceImpl::acquire_lock(const LockRequest* request,
+                                      LockResponse* response,
+                                      bool isExclusive) -> Status {
+  std::optional<JobFuture> future =
+      submit_lock(request, response, isExclusive);
+  if (!future.has_value()) {
     return Status::OK;
   }
-  return Status::CANCELLED;
+  return finish_lock(future->get(), response);
 }
 
-auto LockingServiceImpl::LockShared(ServerContext* context,
-                                    const LockRequest* request,
-                                    LockResponse* response) -> Status {
+auto LockingServiceImpl::submit_lock(const LockRequest* request,
+                                     LockResponse* response, bool isExclusive)
+    -> std::optional<JobFuture> {
   unsigned int transaction_id = request->transaction_id();
   unsigned int row_id = request->row_id();
   bool wait_for_signature = request->wait_for_signature();
+  unsigned int lock_budget = request->lock_budget();
 
-  auto [signature, ok] =
-      lockManager_.lock(transaction_id, row_id, false, wait_for_signature);
+  JobFuture future =
+      lockManager_.lockAsync(transaction_id, row_id, isExclusive, lock_budget);
+  if (!wait_for_signature) {
+    uint64_t ticket =
+        signatures_.add(transaction_id, row_id, isExclusive, future);
+    if (ticket != 0) {
+      response->set_ticket(ticket);
+      return std::nullopt;
+    }
+    // The store is full, so the result is returned right away
+  }
+  return future;
+}
 
+auto LockingServiceImpl::finish_lock(
+    const std::pair<std::string, bool>& result, LockResponse* response)
+    -> Status {
   response->set_signature(
-      signature);  // If not ok, signature contains an error message instead
-  if (ok) {
+      result.first);  // If not ok, signature contains an error message instead
+  if (result.second) {
     return Status::OK;
   }
   return Status::CANCELLED;
@@ -59,4 +83,234 @@ auto LockingServiceImpl::Unlock(ServerContext* context,
 
   lockManager_.unlock(transaction_id, row_id, wait_for_signature);
   return Status::OK;
-}
\ No newline at end of file
+}
+
+auto LockingServiceImpl::SubmitBatch(ServerContext* context,
+                                     const BatchRequest* request,
+                                     BatchResponse* response) -> Status {
+  std::vector<BatchedJob> jobs;
+  jobs.reserve(request->jobs_size());
+  for (const BatchRequest::Job& job : request->jobs()) {
+    Command command;
+    switch (job.command()) {
+      case BatchRequest::SHARED:
+        command = SHARED;
+        break;
+      case BatchRequest::EXCLUSIVE:
+        command = EXCLUSIVE;
+        break;
+      case BatchRequest::UNLOCK:
+        command = UNLOCK;
+        break;
+      case BatchRequest::REGISTER:
+        command = REGISTER;
+        break;
+      default:
+        return Status(grpc::StatusCode::INVALID_ARGUMENT, "Unknown command");
+    }
+    jobs.push_back(BatchedJob{command, job.transaction_id(), job.row_id(),
+                              (int)job.lock_budget()});
+  }
+
+  for (auto& [signature, ok] :
+       lockManager_.submitBatch(jobs, request->wait_for_signature())) {
+    BatchResponse::Result* result = response->add_results();
+    result->set_ok(ok);
+    result->set_signature(signature);
+  }
+  return Status::OK;
+}
+
+auto LockingServiceImpl::LockBatch(ServerContext* context,
+                                   const LockBatchRequest* request,
+                                   LockBatchResponse* response) -> Status {
+  unsigned int transaction_id = request->transaction_id();
+  std::vector<BatchedJob> jobs;
+  jobs.reserve(request->locks_size());
+  for (const LockBatchRequest::Lock& lock : request->locks()) {
+    jobs.push_back(BatchedJob{lock.exclusive() ? EXCLUSIVE : SHARED,
+                              transaction_id, lock.row_id(),
+                              (int)request->lock_budget()});
+  }
+
+  auto results = lockManager_.submitBatch(jobs);
+  for (size_t i = 0; i < results.size(); i++) {
+    LockBatchResponse::Result* result = response->add_results();
+    result->set_row_id(request->locks(i).row_id());
+    result->set_ok(results[i].second);
+    result->set_signature(results[i].first);
+  }
+  return Status::OK;
+}
+
+auto LockingServiceImpl::UnlockBatch(ServerContext* context,
+                                     const UnlockBatchRequest* request,
+                                     UnlockBatchResponse* response) -> Status {
+  unsigned int transaction_id = request->transaction_id();
+  std::vector<BatchedJob> jobs;
+  jobs.reserve(request->row_ids_size());
+  for (unsigned int row_id : request->row_ids()) {
+    jobs.push_back(BatchedJob{UNLOCK, transaction_id, row_id, 0});
+  }
+
+  for (auto& [signature, ok] : lockManager_.submitBatch(jobs)) {
+    response->add_released(ok);
+  }
+  return Status::OK;
+}
+
+auto LockingServiceImpl::Commit(ServerContext* context,
+                                const EndTransactionRequest* request,
+                                EndTransactionResponse* response) -> Status {
+  if (lockManager_.commit(request->transaction_id())) {
+    return Status::OK;
+  }
+  return Status::CANCELLED;
+}
+
+auto LockingServiceImpl::Abort(ServerContext* context,
+                               const EndTransactionRequest* request,
+                               EndTransactionResponse* response) -> Status {
+  if (lockManager_.abort(request->transaction_id())) {
+    return Status::OK;
+  }
+  return Status::CANCELLED;
+}
+
+auto LockingServiceImpl::TransactionSession(
+    ServerContext* context,
+    ServerReaderWriter<SessionResponse, SessionRequest>* stream) -> Status {
+  SessionQueue queue;
+  std::thread writer([&]() { answer_session(queue, stream); });
+
+  // The first request determines the transaction of the session
+  SessionRequest request;
+  std::optional<unsigned int> transaction_id;
+  bool finished = false;
+  while (stream->Read(&request)) {
+    if (!transaction_id.has_value()) {
+      transaction_id = request.transaction_id();
+    }
+    if (request.command() == SessionRequest::COMMIT ||
+        request.command() == SessionRequest::ABORT) {
+      finished = true;
+      break;
+    }
+
+    PendingSessionRequest pending{request.request_id(), std::nullopt};
+    if (request.transaction_id() == *transaction_id) {
+      switch (request.command()) {
+        case SessionRequest::SHARED:
+        case SessionRequest::EXCLUSIVE:
+          pending.future = lockManager_.lockAsync(
+              *transaction_id, request.row_id(),
+              request.command() == SessionRequest::EXCLUSIVE,
+              request.lock_budget());
+          break;
+        case SessionRequest::UNLOCK:
+          pending.future =
+              lockManager_.unlockAsync(*transaction_id, request.row_id());
+          break;
+        default:
+          break;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.requests.push_back(std::move(pending));
+    }
+    queue.submitted.notify_one();
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.closed = true;
+  }
+  queue.submitted.notify_one();
+  writer.join();
+
+  // The locks of the transaction do not outlive its session. Every request was
+  // answered, so the enclave knows about all of them.
+  if (transaction_id.has_value()) {
+    if (finished && request.command() == SessionRequest::COMMIT) {
+      lockManager_.commit(*transaction_id);
+    } else {
+      lockManager_.abort(*transaction_id);
+    }
+  }
+
+  if (!finished) {
+    return Status::CANCELLED;
+  }
+  SessionResponse response;
+  response.set_request_id(request.request_id());
+  response.set_ok(true);
+  stream->Write(response);
+  return Status::OK;
+}
+
+void LockingServiceImpl::answer_session(
+    SessionQueue& queue,
+    ServerReaderWriter<SessionResponse, SessionRequest>* stream) {
+  std::list<PendingSessionRequest> inFlight;
+  SessionResponse response;
+  auto answer = [&](PendingSessionRequest& pending) {
+    std::pair<std::string, bool> result(NO_SIGNATURE, false);
+    if (pending.future.has_value()) {
+      result = pending.future->get();
+    }
+    auto& [signature, ok] = result;
+    response.set_request_id(pending.requestId);
+    response.set_ok(ok);
+    response.set_signature(signature);
+    stream->Write(response);
+  };
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      if (inFlight.empty()) {
+        queue.submitted.wait(
+            lock, [&]() { return !queue.requests.empty() || queue.closed; });
+      }
+      inFlight.splice(inFlight.end(), queue.requests);
+      if (inFlight.empty()) {
+        return;  // closed and every request is answered
+      }
+    }
+
+    // Answer every finished request. Requests for the same row are finished
+    // in the order they were submitted.
+    bool answered = false;
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+      if (!it->future.has_value() || it->future->isReady()) {
+        answer(*it);
+        it = inFlight.erase(it);
+        answered = true;
+      } else {
+        it++;
+      }
+    }
+
+    // Else wait for the oldest request, instead of polling
+    if (!answered) {
+      answer(inFlight.front());
+      inFlight.pop_front();
+    }
+  }
+}
+
+auto LockingServiceImpl::CollectSignatures(ServerContext* context,
+                                           const CollectRequest* request,
+                                           CollectResponse* response)
+    -> Status {
+  for (const CollectedSignature& collected :
+       signatures_.collect(request->transaction_id())) {
+    CollectResponse::Result* result = response->add_results();
+    result->set_ticket(collected.ticket);
+    result->set_row_id(collected.rowId);
+    result->set_exclusive(collected.isExclusive);
+    result->set_ok(collected.ok);
+    result->set_signature(collected.signature);
+  }
+  return Status::OK;
+}
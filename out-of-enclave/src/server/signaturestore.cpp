@@ -0,0 +1,76 @@
+#include "signaturestore.h"
+
+SignatureStore::SignatureStore(size_t capacity,
+                               std::chrono::milliseconds timeout)
+    : capacity(capacity), timeout(timeout) {}
+
+auto SignatureStore::add(unsigned int transactionId, unsigned int rowId,
+                         bool isExclusive, JobFuture &future) -> uint64_t {
+  // Declared before the guard, so that it is destroyed after unlocking
+  std::vector<PendingSignature> expired;
+  std::lock_guard<std::mutex> guard(mutex);
+  Clock::time_point now = Clock::now();
+  expired = expire(now);
+  if (pending.size() >= capacity) {
+    return 0;
+  }
+
+  uint64_t ticket = nextTicket++;
+  pending.emplace(ticket,
+                  PendingSignature{transactionId, rowId, isExclusive,
+                                   now + timeout, std::move(future)});
+  tickets[transactionId].push_back(ticket);
+  return ticket;
+}
+
+auto SignatureStore::collect(unsigned int transactionId)
+    -> std::vector<CollectedSignature> {
+  std::vector<std::pair<uint64_t, PendingSignature>> collected;
+  std::vector<PendingSignature> expired;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    expired = expire(Clock::now());
+    auto transaction = tickets.find(transactionId);
+    if (transaction == tickets.end()) {
+      return {};
+    }
+    for (uint64_t ticket : transaction->second) {
+      auto entry = pending.find(ticket);
+      collected.emplace_back(ticket, std::move(entry->second));
+      pending.erase(entry);
+    }
+    tickets.erase(transaction);
+  }
+
+  // Wait for the enclave without blocking other requests
+  std::vector<CollectedSignature> results;
+  results.reserve(collected.size());
+  for (auto &[ticket, entry] : collected) {
+    auto [signature, ok] = entry.future.get();
+    results.push_back(CollectedSignature{ticket, entry.rowId,
+                                         entry.isExclusive, ok, signature});
+  }
+  return results;
+}
+
+auto SignatureStore::size() -> size_t {
+  std::lock_guard<std::mutex> guard(mutex);
+  return pending.size();
+}
+
+auto SignatureStore::expire(Clock::time_point now)
+    -> std::vector<PendingSignature> {
+  std::vector<PendingSignature> expired;
+  while (!pending.empty() && pending.begin()->second.deadline <= now) {
+    unsigned int transactionId = pending.begin()->second.transactionId;
+    // The oldest result of the store is also the oldest of its transaction
+    auto transaction = tickets.find(transactionId);
+    transaction->second.pop_front();
+    if (transaction->second.empty()) {
+      tickets.erase(transaction);
+    }
+    expired.push_back(std::move(pending.begin()->second));
+    pending.erase(pending.begin());
+  }
+  return expired;
+}
@@ -6,12 +6,16 @@ Transaction* newTransaction(int transactionId, int lockBudget) {
   transaction->aborted = false;
   transaction->growing_phase = true;
   transaction->lock_budget = lockBudget;
-  transaction->locked_rows = new int[lockBudget];
+  transaction->locked_rows = (int*)malloc(sizeof(int) * lockBudget);
   transaction->locked_rows_size = lockBudget;
   transaction->num_locked = 0;
   return transaction;
 }
 
+auto getTransactionShard(unsigned int transactionId, int numShards) -> int {
+  return transactionId % numShards;
+}
+
 auto addLock(Transaction* transaction, int rowId, bool isExclusive, Lock* lock)
     -> bool {
   if (transaction->aborted) {
@@ -26,15 +30,13 @@ auto addLock(Transaction* transaction, int rowId, bool isExclusive, Lock* lock)
   }
 
   if (ret) {
-    if (transaction->num_locked == 0) {
-      transaction->locked_rows = new int[1];
-      transaction->locked_rows[0] = rowId;
-    } else {
+    if (transaction->num_locked == transaction->locked_rows_size) {
+      transaction->locked_rows_size++;
       transaction->locked_rows =
           (int*)realloc(transaction->locked_rows,
-                        sizeof(int) * (transaction->num_locked + 1));
-      transaction->locked_rows[transaction->num_locked] = rowId;
+                        sizeof(int) * transaction->locked_rows_size);
     }
+    transaction->locked_rows[transaction->num_locked] = rowId;
 
     transaction->num_locked++;
     transaction->lock_budget--;
@@ -43,7 +45,7 @@ auto addLock(Transaction* transaction, int rowId, bool isExclusive, Lock* lock)
   return ret;
 };
 
-void releaseLock(Transaction* transaction, int rowId, HashTable* lockTable) {
+auto releaseLock(Transaction* transaction, int rowId, Lock* lock) -> bool {
   bool wasOwner = false;
   for (int i = 0; i < transaction->num_locked; i++) {
     if (transaction->locked_rows[i] == rowId) {
@@ -58,15 +60,11 @@ void releaseLock(Transaction* transaction, int rowId, HashTable* lockTable) {
   if (wasOwner) {
     transaction->num_locked--;
     transaction->growing_phase = false;
-    auto lock = (Lock*)get(lockTable, rowId);
     if (lock != nullptr) {
       release(lock, transaction->transaction_id);
-      if (lock->num_owners == 0) {
-        remove(lockTable, rowId);
-        // delete lock; -> issues with deleting locks in untrusted memory
-      }
     }
   }
+  return wasOwner;
 };
 
 auto hasLock(Transaction* transaction, int rowId) -> bool {
@@ -78,10 +76,13 @@ auto hasLock(Transaction* transaction, int rowId) -> bool {
   return false;
 };
 
-void releaseAllLocks(Transaction* transaction, HashTable* lockTable) {
+void releaseAllLocks(Transaction* transaction, LockTable* lockTable) {
   for (int i = 0; i < transaction->num_locked; i++) {
     int locked_row = transaction->locked_rows[i];
-    auto lock = (Lock*)get(lockTable, locked_row);
+    auto lock = get(lockTable, locked_row);
+    if (lock == nullptr) {
+      continue;
+    }
     release(lock, transaction->transaction_id);
     if (lock->num_owners == 0) {
       remove(lockTable, locked_row);
@@ -102,11 +103,7 @@ auto copy_transaction(Transaction* transaction) -> void* {
   int num_locked = transaction->num_locked;
   copy->num_locked = num_locked;
 
-  if (copy->num_locked > 0) {
-    copy->locked_rows = new int[copy->num_locked];
-  } else {
-    copy->locked_rows = nullptr;
-  }
+  copy->locked_rows = (int*)malloc(sizeof(int) * copy->locked_rows_size);
   for (int i = 0; i < num_locked; i++) {
     copy->locked_rows[i] = transaction->locked_rows[i];
   }
@@ -115,6 +112,10 @@ auto copy_transaction(Transaction* transaction) -> void* {
 }
 
 void free_transaction_copy(Transaction*& transaction) {
-  delete[] transaction->locked_rows;
+  freeTransaction(transaction);
+}
+
+void freeTransaction(Transaction* transaction) {
+  free(transaction->locked_rows);
   delete transaction;
-}
\ No newline at end of file
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "completion.h"
+
+TEST(CompletionTest, finishedJobReturnsRightAway) {
+  volatile int state = JOB_PENDING;
+  completeJob(&state);
+  EXPECT_EQ(state, JOB_FINISHED);
+  waitForCompletion(&state);
+  EXPECT_EQ(state, JOB_FINISHED);
+}
+
+TEST(CompletionTest, sleepingCallerIsWokenUp) {
+  volatile int state = JOB_PENDING;
+  std::thread caller([&] { waitForCompletion(&state); });
+
+  // Wait until the caller stopped spinning and announced its sleep
+  while (state != JOB_PENDING_WAITER) {
+    std::this_thread::yield();
+  }
+  completeJob(&state);
+  caller.join();
+  EXPECT_EQ(state, JOB_FINISHED);
+}
+
+TEST(CompletionTest, manyJobsOneAfterTheOther) {
+  volatile int state;
+  for (int i = 0; i < 1000; i++) {
+    state = JOB_PENDING;
+    std::thread worker([&] { completeJob(&state); });
+    waitForCompletion(&state);
+    worker.join();
+  }
+  EXPECT_EQ(state, JOB_FINISHED);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "jobqueue.h"
+
+/*
+ ********************************
+ * PUSH AND POP
+ ********************************
+ */
+
+TEST(JobQueueTest, jobsAreFirstInFirstOut) {
+  auto queue = std::make_unique<JobQueue>();
+  initJobQueue(queue.get());
+  Job job = Job();
+
+  job.row_id = 1;
+  EXPECT_TRUE(pushJob(queue.get(), job));
+  job.row_id = 2;
+  EXPECT_TRUE(pushJob(queue.get(), job));
+
+  ASSERT_TRUE(popJob(queue.get(), &job));
+  EXPECT_EQ(job.row_id, 1);
+  ASSERT_TRUE(popJob(queue.get(), &job));
+  EXPECT_EQ(job.row_id, 2);
+  EXPECT_FALSE(popJob(queue.get(), &job));
+}
+
+TEST(JobQueueTest, pushFailsWhenQueueIsFull) {
+  auto queue = std::make_unique<JobQueue>();
+  initJobQueue(queue.get());
+  Job job = Job();
+
+  for (size_t i = 0; i < kJobQueueSize; i++) {
+    EXPECT_TRUE(pushJob(queue.get(), job));
+  }
+  EXPECT_FALSE(pushJob(queue.get(), job));
+
+  // Taking a job out makes room for the next one, in the next round
+  ASSERT_TRUE(popJob(queue.get(), &job));
+  EXPECT_TRUE(pushJob(queue.get(), job));
+  EXPECT_FALSE(pushJob(queue.get(), job));
+}
+
+TEST(JobQueueTest, concurrentProducersLoseNoJobs) {
+  auto queue = std::make_unique<JobQueue>();
+  initJobQueue(queue.get());
+  const int kProducers = 4;
+  const int kJobsPerProducer = 10000;
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kProducers; i++) {
+    producers.emplace_back([&, i] {
+      Job job = Job();
+      job.transaction_id = i;
+      for (int j = 0; j < kJobsPerProducer; j++) {
+        job.row_id = j;
+        while (!pushJob(queue.get(), job)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Jobs of the same producer keep their order
+  std::vector<int> next(kProducers, 0);
+  Job job;
+  for (int popped = 0; popped < kProducers * kJobsPerProducer;) {
+    if (popJob(queue.get(), &job)) {
+      EXPECT_EQ(job.row_id, next[job.transaction_id]++);
+      popped++;
+    }
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_FALSE(popJob(queue.get(), &job));
+}
+
+/*
+ ********************************
+ * SLEEPING CONSUMER
+ ********************************
+ */
+
+TEST(JobQueueTest, sleepingConsumerIsWokenUpOnce) {
+  auto queue = std::make_unique<JobQueue>();
+  initJobQueue(queue.get());
+
+  EXPECT_FALSE(needsWakeUp(queue.get()));
+  ASSERT_TRUE(prepareToSleep(queue.get()));
+  EXPECT_TRUE(pushJob(queue.get(), Job()));
+  EXPECT_TRUE(needsWakeUp(queue.get()));
+  EXPECT_FALSE(needsWakeUp(queue.get()));
+}
+
+TEST(JobQueueTest, consumerDoesNotSleepWithPendingJob) {
+  auto queue = std::make_unique<JobQueue>();
+  initJobQueue(queue.get());
+
+  EXPECT_TRUE(pushJob(queue.get(), Job()));
+  EXPECT_FALSE(prepareToSleep(queue.get()));
+  EXPECT_FALSE(needsWakeUp(queue.get()));
+}
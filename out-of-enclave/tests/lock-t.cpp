@@ -10,13 +10,22 @@ const unsigned int kTransactionIdB = 2;
 // Shared access works
 TEST(LockTest, sharedAccess) {
   Lock* lock = newLock();
-  getSharedAccess(lock, 1);
-  getSharedAccess(lock, 2);
-  getSharedAccess(lock, 3);
-  getSharedAccess(lock, 4);
+  for (int i = 0; i < kTransactionBudget; i++) {
+    EXPECT_TRUE(getSharedAccess(lock, i + 1));
+  }
 
   EXPECT_FALSE(lock->exclusive);
-  EXPECT_EQ(lock->num_owners, 4);
+  EXPECT_EQ(lock->num_owners, kTransactionBudget);
+};
+
+// Shared access is bounded by the inline owner capacity
+TEST(LockTest, sharedAccessFullLock) {
+  Lock* lock = newLock();
+  for (int i = 0; i < kTransactionBudget; i++) {
+    EXPECT_TRUE(getSharedAccess(lock, i + 1));
+  }
+  EXPECT_FALSE(getSharedAccess(lock, kTransactionBudget + 1));
+  EXPECT_EQ(lock->num_owners, kTransactionBudget);
 };
 
 // Exclusive access works
@@ -68,4 +77,27 @@ TEST(LockTest, releaseUnownedLock) {
   EXPECT_TRUE(lock->exclusive);
   EXPECT_EQ(lock->num_owners, 1);
   EXPECT_EQ(lock->owners[0], kTransactionIdA);
-}
\ No newline at end of file
+}
+
+// Only a transaction older than every other owner may wait for a lock
+TEST(LockTest, waitDie) {
+  Lock* lock = newLock();
+  EXPECT_TRUE(getSharedAccess(lock, 5));
+  EXPECT_TRUE(mayWait(lock, 3));
+  EXPECT_FALSE(mayWait(lock, 7));
+  EXPECT_TRUE(mayWait(lock, 5));
+}
+
+// A request is grantable, once the lock is free for its mode
+TEST(LockTest, grantableRequests) {
+  Lock* lock = newLock();
+  EXPECT_TRUE(getSharedAccess(lock, kTransactionIdA));
+  EXPECT_TRUE(getSharedAccess(lock, kTransactionIdB));
+  EXPECT_FALSE(isGrantable(lock, 3, false));  // no room for another owner
+  EXPECT_FALSE(isGrantable(lock, 3, true));
+  EXPECT_FALSE(isGrantable(lock, kTransactionIdA, true));
+
+  release(lock, kTransactionIdB);
+  EXPECT_TRUE(isGrantable(lock, 3, false));
+  EXPECT_TRUE(isGrantable(lock, kTransactionIdA, true));
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "lock.h"
 #include "lockmanager.h"
 
@@ -37,8 +41,7 @@ TEST_F(LockManagerTest, acquiringLocks) {
 };
 
 // Cannot get exclusive access when someone already has shared access
-// TODO: Doesn't check if transaction already owns lock yet
-TEST_F(LockManagerTest, DISABLED_wantExclusiveButAlreadyShared) {
+TEST_F(LockManagerTest, wantExclusiveButAlreadyShared) {
   LockManager lock_manager = LockManager();
   EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
   EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
@@ -48,8 +51,7 @@ TEST_F(LockManagerTest, DISABLED_wantExclusiveButAlreadyShared) {
 };
 
 // Cannot get shared access, when someone has exclusive access
-// TODO: Doesn't check if transaction already owns lock yet
-TEST_F(LockManagerTest, DISABLED_wantSharedButAlreadyExclusive) {
+TEST_F(LockManagerTest, wantSharedButAlreadyExclusive) {
   LockManager lock_manager = LockManager();
   EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
   EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
@@ -69,8 +71,7 @@ TEST_F(LockManagerTest, multipleTransactionsSharedLock) {
 };
 
 // Cannot get the same lock twice
-// TODO: Doesn't check if transaction already owns lock yet
-TEST_F(LockManagerTest, DISABLED_sameLockTwice) {
+TEST_F(LockManagerTest, sameLockTwice) {
   LockManager lock_manager = LockManager();
   EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
   EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, false).second);
@@ -90,6 +91,32 @@ TEST_F(LockManagerTest, lockBudgetRunsOut) {
   EXPECT_FALSE(lock_manager.lock(kTransactionIdA, row_id, false).second);
 };
 
+// A lock request with a lock budget registers the transaction
+TEST_F(LockManagerTest, lockRequestRegistersTransaction) {
+  LockManager lock_manager = LockManager(2);
+  EXPECT_TRUE(
+      lock_manager.lock(kTransactionIdA, kRowId, false, true, 2).second);
+  EXPECT_FALSE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+
+  // The transaction got the given lock budget and keeps it
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId + 1, false, true,
+                                kLockBudget)
+                  .second);
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdA, kRowId + 2, false).second);
+};
+
+// The transaction is only registered, if it gets the lock
+TEST_F(LockManagerTest, failedLockRequestDoesNotRegister) {
+  LockManager lock_manager = LockManager();
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, true).second);
+
+  EXPECT_FALSE(
+      lock_manager.lock(kTransactionIdB, kRowId, false, true, kLockBudget)
+          .second);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+};
+
 // Can upgrade a lock
 TEST_F(LockManagerTest, upgradeLock) {
   LockManager lock_manager = LockManager();
@@ -187,8 +214,8 @@ TEST_F(LockManagerTest,
 
   // Next lock request fails because change is detected
   int anotherLockId =
-      kRowId + lock_manager.lockTable
-                   ->size;  // make sure that lock will be in the same bucket
+      kRowId + lock_manager.lockTable->partitions[0]
+                   .size;  // make sure that lock will be in the same bucket
   EXPECT_FALSE(lock_manager.lock(kTransactionIdA, anotherLockId, false).second);
 }
 
@@ -204,8 +231,8 @@ TEST_F(LockManagerTest,
 
   // Next lock request fails because change is detected
   int anotherLockId =
-      kRowId + lock_manager.lockTable
-                   ->size;  // make sure that lock will be in the same bucket
+      kRowId + lock_manager.lockTable->partitions[0]
+                   .size;  // make sure that lock will be in the same bucket
   EXPECT_FALSE(lock_manager.lock(kTransactionIdA, anotherLockId, false).second);
 }
 
@@ -258,4 +285,444 @@ TEST_F(LockManagerTest, notWaitingForSignature) {
   EXPECT_TRUE(lock_manager.lock(kTransactionIdA, lockBudget, false,
                                 true)
                   .second);  // waitung for signature return value at the end
-}
\ No newline at end of file
+}
+
+// The lock table grows while locks are acquired and keeps all of them while
+// they are migrated into the new buckets. It shrinks again, once the locks are
+// released.
+TEST_F(LockManagerTest, lockTableGrowsAndShrinksWithNumberOfLocks) {
+  LockManager lock_manager = LockManager();
+  LockTablePartition* partition = &lock_manager.lockTable->partitions[0];
+  int initialSize = partition->size;
+  int numLocks =
+      initialSize * kLockTableSlotsPerBucket * kLockTableMaxLoadFactor + 1;
+
+  int lockBudget = 1000;
+  int numTransactions = numLocks / lockBudget + 1;
+  for (int i = 1; i <= numTransactions; i++) {
+    EXPECT_TRUE(lock_manager.registerTransaction(i, lockBudget));
+  }
+  for (int i = 1; i < numLocks; i++) {
+    lock_manager.lock(1 + i / lockBudget, i, false, false);
+  }
+  EXPECT_TRUE(
+      lock_manager.lock(1 + numLocks / lockBudget, numLocks, false).second);
+  EXPECT_EQ(partition->size, 2 * initialSize);
+
+  // The locks from the old and the new buckets are still held
+  int transactionId = numTransactions + 1;
+  EXPECT_TRUE(lock_manager.registerTransaction(transactionId, kLockBudget));
+  EXPECT_FALSE(lock_manager.lock(transactionId, 1, true).second);
+  EXPECT_FALSE(lock_manager.lock(transactionId, numLocks, true).second);
+  EXPECT_TRUE(lock_manager.lock(transactionId, numLocks + 1, true).second);
+
+  for (int i = 1; i < numLocks; i++) {
+    lock_manager.unlock(1 + i / lockBudget, i);
+  }
+  lock_manager.unlock(1 + numLocks / lockBudget, numLocks, true);
+  EXPECT_EQ(partition->size, initialSize);
+  EXPECT_FALSE(isRehashing(partition));
+}
+
+// Several worker threads serve concurrent requests of transactions, that hold
+// locks in the partitions of all of them
+TEST_F(LockManagerTest, multipleWorkerThreads) {
+  int numWorkerThreads = 2;
+  LockManager lock_manager = LockManager(numWorkerThreads);
+  int partitionSize = lock_manager.lockTable->key_range / numWorkerThreads;
+  int numLocks = 50;
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+
+  std::atomic<int> numAcquired{0};
+  auto acquire = [&](unsigned int transactionId) {
+    for (int i = 1; i <= numLocks; i++) {
+      for (int partition = 0; partition < numWorkerThreads; partition++) {
+        if (lock_manager.lock(transactionId, partition * partitionSize + i,
+                              false)
+                .second) {
+          numAcquired++;
+        }
+      }
+    }
+  };
+  std::thread clientA(acquire, kTransactionIdA);
+  std::thread clientB(acquire, kTransactionIdB);
+  clientA.join();
+  clientB.join();
+
+  EXPECT_EQ(numAcquired, 2 * numWorkerThreads * numLocks);
+
+  // Both transactions share every lock
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdC, kLockBudget));
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdC, 1, true).second);
+  EXPECT_FALSE(
+      lock_manager.lock(kTransactionIdC, partitionSize + numLocks, true)
+          .second);
+}
+
+// With a Merkle tree only the cached top levels of the tree stay inside the
+// enclave, also after the lock table grew. Every lock survives the migration
+// into the new buckets.
+TEST_F(LockManagerTest, merkleTreeKeepsIntegrityDataSmall) {
+  IntegrityOptions integrity = {MERKLE_TREE, 2, 4};
+  LockManager lock_manager = LockManager(1, integrity);
+  LockTablePartition* partition = &lock_manager.lockTable->partitions[0];
+  int initialSize = partition->size;
+  int numLocks =
+      initialSize * kLockTableSlotsPerBucket * kLockTableMaxLoadFactor + 1;
+
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, numLocks));
+  for (int i = 1; i < numLocks; i++) {
+    lock_manager.lock(kTransactionIdA, i, false, false);
+  }
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, numLocks, false).second);
+  EXPECT_EQ(partition->size, 2 * initialSize);
+  EXPECT_LT(lock_manager.getIntegrityMemoryUsage(),
+            initialSize * sizeof(sgx_sha256_hash_t));
+
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, 1, true).second);
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, numLocks, true).second);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, numLocks + 1, true).second);
+}
+
+// Incremental bucket digests verify buckets, whose slots are modified one
+// after the other, also while locks are migrated into new buckets
+TEST_F(LockManagerTest, incrementalBucketDigests) {
+  IntegrityOptions integrity = {MERKLE_TREE, 4, 16, INCREMENTAL_HASH};
+  LockManager lock_manager = LockManager(1, integrity);
+  int numLocks = lock_manager.lockTable->partitions[0].size *
+                     kLockTableSlotsPerBucket * kLockTableMaxLoadFactor +
+                 1;
+
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, numLocks));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  for (int i = 1; i < numLocks; i++) {
+    lock_manager.lock(kTransactionIdA, i, false, false);
+  }
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, numLocks, false).second);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, 1, false).second);
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, 2, true).second);
+
+  lock_manager.unlock(kTransactionIdA, 2, true);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, 2, true).second);
+}
+
+// Truncated AES-CMAC digests protect the buckets just as well
+TEST_F(LockManagerTest, truncatedCmacBucketDigests) {
+  IntegrityOptions integrity = {HASH_LIST, 0, 0, FULL_CMAC, 8};
+  LockManager lock_manager = LockManager(1, integrity);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, true).second);
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId, false).second);
+  lock_manager.unlock(kTransactionIdA, kRowId, true);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, false).second);
+}
+
+// A batch returns the results of its requests in order, with the requests for
+// the same row executed in order as well
+TEST_F(LockManagerTest, submitBatch) {
+  LockManager lock_manager = LockManager(2);
+  unsigned int partitionSize = lock_manager.lockTable->key_range / 2;
+  auto registrations = lock_manager.submitBatch(
+      {{REGISTER, kTransactionIdA, 0, (int)kLockBudget},
+       {REGISTER, kTransactionIdB, 0, (int)kLockBudget},
+       {REGISTER, kTransactionIdC, 0, (int)kLockBudget},
+       {REGISTER, kTransactionIdA, 0, (int)kLockBudget}});
+  ASSERT_EQ(registrations.size(), 4);
+  EXPECT_TRUE(registrations[0].second);
+  EXPECT_TRUE(registrations[1].second);
+  EXPECT_TRUE(registrations[2].second);
+  EXPECT_FALSE(registrations[3].second);
+
+  unsigned int kTransactionIdD = kTransactionIdC + 1;
+  auto results = lock_manager.submitBatch(
+      {{EXCLUSIVE, kTransactionIdA, 1, 0},
+       {SHARED, kTransactionIdA, partitionSize + 1, 0},
+       {SHARED, kTransactionIdB, partitionSize + 1, 0},
+       {SHARED, kTransactionIdC, 1, 0},
+       {SHARED, kTransactionIdD, 2, 0}});
+  ASSERT_EQ(results.size(), 5);
+  EXPECT_TRUE(results[0].second);
+  EXPECT_TRUE(lock_manager.verify_signature_string(results[0].first,
+                                                   kTransactionIdA, 1, true));
+  EXPECT_TRUE(results[1].second);
+  EXPECT_TRUE(results[2].second);
+  EXPECT_FALSE(results[3].second);
+  EXPECT_FALSE(results[4].second);  // not registered
+}
+
+// The lock manager behaves the same with regular enclave transitions
+TEST_F(LockManagerTest, withoutSwitchlessCalls) {
+  SwitchlessOptions switchless = kDefaultSwitchlessOptions;
+  switchless.enabled = false;
+  LockManager lock_manager =
+      LockManager(1, kDefaultIntegrityOptions, switchless);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  auto [signature, ok] = lock_manager.lock(kTransactionIdA, kRowId, true);
+  EXPECT_TRUE(ok);
+  EXPECT_TRUE(lock_manager.verify_signature_string(signature, kTransactionIdA,
+                                                   kRowId, true));
+  lock_manager.unlock(kTransactionIdA, kRowId, true);
+}
+
+// Jobs submitted through the request rings get the same results as by ECALLs
+TEST_F(LockManagerTest, submitThroughRequestRings) {
+  LockManager lock_manager = LockManager(2, kDefaultIntegrityOptions,
+                                         kDefaultSwitchlessOptions,
+                                         SUBMIT_BY_REQUEST_RING);
+  unsigned int partitionSize = lock_manager.lockTable->key_range / 2;
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdA, kRowId, true).second);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_FALSE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+
+  auto [signature, ok] = lock_manager.lock(kTransactionIdA, kRowId, true);
+  EXPECT_TRUE(ok);
+  EXPECT_TRUE(lock_manager.verify_signature_string(signature, kTransactionIdA,
+                                                   kRowId, true));
+  EXPECT_TRUE(
+      lock_manager.lock(kTransactionIdA, partitionSize + 1, false).second);
+
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  auto results = lock_manager.submitBatch(
+      {{SHARED, kTransactionIdB, kRowId, 0},
+       {SHARED, kTransactionIdB, partitionSize + 1, 0}});
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_FALSE(results[0].second);
+  EXPECT_TRUE(results[1].second);
+
+  lock_manager.unlock(kTransactionIdA, kRowId, true);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true).second);
+}
+
+// Lock requests with a lock budget register their transaction in a batch and
+// through the request rings
+TEST_F(LockManagerTest, batchedLockRequestsRegisterTransaction) {
+  for (JobSubmission submission : {SUBMIT_BY_ECALL, SUBMIT_BY_REQUEST_RING}) {
+    LockManager lock_manager =
+        LockManager(2, kDefaultIntegrityOptions, kDefaultSwitchlessOptions,
+                    submission);
+    unsigned int partitionSize = lock_manager.lockTable->key_range / 2;
+    auto results = lock_manager.submitBatch(
+        {{SHARED, kTransactionIdA, kRowId, (int)kLockBudget},
+         {EXCLUSIVE, kTransactionIdA, partitionSize + 1, (int)kLockBudget},
+         {SHARED, kTransactionIdB, kRowId, 0}});
+    ASSERT_EQ(results.size(), 3);
+    EXPECT_TRUE(results[0].second);
+    EXPECT_TRUE(results[1].second);
+    EXPECT_TRUE(lock_manager.verify_signature_string(
+        results[1].first, kTransactionIdA, partitionSize + 1, true));
+    EXPECT_FALSE(results[2].second);  // not registered
+    EXPECT_FALSE(
+        lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  }
+}
+
+// Many asynchronous lock requests are in flight at once and their futures
+// deliver the signatures, in any order
+TEST_F(LockManagerTest, asyncLockRequests) {
+  for (JobSubmission submission : {SUBMIT_BY_ECALL, SUBMIT_BY_REQUEST_RING}) {
+    LockManager lock_manager =
+        LockManager(2, kDefaultIntegrityOptions, kDefaultSwitchlessOptions,
+                    submission);
+    EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+    std::vector<JobFuture> futures;
+    for (int rowId = 1; rowId < kLockBudget; rowId++) {
+      futures.push_back(lock_manager.lockAsync(kTransactionIdA, rowId, true));
+    }
+    for (int i = futures.size() - 1; i >= 0; i--) {
+      auto [signature, ok] = futures[i].get();
+      EXPECT_TRUE(ok);
+      EXPECT_TRUE(lock_manager.verify_signature_string(
+          signature, kTransactionIdA, i + 1, true));
+    }
+    EXPECT_THROW(futures[0].get(), std::logic_error);
+  }
+}
+
+// The futures report denied lock requests and unlock requests for locks the
+// transaction does not own
+TEST_F(LockManagerTest, asyncRequestsReportErrors) {
+  LockManager lock_manager = LockManager();
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, true).second);
+
+  JobFuture denied = lock_manager.lockAsync(kTransactionIdB, kRowId, false);
+  JobFuture unowned = lock_manager.unlockAsync(kTransactionIdB, kRowId + 1);
+  JobFuture unregistered =
+      lock_manager.lockAsync(kTransactionIdC, kRowId, true);
+  while (!denied.isReady()) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(denied.get().second);
+  EXPECT_FALSE(unowned.get().second);
+  EXPECT_FALSE(unregistered.get().second);
+  EXPECT_TRUE(lock_manager.unlockAsync(kTransactionIdA, kRowId).get().second);
+}
+
+// The callback of a future runs once the enclave finished the job, or right
+// away, when it is already finished
+TEST_F(LockManagerTest, callbackRunsOnceJobIsFinished) {
+  LockManager lock_manager = LockManager(2);
+  lock_manager.setConflictPolicy(WAIT_DIE);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true).second);
+
+  std::atomic<int> notified(0);
+  auto notify = [](void *arg) { (*(std::atomic<int> *)arg)++; };
+  JobFuture waiting = lock_manager.lockAsync(kTransactionIdA, kRowId, true);
+  waiting.notifyWhenReady(notify, &notified);
+  EXPECT_EQ(notified, 0);
+  EXPECT_TRUE(lock_manager.commit(kTransactionIdB));
+  while (notified == 0) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(waiting.get().second);
+
+  JobFuture finished = lock_manager.unlockAsync(kTransactionIdA, kRowId);
+  while (!finished.isReady()) {
+    std::this_thread::yield();
+  }
+  finished.notifyWhenReady(notify, &notified);
+  EXPECT_EQ(notified, 2);
+  EXPECT_TRUE(finished.get().second);
+}
+
+// Committing through the request rings waits for the requests of the
+// transaction submitted before, so that none of them arrives after it ended
+TEST_F(LockManagerTest, commitFollowsRequestsThroughRequestRings) {
+  LockManager lock_manager = LockManager(2, kDefaultIntegrityOptions,
+                                         kDefaultSwitchlessOptions,
+                                         SUBMIT_BY_REQUEST_RING);
+  int partitionSize = lock_manager.lockTable->key_range / 2;
+  std::vector<int> rowIds;
+  for (int i = 1; i <= 20; i++) {
+    rowIds.push_back(i);
+    rowIds.push_back(partitionSize + i);
+  }
+  for (int rowId : rowIds) {
+    lock_manager.lock(kTransactionIdA, rowId, true, false, kLockBudget);
+  }
+  EXPECT_TRUE(lock_manager.commit(kTransactionIdA));
+
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  for (int rowId : rowIds) {
+    EXPECT_TRUE(lock_manager.lock(kTransactionIdB, rowId, true).second);
+  }
+}
+
+// Committing releases the locks of a transaction in the partitions of all
+// worker threads at once and forgets about the transaction
+TEST_F(LockManagerTest, commitReleasesAllLocks) {
+  for (JobSubmission submission : {SUBMIT_BY_ECALL, SUBMIT_BY_REQUEST_RING}) {
+    LockManager lock_manager =
+        LockManager(2, kDefaultIntegrityOptions, kDefaultSwitchlessOptions,
+                    submission);
+    int partitionSize = lock_manager.lockTable->key_range / 2;
+    std::vector<int> rowIds;
+    for (int i = 1; i <= 20; i++) {
+      rowIds.push_back(i);
+      rowIds.push_back(partitionSize + i);
+    }
+    EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+    for (int rowId : rowIds) {
+      EXPECT_TRUE(lock_manager.lock(kTransactionIdA, rowId, true).second);
+    }
+    EXPECT_TRUE(lock_manager.commit(kTransactionIdA));
+
+    EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+    for (int rowId : rowIds) {
+      EXPECT_TRUE(lock_manager.lock(kTransactionIdB, rowId, true).second);
+    }
+    EXPECT_FALSE(lock_manager.commit(kTransactionIdA));
+    EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  }
+}
+
+// Aborting releases the locks like committing, also of a transaction without
+// any locks
+TEST_F(LockManagerTest, abortReleasesAllLocks) {
+  LockManager lock_manager = LockManager();
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, false).second);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, false).second);
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId + 1, true).second);
+
+  EXPECT_TRUE(lock_manager.abort(kTransactionIdA));
+  EXPECT_FALSE(lock_manager.abort(kTransactionIdA));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId + 1, true).second);
+
+  // The shared lock of the other transaction is left
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdC, kLockBudget));
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdC, kRowId, true).second);
+  EXPECT_TRUE(lock_manager.abort(kTransactionIdC));
+}
+
+// Under wait-die, an older transaction waits for a conflicting lock and gets
+// it, once the younger owner releases it, also through the request rings
+TEST_F(LockManagerTest, olderTransactionWaitsForLock) {
+  for (JobSubmission submission : {SUBMIT_BY_ECALL, SUBMIT_BY_REQUEST_RING}) {
+    LockManager lock_manager =
+        LockManager(2, kDefaultIntegrityOptions, kDefaultSwitchlessOptions,
+                    submission);
+    lock_manager.setConflictPolicy(WAIT_DIE);
+    EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+    EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+    EXPECT_TRUE(lock_manager.lock(kTransactionIdB, kRowId, true).second);
+
+    JobFuture waiting = lock_manager.lockAsync(kTransactionIdA, kRowId, true);
+    EXPECT_FALSE(waiting.isReady());
+    EXPECT_TRUE(lock_manager.commit(kTransactionIdB));
+
+    auto [signature, ok] = waiting.get();
+    EXPECT_TRUE(ok);
+    EXPECT_TRUE(lock_manager.verify_signature_string(signature, kTransactionIdA,
+                                                     kRowId, true));
+  }
+}
+
+// Under wait-die, a younger transaction does not wait for an older one, nor
+// for an older request waiting for the same lock
+TEST_F(LockManagerTest, youngerTransactionDies) {
+  LockManager lock_manager = LockManager();
+  lock_manager.setConflictPolicy(WAIT_DIE);
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdA, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdC, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdA, kRowId, true).second);
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId, false).second);
+
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdC, kRowId + 1, true).second);
+  JobFuture waiting = lock_manager.lockAsync(kTransactionIdA, kRowId + 1, true);
+  EXPECT_FALSE(lock_manager.lock(kTransactionIdB, kRowId + 1, true).second);
+
+  EXPECT_TRUE(lock_manager.abort(kTransactionIdC));
+  EXPECT_TRUE(waiting.get().second);
+}
+
+// Aborting a transaction fails its waiting requests, so that younger
+// transactions do not die for them
+TEST_F(LockManagerTest, abortDropsWaitingRequests) {
+  LockManager lock_manager = LockManager();
+  lock_manager.setConflictPolicy(WAIT_DIE);
+  unsigned int kTransactionIdD = kTransactionIdC + 1;
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdB, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdC, kLockBudget));
+  EXPECT_TRUE(lock_manager.registerTransaction(kTransactionIdD, kLockBudget));
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdD, kRowId, true).second);
+  JobFuture waiting = lock_manager.lockAsync(kTransactionIdB, kRowId, true);
+
+  // The requests for a partition are processed in order, so B waits by now
+  EXPECT_TRUE(lock_manager.lock(kTransactionIdD, kRowId + 1, true).second);
+  EXPECT_TRUE(lock_manager.abort(kTransactionIdB));
+  EXPECT_FALSE(waiting.get().second);
+
+  JobFuture next = lock_manager.lockAsync(kTransactionIdC, kRowId, true);
+  EXPECT_TRUE(lock_manager.abort(kTransactionIdD));
+  EXPECT_TRUE(next.get().second);
+}
@@ -0,0 +1,346 @@
+#include <gtest/gtest.h>
+
+#include "lock.h"
+#include "locktable.h"
+
+/*
+ ********************************
+ * GET
+ ********************************
+ */
+
+TEST(LockTableTest, getWhenTableEmpty) {
+  LockTable* lockTable = newLockTable(10);
+  EXPECT_EQ(get(lockTable, 102), nullptr);
+};
+
+TEST(LockTableTest, getKeyExists) {
+  LockTable* lockTable = newLockTable(10);
+  Lock lock = Lock();
+  lock.exclusive = true;
+  lock.num_owners = 1;
+
+  set(lockTable, 12, newLock());
+  set(lockTable, 22, newLock());
+  set(lockTable, 32, &lock);
+  set(lockTable, 42, newLock());
+
+  Lock* value = get(lockTable, 32);
+  EXPECT_EQ(value->exclusive, lock.exclusive);
+  EXPECT_EQ(value->num_owners, lock.num_owners);
+};
+
+TEST(LockTableTest, getElementNotFound) {
+  LockTable* lockTable = newLockTable(10);
+
+  set(lockTable, 12, newLock());
+  set(lockTable, 22, newLock());
+  set(lockTable, 42, newLock());
+
+  EXPECT_EQ(get(lockTable, 32), nullptr);
+};
+
+/*
+ ********************************
+ * SET
+ ********************************
+ */
+
+TEST(LockTableTest, setWhenKeyAlreadyExists) {
+  LockTable* lockTable = newLockTable(10);
+  Lock lock = Lock();
+  lock.exclusive = true;
+  lock.num_owners = 1;
+
+  Lock anotherLock = Lock();
+  anotherLock.exclusive = false;
+  anotherLock.num_owners = 2;
+
+  set(lockTable, 32, &lock);
+  // Because lock for that key already exists, it should ignore this set
+  // function call!
+  set(lockTable, 32, &anotherLock);
+
+  Lock* value = get(lockTable, 32);
+  EXPECT_EQ(value->exclusive, lock.exclusive);
+  EXPECT_EQ(value->num_owners, lock.num_owners);
+};
+
+TEST(LockTableTest, setOverflowsIntoNextBucket) {
+  LockTable* lockTable = newLockTable(4);
+
+  // All keys hash to bucket 1, which can hold only kLockTableSlotsPerBucket
+  int numKeys = kLockTableSlotsPerBucket + 2;
+  for (int i = 0; i < numKeys; i++) {
+    EXPECT_NE(set(lockTable, 1 + 4 * i, newLock()), nullptr);
+  }
+
+  EXPECT_EQ(lockTable->partitions[0].buckets[1].overflow, 2);
+  EXPECT_EQ(lockTable->partitions[0].buckets[2].occupied, 0b11);
+  for (int i = 0; i < numKeys; i++) {
+    EXPECT_TRUE(contains(lockTable, 1 + 4 * i));
+  }
+};
+
+/*
+ ********************************
+ * CONTAINS
+ ********************************
+ */
+
+TEST(LockTableTest, containsTableEmpty) {
+  LockTable* lockTable = newLockTable(10);
+  EXPECT_FALSE(contains(lockTable, 32));
+};
+
+TEST(LockTableTest, containsTrue) {
+  LockTable* lockTable = newLockTable(10);
+
+  set(lockTable, 12, newLock());
+  set(lockTable, 22, newLock());
+  set(lockTable, 42, newLock());
+
+  EXPECT_TRUE(contains(lockTable, 22));
+};
+
+TEST(LockTableTest, containsFalse) {
+  LockTable* lockTable = newLockTable(10);
+
+  set(lockTable, 12, newLock());
+  set(lockTable, 22, newLock());
+  set(lockTable, 42, newLock());
+
+  EXPECT_FALSE(contains(lockTable, 32));
+};
+
+/*
+ ********************************
+ * REMOVE
+ ********************************
+ */
+
+TEST(LockTableTest, removeEmptyTable) {
+  LockTable* lockTable = newLockTable(10);
+  // Nothing happens
+  remove(lockTable, 10);
+};
+
+TEST(LockTableTest, removeFromBucket) {
+  LockTable* lockTable = newLockTable(10);
+
+  set(lockTable, 12, newLock());
+  set(lockTable, 22, newLock());
+  set(lockTable, 32, newLock());
+
+  remove(lockTable, 22);
+
+  EXPECT_TRUE(contains(lockTable, 12));
+  EXPECT_FALSE(contains(lockTable, 22));
+  EXPECT_TRUE(contains(lockTable, 32));
+};
+
+TEST(LockTableTest, removeElementNotFound) {
+  LockTable* lockTable = newLockTable(10);
+
+  set(lockTable, 12, newLock());
+  set(lockTable, 22, newLock());
+
+  remove(lockTable, 32);
+
+  EXPECT_TRUE(contains(lockTable, 12));
+  EXPECT_TRUE(contains(lockTable, 22));
+  EXPECT_FALSE(contains(lockTable, 32));
+};
+
+TEST(LockTableTest, removeOverflowedKey) {
+  LockTable* lockTable = newLockTable(4);
+
+  int numKeys = kLockTableSlotsPerBucket + 1;
+  for (int i = 0; i < numKeys; i++) {
+    set(lockTable, 1 + 4 * i, newLock());
+  }
+  EXPECT_EQ(lockTable->partitions[0].buckets[1].overflow, 1);
+
+  // Removing the key that was placed in the next bucket resets the overflow
+  remove(lockTable, 1 + 4 * (numKeys - 1));
+  EXPECT_EQ(lockTable->partitions[0].buckets[1].overflow, 0);
+  EXPECT_EQ(lockTable->partitions[0].buckets[2].occupied, 0);
+};
+
+TEST(LockTableTest, freedSlotIsReused) {
+  LockTable* lockTable = newLockTable(4);
+
+  int numKeys = kLockTableSlotsPerBucket + 1;
+  for (int i = 0; i < numKeys; i++) {
+    set(lockTable, 1 + 4 * i, newLock());
+  }
+
+  // The overflowed key is still found after a slot in its home bucket is freed
+  remove(lockTable, 1);
+  EXPECT_TRUE(contains(lockTable, 1 + 4 * (numKeys - 1)));
+
+  // A new key takes the freed slot in its home bucket
+  set(lockTable, 1, newLock());
+  EXPECT_EQ(lockTable->partitions[0].buckets[1].keys[0], 1);
+  EXPECT_EQ(lockTable->partitions[0].buckets[1].overflow, 1);
+};
+
+/*
+ ********************************
+ * MODIFYING POINTERS
+ ********************************
+ */
+
+TEST(LockTableTest, changeValue) {
+  LockTable* lockTable = newLockTable(10);
+
+  set(lockTable, 12, newLock());
+  Lock* lock = set(lockTable, 32, newLock());
+
+  // Change some values on the lock pointer
+  lock->num_owners = 2;
+  lock->exclusive = true;
+
+  // Check that the values also changed within the table
+  Lock* value = get(lockTable, 32);
+  EXPECT_EQ(value->num_owners, 2);
+  EXPECT_EQ(value->exclusive, true);
+};
+
+/*
+ ********************************
+ * PARTITIONS
+ ********************************
+ */
+
+TEST(LockTableTest, partitionsAreContiguous) {
+  LockTable* lockTable = newLockTable(10, 3);
+
+  EXPECT_EQ(getPartition(lockTable, 0), 0);
+  EXPECT_EQ(getPartition(lockTable, 3), 0);
+  EXPECT_EQ(getPartition(lockTable, 4), 1);
+  EXPECT_EQ(getPartition(lockTable, 6), 1);
+  EXPECT_EQ(getPartition(lockTable, 7), 2);
+  EXPECT_EQ(getPartition(lockTable, 19), 2);
+
+  // Row IDs beyond the range of int map like any other row ID
+  EXPECT_EQ(getPartition(lockTable, 4294967295u), 1);
+
+  // Every partition starts with an equal share of the buckets
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(lockTable->partitions[i].size, 4);
+  }
+};
+
+TEST(LockTableTest, partitionsResizeIndependently) {
+  LockTable* lockTable = newLockTable(10, 3);
+
+  // Fill partition 1, which is responsible for 4..6, 14..16, a.s.o.
+  for (int i = 0; i < 100; i++) {
+    set(lockTable, 4 + 10 * i, newLock());
+  }
+
+  EXPECT_GT(lockTable->partitions[1].size, 4);
+  EXPECT_EQ(lockTable->partitions[0].size, 4);
+  EXPECT_EQ(lockTable->partitions[2].size, 4);
+
+  // Rows stay in their partition, no matter how big it is
+  EXPECT_EQ(getPartition(lockTable, 4), 1);
+  EXPECT_EQ(getPartition(lockTable, 994), 1);
+};
+
+/*
+ ********************************
+ * RESIZING
+ ********************************
+ */
+
+TEST(LockTableTest, partitionGrowsWhenLoadFactorIsExceeded) {
+  LockTable* lockTable = newLockTable(2);
+  LockTablePartition* partition = &lockTable->partitions[0];
+
+  int maxLocks = 2 * kLockTableSlotsPerBucket * kLockTableMaxLoadFactor;
+  for (int i = 0; i <= maxLocks; i++) {
+    set(lockTable, i, newLock());
+  }
+
+  // The new bucket array is allocated, but the locks are still in the old one
+  EXPECT_TRUE(isRehashing(partition));
+  EXPECT_EQ(partition->size, 4);
+  EXPECT_EQ(partition->old_size, 2);
+  for (int i = 0; i <= maxLocks; i++) {
+    EXPECT_TRUE(contains(lockTable, i));
+  }
+};
+
+TEST(LockTableTest, rehashingMigratesLocksIncrementally) {
+  LockTable* lockTable = newLockTable(8);
+  LockTablePartition* partition = &lockTable->partitions[0];
+
+  int numLocks = 8 * kLockTableSlotsPerBucket * kLockTableMaxLoadFactor + 1;
+  for (int i = 0; i < numLocks; i++) {
+    Lock* lock = set(lockTable, i, newLock());
+    lock->num_owners = 1;
+    lock->owners[0] = i;
+  }
+  ASSERT_TRUE(isRehashing(partition));
+
+  // Each operation migrates the locks of kLockTableRehashStep old buckets
+  int operations = 0;
+  while (isRehashing(partition)) {
+    EXPECT_EQ(partition->rehash_index, operations * kLockTableRehashStep);
+    remove(lockTable, numLocks);  // any operation on the partition
+    operations++;
+  }
+  EXPECT_EQ(operations, 8 / kLockTableRehashStep);
+
+  // The locks are in the new bucket array and kept their state
+  EXPECT_EQ(partition->size, 16);
+  EXPECT_EQ(partition->num_locks, numLocks);
+  for (int i = 0; i < numLocks; i++) {
+    Lock* lock = get(lockTable, i);
+    ASSERT_NE(lock, nullptr);
+    EXPECT_EQ(lock->num_owners, 1);
+    EXPECT_EQ(lock->owners[0], i);
+  }
+};
+
+TEST(LockTableTest, removeWhileRehashing) {
+  LockTable* lockTable = newLockTable(8);
+  LockTablePartition* partition = &lockTable->partitions[0];
+
+  int numLocks = 8 * kLockTableSlotsPerBucket * kLockTableMaxLoadFactor + 1;
+  for (int i = 0; i < numLocks; i++) {
+    set(lockTable, i, newLock());
+  }
+  ASSERT_TRUE(isRehashing(partition));
+
+  // Removes keys from the old as well as the new bucket array
+  for (int i = 0; i < numLocks; i += 2) {
+    remove(lockTable, i);
+  }
+  for (int i = 0; i < numLocks; i++) {
+    EXPECT_EQ(contains(lockTable, i), i % 2 == 1);
+  }
+};
+
+TEST(LockTableTest, partitionShrinksToInitialSize) {
+  LockTable* lockTable = newLockTable(2);
+  LockTablePartition* partition = &lockTable->partitions[0];
+
+  for (int i = 0; i < 100; i++) {
+    set(lockTable, i, newLock());
+  }
+  EXPECT_GT(partition->size, 2);
+
+  for (int i = 1; i < 100; i++) {
+    remove(lockTable, i);
+  }
+  while (isRehashing(partition)) {
+    remove(lockTable, 100);
+  }
+
+  EXPECT_EQ(partition->size, 2);
+  EXPECT_EQ(partition->num_locks, 1);
+  EXPECT_TRUE(contains(lockTable, 0));
+};
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "partitionmap.h"
+
+/**
+ * Dispatches lock requests to a partition and lets the worker threads execute
+ * them right away.
+ */
+void executeRequests(PartitionMap* map, int partition, int count) {
+  for (int i = 0; i < count; i++) {
+    routeRequest(map, partition);
+    finishRequest(map, partition);
+  }
+}
+
+/*
+ ********************************
+ * ASSIGNMENT
+ ********************************
+ */
+
+TEST(PartitionMapTest, partitionsStartRoundRobin) {
+  PartitionMap* map = newPartitionMap(8, 3, true);
+
+  for (int i = 0; i < 8; i++) {
+    EXPECT_EQ(map->partitions[i].owner, i % 3);
+    EXPECT_EQ(getHomeWorker(i, 3), i % 3);
+    EXPECT_EQ(routeRequest(map, i), i % 3);
+  }
+  freePartitionMap(map);
+}
+
+TEST(PartitionMapTest, evenLoadKeepsPartitions) {
+  PartitionMap* map = newPartitionMap(8, 4, true);
+
+  for (int i = 0; i < 4 * kRebalanceInterval; i++) {
+    executeRequests(map, i % 8, 1);
+  }
+  for (int i = 0; i < 8; i++) {
+    EXPECT_EQ(map->partitions[i].owner, i % 4);
+  }
+  freePartitionMap(map);
+}
+
+TEST(PartitionMapTest, withoutRebalancingPartitionsStay) {
+  PartitionMap* map = newPartitionMap(4, 2, false);
+
+  executeRequests(map, 0, 4 * kRebalanceInterval);
+  executeRequests(map, 2, 4 * kRebalanceInterval);
+  EXPECT_EQ(map->partitions[0].owner, 0);
+  EXPECT_EQ(map->partitions[2].owner, 0);
+  freePartitionMap(map);
+}
+
+/*
+ ********************************
+ * HANDOFF
+ ********************************
+ */
+
+TEST(PartitionMapTest, busiestWorkerHandsOverPartition) {
+  // Partitions 0 and 2 belong to worker 0, which gets all the load
+  PartitionMap* map = newPartitionMap(4, 2, false);
+  executeRequests(map, 0, 100);
+  executeRequests(map, 2, 100);
+
+  EXPECT_TRUE(rebalance(map));
+  int moved = map->partitions[0].owner == 1 ? 0 : 2;
+  int kept = moved == 0 ? 2 : 0;
+  EXPECT_EQ(map->partitions[moved].owner, 1);
+  EXPECT_EQ(map->partitions[kept].owner, 0);
+  EXPECT_EQ(routeRequest(map, moved), 1);
+  freePartitionMap(map);
+}
+
+TEST(PartitionMapTest, hotPartitionIsNotMovedAlone) {
+  // Moving the only loaded partition would just move the imbalance
+  PartitionMap* map = newPartitionMap(4, 2, false);
+  executeRequests(map, 0, 100);
+
+  EXPECT_FALSE(rebalance(map));
+  EXPECT_EQ(map->partitions[0].owner, 0);
+  freePartitionMap(map);
+}
+
+TEST(PartitionMapTest, newOwnerWaitsForPreviousOwner) {
+  PartitionMap* map = newPartitionMap(4, 2, false);
+  executeRequests(map, 0, 100);
+  executeRequests(map, 2, 100);
+
+  // Worker 0 still has requests of the partition queued
+  routeRequest(map, 0);
+  routeRequest(map, 2);
+  ASSERT_TRUE(rebalance(map));
+  int moved = map->partitions[0].owner == 1 ? 0 : 2;
+
+  EXPECT_FALSE(mayExecute(map, moved, 1));
+  EXPECT_TRUE(mayExecute(map, moved, 0));
+
+  // After the previous owner executed them, the new owner takes over
+  finishRequest(map, moved);
+  EXPECT_TRUE(mayExecute(map, moved, 1));
+  freePartitionMap(map);
+}
+
+TEST(PartitionMapTest, onlyOneHandoffAtATime) {
+  PartitionMap* map = newPartitionMap(6, 3, false);
+  executeRequests(map, 0, 100);
+  executeRequests(map, 3, 100);
+  executeRequests(map, 1, 100);
+  executeRequests(map, 4, 100);
+
+  // Worker 0 and 1 are both busier than worker 2
+  routeRequest(map, 0);
+  routeRequest(map, 3);
+  ASSERT_TRUE(rebalance(map));
+  int moved = map->partitions[0].owner == 2 ? 0 : 3;
+  executeRequests(map, 1, 100);
+  executeRequests(map, 4, 100);
+  EXPECT_FALSE(rebalance(map));
+
+  finishRequest(map, moved);
+  EXPECT_TRUE(rebalance(map));
+  freePartitionMap(map);
+}
+
+TEST(PartitionMapTest, skewedLoadIsBalanced) {
+  const int kWorkers = 4;
+  const int kPartitions = kWorkers * kPartitionsPerWorker;
+  PartitionMap* map = newPartitionMap(kPartitions, kWorkers, true);
+
+  // The first quarter of the partitions gets all requests, like row IDs
+  // clustered at the beginning of the key range, with partition 0 the hottest
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < kPartitions / 4; i++) {
+      executeRequests(map, i, i == 0 ? 64 : 16);
+    }
+  }
+
+  std::vector<unsigned long> loads(kWorkers, 0);
+  for (int i = 0; i < kPartitions; i++) {
+    loads[map->partitions[i].owner] += map->partitions[i].load;
+  }
+  unsigned long total = 0;
+  for (unsigned long load : loads) {
+    total += load;
+  }
+  for (unsigned long load : loads) {
+    EXPECT_LT(load, total / kWorkers * 5 / 4);
+    EXPECT_GT(load, total / kWorkers * 3 / 4);
+  }
+  freePartitionMap(map);
+}
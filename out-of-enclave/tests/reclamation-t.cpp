@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include "reclaimer.h"
+#include "reclamation.h"
+
+/*
+ ********************************
+ * RECLAMATION RING
+ ********************************
+ */
+
+TEST(ReclamationTest, ringIsFirstInFirstOut) {
+  Reclamation* reclamation = newReclamation(1);
+  ReclamationRing* ring = &reclamation->rings[0];
+  LockBucket first[2];
+  LockBucket second[4];
+
+  EXPECT_TRUE(pushRetired(ring, first, 2));
+  EXPECT_TRUE(pushRetired(ring, second, 4));
+
+  RetiredBuckets retired;
+  ASSERT_TRUE(popRetired(ring, &retired));
+  EXPECT_EQ(retired.buckets, first);
+  EXPECT_EQ(retired.size, 2);
+  ASSERT_TRUE(popRetired(ring, &retired));
+  EXPECT_EQ(retired.buckets, second);
+  EXPECT_EQ(retired.size, 4);
+  EXPECT_FALSE(popRetired(ring, &retired));
+  freeReclamation(reclamation);
+}
+
+TEST(ReclamationTest, pushFailsWhenRingIsFull) {
+  Reclamation* reclamation = newReclamation(1);
+  ReclamationRing* ring = &reclamation->rings[0];
+  LockBucket buckets[1];
+
+  for (int i = 0; i < kReclamationRingSize; i++) {
+    EXPECT_TRUE(pushRetired(ring, buckets, 1));
+  }
+  EXPECT_FALSE(pushRetired(ring, buckets, 1));
+
+  // Emptying a slot makes room for the next one
+  RetiredBuckets retired;
+  ASSERT_TRUE(popRetired(ring, &retired));
+  EXPECT_TRUE(pushRetired(ring, buckets, 1));
+  freeReclamation(reclamation);
+}
+
+/*
+ ********************************
+ * EPOCHS
+ ********************************
+ */
+
+TEST(ReclamationTest, epochGuardAnnouncesEpoch) {
+  Reclamation* reclamation = newReclamation(1);
+  reclamation->epoch = 7;
+  {
+    EpochGuard guard(reclamation, &reclamation->rings[0]);
+    EXPECT_EQ(reclamation->rings[0].active_epoch, 7);
+  }
+  EXPECT_EQ(reclamation->rings[0].active_epoch, kIdleEpoch);
+  freeReclamation(reclamation);
+}
+
+TEST(ReclamationTest, noRecyclingWhileOlderOperationRuns) {
+  Reclamation* reclamation = newReclamation(2);
+  LockBucketPool pool;
+  LockBucketReclaimer reclaimer(reclamation, pool);
+
+  // Worker 1 might still read the array, which worker 0 hands back
+  enterEpoch(reclamation, &reclamation->rings[1]);
+  LockBucket* buckets = pool.allocate(4);
+  ASSERT_TRUE(pushRetired(&reclamation->rings[0], buckets, 4));
+  reclaimer.reclaim();
+  EXPECT_EQ(reclaimer.num_retired(), 1);
+
+  // Operations starting after the array was collected cannot see it
+  exitEpoch(&reclamation->rings[1]);
+  enterEpoch(reclamation, &reclamation->rings[1]);
+  reclaimer.reclaim();
+  EXPECT_EQ(reclaimer.num_retired(), 0);
+  EXPECT_EQ(pool.allocate(4), buckets);
+  exitEpoch(&reclamation->rings[1]);
+
+  pool.free(buckets, 4);
+  freeReclamation(reclamation);
+}
+
+TEST(ReclamationTest, retireWithoutRing) {
+  Reclamation* reclamation = newReclamation(1);
+  LockBucketPool pool;
+  LockBucketReclaimer reclaimer(reclamation, pool);
+
+  enterEpoch(reclamation, &reclamation->rings[0]);
+  LockBucket* buckets = pool.allocate(4);
+  reclaimer.retire(buckets, 4);
+  reclaimer.reclaim();
+  EXPECT_EQ(reclaimer.num_retired(), 1);
+
+  exitEpoch(&reclamation->rings[0]);
+  reclaimer.reclaim();
+  EXPECT_EQ(reclaimer.num_retired(), 0);
+  freeReclamation(reclamation);
+}
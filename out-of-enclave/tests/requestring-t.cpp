@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <climits>
+
+#include "requestring.h"
+
+/*
+ ********************************
+ * REQUESTS AND RESPONSES
+ ********************************
+ */
+
+TEST(RequestRingTest, requestsAreFirstInFirstOut) {
+  RequestRings* rings = newRequestRings(1);
+  RequestRing* ring = &rings->rings[0];
+
+  EXPECT_TRUE(pushRequest(ring, RingRequest{SHARED, 1, 2, 0, 1, 10}));
+  EXPECT_TRUE(pushRequest(ring, RingRequest{REGISTER, 3, 0, 5, 0, 0}));
+
+  RingRequest request;
+  ASSERT_TRUE(popRequest(ring, &request));
+  EXPECT_EQ(request.command, SHARED);
+  EXPECT_EQ(request.transaction_id, 1);
+  EXPECT_EQ(request.row_id, 2);
+  EXPECT_EQ(request.tag, 10);
+  ASSERT_TRUE(popRequest(ring, &request));
+  EXPECT_EQ(request.command, REGISTER);
+  EXPECT_EQ(request.lock_budget, 5);
+  EXPECT_FALSE(popRequest(ring, &request));
+  freeRequestRings(rings);
+}
+
+TEST(RequestRingTest, pushFailsWhenRingIsFull) {
+  RequestRings* rings = newRequestRings(1);
+  RequestRing* ring = &rings->rings[0];
+  RingRequest request = {UNLOCK, 1, 1, 0, 0, 0};
+
+  for (int i = 0; i < kRequestRingSize; i++) {
+    EXPECT_TRUE(pushRequest(ring, request));
+  }
+  EXPECT_FALSE(pushRequest(ring, request));
+
+  // Copying a request out makes room for the next one
+  ASSERT_TRUE(popRequest(ring, &request));
+  EXPECT_TRUE(pushRequest(ring, request));
+  freeRequestRings(rings);
+}
+
+TEST(RequestRingTest, popIgnoresCorruptedHead) {
+  RequestRings* rings = newRequestRings(1);
+  RequestRing* ring = &rings->rings[0];
+
+  ring->request_head = kRequestRingSize + 1;
+  RingRequest request;
+  EXPECT_FALSE(popRequest(ring, &request));
+  EXPECT_EQ(ring->request_tail, 0);
+  freeRequestRings(rings);
+}
+
+TEST(RequestRingTest, responsesAreFirstInFirstOut) {
+  RequestRings* rings = newRequestRings(1);
+  RequestRing* ring = &rings->rings[0];
+
+  RingResponse response = RingResponse();
+  response.tag = 1;
+  EXPECT_TRUE(pushResponse(ring, response));
+  response.tag = 2;
+  response.error = 1;
+  EXPECT_TRUE(pushResponse(ring, response));
+
+  ASSERT_TRUE(popResponse(ring, &response));
+  EXPECT_EQ(response.tag, 1);
+  EXPECT_EQ(response.error, 0);
+  ASSERT_TRUE(popResponse(ring, &response));
+  EXPECT_EQ(response.tag, 2);
+  EXPECT_EQ(response.error, 1);
+  EXPECT_FALSE(popResponse(ring, &response));
+  freeRequestRings(rings);
+}
+
+// A fence is passed, once every request submitted before it was processed,
+// also when the counters wrap around
+TEST(RequestRingTest, fenceIsPassedOnceRequestsAreProcessed) {
+  RequestRings* rings = newRequestRings(1);
+  RequestRing* ring = &rings->rings[0];
+  ring->request_head = ring->request_tail = ring->request_done = UINT_MAX;
+  EXPECT_TRUE(isProcessedUpTo(ring, ring->request_head));
+
+  RingRequest request = {UNLOCK, 1, 1, 0, 0, 0};
+  EXPECT_TRUE(pushRequest(ring, request));
+  EXPECT_TRUE(pushRequest(ring, request));
+  unsigned int fence = ring->request_head;
+  EXPECT_FALSE(isProcessedUpTo(ring, fence));
+
+  ASSERT_TRUE(popRequest(ring, &request));
+  markRequestProcessed(ring);
+  ASSERT_TRUE(popRequest(ring, &request));
+  EXPECT_FALSE(isProcessedUpTo(ring, fence));
+  markRequestProcessed(ring);
+  EXPECT_TRUE(isProcessedUpTo(ring, fence));
+  freeRequestRings(rings);
+}
+
+/*
+ ********************************
+ * SLEEPING WORKER THREADS
+ ********************************
+ */
+
+TEST(RequestRingTest, sleepingWorkerIsWokenUpOnce) {
+  RequestRings* rings = newRequestRings(1);
+  RequestRing* ring = &rings->rings[0];
+
+  EXPECT_FALSE(needsWakeUp(ring));
+  ASSERT_TRUE(prepareToSleep(ring));
+  EXPECT_TRUE(pushRequest(ring, RingRequest{UNLOCK, 1, 1, 0, 0, 0}));
+  EXPECT_TRUE(needsWakeUp(ring));
+  EXPECT_FALSE(needsWakeUp(ring));
+  freeRequestRings(rings);
+}
+
+TEST(RequestRingTest, workerDoesNotSleepWithPendingRequest) {
+  RequestRings* rings = newRequestRings(1);
+  RequestRing* ring = &rings->rings[0];
+
+  EXPECT_TRUE(pushRequest(ring, RingRequest{UNLOCK, 1, 1, 0, 0, 0}));
+  EXPECT_FALSE(prepareToSleep(ring));
+  EXPECT_FALSE(needsWakeUp(ring));
+  freeRequestRings(rings);
+}
@@ -1,6 +1,14 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "asyncclient.h"
+#include "asyncserver.h"
+#include "client.h"
 #include "server.h"
 #include "spdlog/spdlog.h"
 
@@ -17,9 +25,11 @@ class ServerTest : public ::testing::Test {
     return status.ok();
   }
 
-  auto getSharedLock(LockingServiceImpl &server) -> bool {
+  auto getSharedLock(LockingServiceImpl &server, unsigned int lockBudget = 0)
+      -> bool {
     request_.set_transaction_id(transactionId_);
     request_.set_row_id(rowId_);
+    request_.set_lock_budget(lockBudget);
     request_.set_wait_for_signature(
         true);  // so that we can assert the return value
 
@@ -27,9 +37,11 @@ class ServerTest : public ::testing::Test {
     return status.ok();
   }
 
-  auto getExclusiveLock(LockingServiceImpl &server) -> bool {
+  auto getExclusiveLock(LockingServiceImpl &server,
+                        unsigned int lockBudget = 0) -> bool {
     request_.set_transaction_id(transactionId_);
     request_.set_row_id(rowId_);
+    request_.set_lock_budget(lockBudget);
     request_.set_wait_for_signature(
         true);  // so that we can assert the return value
 
@@ -90,6 +102,231 @@ TEST_F(ServerTest, lockBudget) {
   EXPECT_FALSE(getSharedLock(server));
 };
 
+// A lock request with a lock budget registers the transaction
+TEST_F(ServerTest, registerWithLockRequest) {
+  LockingServiceImpl server;
+  EXPECT_TRUE(getExclusiveLock(server, 1));
+  EXPECT_FALSE(registerTransaction(server));
+  rowId_++;
+  EXPECT_FALSE(getSharedLock(server, 1));  // the lock budget is used up
+};
+
+// Lock requests, which do not wait for their signatures, get a ticket and the
+// transaction collects their results at once
+TEST_F(ServerTest, collectSignatures) {
+  LockingServiceImpl server;
+  EXPECT_TRUE(registerTransaction(server));
+  request_.set_transaction_id(transactionId_);
+  request_.set_wait_for_signature(false);
+  std::vector<uint64_t> tickets;
+  for (unsigned int rowId = 1; rowId <= 3; rowId++) {
+    request_.set_row_id(rowId);
+    EXPECT_TRUE(server.LockExclusive(&context_, &request_, &response_).ok());
+    EXPECT_NE(response_.ticket(), 0);
+    tickets.push_back(response_.ticket());
+  }
+  request_.set_transaction_id(transactionId_ + 1);  // not registered
+  EXPECT_TRUE(server.LockShared(&context_, &request_, &response_).ok());
+
+  CollectRequest collect;
+  CollectResponse collected;
+  collect.set_transaction_id(transactionId_);
+  EXPECT_TRUE(server.CollectSignatures(&context_, &collect, &collected).ok());
+  ASSERT_EQ(collected.results_size(), 3);
+  for (int i = 0; i < 3; i++) {
+    const CollectResponse::Result& result = collected.results(i);
+    EXPECT_EQ(result.ticket(), tickets[i]);
+    EXPECT_EQ(result.row_id(), i + 1);
+    EXPECT_TRUE(result.exclusive());
+    EXPECT_TRUE(result.ok());
+    EXPECT_FALSE(result.signature().empty());
+  }
+
+  // Every result is handed out once
+  collected.Clear();
+  EXPECT_TRUE(server.CollectSignatures(&context_, &collect, &collected).ok());
+  EXPECT_EQ(collected.results_size(), 0);
+
+  collect.set_transaction_id(transactionId_ + 1);
+  EXPECT_TRUE(server.CollectSignatures(&context_, &collect, &collected).ok());
+  ASSERT_EQ(collected.results_size(), 1);
+  EXPECT_FALSE(collected.results(0).ok());
+}
+
+// A transaction acquires and releases several locks with one RPC each
+TEST_F(ServerTest, lockBatch) {
+  LockingServiceImpl server;
+  LockBatchRequest locks;
+  LockBatchResponse acquired;
+  locks.set_transaction_id(transactionId_);
+  locks.set_lock_budget(10);
+  for (unsigned int rowId = 1; rowId <= 3; rowId++) {
+    LockBatchRequest::Lock* lock = locks.add_locks();
+    lock->set_row_id(rowId);
+    lock->set_exclusive(rowId == 2);
+  }
+  EXPECT_TRUE(server.LockBatch(&context_, &locks, &acquired).ok());
+  ASSERT_EQ(acquired.results_size(), 3);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(acquired.results(i).row_id(), i + 1);
+    EXPECT_TRUE(acquired.results(i).ok());
+    EXPECT_FALSE(acquired.results(i).signature().empty());
+  }
+
+  UnlockBatchRequest unlocks;
+  UnlockBatchResponse released;
+  unlocks.set_transaction_id(transactionId_);
+  unlocks.add_row_ids(2);
+  unlocks.add_row_ids(4);  // not locked
+  EXPECT_TRUE(server.UnlockBatch(&context_, &unlocks, &released).ok());
+  ASSERT_EQ(released.released_size(), 2);
+  EXPECT_TRUE(released.released(0));
+  EXPECT_FALSE(released.released(1));
+}
+
+// Commit and Abort release all locks of a transaction with a single RPC
+TEST_F(ServerTest, commitAndAbort) {
+  LockingServiceImpl server;
+  EndTransactionRequest end;
+  EndTransactionResponse ended;
+  end.set_transaction_id(transactionId_);
+  for (int i = 0; i < 2; i++) {
+    LockBatchRequest locks;
+    LockBatchResponse acquired;
+    locks.set_transaction_id(transactionId_);
+    locks.set_lock_budget(10);
+    for (unsigned int rowId = 1; rowId <= 3; rowId++) {
+      LockBatchRequest::Lock* lock = locks.add_locks();
+      lock->set_row_id(rowId);
+      lock->set_exclusive(true);
+    }
+    EXPECT_TRUE(server.LockBatch(&context_, &locks, &acquired).ok());
+    for (const auto& result : acquired.results()) {
+      EXPECT_TRUE(result.ok());
+    }
+
+    // The transaction is gone afterwards
+    Status status = i == 0 ? server.Commit(&context_, &end, &ended)
+                           : server.Abort(&context_, &end, &ended);
+    EXPECT_TRUE(status.ok());
+    EXPECT_FALSE(server.Commit(&context_, &end, &ended).ok());
+  }
+}
+
+// A transaction streams its requests over a session, which releases its locks
+TEST_F(ServerTest, transactionSession) {
+  LockingServiceImpl service;
+  ServerBuilder builder;
+  int port = 0;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(),
+                           &port);
+  builder.RegisterService(&service);
+  std::unique_ptr<Server> server(builder.BuildAndStart());
+  ASSERT_NE(port, 0);
+  LockingServiceClient client(grpc::CreateChannel(
+      "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+
+  auto session = client.openSession(transactionId_, 10);
+  std::vector<uint64_t> requestIds;
+  for (unsigned int rowId = 1; rowId <= 3; rowId++) {
+    requestIds.push_back(session->requestLock(rowId, rowId == 2));
+  }
+  requestIds.push_back(session->requestUnlock(4));  // not locked
+
+  // The responses can arrive in any order
+  std::vector<SessionResponse> responses(requestIds.size());
+  for (size_t i = 0; i < requestIds.size(); i++) {
+    SessionResponse response;
+    ASSERT_TRUE(session->readResponse(&response));
+    ASSERT_GE(response.request_id(), 1);
+    ASSERT_LE(response.request_id(), requestIds.size());
+    responses[response.request_id() - 1] = response;
+  }
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(responses[i].ok());
+    EXPECT_FALSE(responses[i].signature().empty());
+  }
+  EXPECT_FALSE(responses[3].ok());
+  EXPECT_TRUE(session->finish(true));
+
+  // The locks were released, when the session ended
+  auto other = client.openSession(transactionId_ + 1, 10);
+  other->requestLock(2, true);
+  SessionResponse response;
+  ASSERT_TRUE(other->readResponse(&response));
+  EXPECT_TRUE(response.ok());
+  EXPECT_TRUE(other->finish(false));
+  server->Shutdown();
+}
+
+// Lock and unlock requests are served by completion queues, while the other
+// RPCs stay synchronous
+TEST_F(ServerTest, asyncServer) {
+  AsyncLockingServiceImpl service(2);
+  ServerBuilder builder;
+  int port = 0;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(),
+                           &port);
+  ASSERT_NE(service.start(builder), nullptr);
+  LockingServiceClient client(grpc::CreateChannel(
+      "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+
+  EXPECT_TRUE(client.registerTransaction(transactionId_, 100));
+  for (unsigned int rowId = 1; rowId <= 50; rowId++) {
+    EXPECT_FALSE(
+        client.requestSharedLock(transactionId_, rowId, true).empty());
+  }
+  EXPECT_TRUE(
+      client.requestExclusiveLock(transactionId_ + 1, 1, true, 10).empty());
+  for (unsigned int rowId = 1; rowId <= 50; rowId++) {
+    EXPECT_TRUE(client.requestUnlock(transactionId_, rowId, true));
+  }
+  EXPECT_FALSE(
+      client.requestExclusiveLock(transactionId_ + 2, 1, true, 10).empty());
+
+  // Results of requests, that do not wait, are still collected
+  client.requestSharedLock(transactionId_ + 3, 2, false, 10);
+  auto results = client.collectSignatures(transactionId_ + 3);
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_TRUE(results[0].ok());
+  service.shutdown();
+}
+
+// A client keeps many requests in flight and releases the locks on commit
+TEST_F(ServerTest, asyncClient) {
+  AsyncLockingServiceImpl service;
+  ServerBuilder builder;
+  int port = 0;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(),
+                           &port);
+  ASSERT_NE(service.start(builder), nullptr);
+  auto channel = grpc::CreateChannel("localhost:" + std::to_string(port),
+                                     grpc::InsecureChannelCredentials());
+  AsyncLockingServiceClient client(channel, 8);
+
+  std::vector<std::future<std::pair<std::string, bool>>> grants;
+  for (unsigned int rowId = 1; rowId <= 100; rowId++) {
+    grants.push_back(client.requestExclusiveLock(transactionId_, rowId, 100));
+    EXPECT_LE(client.inFlight(), 8);
+  }
+  for (auto& grant : grants) {
+    auto [signature, ok] = grant.get();
+    EXPECT_TRUE(ok);
+    EXPECT_FALSE(signature.empty());
+  }
+  EXPECT_TRUE(client.requestUnlock(transactionId_, 1).get());
+  EXPECT_TRUE(client.commit(transactionId_).get());
+
+  // Every lock was released
+  LockingServiceClient other(channel);
+  for (unsigned int rowId = 1; rowId <= 100; rowId++) {
+    EXPECT_FALSE(
+        other.requestExclusiveLock(transactionId_ + 1, rowId, true, 100)
+            .empty());
+  }
+  service.shutdown();
+}
+
 // Simple request for exclusive access
 TEST_F(ServerTest, exclusiveAccess) {
   LockingServiceImpl server;
@@ -151,4 +388,24 @@ TEST_F(ServerTest, noExclusiveWhileShared) {
   EXPECT_TRUE(getSharedLock(server));
   transactionId_++;
   EXPECT_FALSE(getExclusiveLock(server));
-};
\ No newline at end of file
+};
+// The signature store keeps a bounded number of results for a limited time
+TEST(SignatureStoreTest, boundedAndTimeLimited) {
+  spdlog::set_level(spdlog::level::off);
+  LockManager lockManager;
+  SignatureStore store(2, std::chrono::milliseconds(50));
+  EXPECT_TRUE(lockManager.registerTransaction(1, 10));
+
+  JobFuture first = lockManager.lockAsync(1, 1, false);
+  JobFuture second = lockManager.lockAsync(1, 2, false);
+  JobFuture third = lockManager.lockAsync(1, 3, false);
+  EXPECT_EQ(store.add(1, 1, false, first), 1);
+  EXPECT_EQ(store.add(1, 2, false, second), 2);
+  EXPECT_EQ(store.add(1, 3, false, third), 0);  // full
+  EXPECT_TRUE(third.get().second);
+  EXPECT_EQ(store.size(), 2);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(store.collect(1).empty());
+  EXPECT_EQ(store.size(), 0);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "slab.h"
+
+/*
+ ********************************
+ * SLAB POOL
+ ********************************
+ */
+
+TEST(SlabPoolTest, allocateDistinctObjects) {
+  SlabPool pool(sizeof(long), 4);
+  std::set<void*> objects;
+  for (int i = 0; i < 10; i++) {
+    objects.insert(pool.allocate());
+  }
+
+  EXPECT_EQ(objects.size(), 10);
+  EXPECT_EQ(pool.capacity(), 12);  // three slabs of four objects
+}
+
+TEST(SlabPoolTest, freedObjectIsReused) {
+  SlabPool pool(sizeof(long), 4);
+  void* object = pool.allocate();
+  pool.free(object);
+
+  EXPECT_EQ(pool.allocate(), object);
+}
+
+TEST(SlabPoolTest, capacityStaysFlatUnderSteadyWorkload) {
+  SlabPool pool(100, 8);
+  for (int round = 0; round < 1000; round++) {
+    void* objects[8];
+    for (void*& object : objects) {
+      object = pool.allocate();
+    }
+    for (void* object : objects) {
+      pool.free(object);
+    }
+  }
+
+  EXPECT_EQ(pool.capacity(), 8);
+}
+
+TEST(SlabPoolTest, concurrentThreadsGetDistinctObjects) {
+  SlabPool pool(sizeof(long), 4);
+  std::mutex mut;
+  std::set<void*> objects;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&pool, &mut, &objects]() {
+      // Every thread keeps reusing the objects of its own shard
+      for (int round = 0; round < 100; round++) {
+        void* object = pool.allocate();
+        pool.free(object);
+      }
+      void* kept[4];
+      for (void*& object : kept) {
+        object = pool.allocate();
+      }
+      std::lock_guard<std::mutex> lock(mut);
+      objects.insert(std::begin(kept), std::end(kept));
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(objects.size(), 16);
+  EXPECT_EQ(pool.capacity(), 16);  // one slab for each thread
+}
+
+/*
+ ********************************
+ * LOCK BUCKET POOL
+ ********************************
+ */
+
+TEST(LockBucketPoolTest, allocateEmptyBuckets) {
+  LockBucketPool pool;
+  LockBucket* buckets = pool.allocate(4);
+  buckets[1].occupied = 0b1;
+  buckets[1].keys[0] = 42;
+  pool.free(buckets, 4);
+
+  // The same array is handed out again, but without its old contents
+  LockBucket* reused = pool.allocate(4);
+  EXPECT_EQ(reused, buckets);
+  EXPECT_EQ(reused[1].occupied, 0);
+  EXPECT_EQ(reused[1].keys[0], 0);
+  EXPECT_EQ(pool.num_allocated(), 1);
+  delete[] reused;
+}
+
+TEST(LockBucketPoolTest, sizesAreKeptApart) {
+  LockBucketPool pool;
+  LockBucket* buckets = pool.allocate(4);
+  pool.free(buckets, 4);
+
+  LockBucket* bigger = pool.allocate(8);
+  EXPECT_NE(bigger, buckets);
+  EXPECT_EQ(pool.num_allocated(), 2);
+  pool.free(bigger, 8);
+}
+
+TEST(LockBucketPoolTest, reserveAvoidsLaterAllocations) {
+  LockBucketPool pool;
+  pool.reserve(4, 2);
+  EXPECT_EQ(pool.num_allocated(), 2);
+
+  LockBucket* first = pool.allocate(4);
+  LockBucket* second = pool.allocate(4);
+  EXPECT_EQ(pool.num_allocated(), 2);
+  pool.free(first, 4);
+  pool.free(second, 4);
+}
@@ -3,9 +3,10 @@
 #include <atomic>
 #include <functional>
 #include <thread>
+#include <vector>
 
-#include "hashtable.h"
 #include "lock.h"
+#include "locktable.h"
 #include "transaction.h"
 
 class TransactionTest : public ::testing::Test {
@@ -14,12 +15,13 @@ class TransactionTest : public ::testing::Test {
     lock_ = newLock();
     transactionA_ = newTransaction(kTransactionIdA_, kLockBudget_);
     transactionB_ = newTransaction(kTransactionIdB_, kLockBudget_);
-    lockTable_ = newHashTable(100);
+    lockTable_ = newLockTable(100);
   };
 
   void TearDown() override {
-    delete transactionA_;
-    delete transactionB_;
+    freeTransaction(transactionA_);
+    freeTransaction(transactionB_);
+    freeLockTable(lockTable_);
   }
 
   const unsigned int kTransactionIdA_ = 0;
@@ -29,13 +31,12 @@ class TransactionTest : public ::testing::Test {
   Lock* lock_;
   Transaction* transactionA_;
   Transaction* transactionB_;
-  HashTable* lockTable_;
+  LockTable* lockTable_;
 
  public:
   void acquireLock(Transaction* transaction, unsigned int rowId) {
-    auto lock = newLock();
-    getSharedAccess(lock, transaction->transaction_id);
-    set(lockTable_, rowId, (void*)lock);
+    Lock emptyLock = Lock();
+    auto lock = set(lockTable_, rowId, &emptyLock);
     addLock(transaction, rowId, false, lock);
   };
 };
@@ -66,14 +67,13 @@ TEST_F(TransactionTest, noSharedOnExclusive) {
 // Enters shrinking phase after releasing a lock
 TEST_F(TransactionTest, entersShrinkingPhase) {
   EXPECT_TRUE(addLock(transactionA_, rowId_, false, lock_));
-  set(lockTable_, rowId_, (void*)lock_);
 
   auto locked_rows = transactionA_->locked_rows;
   EXPECT_EQ(transactionA_->num_locked, 1);
   EXPECT_EQ(locked_rows[0], rowId_);
   EXPECT_TRUE(transactionA_->growing_phase);
 
-  releaseLock(transactionA_, rowId_, lockTable_);
+  EXPECT_TRUE(releaseLock(transactionA_, rowId_, lock_));
 
   EXPECT_EQ(transactionA_->num_locked, 0);
   EXPECT_FALSE(transactionA_->growing_phase);
@@ -83,12 +83,10 @@ TEST_F(TransactionTest, entersShrinkingPhase) {
 TEST_F(TransactionTest, lockBudgetDecreases) {
   auto another_lock = newLock();
   addLock(transactionA_, rowId_, false, lock_);
-  set(lockTable_, rowId_, (void*)lock_);
   addLock(transactionA_, rowId_ + 1, true, another_lock);
-  set(lockTable_, rowId_ + 1, (void*)another_lock);
   EXPECT_EQ(transactionA_->lock_budget, kLockBudget_ - 2);
 
-  releaseLock(transactionA_, rowId_, lockTable_);
+  releaseLock(transactionA_, rowId_, lock_);
   EXPECT_EQ(transactionA_->lock_budget, kLockBudget_ - 2);
 };
 
@@ -121,4 +119,31 @@ TEST_F(TransactionTest, releasesAllLocks) {
 
   // Assert that the transaction holds no locks
   EXPECT_EQ(transactionA_->num_locked, 0);
-};
\ No newline at end of file
+};
+
+// Releasing all locks removes the unowned locks from the lock table
+TEST_F(TransactionTest, releaseAllLocksRemovesLocks) {
+  acquireLock(transactionA_, rowId_);
+  acquireLock(transactionA_, rowId_ + 1);
+  EXPECT_TRUE(contains(lockTable_, rowId_));
+
+  releaseAllLocks(transactionA_, lockTable_);
+
+  EXPECT_FALSE(contains(lockTable_, rowId_));
+  EXPECT_FALSE(contains(lockTable_, rowId_ + 1));
+};
+// Consecutive transaction IDs are spread evenly over the shards
+TEST(TransactionShardTest, spreadsTransactionsOverShards) {
+  const int kShards = 5;
+  std::vector<int> transactions(kShards, 0);
+  for (unsigned int transactionId = 0; transactionId < 100; transactionId++) {
+    int shard = getTransactionShard(transactionId, kShards);
+    ASSERT_GE(shard, 0);
+    ASSERT_LT(shard, kShards);
+    transactions[shard]++;
+  }
+  for (int count : transactions) {
+    EXPECT_EQ(count, 100 / kShards);
+  }
+  EXPECT_EQ(getTransactionShard(4294967295u, kShards), 4294967295u % kShards);
+};